@@ -23,6 +23,9 @@ Action::Action(const ComponentConfiguration& compConf) :
     FailureAware(compConf), compConf_(compConf), type_{compConf.parsedConfig().getString("type")} {}
 
 void Action::execute(message::Message msg) {
+    if (!readsMetadataOverlay()) {
+        msg.mergeMetadataOverlay();
+    }
     auto lmsg = msg.logMessage();
     withFailureHandling([&, msg = std::move(msg)]() mutable { executeImpl(std::move(msg)); },
                         [&, lmsg = std::move(lmsg)]() {
@@ -42,6 +45,10 @@ util::FailureHandlerResponse Action::handleFailure(util::OnActionError t, const
 
 void Action::matchedFields(message::match::MatchReduce& selectors) const {}
 
+bool Action::readsMetadataOverlay() const {
+    return false;
+}
+
 std::ostream& operator<<(std::ostream& os, const Action& a) {
     a.print(os);
     return os;
@@ -77,6 +77,10 @@ protected:
 private:
     virtual void executeImpl(message::Message msg) = 0;
 
+    // Actions reading metadata only through `MetadataOverlay` views receive keys set with `modifyMetadataOverlay`
+    // unmerged, for all other actions they are merged before `executeImpl` is called
+    virtual bool readsMetadataOverlay() const;
+
     virtual void print(std::ostream& os) const = 0;
 
     friend std::ostream& operator<<(std::ostream& os, const Action& a);
@@ -9,6 +9,13 @@ ActionStatistics::ActionStatistics() {}
 void ActionStatistics::report(std::ostream& out, const std::string& type, const char* indent) {
     std::string str = "    -- <" + type + "> timing";
     reportTime(out, str.c_str(), actionTiming_, indent);
+
+    if (const auto lookups = cacheHits_ + cacheMisses_; lookups > 0) {
+        reportCount(out, ("    -- <" + type + "> cache hits").c_str(), cacheHits_, indent);
+        reportCount(out, ("    -- <" + type + "> cache misses").c_str(), cacheMisses_, indent);
+        reportUnit(out, ("    -- <" + type + "> cache hit rate").c_str(), "%",
+                   100.0 * static_cast<double>(cacheHits_) / static_cast<double>(lookups), indent);
+    }
 }
 
 }  // namespace action
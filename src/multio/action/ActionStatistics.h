@@ -14,6 +14,10 @@ public:
 
     util::Timing<> actionTiming_;
 
+    // Lookups in caches owned by the action (e.g. prepared encoding headers), only reported if used
+    std::size_t cacheHits_ = 0;
+    std::size_t cacheMisses_ = 0;
+
     void report(std::ostream& out, const std::string& type = "Action", const char* indent = "");
 };
 
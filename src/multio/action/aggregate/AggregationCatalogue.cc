@@ -2,6 +2,7 @@
 #include "AggregationCatalogue.h"
 
 #include "multio/domain/Mappings.h"
+#include "multio/message/ValueStatistics.h"
 
 namespace multio::action {
 
@@ -34,11 +35,18 @@ void AggregationCatalogue::addNew(const message::Message& msg) {
         // The source of the message is the same as the destination - otherwise on serverside the source is depending on
         // the source of the first arriving although all multiple sources are combined on the servier (which is the
         // destination).
-        messageMap_.emplace(
-            msg.fieldId(),
-            message::Message{message::Message::Header{msg.header().tag(), msg.header().destination(),
-                                                      msg.header().destination(), msg.header().moveOrCopyMetadata()},
-                             eckit::Buffer{msg.globalSize() * sizeof(Precision)}});
+        auto& aggregated
+            = messageMap_
+                  .emplace(msg.fieldId(),
+                           message::Message{message::Message::Header{msg.header().tag(), msg.header().destination(),
+                                                                     msg.header().destination(),
+                                                                     msg.header().moveOrCopyMetadata()},
+                                            eckit::Buffer{msg.globalSize() * sizeof(Precision)}})
+                  .first->second;
+        // The metadata is the one of the first part, statistics of its values do not hold for the aggregated field
+        if (message::hasValueStatistics(aggregated.metadata())) {
+            message::eraseValueStatistics(aggregated.modifyMetadata());
+        }
         processedParts_.emplace(msg.fieldId(), std::set<message::Peer>{});
     });
 }
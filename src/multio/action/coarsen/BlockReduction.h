@@ -0,0 +1,197 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/ParallelFor.h"
+
+namespace multio::action::coarsen {
+
+/**
+ * Arrangement of the points of a field as far as block reductions are concerned:
+ *  - nested HEALPix: the 4^k children of a pixel of Nside/2^k are consecutive, a block is a contiguous range;
+ *  - regular grids: ni points per row, nj rows, a block is a square of factor x factor points. Points of incomplete
+ *    blocks at the end of the rows and of the last rows are dropped.
+ */
+struct Layout {
+    std::size_t ni;
+    std::size_t nj;
+    bool nested;
+
+    static Layout healpixNested(std::size_t Nside) { return {12 * Nside * Nside, 1, true}; }
+    static Layout regular(std::size_t ni, std::size_t nj) { return {ni, nj, false}; }
+
+    std::size_t size() const { return ni * nj; }
+
+    // Layout of the blocks of factor x factor points
+    Layout coarsen(std::size_t factor) const {
+        return nested ? Layout{ni / (factor * factor), 1, true} : Layout{ni / factor, nj / factor, false};
+    }
+};
+
+/// Number of valid points, sum, minimum and maximum of the blocks of a level. Blocks without valid points have a
+/// minimum of +inf and a maximum of -inf, such that they do not contribute to coarser levels.
+struct Cells {
+    std::vector<double> sum;
+    std::vector<std::uint32_t> count;
+    std::vector<double> min;
+    std::vector<double> max;
+
+    std::size_t size() const { return count.size(); }
+
+    void resize(std::size_t size) {
+        sum.resize(size);
+        count.resize(size);
+        min.resize(size);
+        max.resize(size);
+    }
+};
+
+enum class Operation
+{
+    Mean,
+    Minimum,
+    Maximum
+};
+
+namespace detail {
+
+// Points read by one thread at least, below that threading costs more than it saves
+constexpr std::size_t MIN_POINTS_PER_THREAD = 1 << 16;
+
+// Calls func(cell, first, stride, runs, runLength) for each block of the fine layout: the points of the block are
+// `runs` contiguous ranges of `runLength` points, starting at `first` and `stride` points apart
+template <typename Func>
+void forEachBlock(const Layout& fine, std::size_t factor, std::size_t threads, Func&& func) {
+    const Layout coarse = fine.coarsen(factor);
+    const std::size_t blockSize = factor * factor;
+    const std::size_t runs = fine.nested ? 1 : factor;
+    const std::size_t runLength = fine.nested ? blockSize : factor;
+
+    const std::size_t nChunks
+        = util::numChunks(threads, coarse.size(), std::max<std::size_t>(1, MIN_POINTS_PER_THREAD / blockSize));
+    util::parallelFor(nChunks, coarse.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            const std::size_t first
+                = fine.nested ? c * blockSize : (c / coarse.ni) * factor * fine.ni + (c % coarse.ni) * factor;
+            func(c, first, fine.ni, runs, runLength);
+        }
+    });
+}
+
+}  // namespace detail
+
+/// Reduces the blocks of factor x factor values of a field. Points equal to `missing` are skipped if `haveMissing`.
+template <typename Precision>
+void reduceValues(const Precision* values, const Layout& fine, std::size_t factor, bool haveMissing,
+                  Precision missing, Cells& cells, std::size_t threads = 1) {
+    auto reduceBlock = [&](std::size_t c, std::size_t first, std::size_t stride, std::size_t runs,
+                           std::size_t runLength) {
+        double sum = 0.0;
+        std::uint32_t count = 0;
+        Precision min = std::numeric_limits<Precision>::max();
+        Precision max = std::numeric_limits<Precision>::lowest();
+        // Branch-free inner loops so that the compiler can vectorize them
+        for (std::size_t r = 0; r < runs; ++r) {
+            const Precision* run = values + first + r * stride;
+            if (haveMissing) {
+                for (std::size_t i = 0; i < runLength; ++i) {
+                    const Precision v = run[i];
+                    const bool valid = v != missing;
+                    sum += valid ? static_cast<double>(v) : 0.0;
+                    count += valid ? 1 : 0;
+                    min = valid && v < min ? v : min;
+                    max = valid && v > max ? v : max;
+                }
+            }
+            else {
+                for (std::size_t i = 0; i < runLength; ++i) {
+                    const Precision v = run[i];
+                    sum += static_cast<double>(v);
+                    min = v < min ? v : min;
+                    max = v > max ? v : max;
+                }
+                count += static_cast<std::uint32_t>(runLength);
+            }
+        }
+        cells.sum[c] = sum;
+        cells.count[c] = count;
+        cells.min[c] = count > 0 ? static_cast<double>(min) : std::numeric_limits<double>::infinity();
+        cells.max[c] = count > 0 ? static_cast<double>(max) : -std::numeric_limits<double>::infinity();
+    };
+
+    cells.resize(fine.coarsen(factor).size());
+    detail::forEachBlock(fine, factor, threads, reduceBlock);
+}
+
+/// Reduces the blocks of factor x factor cells of a level to the cells of a coarser level
+inline void reduceCells(const Cells& fineCells, const Layout& fine, std::size_t factor, Cells& cells,
+                        std::size_t threads = 1) {
+    auto reduceBlock = [&](std::size_t c, std::size_t first, std::size_t stride, std::size_t runs,
+                           std::size_t runLength) {
+        double sum = 0.0;
+        std::uint32_t count = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        for (std::size_t r = 0; r < runs; ++r) {
+            const std::size_t begin = first + r * stride;
+            for (std::size_t i = begin; i < begin + runLength; ++i) {
+                sum += fineCells.sum[i];
+                count += fineCells.count[i];
+                min = fineCells.min[i] < min ? fineCells.min[i] : min;
+                max = fineCells.max[i] > max ? fineCells.max[i] : max;
+            }
+        }
+        cells.sum[c] = sum;
+        cells.count[c] = count;
+        cells.min[c] = min;
+        cells.max[c] = max;
+    };
+
+    cells.resize(fine.coarsen(factor).size());
+    detail::forEachBlock(fine, factor, threads, reduceBlock);
+}
+
+/// Writes the mean, minimum or maximum of each cell, `missing` for cells without valid points
+template <typename Precision>
+message::ValueStatistics writeCells(const Cells& cells, Operation op, Precision missing, Precision* out,
+                                    std::size_t threads = 1) {
+    const std::size_t nChunks = util::numChunks(threads, cells.size(), detail::MIN_POINTS_PER_THREAD);
+    std::vector<message::ValueStatistics> partials(nChunks);
+    util::parallelFor(nChunks, cells.size(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        auto& stats = partials[chunk];
+        for (std::size_t c = begin; c < end; ++c) {
+            if (cells.count[c] == 0) {
+                out[c] = missing;
+                ++stats.missing;
+                continue;
+            }
+            out[c] = static_cast<Precision>(op == Operation::Mean      ? cells.sum[c] / cells.count[c]
+                                            : op == Operation::Minimum ? cells.min[c]
+                                                                       : cells.max[c]);
+            stats.add(static_cast<double>(out[c]));
+        }
+    });
+
+    message::ValueStatistics stats;
+    for (const auto& p : partials) {
+        stats.merge(p);
+    }
+    return stats;
+}
+
+}  // namespace multio::action::coarsen
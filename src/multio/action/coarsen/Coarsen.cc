@@ -0,0 +1,243 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "Coarsen.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/utils/StringTools.h"
+
+#include "multio/message/Glossary.h"
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/PrecisionTag.h"
+
+namespace multio::action::coarsen {
+
+using message::glossary;
+
+namespace {
+
+// HEALPix grids have Nside up to 2^13
+constexpr long MAX_LEVEL = 13;
+
+std::vector<std::size_t> parseLevels(const eckit::LocalConfiguration& cfg) {
+    const auto values = cfg.isList("levels") ? cfg.getLongVector("levels")
+                                              : std::vector<long>{cfg.getLong("levels", 1)};
+    std::vector<std::size_t> levels;
+    for (const auto level : values) {
+        if (level < 1 || level > MAX_LEVEL) {
+            std::ostringstream os;
+            os << "coarsen: levels must be in [1, " << MAX_LEVEL << "] :: " << level;
+            throw eckit::UserError{os.str(), Here()};
+        }
+        levels.push_back(static_cast<std::size_t>(level));
+    }
+    if (levels.empty()) {
+        throw eckit::UserError{"coarsen: no levels given", Here()};
+    }
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+    return levels;
+}
+
+const std::string& operationName(Operation op) {
+    static const std::string names[] = {"mean", "minimum", "maximum"};
+    return names[static_cast<int>(op)];
+}
+
+// The coarse fields of different operations would only differ in "coarsen-operation", which is not encoded, and
+// overwrite each other when archived. Each operation needs its own action, with its own param mapping.
+Operation parseOperation(const eckit::LocalConfiguration& cfg) {
+    if (cfg.has("operations")) {
+        throw eckit::UserError{"coarsen: \"operations\" is not supported, use one action per \"operation\"", Here()};
+    }
+    const auto name = cfg.getString("operation", "mean");
+    if (name == "mean") {
+        return Operation::Mean;
+    }
+    if (name == "minimum") {
+        return Operation::Minimum;
+    }
+    if (name == "maximum") {
+        return Operation::Maximum;
+    }
+    throw eckit::UserError{"coarsen: unknown operation :: " + name, Here()};
+}
+
+template <typename T>
+T require(const message::Metadata& md, const std::string& key) {
+    const auto value = md.getOpt<T>(key);
+    if (!value) {
+        throw eckit::UserError{"coarsen: \"" + key + "\" not present in the metadata", Here()};
+    }
+    return *value;
+}
+
+// Layout of the field, checking that it is large enough for the coarsest level
+Layout fieldLayout(const message::Metadata& md, std::size_t maxLevel) {
+    const auto gridType = require<std::string>(md, glossary().gridType);
+    const std::size_t factor = std::size_t{1} << maxLevel;
+
+    if (eckit::StringTools::lower(gridType) == "healpix") {
+        if (const auto ordering = require<std::string>(md, glossary().orderingConvention); ordering != "nested") {
+            throw eckit::UserError{
+                "coarsen: HEALPix fields have to be in nested ordering (see renumber-healpix), got: " + ordering,
+                Here()};
+        }
+        const auto Nside = require<std::int64_t>(md, glossary().nside);
+        if (Nside <= 0 || Nside % static_cast<std::int64_t>(factor) != 0) {
+            std::ostringstream os;
+            os << "coarsen: Nside " << Nside << " is not a multiple of 2^" << maxLevel;
+            throw eckit::UserError{os.str(), Here()};
+        }
+        return Layout::healpixNested(static_cast<std::size_t>(Nside));
+    }
+
+    if (gridType == "regular_ll") {
+        const auto ni = require<std::int64_t>(md, glossary().ni);
+        const auto nj = require<std::int64_t>(md, glossary().nj);
+        if (ni < static_cast<std::int64_t>(factor) || nj < static_cast<std::int64_t>(factor)) {
+            std::ostringstream os;
+            os << "coarsen: grid of " << ni << "x" << nj << " points is too small for level " << maxLevel;
+            throw eckit::UserError{os.str(), Here()};
+        }
+        return Layout::regular(static_cast<std::size_t>(ni), static_cast<std::size_t>(nj));
+    }
+
+    throw eckit::UserError{"coarsen: grid type not supported :: " + gridType, Here()};
+}
+
+}  // namespace
+
+
+void setGeometry(message::Metadata& md, const Layout& layout, std::size_t factor) {
+    if (layout.nested) {
+        md.set(glossary().nside, md.get<std::int64_t>(glossary().nside) / static_cast<std::int64_t>(factor));
+        return;
+    }
+
+    const Layout coarse = layout.coarsen(factor);
+    const double shift = 0.5 * static_cast<double>(factor - 1);
+    const double westEast = require<double>(md, glossary().westEastIncrement);
+    const double southNorth = require<double>(md, glossary().southNorthIncrement);
+    const double north = require<double>(md, glossary().north) - shift * southNorth;
+    const double west = require<double>(md, glossary().west) + shift * westEast;
+
+    md.set(glossary().ni, static_cast<std::int64_t>(coarse.ni));
+    md.set(glossary().nj, static_cast<std::int64_t>(coarse.nj));
+    md.set(glossary().westEastIncrement, westEast * factor);
+    md.set(glossary().southNorthIncrement, southNorth * factor);
+    md.set(glossary().north, north);
+    md.set(glossary().west, west);
+    md.set(glossary().south, north - static_cast<double>(coarse.nj - 1) * southNorth * factor);
+    md.set(glossary().east, west + static_cast<double>(coarse.ni - 1) * westEast * factor);
+}
+
+
+Coarsen::Coarsen(const ComponentConfiguration& compConf) :
+    ChainedAction{compConf},
+    levels_{parseLevels(compConf.parsedConfig())},
+    operation_{parseOperation(compConf.parsedConfig())},
+    forwardInput_{compConf.parsedConfig().getBool("forward-input", true)},
+    threads_{static_cast<std::size_t>(std::max(1L, compConf.parsedConfig().getLong("threads", 1)))},
+    cells_(levels_.size()),
+    bufferPool_{static_cast<std::size_t>(std::max(0L, compConf.parsedConfig().getLong("buffer-pool-size", 16)))} {}
+
+
+void Coarsen::executeImpl(message::Message msg) {
+    if (msg.tag() != message::Message::Tag::Field) {
+        executeNext(std::move(msg));
+        return;
+    }
+
+    std::vector<message::Message> outputs;
+    {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+        const Layout layout = fieldLayout(msg.metadata(), levels_.back());
+        util::dispatchPrecisionTag(msg.precision(), [&](auto pt) {
+            using Precision = typename decltype(pt)::type;
+            coarsen<Precision>(msg, layout, outputs);
+        });
+    }
+
+    // The input keeps its payload, the coarse fields have their own
+    if (forwardInput_) {
+        executeNext(std::move(msg));
+    }
+    for (auto& out : outputs) {
+        executeNext(std::move(out));
+    }
+}
+
+
+template <typename Precision>
+void Coarsen::coarsen(const message::Message& msg, const Layout& layout, std::vector<message::Message>& outputs) {
+    const std::size_t size = msg.size() / sizeof(Precision);
+    if (size != layout.size()) {
+        std::ostringstream os;
+        os << "coarsen: field has " << size << " values, its grid has " << layout.size() << " points";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
+
+    const auto& md = msg.metadata();
+    const auto missingValue = md.getOpt<double>(glossary().missingValue);
+    const bool haveMissing = missingValue && md.getOpt<bool>(glossary().bitmapPresent).value_or(false);
+    const auto missing = static_cast<Precision>(missingValue.value_or(std::numeric_limits<float>::max()));
+    const auto* values = static_cast<const Precision*>(msg.payload().data());
+
+    Layout fine = layout;
+    for (std::size_t l = 0; l < levels_.size(); ++l) {
+        const std::size_t factor = std::size_t{1} << (levels_[l] - (l == 0 ? 0 : levels_[l - 1]));
+        if (l == 0) {
+            reduceValues(values, fine, factor, haveMissing, missing, cells_[l], threads_);
+        }
+        else {
+            reduceCells(cells_[l - 1], fine, factor, cells_[l], threads_);
+        }
+        fine = fine.coarsen(factor);
+
+        auto buffer = bufferPool_.get(fine.size() * sizeof(Precision));
+        const auto stats
+            = writeCells(cells_[l], operation_, missing, static_cast<Precision*>(buffer->data()), threads_);
+
+        auto outMd = md;
+        setGeometry(outMd, layout, std::size_t{1} << levels_[l]);
+        outMd.set("coarsen-operation", operationName(operation_));
+        outMd.set(glossary().globalSize, static_cast<std::int64_t>(fine.size()));
+        outMd.set(glossary().bitmapPresent, stats.missing > 0);
+        if (stats.missing > 0) {
+            outMd.set(glossary().missingValue, static_cast<double>(missing));
+        }
+        message::setValueStatistics(outMd, stats);
+
+        outputs.emplace_back(message::Message{
+            message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(), std::move(outMd)},
+            message::SharedPayload{std::move(buffer)}});
+    }
+}
+
+
+void Coarsen::print(std::ostream& os) const {
+    os << "Coarsen(levels=";
+    for (std::size_t l = 0; l < levels_.size(); ++l) {
+        os << (l == 0 ? "" : ", ") << levels_[l];
+    }
+    os << ", operation=" << operationName(operation_);
+    os << ", forward-input=" << (forwardInput_ ? "true" : "false") << ", threads=" << threads_ << ")";
+}
+
+
+static ActionBuilder<Coarsen> CoarsenBuilder("coarsen");
+
+}  // namespace multio::action::coarsen
@@ -0,0 +1,60 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+#include "BlockReduction.h"
+#include "multio/action/ChainedAction.h"
+#include "multio/message/Metadata.h"
+#include "multio/util/BufferPool.h"
+
+namespace multio::action::coarsen {
+
+/// Describes in md the grid of the blocks of factor x factor points of layout, each located at the centre of its block
+void setGeometry(message::Metadata& md, const Layout& layout, std::size_t factor);
+
+/**
+ * Produces lower resolution versions of fields on nested HEALPix and regular_ll grids, e.g. for quicklooks. Level k
+ * reduces blocks of 2^k x 2^k points (Nside / 2^k, increments * 2^k) to their mean, minimum or maximum (`operation`),
+ * skipping missing values; blocks without valid points are missing. The operation is recorded in "coarsen-operation",
+ * which is not encoded: fields of different operations need their own action and param mapping.
+ *
+ * All `levels` are computed in one pass over the field: the finest level is reduced from the values, each coarser level
+ * from the partial sums, counts and extrema of the previous one. One message is emitted per level, after the input
+ * field itself unless `forward-input` is false.
+ */
+class Coarsen final : public ChainedAction {
+public:
+    explicit Coarsen(const ComponentConfiguration& compConf);
+
+    void executeImpl(message::Message msg) override;
+
+private:
+    template <typename Precision>
+    void coarsen(const message::Message& msg, const Layout& layout, std::vector<message::Message>& outputs);
+
+    void print(std::ostream& os) const override;
+
+    const std::vector<std::size_t> levels_;
+    const Operation operation_;
+    const bool forwardInput_;
+    const std::size_t threads_;
+
+    // Partial reductions of each level, reused for all fields
+    std::vector<Cells> cells_;
+
+    // Payloads of the coarse fields, at most `buffer-pool-size` are kept
+    util::BufferPool bufferPool_;
+};
+
+}  // namespace multio::action::coarsen
@@ -0,0 +1,320 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "ChunkedArray.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/compression/Compressor.h"
+#include "eckit/log/JSON.h"
+#include "eckit/parser/JSONParser.h"
+
+#include "multio/util/ParallelFor.h"
+
+namespace multio::action {
+
+namespace {
+
+constexpr char RECORD_MAGIC[8] = {'M', 'I', 'O', 'C', 'H', 'U', 'N', 'K'};
+// Version 2 added the byte order of the values, version 1 records were written on little-endian hosts only
+constexpr std::uint32_t RECORD_VERSION = 2;
+// Magic, version and index length
+constexpr std::size_t PREAMBLE_SIZE = 16;
+
+const std::vector<std::string> DEFAULT_INDEX_KEYS{"name",      "paramId",   "param",       "shortName",
+                                                  "levtype",   "level",     "levelist",    "step",
+                                                  "date",      "time",      "startDate",   "startTime",
+                                                  "currentDate", "currentTime", "gridType", "domain",
+                                                  "missingValue", "bitmapPresent"};
+
+void putUInt32(unsigned char* p, std::uint32_t v) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        p[i] = static_cast<unsigned char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+std::uint32_t getUInt32(const unsigned char* p) {
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+const char* hostByteOrder() {
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1 ? "little" : "big";
+}
+
+void swapBytes(void* data, std::size_t count, std::size_t typeSize) {
+    auto* bytes = static_cast<unsigned char*>(data);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::reverse(bytes + i * typeSize, bytes + (i + 1) * typeSize);
+    }
+}
+
+// Nothing is returned for "none", eckit compressors are not guaranteed to be thread-safe and are built per thread
+std::unique_ptr<eckit::Compressor> makeCompressor(const std::string& name) {
+    if (name == "none") {
+        return nullptr;
+    }
+    return std::unique_ptr<eckit::Compressor>{eckit::CompressorFactory::instance().build(name)};
+}
+
+bool isCompressorAvailable(const std::string& name) {
+    return name == "none" || eckit::CompressorFactory::instance().has(name);
+}
+
+std::size_t typeSize(const std::string& dtype) {
+    if (dtype == "float32") {
+        return sizeof(float);
+    }
+    if (dtype == "float64") {
+        return sizeof(double);
+    }
+    throw eckit::SeriousBug("ChunkedArrayReader: unsupported dtype " + dtype, Here());
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ChunkedArrayOptions ChunkedArrayOptions::fromConfig(const eckit::LocalConfiguration& conf) {
+    ChunkedArrayOptions options;
+
+    const auto chunkSize = conf.getLong("chunk-size", static_cast<long>(options.chunkSize));
+    if (chunkSize < 1) {
+        throw eckit::UserError("Encode: chunk-size has to be positive", Here());
+    }
+    options.chunkSize = static_cast<std::size_t>(chunkSize);
+    options.shuffle = conf.getBool("shuffle", options.shuffle);
+
+    options.compression = conf.getString("compression", options.compression);
+    if (!isCompressorAvailable(options.compression)) {
+        throw eckit::UserError("Encode: compression <" + options.compression + "> is not available in eckit", Here());
+    }
+
+    options.threads = static_cast<std::size_t>(std::max(1L, conf.getLong("compression-threads", 1)));
+    options.indexKeys = conf.has("index-keys") ? conf.getStringVector("index-keys") : DEFAULT_INDEX_KEYS;
+
+    // Batches are concatenated as GRIB messages and archived as such by the sinks
+    if (conf.getLong("batch-size", 1) > 1) {
+        throw eckit::UserError("Encode: batch-size is not supported with format chunked-array", Here());
+    }
+
+    return options;
+}
+
+void shuffleBytes(const void* in, void* out, std::size_t count, std::size_t typeSize) {
+    const auto* src = static_cast<const unsigned char*>(in);
+    auto* dst = static_cast<unsigned char*>(out);
+    for (std::size_t b = 0; b < typeSize; ++b) {
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[b * count + i] = src[i * typeSize + b];
+        }
+    }
+}
+
+void unshuffleBytes(const void* in, void* out, std::size_t count, std::size_t typeSize) {
+    const auto* src = static_cast<const unsigned char*>(in);
+    auto* dst = static_cast<unsigned char*>(out);
+    for (std::size_t b = 0; b < typeSize; ++b) {
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[i * typeSize + b] = src[b * count + i];
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ChunkedArrayEncoder::ChunkedArrayEncoder(ChunkedArrayOptions options) : options_{std::move(options)} {}
+
+message::Message ChunkedArrayEncoder::encodeField(const message::Message& msg,
+                                                  const message::MetadataOverlay& md) const {
+    const bool isFloat = msg.precision() == util::PrecisionTag::Float;
+    const std::size_t valueSize = isFloat ? sizeof(float) : sizeof(double);
+    const std::size_t count = msg.size() / valueSize;
+    const std::size_t chunkSize = options_.chunkSize;
+    const std::size_t nChunks = (count + chunkSize - 1) / chunkSize;
+    const auto* values = static_cast<const unsigned char*>(msg.payload().data());
+
+    // Chunks are shuffled and compressed independently, hence concurrently
+    std::vector<eckit::Buffer> chunks;
+    chunks.reserve(nChunks);
+    for (std::size_t c = 0; c < nChunks; ++c) {
+        chunks.emplace_back(std::size_t{0});
+    }
+    std::vector<std::size_t> sizes(nChunks, 0);
+
+    util::parallelFor(util::numChunks(options_.threads, nChunks, 1), nChunks,
+                      [&](std::size_t, std::size_t begin, std::size_t end) {
+                          auto compressor = makeCompressor(options_.compression);
+                          eckit::Buffer shuffled{options_.shuffle ? chunkSize * valueSize : 0};
+                          for (std::size_t c = begin; c < end; ++c) {
+                              const std::size_t first = c * chunkSize;
+                              const std::size_t bytes = std::min(chunkSize, count - first) * valueSize;
+                              const void* src = values + first * valueSize;
+                              if (options_.shuffle) {
+                                  shuffleBytes(src, shuffled.data(), bytes / valueSize, valueSize);
+                                  src = shuffled.data();
+                              }
+                              if (compressor) {
+                                  sizes[c] = compressor->compress(src, bytes, chunks[c]);
+                              }
+                              else {
+                                  chunks[c] = eckit::Buffer{src, bytes};
+                                  sizes[c] = bytes;
+                              }
+                          }
+                      });
+
+    std::ostringstream index;
+    {
+        eckit::JSON json(index);
+        json.startObject();
+        json << "dtype" << (isFloat ? "float32" : "float64");
+        json << "byte-order" << hostByteOrder();
+        json << "count" << count;
+        json << "chunk-size" << chunkSize;
+        json << "shuffle" << options_.shuffle;
+        json << "compression" << options_.compression;
+        json << "chunk-sizes";
+        json.startList();
+        for (const auto size : sizes) {
+            json << size;
+        }
+        json.endList();
+        json << "metadata";
+        json.startObject();
+        for (const auto& key : options_.indexKeys) {
+            if (auto search = md.find(key); search != md.end()) {
+                json << key << search->second;
+            }
+        }
+        json.endObject();
+        json.endObject();
+    }
+    const std::string header = index.str();
+
+    std::size_t length = PREAMBLE_SIZE + header.size();
+    for (const auto size : sizes) {
+        length += size;
+    }
+
+    eckit::Buffer buffer{length};
+    auto* out = static_cast<unsigned char*>(buffer.data());
+    std::memcpy(out, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    putUInt32(out + 8, RECORD_VERSION);
+    putUInt32(out + 12, static_cast<std::uint32_t>(header.size()));
+    std::memcpy(out + PREAMBLE_SIZE, header.data(), header.size());
+
+    std::size_t pos = PREAMBLE_SIZE + header.size();
+    for (std::size_t c = 0; c < nChunks; ++c) {
+        std::memcpy(out + pos, chunks[c].data(), sizes[c]);
+        pos += sizes[c];
+    }
+
+    return message::Message{message::Message::Header{message::Message::Tag::Field,
+                                                     message::Peer{msg.source().group()}, msg.destination()},
+                            std::move(buffer)};
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ChunkedArrayReader::ChunkedArrayReader(const void* data, std::size_t size) :
+    data_{static_cast<const unsigned char*>(data)}, size_{size} {}
+
+bool ChunkedArrayReader::next(ChunkedArrayRecord& record) {
+    if (pos_ == size_) {
+        return false;
+    }
+
+    const auto* begin = data_ + pos_;
+    const std::size_t available = size_ - pos_;
+    if (available < PREAMBLE_SIZE || std::memcmp(begin, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0) {
+        throw eckit::SeriousBug("ChunkedArrayReader: no record at offset " + std::to_string(pos_), Here());
+    }
+    const auto version = getUInt32(begin + 8);
+    if (version < 1 || version > RECORD_VERSION) {
+        throw eckit::SeriousBug("ChunkedArrayReader: unsupported record version " + std::to_string(version), Here());
+    }
+    const std::size_t indexLength = getUInt32(begin + 12);
+    if (available - PREAMBLE_SIZE < indexLength) {
+        throw eckit::SeriousBug("ChunkedArrayReader: truncated record at offset " + std::to_string(pos_), Here());
+    }
+
+    std::istringstream in{std::string{reinterpret_cast<const char*>(begin + PREAMBLE_SIZE), indexLength}};
+    eckit::JSONParser parser{in};
+    const auto index = message::toMetadata(parser.parse());
+
+    record.dtype = index.get<std::string>("dtype");
+    record.count = static_cast<std::size_t>(index.get<std::int64_t>("count"));
+    record.metadata = index.getOpt<message::Metadata>("metadata").value_or(message::Metadata{});
+
+    const std::size_t valueSize = typeSize(record.dtype);
+    const auto chunkSize = static_cast<std::size_t>(index.get<std::int64_t>("chunk-size"));
+    const bool shuffle = index.get<bool>("shuffle");
+    const auto byteOrder = version < 2 ? std::string{"little"} : index.get<std::string>("byte-order");
+    if (byteOrder != "little" && byteOrder != "big") {
+        throw eckit::SeriousBug("ChunkedArrayReader: unsupported byte order " + byteOrder, Here());
+    }
+    const auto sizes = index.getOpt<std::vector<std::int64_t>>("chunk-sizes").value_or(std::vector<std::int64_t>{});
+    if (sizes.size() != (record.count + chunkSize - 1) / chunkSize) {
+        throw eckit::SeriousBug("ChunkedArrayReader: number of chunks does not match the number of values", Here());
+    }
+
+    auto compressor = makeCompressor(index.get<std::string>("compression"));
+    eckit::Buffer values{record.count * valueSize};
+    eckit::Buffer chunk{chunkSize * valueSize};
+
+    std::size_t pos = pos_ + PREAMBLE_SIZE + indexLength;
+    for (std::size_t c = 0; c < sizes.size(); ++c) {
+        const std::size_t first = c * chunkSize;
+        const std::size_t bytes = std::min(chunkSize, record.count - first) * valueSize;
+        const auto size = static_cast<std::size_t>(sizes[c]);
+        if (size > size_ - pos) {
+            throw eckit::SeriousBug("ChunkedArrayReader: truncated record at offset " + std::to_string(pos_), Here());
+        }
+
+        const void* raw = data_ + pos;
+        if (compressor) {
+            compressor->uncompress(raw, size, chunk, bytes);
+            raw = chunk.data();
+        }
+        else if (size != bytes) {
+            throw eckit::SeriousBug("ChunkedArrayReader: unexpected size of an uncompressed chunk", Here());
+        }
+
+        auto* dst = static_cast<unsigned char*>(values.data()) + first * valueSize;
+        if (shuffle) {
+            unshuffleBytes(raw, dst, bytes / valueSize, valueSize);
+        }
+        else {
+            std::memcpy(dst, raw, bytes);
+        }
+        pos += size;
+    }
+
+    if (byteOrder != hostByteOrder()) {
+        swapBytes(values.data(), record.count, valueSize);
+    }
+
+    record.values = std::move(values);
+    pos_ = pos;
+    return true;
+}
+
+}  // namespace multio::action
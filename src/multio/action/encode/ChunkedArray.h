@@ -0,0 +1,96 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/io/Buffer.h"
+
+#include "multio/message/Message.h"
+#include "multio/message/MetadataOverlay.h"
+
+namespace multio::action {
+
+/**
+ * Chunked array records (`format: chunked-array` of the encode action), a light-weight alternative to GRIB for
+ * consumers that read plain arrays (e.g. ML training pipelines). Each field becomes one self-describing record:
+ *
+ *   "MIOCHUNK" | uint32 version | uint32 index length | JSON index | chunk 0 | chunk 1 | ...
+ *
+ * (integers little-endian). The JSON index holds the data type, the byte order of the values, the number of values,
+ * the chunk size, the compression, the compressed size of each chunk and the configured metadata keys of the field.
+ * Values are written in the byte order of the host and swapped by the reader if needed. Values are split
+ * into chunks of a fixed number of values, each chunk is byte-shuffled (bytes of equal significance stored
+ * together, as done by blosc) and compressed independently, chunks are processed concurrently.
+ *
+ * Records are concatenated when written, e.g. one append-only file per variable is obtained with a select action
+ * and a file sink (`append: true`) per variable. ChunkedArrayReader decodes such files. Records can not be
+ * batched (`batch-size`), batches are archived as GRIB by the sinks.
+ */
+
+struct ChunkedArrayOptions {
+    // Number of values per chunk (`chunk-size`)
+    std::size_t chunkSize = 1 << 18;
+    // Byte-shuffle values before compression (`shuffle`)
+    bool shuffle = true;
+    // Any eckit compressor (e.g. lz4, snappy, aec) or none (`compression`)
+    std::string compression = "none";
+    // Number of threads compressing chunks concurrently (`compression-threads`)
+    std::size_t threads = 1;
+    // Metadata keys copied to the index, if present (`index-keys`), by default including the missing value
+    std::vector<std::string> indexKeys;
+
+    static ChunkedArrayOptions fromConfig(const eckit::LocalConfiguration& conf);
+};
+
+// Blosc-style byte shuffle: byte b of value i is stored at position b * count + i
+void shuffleBytes(const void* in, void* out, std::size_t count, std::size_t typeSize);
+void unshuffleBytes(const void* in, void* out, std::size_t count, std::size_t typeSize);
+
+class ChunkedArrayEncoder {
+public:
+    explicit ChunkedArrayEncoder(ChunkedArrayOptions options);
+
+    message::Message encodeField(const message::Message& msg, const message::MetadataOverlay& md) const;
+
+    const ChunkedArrayOptions& options() const { return options_; }
+
+private:
+    const ChunkedArrayOptions options_;
+};
+
+// A decoded record, values are float32 or float64 as indicated by dtype
+struct ChunkedArrayRecord {
+    std::string dtype;
+    std::size_t count = 0;
+    message::Metadata metadata;
+    eckit::Buffer values;
+};
+
+// Reads records from memory, e.g. the content of a file written by a file sink
+class ChunkedArrayReader {
+public:
+    ChunkedArrayReader(const void* data, std::size_t size);
+
+    // Decodes the next record, returns false at the end of the data
+    bool next(ChunkedArrayRecord& record);
+
+private:
+    const unsigned char* data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+};
+
+}  // namespace multio::action
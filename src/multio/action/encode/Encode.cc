@@ -10,6 +10,7 @@
 
 #include "Encode.h"
 
+#include <cstring>
 #include <iostream>
 
 #include <regex>
@@ -21,13 +22,14 @@
 #include "eckit/value/Value.h"
 
 
-#include "atlas/grid.h"
-#include "atlas/library.h"
-#include "atlas/parallel/mpi/mpi.h"
-
+#include "ChunkedArray.h"
+#include "EncoderPool.h"
 #include "GridDownloader.h"
+#include "GridGeometry.h"
 #include "multio/LibMultio.h"
 #include "multio/config/PathConfiguration.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/MetadataOverlay.h"
 #include "multio/util/Timing.h"
 
 namespace multio::action {
@@ -44,68 +46,46 @@ void handleCodesError(const std::string& errorPrefix, int error, const eckit::Co
     }
 }
 
-atlas::Grid readGrid(const std::string& name) {
-    atlas::mpi::Scope mpi_scope("self");
-    return atlas::Grid{name};
-}
-
-template <class GridType>
-GridType createGrid(const std::string& atlasNamedGrid) {
-
-    const atlas::Grid grid = readGrid(atlasNamedGrid);
-
-    auto structuredGrid = atlas::StructuredGrid(grid);
-
-    return GridType(structuredGrid);
-}
-
 void updateGaussianGrid(codes_handle* handle, const std::string& atlasNamedGrid) {
-    const auto gaussianGrid = createGrid<atlas::GaussianGrid>(atlasNamedGrid);
+    const auto geometry = GridGeometryCache::instance().gaussian(atlasNamedGrid);
 
-    int err = codes_set_long(handle, "N", gaussianGrid.N());
+    int err = codes_set_long(handle, "N", geometry->N);
     handleCodesError("eccodes error while setting the N value: ", err, Here());
 
-    auto tmp = gaussianGrid.nx();
-    std::vector<long> pl(tmp.size(), 0);
-    for (int i = 0; i < tmp.size(); ++i) {
-        pl[i] = long(tmp[i]);
-    }
-
-    err = codes_set_long_array(handle, "pl", pl.data(), pl.size());
+    err = codes_set_long_array(handle, "pl", geometry->pl.data(), geometry->pl.size());
     handleCodesError("eccodes error while setting the PL array: ", err, Here());
 
-    std::vector<double> values(gaussianGrid.size(), 0.0);
-
-    auto it = gaussianGrid.lonlat().begin();
-    err = codes_set_double(handle, "latitudeOfFirstGridPointInDegrees", (*it)[1]);
+    err = codes_set_double(handle, "latitudeOfFirstGridPointInDegrees", geometry->latitudeOfFirstGridPointInDegrees);
     handleCodesError("eccodes error while setting the latitudeOfFirstGridPointInDegrees: ", err, Here());
-    err = codes_set_double(handle, "longitudeOfFirstGridPointInDegrees", (*it)[0]);
+    err = codes_set_double(handle, "longitudeOfFirstGridPointInDegrees", geometry->longitudeOfFirstGridPointInDegrees);
     handleCodesError("eccodes error while setting the longitudeOfFirstGridPointInDegrees: ", err, Here());
-    it += gaussianGrid.size() - 1;
-    err = codes_set_double(handle, "latitudeOfLastGridPointInDegrees", (*it)[1]);
+    err = codes_set_double(handle, "latitudeOfLastGridPointInDegrees", geometry->latitudeOfLastGridPointInDegrees);
     handleCodesError("eccodes error while setting the latitudeOfLastGridPointInDegrees: ", err, Here());
 
-    err = codes_set_double_array(handle, "values", values.data(), values.size());
-    handleCodesError("eccodes error while setting the values array: ", err, Here());
-
-    const auto equator = gaussianGrid.N();
-    const auto maxLongitude = gaussianGrid.x(gaussianGrid.nx(equator) - 1, equator);
+    // Only the geometry is set, the data section is sized when the values of a field are encoded. Filling it here
+    // would make every copy of the template (e.g. the headers of the native packer) carry a full size data section
 
-    err = codes_set_double(handle, "longitudeOfLastGridPointInDegrees", maxLongitude);
+    err = codes_set_double(handle, "longitudeOfLastGridPointInDegrees", geometry->longitudeOfLastGridPointInDegrees);
     handleCodesError("eccodes error while setting the longitudeOfLastGridPointInDegrees value: ", err, Here());
 }
 
 void updateRegularLatLonGrid(codes_handle* handle, const std::string& atlasNamedGrid) {
-    const auto llGrid = createGrid<atlas::RegularLonLatGrid>(atlasNamedGrid);
-    int err = codes_set_long(handle, "Ni", llGrid.nx());
+    const auto geometry = GridGeometryCache::instance().regularLatLon(atlasNamedGrid);
+    int err = codes_set_long(handle, "Ni", geometry->Ni);
     handleCodesError("eccodes error while setting the Ni value: ", err, Here());
-    err = codes_set_long(handle, "Nj", llGrid.ny());
+    err = codes_set_long(handle, "Nj", geometry->Nj);
     handleCodesError("eccodes error while setting the Nj value: ", err, Here());
 }
 
 using UpdateFunctionType = std::function<void(codes_handle*, const std::string&)>;
-static const std::unordered_map<std::string, UpdateFunctionType> updateFunctionMap{
-    {"^\\s*[FON]\\d+\\s*$", &updateGaussianGrid}, {"^\\s*L\\d+x\\d+\\s*$", &updateRegularLatLonGrid}};
+
+// Regular expressions are compiled once, not for every encode action
+const std::vector<std::pair<std::regex, UpdateFunctionType>>& updateFunctions() {
+    static const std::vector<std::pair<std::regex, UpdateFunctionType>> functions{
+        {std::regex{"^\\s*[FON]\\d+\\s*$"}, &updateGaussianGrid},
+        {std::regex{"^\\s*L\\d+x\\d+\\s*$"}, &updateRegularLatLonGrid}};
+    return functions;
+}
 
 eckit::LocalConfiguration getEncodingConfiguration(const ComponentConfiguration& compConf) {
     if (compConf.parsedConfig().has("encoding")) {
@@ -116,8 +96,10 @@ eckit::LocalConfiguration getEncodingConfiguration(const ComponentConfiguration&
     }
 }
 
-std::unique_ptr<GribEncoder> makeEncoder(const eckit::LocalConfiguration& conf,
-                                         const config::MultioConfiguration& multioConfig) {
+// Creates one encoder for each encoding thread, all sharing the same (updated) template
+std::vector<std::unique_ptr<GribEncoder>> makeEncoders(const eckit::LocalConfiguration& conf,
+                                                       const config::MultioConfiguration& multioConfig,
+                                                       std::size_t count) {
     auto format = conf.getString("format");
 
     if (format == "grib") {
@@ -139,27 +121,55 @@ std::unique_ptr<GribEncoder> makeEncoder(const eckit::LocalConfiguration& conf,
 
             eckit::Log::info() << "REQUESTED ATLAS GRID DEFINITION UPDATE: " << atlasNamedGrid << std::endl;
 
-            const auto updateFunction = std::find_if(updateFunctionMap.cbegin(), updateFunctionMap.cend(),
-                                                     [&atlasNamedGrid](const auto& item) {
-                                                         std::regex r{item.first};
-                                                         return std::regex_match(atlasNamedGrid, r);
-                                                     });
+            const auto& functions = updateFunctions();
+            const auto updateFunction
+                = std::find_if(functions.cbegin(), functions.cend(),
+                               [&atlasNamedGrid](const auto& item) { return std::regex_match(atlasNamedGrid, item.first); });
 
-            if (updateFunction != updateFunctionMap.cend()) {
+            if (updateFunction != functions.cend()) {
                 updateFunction->second(sample, atlasNamedGrid);
             }
         }
 
-        return std::make_unique<GribEncoder>(sample, conf);
+        std::vector<std::unique_ptr<GribEncoder>> encoders;
+        encoders.reserve(count);
+        for (std::size_t i = 1; i < count; ++i) {
+            auto clone = codes_handle_clone(sample);
+            if (!clone) {
+                throw eckit::SeriousBug("Failed to clone the grib template", Here());
+            }
+            encoders.push_back(std::make_unique<GribEncoder>(clone, conf));
+        }
+        encoders.push_back(std::make_unique<GribEncoder>(sample, conf));
+        return encoders;
     }
     else if (format == "raw") {
-        return nullptr;  // leave message in raw binary format
+        return {};  // leave message in raw binary format
+    }
+    else if (format == "chunked-array") {
+        return {};  // encoded by a ChunkedArrayEncoder, see below
     }
     else {
         throw eckit::SeriousBug("Encoding format <" + format + "> is not supported");
     }
 }
 
+std::size_t encodingThreads(const eckit::LocalConfiguration& conf) {
+    const auto threads = conf.getLong("threads", 1);
+    if (threads < 1) {
+        throw eckit::UserError("Encode: threads has to be positive", Here());
+    }
+    return static_cast<std::size_t>(threads);
+}
+
+bool forwardInArrivalOrder(const eckit::LocalConfiguration& conf) {
+    const auto order = conf.getString("output-order", "arrival");
+    if (order != "arrival" && order != "ready") {
+        throw eckit::UserError("Encode: output-order has to be either \"arrival\" or \"ready\", got " + order, Here());
+    }
+    return order == "arrival";
+}
+
 std::string encodingExceptionReason(const std::string& r) {
     std::string s("Enocding exception: ");
     s.append(r);
@@ -218,24 +228,69 @@ Encode::Encode(const ComponentConfiguration& compConf, const eckit::LocalConfigu
                                 ? eckit::LocalConfiguration{encConf.getSubConfiguration("additional-metadata")}
                                 : (encConf.has("run") ? eckit::LocalConfiguration{encConf.getSubConfiguration("run")}
                                                       : eckit::LocalConfiguration{}))},
-    encoder_{makeEncoder(encConf, compConf.multioConfig())},
-    gridDownloader_{std::make_unique<multio::action::GridDownloader>(compConf)} {}
+    gridDownloader_{std::make_unique<multio::action::GridDownloader>(compConf)},
+    batchSize_{static_cast<std::size_t>(std::max(1L, encConf.getLong("batch-size", 1)))},
+    batchBytes_{static_cast<std::size_t>(std::max(1L, encConf.getLong("batch-bytes", 64L * 1024 * 1024)))} {
+    if (format_ == "chunked-array") {
+        chunkedArray_ = std::make_unique<ChunkedArrayEncoder>(ChunkedArrayOptions::fromConfig(encConf));
+    }
+
+    auto encoders = makeEncoders(encConf, compConf.multioConfig(), encodingThreads(encConf));
+    if (encoders.size() == 1) {
+        encoder_ = std::move(encoders.front());
+    }
+    else if (encoders.size() > 1) {
+        // Twice as many fields as threads in flight keeps all workers busy while the next field is being received
+        const auto maxInFlight = 2 * encoders.size();
+        pool_ = std::make_unique<EncoderPool>(std::move(encoders), forwardInArrivalOrder(encConf), maxInFlight);
+    }
+}
 
 Encode::Encode(const ComponentConfiguration& compConf) : Encode(compConf, getEncodingConfiguration(compConf)) {}
 
+Encode::~Encode() {
+    // Plans may end without a final flush, pending fields must not be lost
+    try {
+        flushPending();
+    }
+    catch (const std::exception& e) {
+        eckit::Log::error() << "Encode: pending fields could not be forwarded: " << e.what() << std::endl;
+    }
+}
+
 void Encode::executeImpl(Message msg) {
     if (msg.tag() != Message::Tag::Field) {
+        // Flush and all other control messages are barriers: encoded fields are forwarded before them
+        flushPending();
         executeNext(std::move(msg));
         return;
     }
-    if (not encoder_) {
+    if (chunkedArray_) {
+        std::optional<Message> encoded;
+        {
+            util::ScopedTiming timing{statistics_.actionTiming_};
+            message::MetadataOverlay md{msg.sharedMetadata()};
+            md.push(additionalMetadata_);
+            encoded = chunkedArray_->encodeField(msg, md);
+        }
+        emit(std::move(*encoded));
+        return;
+    }
+    if (!encoder_ && !pool_) {
         executeNext(std::move(msg));
         return;
     }
 
     auto gridUID = std::optional<GridDownloader::GridUIDType>{};
 
-    auto& md = msg.metadata();
+    const message::MetadataOverlay md{msg.sharedMetadata()};
+    if (auto searchGridType = md.find("gridType");
+        searchGridType != md.end() && searchGridType->second.get<std::string>() == "none") {
+        throw eckit::UserError(
+            "Encode: fields without a grid (e.g. outputs of spatial-statistics) cannot be encoded as GRIB, use the "
+            "chunked-array format",
+            Here());
+    }
     auto searchDomain = md.find("domain");
     auto searchUUIDOfHGrid = md.find("uuidOfHGrid");
     if (searchDomain != md.end() && searchUUIDOfHGrid == md.end() && isOcean(md)) {
@@ -244,13 +299,13 @@ void Encode::executeImpl(Message msg) {
 
         LOG_DEBUG_LIB(LibMultio) << " *** Looking for grid info for subtype: " << msg.domain() << std::endl;
 
-        const auto& md = msg.metadata();
-
         if (auto searchGridType = md.find("gridType");
             searchGridType != md.end() && (searchGridType->second.get<std::string>() != "HEALPix")) {
             auto gridCoords = gridDownloader_->getGridCoords(msg.domain(), md.get<std::int64_t>("startDate"),
                                                              md.get<std::int64_t>("startTime"));
             if (gridCoords) {
+                // The coordinates bypass the batch, fields received before them are forwarded first
+                flushPending();
                 executeNext(gridCoords.value().Lat);
                 executeNext(gridCoords.value().Lon);
             }
@@ -259,7 +314,87 @@ void Encode::executeImpl(Message msg) {
         gridUID = gridDownloader_->getGridUID(msg.domain());
     }
 
-    executeNext(encodeField(std::move(msg), gridUID));
+    if (pool_) {
+        std::vector<Message> encoded;
+        {
+            util::ScopedTiming timing{statistics_.actionTiming_};
+            encoded = pool_->submit(
+                [this, msg = std::move(msg), gridUID](GribEncoder& encoder) { return encodeField(msg, gridUID, encoder); });
+        }
+        forward(std::move(encoded));
+        return;
+    }
+
+    std::optional<Message> encoded;
+    {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+        encoded = encodeField(msg, gridUID, *encoder_);
+    }
+    statistics_.cacheHits_ = encoder_->headerCacheHits();
+    statistics_.cacheMisses_ = encoder_->headerCacheMisses();
+    emit(std::move(*encoded));
+}
+
+void Encode::flushPending() {
+    if (pool_) {
+        forward(pool_->flush());
+    }
+    flushBatch();
+}
+
+void Encode::forward(std::vector<message::Message> encoded) {
+    statistics_.cacheHits_ = pool_->headerCacheHits();
+    statistics_.cacheMisses_ = pool_->headerCacheMisses();
+    for (auto& msg : encoded) {
+        emit(std::move(msg));
+    }
+}
+
+void Encode::emit(message::Message encoded) {
+    if (batchSize_ <= 1) {
+        executeNext(std::move(encoded));
+        return;
+    }
+
+    batchLength_ += encoded.size();
+    batch_.push_back(std::move(encoded));
+    if (batch_.size() >= batchSize_ || batchLength_ >= batchBytes_) {
+        flushBatch();
+    }
+}
+
+void Encode::flushBatch() {
+    if (batch_.empty()) {
+        return;
+    }
+
+    message::Message batch;
+    {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+
+        eckit::Buffer buffer{batchLength_};
+        std::vector<std::int64_t> offsets;
+        offsets.reserve(batch_.size());
+
+        std::size_t offset = 0;
+        for (const auto& msg : batch_) {
+            offsets.push_back(static_cast<std::int64_t>(offset));
+            std::memcpy(static_cast<char*>(buffer.data()) + offset, msg.payload().data(), msg.size());
+            offset += msg.size();
+        }
+
+        message::Metadata md;
+        md.set(message::glossary().batchOffsets, std::move(offsets));
+
+        const auto& first = batch_.front();
+        batch = Message{Message::Header{Message::Tag::Field, first.source(), first.destination(), std::move(md)},
+                        std::move(buffer)};
+
+        batch_.clear();
+        batchLength_ = 0;
+    }
+
+    executeNext(std::move(batch));
 }
 
 void Encode::print(std::ostream& os) const {
@@ -267,19 +402,35 @@ void Encode::print(std::ostream& os) const {
        << "encoder=";
     if (encoder_)
         encoder_->print(os);
+    if (pool_) {
+        os << ", threads=" << pool_->size() << ", output-order=" << (pool_->ordered() ? "arrival" : "ready");
+    }
+    if (chunkedArray_) {
+        const auto& opts = chunkedArray_->options();
+        os << ", chunk-size=" << opts.chunkSize << ", shuffle=" << opts.shuffle << ", compression=" << opts.compression;
+    }
+    if (batchSize_ > 1) {
+        os << ", batch-size=" << batchSize_ << ", batch-bytes=" << batchBytes_;
+    }
     os << ")";
 }
 
-message::Message Encode::encodeField(const message::Message& message, const std::optional<std::string>& gridUID) const {
+bool Encode::readsMetadataOverlay() const {
+    return true;
+}
+
+message::Message Encode::encodeField(const message::Message& message, const std::optional<std::string>& gridUID,
+                                     GribEncoder& encoder) const {
     auto logMsg = message.logMessage();
     try {
-        util::ScopedTiming timing{statistics_.actionTiming_};
-        message::Message msg{message};
-        msg.header().acquireMetadata();
-        if (gridUID) {
-            msg.modifyMetadata().set("uuidOfHGrid", gridUID.value());
+        // The metadata of the message is read through a view instead of being copied for each field
+        message::MetadataOverlay md{message.sharedMetadata()};
+        md.push(additionalMetadata_);
+        // Keys set on the view take precedence, configured additional metadata still overrides the downloaded grid
+        if (gridUID && additionalMetadata_.find("uuidOfHGrid") == additionalMetadata_.end()) {
+            md.set("uuidOfHGrid", gridUID.value());
         }
-        return encoder_->encodeField(std::move(msg), overwrite_, additionalMetadata_);
+        return encoder.encodeField(message, md, overwrite_);
     }
     catch (const std::exception& ex) {
         std::ostringstream oss;
@@ -20,14 +20,18 @@
 #include "multio/action/ChainedAction.h"
 
 #include <optional>
+#include <vector>
 
 namespace multio::action {
 
+class ChunkedArrayEncoder;
+class EncoderPool;
 class GridDownloader;
 
 class Encode : public ChainedAction {
 public:
     explicit Encode(const ComponentConfiguration& compConf);
+    ~Encode() override;
 
     void executeImpl(message::Message msg) override;
 
@@ -38,14 +42,41 @@ private:
 
     void print(std::ostream& os) const override;
 
-    message::Message encodeField(const message::Message& msg, const std::optional<std::string>& gridUID) const;
+    bool readsMetadataOverlay() const override;
+
+    message::Message encodeField(const message::Message& msg, const std::optional<std::string>& gridUID,
+                                 GribEncoder& encoder) const;
+
+    void forward(std::vector<message::Message> encoded);
+
+    // Forwards an encoded message or appends it to the current batch
+    void emit(message::Message encoded);
+    void flushBatch();
+
+    // Forwards all fields still being encoded or batched
+    void flushPending();
 
     const std::string format_;
     CodesOverwrites overwrite_;
     message::Metadata additionalMetadata_;
 
-    const std::unique_ptr<GribEncoder> encoder_ = nullptr;
     const std::unique_ptr<GridDownloader> gridDownloader_ = nullptr;
+
+    // Either a single encoder used on the calling thread or, with `threads: N` (N > 1), a pool of N encoders.
+    // With `output-order: arrival` (default) fields are forwarded in the order they were received, with `ready` as
+    // soon as they are encoded. Any non-field message waits for all pending fields.
+    std::unique_ptr<GribEncoder> encoder_;
+    std::unique_ptr<EncoderPool> pool_;
+
+    // `format: chunked-array` writes plain (optionally compressed) arrays instead of GRIB
+    std::unique_ptr<ChunkedArrayEncoder> chunkedArray_;
+
+    // With `batch-size: N` (N > 1) up to N encoded messages (and at most `batch-bytes`) are concatenated into a single
+    // message, the offsets of the GRIB messages are stored in the metadata (batchOffsets). Sinks write a batch at once.
+    const std::size_t batchSize_;
+    const std::size_t batchBytes_;
+    std::vector<message::Message> batch_;
+    std::size_t batchLength_ = 0;
 };
 
 //---------------------------------------------------------------------------------------------------------------------
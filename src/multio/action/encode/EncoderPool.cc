@@ -0,0 +1,152 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "EncoderPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+#include "eckit/exception/Exceptions.h"
+
+namespace multio::action {
+
+EncoderPool::EncoderPool(std::vector<std::unique_ptr<GribEncoder>> encoders, bool ordered, std::size_t maxInFlight) :
+    encoders_{std::move(encoders)},
+    ordered_{ordered},
+    maxInFlight_{std::max(maxInFlight, encoders_.size())},
+    headerCacheCounts_(encoders_.size()) {
+    ASSERT(!encoders_.empty());
+    workers_.reserve(encoders_.size());
+    for (std::size_t worker = 0; worker < encoders_.size(); ++worker) {
+        workers_.emplace_back(std::make_unique<util::ScopedThread>(std::thread{[this, worker]() { work(worker); }}));
+    }
+}
+
+EncoderPool::~EncoderPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+        tasks_.clear();
+    }
+    taskAvailable_.notify_all();
+    workers_.clear();
+}
+
+void EncoderPool::work(std::size_t worker) {
+    auto& encoder = *encoders_[worker];
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        taskAvailable_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        if (stop_) {
+            return;
+        }
+
+        auto [id, task] = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+
+        Result result;
+        try {
+            result.msg = task(encoder);
+        }
+        catch (...) {
+            result.error = std::current_exception();
+        }
+
+        lock.lock();
+        results_.emplace(id, std::move(result));
+        headerCacheCounts_[worker] = {encoder.headerCacheHits(), encoder.headerCacheMisses()};
+        resultAvailable_.notify_all();
+    }
+}
+
+void EncoderPool::collect(std::vector<message::Message>& out, bool wait) {
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    auto forwardable = [this]() {
+        return !results_.empty() && (!ordered_ || results_.begin()->first == nextResult_);
+    };
+    if (wait && inFlight_ > 0) {
+        resultAvailable_.wait(lock, forwardable);
+    }
+
+    // Drain all ready results before rethrowing, so that a failed task does not leave later results behind
+    std::exception_ptr error;
+    while (forwardable()) {
+        auto node = results_.extract(results_.begin());
+        ++nextResult_;
+        --inFlight_;
+        if (node.mapped().error) {
+            if (!error) {
+                error = node.mapped().error;
+            }
+            continue;
+        }
+        out.push_back(std::move(*node.mapped().msg));
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<message::Message> EncoderPool::submit(Task task) {
+    std::vector<message::Message> out;
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (inFlight_ < maxInFlight_) {
+                tasks_.emplace_back(nextTask_++, std::move(task));
+                ++inFlight_;
+                break;
+            }
+        }
+        collect(out, true);
+    }
+    taskAvailable_.notify_one();
+
+    collect(out, false);
+    return out;
+}
+
+std::vector<message::Message> EncoderPool::flush() {
+    std::vector<message::Message> out;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (inFlight_ == 0) {
+                break;
+            }
+        }
+        collect(out, true);
+    }
+    return out;
+}
+
+std::size_t EncoderPool::headerCacheHits() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::size_t hits = 0;
+    for (const auto& counts : headerCacheCounts_) {
+        hits += counts.first;
+    }
+    return hits;
+}
+
+std::size_t EncoderPool::headerCacheMisses() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::size_t misses = 0;
+    for (const auto& counts : headerCacheCounts_) {
+        misses += counts.second;
+    }
+    return misses;
+}
+
+}  // namespace multio::action
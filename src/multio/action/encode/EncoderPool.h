@@ -0,0 +1,88 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "multio/action/encode/GribEncoder.h"
+#include "multio/message/Message.h"
+#include "multio/util/ScopedThread.h"
+
+namespace multio::action {
+
+// Encodes fields concurrently, each worker thread owning its own GribEncoder (the ecCodes handles are not thread-safe).
+// Tasks are submitted from the thread executing the action, and encoded messages are handed back to that thread
+// either in submission order or as soon as they are ready. Downstream actions are therefore never called concurrently.
+class EncoderPool {
+public:
+    using Task = std::function<message::Message(GribEncoder&)>;
+
+    // maxInFlight bounds the number of submitted but not yet collected fields
+    EncoderPool(std::vector<std::unique_ptr<GribEncoder>> encoders, bool ordered, std::size_t maxInFlight);
+    ~EncoderPool();
+
+    EncoderPool(const EncoderPool&) = delete;
+    EncoderPool& operator=(const EncoderPool&) = delete;
+
+    // Queues a task and returns the messages that can be forwarded. Blocks while too many fields are in flight.
+    std::vector<message::Message> submit(Task task);
+
+    // Waits for all submitted tasks and returns the messages not collected yet
+    std::vector<message::Message> flush();
+
+    std::size_t size() const { return encoders_.size(); }
+    bool ordered() const { return ordered_; }
+
+    std::size_t headerCacheHits() const;
+    std::size_t headerCacheMisses() const;
+
+private:
+    struct Result {
+        std::optional<message::Message> msg;
+        std::exception_ptr error;
+    };
+
+    void work(std::size_t worker);
+
+    // Moves forwardable results into out, waiting for at least one if wait is set. Rethrows errors of failed tasks.
+    void collect(std::vector<message::Message>& out, bool wait);
+
+    const std::vector<std::unique_ptr<GribEncoder>> encoders_;
+    const bool ordered_;
+    const std::size_t maxInFlight_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable taskAvailable_;
+    std::condition_variable resultAvailable_;
+
+    std::deque<std::pair<std::uint64_t, Task>> tasks_;
+    std::map<std::uint64_t, Result> results_;
+    std::uint64_t nextTask_ = 0;
+    std::uint64_t nextResult_ = 0;
+    std::size_t inFlight_ = 0;
+    bool stop_ = false;
+
+    // Header cache counters of each encoder, only updated under the lock
+    std::vector<std::pair<std::size_t, std::size_t>> headerCacheCounts_;
+
+    std::vector<std::unique_ptr<util::ScopedThread>> workers_;
+};
+
+}  // namespace multio::action
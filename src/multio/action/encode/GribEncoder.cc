@@ -14,6 +14,8 @@
 
 #include "GribEncoder.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <functional>
 #include <iomanip>
@@ -31,6 +33,7 @@
 
 
 #include "multio/LibMultio.h"
+#include "multio/util/ContentHash.h"
 #include "multio/util/DateTime.h"
 #include "multio/util/Metadata.h"
 #include "multio/util/Substitution.h"
@@ -91,7 +94,8 @@ std::int64_t timeUnitCodes(util::TimeUnit u) {
 }
 
 
-std::tuple<std::int64_t, std::int64_t> getReferenceDateTime(const std::string& timeRef, const message::Metadata& in) {
+std::tuple<std::int64_t, std::int64_t> getReferenceDateTime(const std::string& timeRef,
+                                                            const message::MetadataOverlay& in) {
     static std::unordered_map<std::string, std::tuple<std::string, std::string>> REF_TO_DATETIME_KEYS{
         {"start", {glossary().startDate, glossary().startTime}},
         {"previous", {glossary().previousDate, glossary().previousTime}},
@@ -105,7 +109,7 @@ std::tuple<std::int64_t, std::int64_t> getReferenceDateTime(const std::string& t
 }
 
 
-void tryMapStepToTimeAndCheckTime(message::Metadata& in) {
+void tryMapStepToTimeAndCheckTime(message::MetadataOverlay& in) {
     const auto searchStartDate = in.find(glossary().startDate);
     const auto searchStartTime = in.find(glossary().startTime);
     const auto searchDataDate = in.find(glossary().dataDate);
@@ -245,12 +249,16 @@ std::string getUnstructuredGridType(const eckit::LocalConfiguration& config) {
 }  // namespace
 
 GribEncoder::GribEncoder(codes_handle* handle, const eckit::LocalConfiguration& config) :
-    template_{handle}, encoder_{nullptr}, config_{config} /*, encodeBitsPerValue_(config)*/ {}
-
-struct QueriedMarsKeys {
-    std::optional<std::string> type{};
-    std::optional<std::int64_t> paramId{};
-};
+    template_{handle},
+    encoder_{nullptr},
+    config_{config},
+    nativePacking_{config.getString("packing", "ecCodes") == "native"},
+    packingOptions_{static_cast<std::size_t>(std::max(1L, config.getLong("packing-threads", 1))),
+                    config.getBool("validate-packing", false)},
+    headerCacheSize_{static_cast<std::size_t>(std::max(0L, config.getLong("header-cache-size", 1024)))},
+    memoSize_{static_cast<std::size_t>(std::max(0L, config.getLong("memo-size", 0)))}
+/*, encodeBitsPerValue_(config)*/
+{}
 
 void setLevelUnrelatedTypeOfLevel(GribEncoder& g, const std::string& typeOfLevel, long level) {
     g.setValue("typeOfLevel", typeOfLevel);
@@ -544,7 +552,7 @@ QueriedMarsKeys setMarsKeys(GribEncoder& g, const Dict& md) {
     return ret;
 }
 
-void applyOverwrites(GribEncoder& g, const message::Metadata& md) {
+void applyOverwrites(GribEncoder& g, const message::MetadataOverlay& md) {
     if (auto searchOverwrites = md.find("encoder-overwrites"); searchOverwrites != md.end()) {
         // TODO Refactor with visitor
         for (const auto& kv : searchOverwrites->second.get<message::Metadata>()) {
@@ -572,7 +580,7 @@ void applyOverwrites(GribEncoder& g, const CodesOverwrites& overwrites) {
 }
 
 
-void setEncodingSpecificFields(GribEncoder& g, const message::Metadata& md) {
+void setEncodingSpecificFields(GribEncoder& g, const message::MetadataOverlay& md) {
     // TODO globalSize is expected to be set in md directly. nmuberOf* should be
     // readonly anyway... test removal..
 
@@ -581,8 +589,8 @@ void setEncodingSpecificFields(GribEncoder& g, const message::Metadata& md) {
     withFirstOf(valueSetter(g, glossary().bitsPerValue), lookUp<std::int64_t>(md, glossary().bitsPerValue));
 }
 
-std::string getTimeReference(GribEncoder& g, const message::Metadata& md, const QueriedMarsKeys& queriedMarsFields,
-                             const std::string& gribEdition, bool isTimeRange,
+std::string getTimeReference(GribEncoder& g, const message::MetadataOverlay& md,
+                             const QueriedMarsKeys& queriedMarsFields, const std::string& gribEdition, bool isTimeRange,
                              const std::optional<std::int64_t> significanceOfReferenceTime) {
     if (auto optTimeRef = lookUp<std::string>(md, "timeReference")(); optTimeRef) {
         return *optTimeRef;
@@ -610,9 +618,9 @@ std::string getTimeReference(GribEncoder& g, const message::Metadata& md, const
     return isReferingToStart ? "start" : (isTimeRange ? "previous" : "current");
 }
 
-void setDateAndStatisticalFields(GribEncoder& g, const message::Metadata& in,
+void setDateAndStatisticalFields(GribEncoder& g, const message::MetadataOverlay& in,
                                  const QueriedMarsKeys& queriedMarsFields) {
-    message::Metadata md = in;  // Copy to allow modification
+    message::MetadataOverlay md = in;  // Copy of the view to allow modification, the layers are not copied
 
     auto gribEdition = lookUp<std::string>(md, "gribEdition")().value_or("2");
     // std::string forecastTimeKey = gribEdition == "2" ? "forecastTime" : "startStep";
@@ -625,6 +633,13 @@ void setDateAndStatisticalFields(GribEncoder& g, const message::Metadata& in,
                     || (queriedMarsFields.type && *queriedMarsFields.type == "tpa")
                     || (endStep && startStep && (endStep != startStep));
 
+    // Percentiles over a time interval use product definition template 4.10. The template needs to be selected
+    // before any of the time range keys are set, changing it afterwards resets them
+    if (operation && (*operation == "percentile") && (gribEdition == "2")) {
+        g.setValue("productDefinitionTemplateNumber", 10l);
+        g.setValue("percentileValue", std::lround(md.get<double>("percentile")));
+    }
+
 
     auto significanceOfReferenceTime = lookUp<std::int64_t>(md, "significanceOfReferenceTime")();
     if (!significanceOfReferenceTime) {
@@ -715,7 +730,11 @@ void setDateAndStatisticalFields(GribEncoder& g, const message::Metadata& in,
                                       / 3600);
         }
 
-        if (operation) {
+        if (operation && (*operation == "percentile")) {
+            // Code table 4.10 has no entry for percentiles, the value is carried by percentileValue
+            g.setMissing("typeOfStatisticalProcessing");
+        }
+        else if (operation) {
             static const std::map<const std::string, const std::int64_t> TYPE_OF_STATISTICAL_PROCESSING{
                 {"average", 0}, {"accumulate", 1}, {"maximum", 2}, {"minimum", 3}, {"stddev", 6}};
             if (auto searchStat = TYPE_OF_STATISTICAL_PROCESSING.find(*operation);
@@ -796,25 +815,70 @@ void setDateAndStatisticalFields(GribEncoder& g, const message::Metadata& in,
     }
 }
 
-void GribEncoder::setFieldMetadata(message::Metadata& md) {
+QueriedMarsKeys GribEncoder::setStaticFieldMetadata(const message::MetadataOverlay& md) {
+    if (isOcean(md)) {
+        return setStaticOceanMetadata(md);
+    }
+    auto queriedMarsFields = setMarsKeys(*this, md);
+    setEncodingSpecificFields(*this, md);
+    return queriedMarsFields;
+}
+
+void GribEncoder::setVaryingFieldMetadata(const message::MetadataOverlay& md,
+                                          const QueriedMarsKeys& queriedMarsFields) {
     if (isOcean(md)) {
-        setOceanMetadata(md);
+        setVaryingOceanMetadata(md, queriedMarsFields);
     }
     else {
-        auto queriedMarsFields = setMarsKeys(*this, md);
-        setEncodingSpecificFields(*this, md);
         setDateAndStatisticalFields(*this, md, queriedMarsFields);
     }
 }
 
-namespace {}
+namespace {
 
-void GribEncoder::setOceanMetadata(message::Metadata& md) {
+// Keys left out of the header cache key, all other metadata is assumed to possibly affect sections 1-4:
+//  - keys only read by the varying part of the encoding (setDateAndStatisticalFields)
+//  - statistics of the values (e.g. collected by an interpolation), they only affect the data sections and would
+//    otherwise make every field miss
+const std::unordered_set<std::string> varyingHeaderKeys{
+    "startDate",    "startTime",      "dataDate",         "dataTime",       "date",          "time",
+    "step",         "stepRange",      "startStep",        "endStep",        "currentDate",   "currentTime",
+    "previousDate", "previousTime",   "dateOfAnalysis",   "timeOfAnalysis", "timeIncrement", "timeStep",
+    "startStepInHours", "endStepInHours", "sampleIntervalInSeconds",
+    "minimumValue", "maximumValue", "numberOfMissingValues"};
+
+std::string headerCacheKey(const message::MetadataOverlay& md) {
+    std::vector<const message::MetadataOverlay::ValueType*> entries;
+    md.forEach([&](const auto& kv) {
+        if (varyingHeaderKeys.find(kv.first.value()) == varyingHeaderKeys.end()) {
+            entries.push_back(&kv);
+        }
+    });
+    // Metadata is unordered, sort to make the key independent of the insertion order
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs->first.value() < rhs->first.value(); });
+
+    // Values are written with their type and full precision, different values must never map to the same key
+    std::ostringstream oss;
+    oss << std::setprecision(17);
+    for (const auto& it : entries) {
+        oss << it->first.value() << ':' << it->second.index() << '=' << it->second << ';';
+    }
+    return oss.str();
+}
+
+}  // namespace
+
+QueriedMarsKeys GribEncoder::setStaticOceanMetadata(const message::MetadataOverlay& md) {
     auto queriedMarsFields = setMarsKeys(*this, md);
     if (queriedMarsFields.type) {
         setValue(glossary().typeOfGeneratingProcess, type_of_generating_process.at(*queriedMarsFields.type));
     }
+    return queriedMarsFields;
+}
 
+void GribEncoder::setVaryingOceanMetadata(const message::MetadataOverlay& md,
+                                          const QueriedMarsKeys& queriedMarsFields) {
     setDateAndStatisticalFields(*this, md, queriedMarsFields);
     setEncodingSpecificFields(*this, md);
 
@@ -880,7 +944,7 @@ void GribEncoder::setOceanMetadata(message::Metadata& md) {
     }
 }
 
-void GribEncoder::setOceanCoordMetadata(message::Metadata& md) {
+void GribEncoder::setOceanCoordMetadata(const message::MetadataOverlay& md) {
     setMarsKeys(*this, md);
 
     setValue(glossary().date, md.get<std::int64_t>(glossary().startDate));
@@ -920,49 +984,134 @@ void GribEncoder::setMissing(const std::string& key) {
     encoder_->setMissing(key);
 }
 
-message::Message GribEncoder::encodeOceanCoordinates(message::Message&& msg,
+message::Message GribEncoder::encodeOceanCoordinates(const message::Message& msg,
                                                      const message::Metadata& additionalMetadata) {
     initEncoder();
-    msg.header().acquireMetadata();
 
-    auto& metadata = msg.modifyMetadata();
-    metadata.updateOverwrite(additionalMetadata);
+    message::MetadataOverlay metadata{msg.sharedMetadata()};
+    metadata.push(additionalMetadata);
     applyOverwrites(*this, metadata);
     setOceanCoordMetadata(metadata);
 
-    return dispatchPrecisionTag(msg.precision(), [&](auto pt) {
-        using Precision = typename decltype(pt)::type;
-        return setFieldValues<Precision>(std::move(msg));
-    });
+    if (memoSize_ > 0) {
+        return encodeMemoized(msg, metadata, "coordinates;" + headerCacheKey(metadata));
+    }
+    return encodeValues(msg, metadata);
 }
 
-message::Message GribEncoder::encodeField(message::Message&& msg, const CodesOverwrites& overwrites,
+message::Message GribEncoder::encodeField(const message::Message& msg, const CodesOverwrites& overwrites,
                                           const message::Metadata& additionalMetadata) {
-    initEncoder();
-    msg.header().acquireMetadata();
+    message::MetadataOverlay metadata{msg.sharedMetadata()};
+    metadata.push(additionalMetadata);
+    return encodeField(msg, metadata, overwrites);
+}
 
-    applyOverwrites(*this, overwrites);
-    auto& metadata = msg.modifyMetadata();
-    metadata.updateOverwrite(additionalMetadata);
-    applyOverwrites(*this, metadata);
+message::Message GribEncoder::encodeField(const message::Message& msg, const message::MetadataOverlay& metadata,
+                                          const CodesOverwrites& overwrites) {
+    std::string key;
+    if (headerCacheSize_ > 0 || memoSize_ > 0) {
+        key = headerCacheKey(metadata);
+    }
+
+    if (headerCacheSize_ == 0) {
+        initEncoder();
+        applyOverwrites(*this, overwrites);
+        applyOverwrites(*this, metadata);
+        setVaryingFieldMetadata(metadata, setStaticFieldMetadata(metadata));
+    }
+    else {
+        auto search = headerCache_.find(key);
+        if (search != headerCache_.end()) {
+            ++headerCacheHits_;
+            encoder_ = search->second.handle->duplicate();
+        }
+        else {
+            ++headerCacheMisses_;
+            initEncoder();
+            applyOverwrites(*this, overwrites);
+            applyOverwrites(*this, metadata);
+            auto queriedMarsKeys = setStaticFieldMetadata(metadata);
+
+            if (headerCache_.size() >= headerCacheSize_) {
+                LOG_DEBUG_LIB(LibMultio) << "GribEncoder: header cache full (" << headerCache_.size()
+                                         << " entries), dropping it" << std::endl;
+                headerCache_.clear();
+            }
+            search = headerCache_.emplace(key, PreparedHeader{encoder_->duplicate(), queriedMarsKeys}).first;
+        }
+        setVaryingFieldMetadata(metadata, search->second.queriedMarsKeys);
+    }
 
-    setFieldMetadata(metadata);
+    if (memoSize_ > 0) {
+        return encodeMemoized(msg, metadata, key);
+    }
+    return encodeValues(msg, metadata);
+}
+
+message::Message GribEncoder::encodeValues(const message::Message& msg, const message::MetadataOverlay& metadata) {
     return dispatchPrecisionTag(msg.precision(), [&](auto pt) {
         using Precision = typename decltype(pt)::type;
-        return setFieldValues<Precision>(std::move(msg));
+        return setFieldValues<Precision>(msg, metadata);
     });
 }
 
+message::Message GribEncoder::encodeMemoized(const message::Message& msg, const message::MetadataOverlay& metadata,
+                                             const std::string& key) {
+    const auto size = msg.payload().size();
+    const auto hash = util::contentHash(msg.payload().data(), size);
+
+    if (auto search = memo_.find(key);
+        search != memo_.end() && search->second.hash == hash && search->second.size == size) {
+        eckit::Buffer header{encoder_->length()};
+        encoder_->write(header);
+        if (auto spliced = spliceDataSections(header, search->second.encoded)) {
+            ++memoHits_;
+            return Message{Message::Header{Message::Tag::Field, Peer{msg.source().group()}, Peer{msg.destination()}},
+                           std::move(*spliced)};
+        }
+    }
+
+    ++memoMisses_;
+    auto encoded = encodeValues(msg, metadata);
+
+    if (memo_.size() >= memoSize_ && memo_.find(key) == memo_.end()) {
+        LOG_DEBUG_LIB(LibMultio) << "GribEncoder: memo full (" << memo_.size() << " entries), dropping it"
+                                 << std::endl;
+        memo_.clear();
+    }
+    memo_.insert_or_assign(key, MemoEntry{hash, size, eckit::Buffer{encoded.payload().data(), encoded.size()}});
+
+    return encoded;
+}
+
 
 template <typename T>
-message::Message GribEncoder::setFieldValues(message::Message&& msg) {
+message::Message GribEncoder::setFieldValues(const message::Message& msg, const message::MetadataOverlay& metadata) {
     auto beg = reinterpret_cast<const T*>(msg.payload().data());
 
-    this->setDataValues(beg, msg.globalSize());
-
-    msg.header().acquireMetadata();
-    const auto& metadata = msg.metadata();
+    const auto globalSize = metadata.get<std::int64_t>(glossary().globalSize);
     auto offsetByValue = metadata.getOpt<double>("offsetValuesBy");
+
+    // Offsets are applied by ecCodes while packing, such fields always go through ecCodes
+    if (nativePacking_ && !offsetByValue) {
+        eckit::Buffer header{this->encoder_->length()};
+        encoder_->write(header);
+        // The range collected by the producer of the values (e.g. an interpolation) saves a pass over the field
+        std::optional<ValueRange> range;
+        auto min = metadata.getOpt<double>(glossary().minimumValue);
+        auto max = metadata.getOpt<double>(glossary().maximumValue);
+        if (min && max && metadata.getOpt<std::int64_t>(glossary().numberOfMissingValues).value_or(-1) == 0) {
+            range = ValueRange{*min, *max};
+        }
+        if (auto packed = encodeSimplePacked(header, beg, globalSize, encoder_->getLongValue("bitsPerValue"),
+                                             packingOptions_, range)) {
+            return Message{Message::Header{Message::Tag::Field, Peer{msg.source().group()}, Peer{msg.destination()}},
+                           std::move(*packed)};
+        }
+    }
+
+    this->setDataValues(beg, globalSize);
+
     if (offsetByValue) {
         setValue("offsetValuesBy", *offsetByValue);
     }
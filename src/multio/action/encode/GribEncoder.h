@@ -14,15 +14,20 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 #include "eckit/config/LocalConfiguration.h"
 
 #include "eccodes.h"
 #include "metkit/codes/GribHandle.h"
 
+#include "multio/action/encode/SimplePacking.h"
 #include "multio/message/Glossary.h"
 #include "multio/message/Message.h"
+#include "multio/message/MetadataOverlay.h"
 #include "multio/util/MioGribHandle.h"
 
 #include <variant>
@@ -34,6 +39,11 @@ using CodesScalarValue = std::variant<std::int64_t, double, std::string>;
 using CodesOverwrites = std::vector<std::pair<std::string, CodesScalarValue>>;
 using multio::util::MioGribHandle;
 
+struct QueriedMarsKeys {
+    std::optional<std::string> type{};
+    std::optional<std::int64_t> paramId{};
+};
+
 class GribEncoder {
 public:
     GribEncoder(codes_handle* handle, const eckit::LocalConfiguration& config);
@@ -67,16 +77,26 @@ public:
     };
     bool hasKey(const char* key);
 
-    message::Message encodeOceanCoordinates(message::Message&& msg, const message::Metadata& additionalMetadata);
+    message::Message encodeOceanCoordinates(const message::Message& msg, const message::Metadata& additionalMetadata);
 
-    message::Message encodeField(message::Message&& msg, const CodesOverwrites& overwrites,
+    message::Message encodeField(const message::Message& msg, const CodesOverwrites& overwrites,
                                  const message::Metadata& additionalMetadata);
 
+    // Encodes the payload of `msg` with the metadata given by a view, the metadata of the message is not read
+    message::Message encodeField(const message::Message& msg, const message::MetadataOverlay& metadata,
+                                 const CodesOverwrites& overwrites);
+
     // TODO May be refactored
     // int getBitsPerValue(int paramid, const std::string& levtype, double min, double max);
 
     void print(std::ostream& os) const;
 
+    std::size_t headerCacheHits() const { return headerCacheHits_; }
+    std::size_t headerCacheMisses() const { return headerCacheMisses_; }
+
+    std::size_t memoHits() const { return memoHits_; }
+    std::size_t memoMisses() const { return memoMisses_; }
+
 private:
     // Encoder is now a member of the action
     const MioGribHandle template_;
@@ -84,17 +104,57 @@ private:
 
     void initEncoder();
 
-    void setFieldMetadata(message::Metadata& md);
-    void setOceanMetadata(message::Metadata& md);
+    // Fields are encoded in two phases: the keys that only depend on the "shape" of the field (overwrites, mars keys,
+    // packing, ...) and the keys that vary from step to step (date, time, step ranges). Handles prepared with the
+    // first phase are cached, such that for most fields only the second phase needs to be applied to a clone.
+    QueriedMarsKeys setStaticFieldMetadata(const message::MetadataOverlay& md);
+    void setVaryingFieldMetadata(const message::MetadataOverlay& md, const QueriedMarsKeys& queriedMarsKeys);
+
+    QueriedMarsKeys setStaticOceanMetadata(const message::MetadataOverlay& md);
+    void setVaryingOceanMetadata(const message::MetadataOverlay& md, const QueriedMarsKeys& queriedMarsKeys);
 
-    void setOceanCoordMetadata(message::Metadata& md);
+    void setOceanCoordMetadata(const message::MetadataOverlay& md);
 
     template <typename T>
-    message::Message setFieldValues(message::Message&& msg);
+    message::Message setFieldValues(const message::Message& msg, const message::MetadataOverlay& metadata);
+
+    message::Message encodeValues(const message::Message& msg, const message::MetadataOverlay& metadata);
+
+    // Reuses the data sections of the last field encoded with the same header key if the payload is unchanged
+    message::Message encodeMemoized(const message::Message& msg, const message::MetadataOverlay& metadata,
+                                    const std::string& key);
 
 
     const eckit::LocalConfiguration config_;
 
+    // Section 7 is packed in-tree for grid_simple fields (`packing: native`), other layouts are left to ecCodes
+    const bool nativePacking_;
+    const SimplePackingOptions packingOptions_;
+
+    struct PreparedHeader {
+        std::unique_ptr<MioGribHandle> handle;
+        QueriedMarsKeys queriedMarsKeys;
+    };
+
+    // Maximum number of prepared headers, the cache is dropped as a whole once full. 0 disables caching
+    const std::size_t headerCacheSize_;
+    std::unordered_map<std::string, PreparedHeader> headerCache_;
+    std::size_t headerCacheHits_ = 0;
+    std::size_t headerCacheMisses_ = 0;
+
+    struct MemoEntry {
+        std::uint64_t hash;
+        std::size_t size;
+        eckit::Buffer encoded;
+    };
+
+    // Encoded output of constant fields (orography, land-sea mask, grid coordinates, ...) is memoized by content hash
+    // (`memo-size` entries, 0 disables). Only sections 0 to 4 are encoded again, e.g. to update the time keys.
+    const std::size_t memoSize_;
+    std::unordered_map<std::string, MemoEntry> memo_;
+    std::size_t memoHits_ = 0;
+    std::size_t memoMisses_ = 0;
+
     const std::set<std::string> coordSet_{"lat_T", "lon_T", "lat_U", "lon_U", "lat_V",
                                           "lon_V", "lat_W", "lon_W", "lat_F", "lon_F"};
 
@@ -102,11 +162,13 @@ private:
     // action EncodeBitsPerValue encodeBitsPerValue_;
 };
 
-inline bool isOcean(const message::Metadata& metadata) {
+// Works on Metadata and MetadataOverlay
+template <typename Dict>
+bool isOcean(const Dict& metadata) {
     using message::glossary;
 
     // Check if metadata has a key "nemoParam" or a category starting with "ocean"
-    std::optional<std::string> category = metadata.getOpt<std::string>(glossary().category);
+    std::optional<std::string> category = metadata.template getOpt<std::string>(glossary().category);
     const bool hasNemoParam = metadata.find(glossary().nemoParam) != metadata.end();
     const bool hasCatOcean = category && (category->rfind("ocean") == 0);
     return hasNemoParam || hasCatOcean;
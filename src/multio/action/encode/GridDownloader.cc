@@ -11,9 +11,8 @@
 #include "GridDownloader.h"
 
 #include "GribEncoder.h"
+#include "GridGeometry.h"
 
-#include "atlas/grid/Grid.h"
-#include "atlas/grid/Iterator.h"
 #include "atlas/grid/SpecRegistry.h"
 #include "atlas/library.h"
 #include "atlas/parallel/mpi/mpi.h"
@@ -58,11 +57,6 @@ std::unique_ptr<multio::action::GribEncoder> createEncoder(const multio::config:
     return encoder;
 }
 
-atlas::Grid readGrid(const std::string& name) {
-    atlas::mpi::Scope mpi_scope("self");
-    return atlas::Grid{name};
-}
-
 std::string getUnstructuredGridType(const multio::config::ComponentConfiguration& compConf) {
     std::optional<std::string_view> (*F)(std::string_view) = &multio::util::getEnv;
     return multio::util::replaceCurly(compConf.parsedConfig().getString("unstructured-grid-type"), F);
@@ -174,24 +168,15 @@ void GridDownloader::downloadOrcaGridCoordinates(const config::ComponentConfigur
 
         eckit::Log::info() << "Multio GridDownloader: starting download for grid: " << completeGridName << std::endl;
 
-        const atlas::Grid grid = readGrid(completeGridName);
+        // Coordinates are shared by all grid downloaders of the process, only the first one downloads them
+        const auto coords = GridGeometryCache::instance().coordinates(completeGridName);
 
         eckit::Log::info() << "Multio GridDownloader: grid " << completeGridName << " downloaded!" << std::endl;
 
-        const auto gridUID = grid.uid();
+        const auto& gridUID = coords->uid;
 
         if (encoder_ != nullptr) {
-            const auto gridSize = grid.size();
-
-            std::vector<double> lon(grid.size());
-            std::vector<double> lat(grid.size());
-            size_t n{0};
-
-            for (const auto p : grid.lonlat()) {
-                lon[n] = p.lon();
-                lat[n] = p.lat();
-                ++n;
-            }
+            const auto gridSize = coords->lat.size();
 
             eckit::Log::info() << "Multio GridDownloader: data from " << completeGridName << " extracted!" << std::endl;
 
@@ -201,9 +186,9 @@ void GridDownloader::downloadOrcaGridCoordinates(const config::ComponentConfigur
                                                             lonParamIds.at(unstructuredGridSubtype));
 
             multio::message::Message latMessage{{multio::message::Message::Tag::Field, {}, {}, std::move(latMetadata)},
-                                                {lat.data(), grid.size() * sizeof(double)}};
+                                                {coords->lat.data(), gridSize * sizeof(double)}};
             multio::message::Message lonMessage{{multio::message::Message::Tag::Field, {}, {}, std::move(lonMetadata)},
-                                                {lon.data(), grid.size() * sizeof(double)}};
+                                                {coords->lon.data(), gridSize * sizeof(double)}};
 
             gridCoordinatesCache_.emplace(std::piecewise_construct,
                                           std::tuple(std::string(unstructuredGridSubtype) + " grid"),
@@ -0,0 +1,108 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "GridGeometry.h"
+
+#include "atlas/grid.h"
+#include "atlas/parallel/mpi/mpi.h"
+
+#include "eckit/log/Log.h"
+
+#include "GridDownloader.h"
+#include "multio/LibMultio.h"
+
+namespace multio::action {
+
+namespace {
+
+atlas::Grid readGrid(const std::string& name) {
+    ScopedAtlasInstance scopedAtlasInstance;
+    atlas::mpi::Scope mpi_scope("self");
+    return atlas::Grid{name};
+}
+
+template <class GridType>
+GridType createGrid(const std::string& atlasNamedGrid) {
+    return GridType(atlas::StructuredGrid(readGrid(atlasNamedGrid)));
+}
+
+GaussianGeometry computeGaussianGeometry(const std::string& name) {
+    const auto gaussianGrid = createGrid<atlas::GaussianGrid>(name);
+
+    GaussianGeometry geometry;
+    geometry.N = gaussianGrid.N();
+
+    const auto& nx = gaussianGrid.nx();
+    geometry.pl.assign(nx.begin(), nx.end());
+
+    const auto ny = static_cast<long>(gaussianGrid.ny());
+    geometry.latitudeOfFirstGridPointInDegrees = gaussianGrid.y(0);
+    geometry.longitudeOfFirstGridPointInDegrees = gaussianGrid.x(0, 0);
+    geometry.latitudeOfLastGridPointInDegrees = gaussianGrid.y(ny - 1);
+
+    const auto equator = gaussianGrid.N();
+    geometry.longitudeOfLastGridPointInDegrees = gaussianGrid.x(gaussianGrid.nx(equator) - 1, equator);
+
+    return geometry;
+}
+
+RegularLatLonGeometry computeRegularLatLonGeometry(const std::string& name) {
+    const auto llGrid = createGrid<atlas::RegularLonLatGrid>(name);
+    return RegularLatLonGeometry{static_cast<long>(llGrid.nx()), static_cast<long>(llGrid.ny())};
+}
+
+GridCoordinateArrays computeCoordinates(const std::string& name) {
+    const atlas::Grid grid = readGrid(name);
+
+    GridCoordinateArrays coords;
+    coords.uid = grid.uid();
+    coords.lat.reserve(grid.size());
+    coords.lon.reserve(grid.size());
+    for (const auto p : grid.lonlat()) {
+        coords.lon.push_back(p.lon());
+        coords.lat.push_back(p.lat());
+    }
+    return coords;
+}
+
+template <typename Geometry, typename Compute>
+std::shared_ptr<const Geometry> getOrCompute(std::mutex& mutex,
+                                             std::map<std::string, std::shared_ptr<const Geometry>>& cache,
+                                             const std::string& name, Compute&& compute) {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (auto it = cache.find(name); it != cache.end()) {
+        LOG_DEBUG_LIB(LibMultio) << "GridGeometryCache: reusing geometry of grid " << name << std::endl;
+        return it->second;
+    }
+    auto geometry = std::make_shared<const Geometry>(compute(name));
+    cache.emplace(name, geometry);
+    return geometry;
+}
+
+}  // namespace
+
+GridGeometryCache& GridGeometryCache::instance() {
+    static GridGeometryCache singleton;
+    return singleton;
+}
+
+std::shared_ptr<const GaussianGeometry> GridGeometryCache::gaussian(const std::string& name) {
+    return getOrCompute(mutex_, gaussian_, name, &computeGaussianGeometry);
+}
+
+std::shared_ptr<const RegularLatLonGeometry> GridGeometryCache::regularLatLon(const std::string& name) {
+    return getOrCompute(mutex_, regularLatLon_, name, &computeRegularLatLonGeometry);
+}
+
+std::shared_ptr<const GridCoordinateArrays> GridGeometryCache::coordinates(const std::string& name) {
+    return getOrCompute(mutex_, coordinates_, name, &computeCoordinates);
+}
+
+}  // namespace multio::action
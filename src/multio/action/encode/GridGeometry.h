@@ -0,0 +1,69 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "eckit/memory/NonCopyable.h"
+
+namespace multio::action {
+
+// Grid description needed to size a GRIB template for a named Gaussian grid (F/O/N)
+struct GaussianGeometry {
+    long N = 0;
+    std::vector<long> pl;
+    double latitudeOfFirstGridPointInDegrees = 0;
+    double longitudeOfFirstGridPointInDegrees = 0;
+    double latitudeOfLastGridPointInDegrees = 0;
+    double longitudeOfLastGridPointInDegrees = 0;
+};
+
+// Grid description needed to size a GRIB template for a named regular lat-lon grid (L<nx>x<ny>)
+struct RegularLatLonGeometry {
+    long Ni = 0;
+    long Nj = 0;
+};
+
+// Point coordinates of an unstructured grid (e.g. ORCA), as emitted by the GridDownloader
+struct GridCoordinateArrays {
+    std::string uid;
+    std::vector<double> lat;
+    std::vector<double> lon;
+};
+
+/**
+ * Process-wide cache of the geometry of named atlas grids. Building atlas grids (and for ORCA downloading the
+ * coordinates) is expensive and used to be repeated by every Encode action and GridDownloader of a plan.
+ * Entries are computed on first request and kept for the lifetime of the process. Thread-safe.
+ */
+class GridGeometryCache : private eckit::NonCopyable {
+public:
+    static GridGeometryCache& instance();
+
+    std::shared_ptr<const GaussianGeometry> gaussian(const std::string& name);
+    std::shared_ptr<const RegularLatLonGeometry> regularLatLon(const std::string& name);
+    std::shared_ptr<const GridCoordinateArrays> coordinates(const std::string& name);
+
+private:
+    GridGeometryCache() = default;
+
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<const GaussianGeometry>> gaussian_;
+    std::map<std::string, std::shared_ptr<const RegularLatLonGeometry>> regularLatLon_;
+    std::map<std::string, std::shared_ptr<const GridCoordinateArrays>> coordinates_;
+};
+
+}  // namespace multio::action
@@ -0,0 +1,467 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "SimplePacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "eccodes.h"
+
+#include "eckit/exception/Exceptions.h"
+
+#include "multio/LibMultio.h"
+#include "multio/util/ParallelFor.h"
+
+namespace multio::action {
+
+namespace {
+
+// Values processed by one thread at least, below that threading costs more than it saves
+constexpr std::size_t MIN_VALUES_PER_THREAD = 1 << 16;
+
+// Values are quantized into 32 bit integers, larger widths are left to ecCodes
+constexpr long MAX_BITS_PER_VALUE = 32;
+
+// Values packed together, 8 values of n bits always fill exactly n bytes
+constexpr std::size_t BLOCK = 8;
+
+constexpr std::size_t SECTION0_LENGTH = 16;
+constexpr std::size_t SECTION5_LENGTH = 21;  // Template 5.0
+
+std::uint64_t readUnsigned(const unsigned char* p, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+void writeUnsigned(unsigned char* p, std::uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        p[i] = static_cast<unsigned char>(v & 0xff);
+        v >>= 8;
+    }
+}
+
+// GRIB2 encodes negative integers with a sign bit followed by the magnitude
+long readSigned16(const unsigned char* p) {
+    const auto v = static_cast<long>(readUnsigned(p, 2));
+    return (v & 0x8000) ? -(v & 0x7fff) : v;
+}
+
+void writeSigned16(unsigned char* p, long v) {
+    writeUnsigned(p, v < 0 ? (0x8000 | static_cast<std::uint64_t>(-v)) : static_cast<std::uint64_t>(v), 2);
+}
+
+void writeFloat(unsigned char* p, float v) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    writeUnsigned(p, bits, 4);
+}
+
+// Same as codes_power in ecCodes, used for scaling such that encoding and decoding agree bitwise
+double power(long s, long n) {
+    double divisor = 1.0;
+    if (s == 0) {
+        return 1.0;
+    }
+    if (s == 1) {
+        return static_cast<double>(n);
+    }
+    while (s < 0) {
+        divisor /= static_cast<double>(n);
+        s++;
+    }
+    while (s > 0) {
+        divisor *= static_cast<double>(n);
+        s--;
+    }
+    return divisor;
+}
+
+// Largest float that is not larger than v
+float nearestSmallerFloat(double v) {
+    float f = static_cast<float>(v);
+    if (static_cast<double>(f) > v) {
+        f = std::nextafter(f, -std::numeric_limits<float>::infinity());
+    }
+    return f;
+}
+
+// Smallest binary scale factor for which the range fits into bitsPerValue bits (grib_get_binary_scale_fact)
+long binaryScaleFactor(double range, long bitsPerValue) {
+    if (range == 0) {
+        return 0;
+    }
+    const double maxint = power(bitsPerValue, 2) - 1;
+    long scale = 0;
+    double zs = 1;
+    while ((range * zs) <= maxint) {
+        scale--;
+        zs *= 2;
+    }
+    while ((range * zs) > maxint) {
+        scale++;
+        zs /= 2;
+    }
+    while (std::floor(range * zs + 0.5) <= maxint) {
+        scale--;
+        zs *= 2;
+    }
+    while (std::floor(range * zs + 0.5) > maxint) {
+        scale++;
+        zs /= 2;
+    }
+    return scale;
+}
+
+// Locates the sections (offsets of sections 1 to 7, 0 if absent) of a GRIB2 message containing a single field
+bool locateSections(const eckit::Buffer& message, std::size_t (&sections)[8]) {
+    const auto* in = static_cast<const unsigned char*>(message.data());
+    const std::size_t size = message.size();
+
+    std::fill(std::begin(sections), std::end(sections), 0);
+    if (size < SECTION0_LENGTH || std::memcmp(in, "GRIB", 4) != 0 || in[7] != 2) {
+        return false;
+    }
+
+    std::size_t pos = SECTION0_LENGTH;
+    while (pos + 4 <= size && std::memcmp(in + pos, "7777", 4) != 0) {
+        if (pos + 5 > size) {
+            return false;
+        }
+        const auto length = static_cast<std::size_t>(readUnsigned(in + pos, 4));
+        const unsigned number = in[pos + 4];
+        if (length < 5 || pos + length > size || number < 1 || number > 7 || sections[number] != 0) {
+            return false;
+        }
+        sections[number] = pos;
+        pos += length;
+    }
+    return pos + 4 == size && sections[3] != 0 && sections[4] != 0 && sections[5] != 0 && sections[7] != 0;
+}
+
+struct Quantizer {
+    explicit Quantizer(const SimplePackingParameters& params) :
+        decimal{power(params.decimalScaleFactor, 10)},
+        divisor{power(-params.binaryScaleFactor, 2)},
+        reference{static_cast<double>(params.referenceValue)},
+        maxint{power(params.bitsPerValue, 2) - 1} {}
+
+    template <typename T>
+    double scale(T v) const {
+        return (static_cast<double>(v) * decimal - reference) * divisor + 0.5;
+    }
+
+    std::uint32_t quantize(double x) const { return static_cast<std::uint32_t>(std::min(std::max(x, 0.0), maxint)); }
+
+    template <typename T>
+    std::uint32_t operator()(T v) const {
+        return quantize(scale(v));
+    }
+
+    // False for values outside of the range the parameters were computed for (and NaN), they would be clamped
+    bool fits(double x) const { return x >= 0.0 && x < maxint + 1.0; }
+
+    const double decimal;
+    const double divisor;
+    const double reference;
+    const double maxint;
+};
+
+// Returns false if any of the values does not fit into the range of the packing parameters
+template <typename T>
+bool packRange(const T* values, std::size_t begin, std::size_t end, const Quantizer& quantize, long bitsPerValue,
+               unsigned char* out) {
+    std::uint64_t acc = 0;
+    long nbits = 0;
+    bool fits = true;
+    std::uint32_t q[BLOCK];
+    for (std::size_t i = begin; i < end; i += BLOCK) {
+        const std::size_t n = std::min(BLOCK, end - i);
+        // Quantization is kept in its own loop without dependencies, so it can be vectorized
+        for (std::size_t k = 0; k < n; ++k) {
+            const double x = quantize.scale(values[i + k]);
+            fits &= quantize.fits(x);
+            q[k] = quantize.quantize(x);
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            acc = (acc << bitsPerValue) | q[k];
+            nbits += bitsPerValue;
+            while (nbits >= 8) {
+                nbits -= 8;
+                *out++ = static_cast<unsigned char>(acc >> nbits);
+            }
+        }
+    }
+    if (nbits > 0) {
+        *out = static_cast<unsigned char>(acc << (8 - nbits));
+    }
+    return fits;
+}
+
+template <typename T>
+void validate(const eckit::Buffer& message, const T* values, std::size_t count, const SimplePackingParameters& params) {
+    codes_handle* h = codes_handle_new_from_message(nullptr, message.data(), message.size());
+    if (!h) {
+        throw eckit::SeriousBug("Native simple packing: ecCodes can not decode the packed message", Here());
+    }
+    std::vector<double> decoded(count);
+    std::size_t size = count;
+    const int err = codes_get_double_array(h, "values", decoded.data(), &size);
+    codes_handle_delete(h);
+    if (err != 0 || size != count) {
+        std::ostringstream oss;
+        oss << "Native simple packing: decoding failed (" << codes_get_error_message(err) << "), " << size
+            << " values decoded, " << count << " expected";
+        throw eckit::SeriousBug(oss.str(), Here());
+    }
+
+    // Decoding as done by ecCodes: (X * 2^E + R) * 10^-D
+    const Quantizer quantize{params};
+    const double s = power(params.binaryScaleFactor, 2);
+    const double d = power(-params.decimalScaleFactor, 10);
+    const double reference = static_cast<double>(params.referenceValue);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double expected
+            = params.bitsPerValue == 0 ? reference : (static_cast<double>(quantize(values[i])) * s + reference) * d;
+        if (std::memcmp(&expected, &decoded[i], sizeof(double)) != 0) {
+            std::ostringstream oss;
+            oss << std::setprecision(17) << "Native simple packing: value " << i << " decodes to " << decoded[i]
+                << " instead of " << expected << " (input " << values[i] << ")";
+            throw eckit::SeriousBug(oss.str(), Here());
+        }
+    }
+}
+
+}  // namespace
+
+
+std::size_t simplePackedSize(std::size_t count, long bitsPerValue) {
+    return (count * static_cast<std::size_t>(bitsPerValue) + 7) / 8;
+}
+
+
+SimplePackingParameters simplePackingParameters(const ValueRange& range, long bitsPerValue, long decimalScaleFactor) {
+    SimplePackingParameters params;
+    params.decimalScaleFactor = decimalScaleFactor;
+    params.bitsPerValue = bitsPerValue;
+
+    const double decimal = power(decimalScaleFactor, 10);
+    const double min = range.min * decimal;
+    const double max = range.max * decimal;
+    if (!std::isfinite(min) || !std::isfinite(max)) {
+        throw eckit::UserError("Native simple packing: field contains non-finite values", Here());
+    }
+
+    params.referenceValue = nearestSmallerFloat(min);
+    if (max == min || bitsPerValue == 0) {
+        // Constant fields are encoded by their reference value only
+        params.referenceValue = nearestSmallerFloat(min / decimal);
+        params.decimalScaleFactor = 0;
+        params.bitsPerValue = 0;
+        return params;
+    }
+    params.binaryScaleFactor = binaryScaleFactor(max - static_cast<double>(params.referenceValue), bitsPerValue);
+    return params;
+}
+
+
+template <typename T>
+SimplePackingParameters simplePackingParameters(const T* values, std::size_t count, long bitsPerValue,
+                                                long decimalScaleFactor, std::size_t threads) {
+    if (count == 0) {
+        SimplePackingParameters params;
+        params.decimalScaleFactor = decimalScaleFactor;
+        return params;
+    }
+
+    // Branch-free reduction so that it can be vectorized, partials are combined in chunk order
+    const std::size_t nChunks = util::numChunks(threads, count, MIN_VALUES_PER_THREAD);
+    std::vector<T> mins(nChunks);
+    std::vector<T> maxs(nChunks);
+    util::parallelFor(nChunks, count, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        T mn = values[begin];
+        T mx = values[begin];
+        for (std::size_t i = begin; i < end; ++i) {
+            const T v = values[i];
+            mn = v < mn ? v : mn;
+            mx = v > mx ? v : mx;
+        }
+        mins[chunk] = mn;
+        maxs[chunk] = mx;
+    });
+    return simplePackingParameters(ValueRange{static_cast<double>(*std::min_element(mins.begin(), mins.end())),
+                                              static_cast<double>(*std::max_element(maxs.begin(), maxs.end()))},
+                                   bitsPerValue, decimalScaleFactor);
+}
+
+
+template <typename T>
+bool packSimple(const T* values, std::size_t count, const SimplePackingParameters& params, unsigned char* out,
+                std::size_t threads) {
+    if (params.bitsPerValue == 0) {
+        return true;
+    }
+    ASSERT(params.bitsPerValue <= MAX_BITS_PER_VALUE);
+
+    // Chunks are made of whole blocks, so each of them starts on a byte boundary of the output
+    const Quantizer quantize{params};
+    const std::size_t blocks = (count + BLOCK - 1) / BLOCK;
+    const std::size_t nChunks = util::numChunks(threads, count, MIN_VALUES_PER_THREAD);
+    std::vector<char> fits(nChunks, 1);
+    util::parallelFor(nChunks, blocks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        fits[chunk] = packRange(values, begin * BLOCK, std::min(end * BLOCK, count), quantize, params.bitsPerValue,
+                                out + begin * static_cast<std::size_t>(params.bitsPerValue));
+    });
+    return std::all_of(fits.begin(), fits.end(), [](char f) { return f != 0; });
+}
+
+
+template <typename T>
+std::optional<eckit::Buffer> encodeSimplePacked(const eckit::Buffer& header, const T* values, std::size_t count,
+                                                long bitsPerValue, const SimplePackingOptions& options,
+                                                const std::optional<ValueRange>& range) {
+    const auto* in = static_cast<const unsigned char*>(header.data());
+
+    std::size_t sections[8];
+    if (bitsPerValue < 0 || bitsPerValue > MAX_BITS_PER_VALUE || !locateSections(header, sections)) {
+        return std::nullopt;
+    }
+    const std::size_t s3 = sections[3];
+    const std::size_t s5 = sections[5];
+    const std::size_t s6 = sections[6];
+    if (s3 == 0 || s5 == 0 || s6 == 0 || sections[7] == 0 || s6 != s5 + SECTION5_LENGTH) {
+        return std::nullopt;
+    }
+    // Grid size, simple packing and no bitmap
+    if (readUnsigned(in + s3 + 6, 4) != count || readUnsigned(in + s5, 4) != SECTION5_LENGTH
+        || readUnsigned(in + s5 + 9, 2) != 0 || in[s6 + 5] != 255) {
+        return std::nullopt;
+    }
+    const std::size_t s6Length = readUnsigned(in + s6, 4);
+
+    const long decimalScaleFactor = readSigned16(in + s5 + 17);
+    const auto scan = [&]() {
+        return simplePackingParameters(values, count, bitsPerValue, decimalScaleFactor, options.threads);
+    };
+
+    // A given range is only trusted as far as the values fit into it, which is checked while packing. A constant
+    // range writes no bits and can not be checked that way, the values are scanned instead
+    std::optional<SimplePackingParameters> params;
+    if (range && count > 0) {
+        params = simplePackingParameters(*range, bitsPerValue, decimalScaleFactor);
+        if (params->bitsPerValue == 0 && bitsPerValue > 0) {
+            params.reset();
+        }
+    }
+    const bool checkRange = params.has_value();
+    if (!params) {
+        params = scan();
+    }
+
+    const std::size_t s7 = s6 + s6Length;
+    const auto pack = [&](const SimplePackingParameters& packing) -> std::optional<eckit::Buffer> {
+        const std::size_t packedSize = simplePackedSize(count, packing.bitsPerValue);
+        const std::size_t total = s7 + 5 + packedSize + 4;
+
+        eckit::Buffer out{total};
+        auto* o = static_cast<unsigned char*>(out.data());
+
+        // Sections 0 to 6 are taken from ecCodes, section 5 is updated with the packing parameters
+        std::memcpy(o, in, s7);
+        writeUnsigned(o + 8, total, 8);
+        writeUnsigned(o + s5 + 5, count, 4);
+        writeFloat(o + s5 + 11, packing.referenceValue);
+        writeSigned16(o + s5 + 15, packing.binaryScaleFactor);
+        writeSigned16(o + s5 + 17, packing.decimalScaleFactor);
+        o[s5 + 19] = static_cast<unsigned char>(packing.bitsPerValue);
+
+        writeUnsigned(o + s7, 5 + packedSize, 4);
+        o[s7 + 4] = 7;
+        const bool fits = packSimple(values, count, packing, o + s7 + 5, options.threads);
+        std::memcpy(o + s7 + 5 + packedSize, "7777", 4);
+        if (checkRange && !fits) {
+            return std::nullopt;
+        }
+        return out;
+    };
+
+    auto out = pack(*params);
+    if (!out) {
+        // Values outside of the given range (e.g. statistics not updated by an action that changed the values)
+        LOG_DEBUG_LIB(LibMultio) << "Native simple packing :: values outside of the given range [" << range->min
+                                 << ", " << range->max << "], computing the range of the values" << std::endl;
+        params = scan();
+        out = pack(*params);
+        ASSERT(out);
+    }
+
+    if (options.validate) {
+        validate(*out, values, count, *params);
+    }
+
+    LOG_DEBUG_LIB(LibMultio) << "Native simple packing :: values=" << count << ", bitsPerValue=" << params->bitsPerValue
+                             << ", binaryScaleFactor=" << params->binaryScaleFactor
+                             << ", decimalScaleFactor=" << params->decimalScaleFactor << std::endl;
+    return out;
+}
+
+std::optional<eckit::Buffer> spliceDataSections(const eckit::Buffer& header, const eckit::Buffer& encoded) {
+    std::size_t h[8];
+    std::size_t e[8];
+    if (!locateSections(header, h) || !locateSections(encoded, e)) {
+        return std::nullopt;
+    }
+
+    const auto* hin = static_cast<const unsigned char*>(header.data());
+    const auto* ein = static_cast<const unsigned char*>(encoded.data());
+
+    // The data sections are only valid for the same grid
+    const std::size_t s3Length = readUnsigned(hin + h[3], 4);
+    if (s3Length != readUnsigned(ein + e[3], 4) || std::memcmp(hin + h[3], ein + e[3], s3Length) != 0) {
+        return std::nullopt;
+    }
+
+    const std::size_t headLength = h[5];
+    const std::size_t dataLength = encoded.size() - e[5];
+    const std::size_t total = headLength + dataLength;
+
+    eckit::Buffer out{total};
+    auto* o = static_cast<unsigned char*>(out.data());
+    std::memcpy(o, hin, headLength);
+    std::memcpy(o + headLength, ein + e[5], dataLength);
+    writeUnsigned(o + 8, total, 8);
+    return out;
+}
+
+
+template SimplePackingParameters simplePackingParameters<float>(const float*, std::size_t, long, long, std::size_t);
+template SimplePackingParameters simplePackingParameters<double>(const double*, std::size_t, long, long, std::size_t);
+
+template bool packSimple<float>(const float*, std::size_t, const SimplePackingParameters&, unsigned char*,
+                                std::size_t);
+template bool packSimple<double>(const double*, std::size_t, const SimplePackingParameters&, unsigned char*,
+                                 std::size_t);
+
+template std::optional<eckit::Buffer> encodeSimplePacked<float>(const eckit::Buffer&, const float*, std::size_t, long,
+                                                                const SimplePackingOptions&,
+                                                                const std::optional<ValueRange>&);
+template std::optional<eckit::Buffer> encodeSimplePacked<double>(const eckit::Buffer&, const double*, std::size_t,
+                                                                 long, const SimplePackingOptions&,
+                                                                 const std::optional<ValueRange>&);
+
+}  // namespace multio::action
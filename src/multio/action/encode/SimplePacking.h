@@ -0,0 +1,76 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "eckit/io/Buffer.h"
+
+namespace multio::action {
+
+// Parameters of GRIB2 simple packing (data representation template 5.0)
+struct SimplePackingParameters {
+    float referenceValue = 0;
+    long binaryScaleFactor = 0;
+    long decimalScaleFactor = 0;
+    long bitsPerValue = 0;
+};
+
+// Minimum and maximum of the values of a field, if already known (e.g. collected while interpolating)
+struct ValueRange {
+    double min = 0;
+    double max = 0;
+};
+
+struct SimplePackingOptions {
+    std::size_t threads = 1;
+    // Decode the packed message with ecCodes and compare bitwise with the values the packer intended to encode
+    bool validate = false;
+};
+
+// Computes the packing parameters of a field the same way ecCodes does for grid_simple:
+// the reference value is the largest float not above the minimum and the binary scale factor
+// the smallest one for which the range fits into bitsPerValue bits.
+template <typename T>
+SimplePackingParameters simplePackingParameters(const T* values, std::size_t count, long bitsPerValue,
+                                                long decimalScaleFactor, std::size_t threads = 1);
+
+// Same from the range of the values, without a pass over them. The range has to be the exact minimum and maximum of
+// the (non-empty) field for the result to be identical.
+SimplePackingParameters simplePackingParameters(const ValueRange& range, long bitsPerValue, long decimalScaleFactor);
+
+// Scales, quantizes and bit-packs (big-endian, most significant bit first) the values into out,
+// which has to hold at least simplePackedSize(count, bitsPerValue) bytes. Returns false if any value was outside of
+// the range the parameters were computed for, such values are clamped.
+template <typename T>
+bool packSimple(const T* values, std::size_t count, const SimplePackingParameters& params, unsigned char* out,
+                std::size_t threads = 1);
+
+std::size_t simplePackedSize(std::size_t count, long bitsPerValue);
+
+// Replaces sections 5 to 8 of a single GRIB2 message produced by ecCodes (header) with natively packed values.
+// Only grid_simple without bitmap is supported, nothing is returned for any other layout and the caller is
+// expected to fall back to ecCodes. The number of points of the grid (section 3) has to match count. If the range of
+// the values is given, the values are only read to be packed. Values found outside of it while packing make the
+// field be packed again with its actual range.
+template <typename T>
+std::optional<eckit::Buffer> encodeSimplePacked(const eckit::Buffer& header, const T* values, std::size_t count,
+                                                long bitsPerValue, const SimplePackingOptions& options,
+                                                const std::optional<ValueRange>& range = std::nullopt);
+
+// Combines sections 0 to 4 of header with the data sections (5 to 7) of a previously encoded message, such that
+// the packed data of a field can be reused with updated product metadata. Both have to be single field GRIB2
+// messages on the same grid (identical section 3), otherwise nothing is returned.
+std::optional<eckit::Buffer> spliceDataSections(const eckit::Buffer& header, const eckit::Buffer& encoded);
+
+}  // namespace multio::action
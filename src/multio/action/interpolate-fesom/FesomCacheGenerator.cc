@@ -75,6 +75,9 @@ private:
             << "fesom-cache-generator --mode=fromTriplets --inputPath=. --inputFile=CORE2_ngrid_NSIDE32_0_ring.csv "
                "--dumpTriplets=1"
             << std::endl
+            << "With --format=flat (or both) the caches are (also) written as flat files (.csr) which are memory-mapped "
+               "by the interpolate-fesom action and preferred over the atlas files."
+            << std::endl
             << std::endl;
     }
 
@@ -94,6 +97,7 @@ private:
     std::string outputPrecision_;
     std::string inputFile_;
     std::string workingMode_;
+    std::string format_;
     bool dumpTriplets_;
 
     std::string fesomName_;
@@ -112,6 +116,7 @@ FesomCacheGenerator::FesomCacheGenerator(int argc, char** argv) :
     outputPath_{"."},
     inputFile_{"CORE2_ngrid_NSIDE32_0_ring.csv"},
     workingMode_{"fromTriplets"},
+    format_{"atlas"},
     dumpTriplets_{false},
     fesomName_{"CORE2"},
     domain_{"ngrid"},
@@ -127,6 +132,8 @@ FesomCacheGenerator::FesomCacheGenerator(int argc, char** argv) :
         "outputPath", "Path of the output files with the triplets. Default( \".\" )"));
     options_.push_back(new eckit::option::SimpleOption<std::string>(
         "inputFile", "Name of the input file. Default( \"CORE2_ngrid_NSIDE32_0_ring.csv\" )"));
+    options_.push_back(new eckit::option::SimpleOption<std::string>(
+        "format", "Format of the cache files [atlas, flat, both]. Default( \"atlas\" )"));
     options_.push_back(new eckit::option::SimpleOption<bool>("dumpTriplets", "Dump all the triplets to screen"));
 
     return;
@@ -171,7 +178,11 @@ void FesomCacheGenerator::init(const eckit::option::CmdArgs& args) {
         args.get("inputPath", inputPath_);
         args.get("outputPath", outputPath_);
         args.get("inputFile", inputFile_);
+        args.get("format", format_);
         args.get("dumpTriplets", dumpTriplets_);
+        if (format_ != "atlas" && format_ != "flat" && format_ != "both") {
+            throw eckit::UserError("Unknown cache format: " + format_, Here());
+        }
 
         eckit::PathName inputPath_tmp{inputPath_};
         ASSERT(inputPath_tmp.exists());
@@ -208,14 +219,26 @@ void FesomCacheGenerator::execute(const eckit::option::CmdArgs& args) {
         weightsf.generateCacheFromTriplets(NSide_, orderingConvention_, level_, nnz, nRows, nCols, nOutRows,
                                            landSeaMask, rowStart, colIdx, valuesf);
 
-        weightsf.dumpCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows, nCols,
-                           nOutRows, landSeaMask, rowStart, colIdx, valuesf);
+        if (format_ != "flat") {
+            weightsf.dumpCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows,
+                               nCols, nOutRows, landSeaMask, rowStart, colIdx, valuesf);
+        }
+        if (format_ != "atlas") {
+            weightsf.dumpFlatCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows,
+                                   nCols, nOutRows, landSeaMask, rowStart, colIdx, valuesf);
+        }
 
         weightsd.generateCacheFromTriplets(NSide_, orderingConvention_, level_, nnz, nRows, nCols, nOutRows,
                                            landSeaMask, rowStart, colIdx, valuesd);
 
-        weightsd.dumpCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows, nCols,
-                           nOutRows, landSeaMask, rowStart, colIdx, valuesd);
+        if (format_ != "flat") {
+            weightsd.dumpCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows,
+                               nCols, nOutRows, landSeaMask, rowStart, colIdx, valuesd);
+        }
+        if (format_ != "atlas") {
+            weightsd.dumpFlatCache(outputPath_, fesomName_, domain_, NSide_, orderingConvention_, level_, nnz, nRows,
+                                   nCols, nOutRows, landSeaMask, rowStart, colIdx, valuesd);
+        }
 
         if (dumpTriplets_) {
             weightsf.dumpTriplets();
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include "InterpolateFesom_debug.h"
+#include "eckit/filesystem/PathName.h"
 
 namespace multio::action::interpolateFESOM {
 
@@ -58,6 +59,21 @@ std::string fesomCacheName(const std::string& fesomName, const std::string& doma
     return os.str();
 }
 
+
+std::optional<std::string> findFesomCache(const std::string& cachePath, const std::string& fesomName,
+                                          const std::string& domain, const std::string& precision, size_t NSide,
+                                          orderingConvention_e orderingConvention, double level) {
+    const std::string base
+        = cachePath + "/" + fesomCacheName(fesomName, domain, precision, NSide, orderingConvention, level);
+    // Flat caches can be memory-mapped and are preferred if present
+    for (const auto& fname : {base + ".csr", base + ".atlas"}) {
+        if (eckit::PathName{fname}.exists()) {
+            return fname;
+        }
+    }
+    return std::nullopt;
+}
+
 // -------------------------------------------------------------------------------------------------
 
 
@@ -4,8 +4,11 @@
 #include <algorithm>
 #include <cmath>
 #include <map>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "FesomMatrixStore.h"
 #include "InterpolateFesom_debug.h"
 #include "atlas_io/atlas-io.h"
 #include "eckit/exception/Exceptions.h"
@@ -29,6 +32,11 @@ std::string orderingConvention_enum2string(orderingConvention_e orderingConventi
 std::string fesomCacheName(const std::string& fesomName, const std::string& domain, const std::string& precision,
                            size_t NSide, orderingConvention_e orderingConvention, double level);
 
+// Path of the cache file in cachePath, the flat cache (`.csr`) if present, else the atlas cache. Empty if none exists.
+std::optional<std::string> findFesomCache(const std::string& cachePath, const std::string& fesomName,
+                                          const std::string& domain, const std::string& precision, size_t NSide,
+                                          orderingConvention_e orderingConvention, double level);
+
 class Tri {
 private:
     std::int32_t i_;  // Index in the HEALPix grid
@@ -165,6 +173,38 @@ public:
 
         return;
     }
+
+    // Same content as dumpCache, written as a flat cache (`.csr`) that can be memory-mapped (see FesomMatrixStore)
+    template <typename T>
+    void dumpFlatCache(const std::string& outputPath, const std::string& fesomName, const std::string& domain,
+                       size_t NSide, orderingConvention_e orderingConvention, size_t level, size_t nnz, size_t nRows,
+                       size_t nCols, size_t nOutRows, const std::vector<std::int32_t>& landSeaMask,
+                       const std::vector<std::int32_t>& rowStart, const std::vector<std::int32_t>& colIdx,
+                       const std::vector<T>& values) const {
+
+        INTERPOLATE_FESOM_OUT_STREAM << " - FesomIntermopationWeights: enter dumpFlatCache"
+                                     << (sizeof(T) == 4 ? "<single>" : "<double>") << std::endl;
+
+        std::ostringstream os;
+        os << outputPath << "/"
+           << fesomCacheName(fesomName, domain, (sizeof(T) == 4 ? "single" : "double"), NSide, orderingConvention,
+                             level)
+           << ".csr";
+
+        FesomMatrix<T> matrix;
+        matrix.nnz = nnz;
+        matrix.nRows = nRows;
+        matrix.nCols = nCols;
+        matrix.nOutRows = nOutRows;
+        matrix.landSeaMask = landSeaMask.data();
+        matrix.rowStart = rowStart.data();
+        matrix.colIdx = colIdx.data();
+        matrix.values = values.data();
+        writeFlatCache(os.str(), NSide, level, matrix);
+
+        INTERPOLATE_FESOM_OUT_STREAM << " - FesomIntermopationWeights: exit dumpFlatCache"
+                                     << (sizeof(T) == 4 ? "<single>" : "<double>") << std::endl;
+    }
 };
 
 }  // namespace multio::action::interpolateFESOM
@@ -0,0 +1,171 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "FesomMatrixPrefetcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <thread>
+
+#include "InterpolateFesom_debug.h"
+#include "multio/LibMultio.h"
+#include "multio/util/Timing.h"
+
+
+namespace multio::action::interpolateFESOM {
+
+namespace {
+
+template <typename Func>
+double timed(Func&& func) {
+    util::Timing<> timing;
+    timing.tic();
+    func();
+    timing.toc();
+    timing.process();
+    return timing.elapsedTimeSeconds();
+}
+
+}  // namespace
+
+
+template <typename MatrixType>
+void FesomMatrixPrefetcher<MatrixType>::Latencies::add(double seconds) {
+    ++count;
+    total += seconds;
+    max = std::max(max, seconds);
+}
+
+template <typename MatrixType>
+void FesomMatrixPrefetcher<MatrixType>::Latencies::report(std::ostream& out, const std::string& label) const {
+    out << "    -- " << label << ": " << count;
+    if (count > 0) {
+        out << " (total " << total << "s, mean " << total / static_cast<double>(count) << "s, max " << max << "s)";
+    }
+    out << std::endl;
+}
+
+
+template <typename MatrixType>
+FesomMatrixPrefetcher<MatrixType>::FesomMatrixPrefetcher() {
+    worker_ = std::make_unique<util::ScopedThread>(std::thread{[this]() { work(); }});
+}
+
+template <typename MatrixType>
+FesomMatrixPrefetcher<MatrixType>::~FesomMatrixPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+    taskAvailable_.notify_all();
+    worker_.reset();
+}
+
+template <typename MatrixType>
+void FesomMatrixPrefetcher<MatrixType>::prefetch(const std::string& file) {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (pending_.find(file) != pending_.end()) {
+            return;
+        }
+        std::promise<MatrixPtr> promise;
+        pending_.emplace(file, promise.get_future().share());
+        queue_.emplace_back(file, std::move(promise));
+    }
+    taskAvailable_.notify_one();
+}
+
+template <typename MatrixType>
+typename FesomMatrixPrefetcher<MatrixType>::MatrixPtr FesomMatrixPrefetcher<MatrixType>::get(const std::string& file) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    auto search = pending_.find(file);
+    if (search == pending_.end()) {
+        lock.unlock();
+        MatrixPtr matrix;
+        const double seconds = timed([&]() { matrix = FesomMatrixStore::instance().get<MatrixType>(file); });
+        INTERPOLATE_FESOM_OUT_STREAM << " - FesomMatrixPrefetcher: loaded " << file << " on request in " << seconds
+                                     << "s" << std::endl;
+        lock.lock();
+        directLoads_.add(seconds);
+        return matrix;
+    }
+
+    // The matrix is handed over, its users keep it alive from now on
+    std::shared_future<MatrixPtr> matrix = search->second;
+    pending_.erase(search);
+
+    if (matrix.wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+        ++ready_;
+        lock.unlock();
+        return matrix.get();
+    }
+
+    lock.unlock();
+    const double seconds = timed([&]() { matrix.wait(); });
+    INTERPOLATE_FESOM_OUT_STREAM << " - FesomMatrixPrefetcher: waited " << seconds << "s for " << file << std::endl;
+    lock.lock();
+    waits_.add(seconds);
+    lock.unlock();
+    return matrix.get();
+}
+
+template <typename MatrixType>
+void FesomMatrixPrefetcher<MatrixType>::work() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        taskAvailable_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            return;
+        }
+
+        auto [file, promise] = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        MatrixPtr matrix;
+        std::exception_ptr error;
+        const double seconds = timed([&]() {
+            try {
+                matrix = FesomMatrixStore::instance().get<MatrixType>(file);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        });
+        INTERPOLATE_FESOM_OUT_STREAM << " - FesomMatrixPrefetcher: prefetched " << file << " in " << seconds << "s"
+                                     << std::endl;
+        if (error) {
+            promise.set_exception(error);
+        }
+        else {
+            promise.set_value(std::move(matrix));
+        }
+
+        lock.lock();
+        prefetchLoads_.add(seconds);
+    }
+}
+
+template <typename MatrixType>
+void FesomMatrixPrefetcher<MatrixType>::report(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    prefetchLoads_.report(out, "matrices prefetched");
+    out << "    -- matrices ready when requested: " << ready_ << std::endl;
+    waits_.report(out, "requests waiting for a prefetch");
+    directLoads_.report(out, "matrices loaded on request");
+}
+
+
+template class FesomMatrixPrefetcher<float>;
+template class FesomMatrixPrefetcher<double>;
+
+}  // namespace multio::action::interpolateFESOM
@@ -0,0 +1,85 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "FesomMatrixStore.h"
+#include "multio/util/ScopedThread.h"
+
+
+namespace multio::action::interpolateFESOM {
+
+/**
+ * Loads cache matrices on a background IO thread (through the FesomMatrixStore), in the order they are queued.
+ * Requesting a matrix blocks only while it is still being loaded; matrices that were never queued are loaded by the
+ * requesting thread. Load and wait latencies are collected for report().
+ */
+template <typename MatrixType>
+class FesomMatrixPrefetcher {
+public:
+    using MatrixPtr = std::shared_ptr<const FesomMatrix<MatrixType>>;
+
+    FesomMatrixPrefetcher();
+    ~FesomMatrixPrefetcher();
+
+    FesomMatrixPrefetcher(const FesomMatrixPrefetcher&) = delete;
+    FesomMatrixPrefetcher& operator=(const FesomMatrixPrefetcher&) = delete;
+
+    // Queues a file, ignored if it is already queued or loaded and not requested yet
+    void prefetch(const std::string& file);
+
+    // Hands over the matrix of a file. Errors of a background load are rethrown here.
+    MatrixPtr get(const std::string& file);
+
+    void report(std::ostream& out) const;
+
+private:
+    struct Latencies {
+        std::size_t count = 0;
+        double total = 0.0;
+        double max = 0.0;
+
+        void add(double seconds);
+        void report(std::ostream& out, const std::string& label) const;
+    };
+
+    void work();
+
+    mutable std::mutex mutex_;
+    std::condition_variable taskAvailable_;
+
+    std::deque<std::pair<std::string, std::promise<MatrixPtr>>> queue_;
+    std::map<std::string, std::shared_future<MatrixPtr>> pending_;
+    bool stop_ = false;
+
+    // Background loads (updated under the lock)
+    Latencies prefetchLoads_;
+    // Requests served without waiting, after waiting for the background load, or loaded by the requesting thread
+    std::size_t ready_ = 0;
+    Latencies waits_;
+    Latencies directLoads_;
+
+    std::unique_ptr<util::ScopedThread> worker_;
+};
+
+}  // namespace multio::action::interpolateFESOM
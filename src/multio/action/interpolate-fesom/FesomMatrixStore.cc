@@ -0,0 +1,441 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "FesomMatrixStore.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "InterpolateFesom_debug.h"
+#include "atlas_io/atlas-io.h"
+#include "eckit/exception/Exceptions.h"
+#include "multio/LibMultio.h"
+#include "multio/util/ContentHash.h"
+
+
+namespace multio::action::interpolateFESOM {
+
+namespace {
+
+constexpr char FLAT_MAGIC[8] = {'F', 'E', 'S', 'O', 'M', 'C', 'S', 'R'};
+// Version 2 added the byte order mark
+constexpr std::uint32_t FLAT_VERSION = 2;
+// Written in native byte order, reads differently on a host of the other byte order
+constexpr std::uint32_t FLAT_BYTE_ORDER_MARK = 0x01020304;
+
+struct FlatCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrderMark;
+    std::uint32_t valueSize;
+    std::uint32_t padding;
+    std::uint64_t nside;
+    std::uint64_t level;
+    std::uint64_t nnz;
+    std::uint64_t nRows;
+    std::uint64_t nCols;
+    std::uint64_t nOutRows;
+    std::uint64_t checksum;
+};
+static_assert(sizeof(FlatCacheHeader) % 8 == 0, "Arrays following the header have to stay aligned");
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) / 8 * 8;
+}
+
+// Offsets of the arrays relative to the end of the header, the last entry is the total size
+std::vector<size_t> flatLayout(size_t nRows, size_t nnz, size_t valueSize) {
+    std::vector<size_t> offsets{0};
+    for (size_t bytes : {nRows * sizeof(std::int32_t), (nRows + 1) * sizeof(std::int32_t), nnz * sizeof(std::int32_t),
+                         nnz * valueSize}) {
+        offsets.push_back(offsets.back() + padded(bytes));
+    }
+    return offsets;
+}
+
+bool isFlatCache(const std::string& file) {
+    return file.size() > 4 && file.compare(file.size() - 4, 4, ".csr") == 0;
+}
+
+std::string precisionName(size_t valueSize) {
+    return valueSize == 4 ? "single" : "double";
+}
+
+// Indices of a CSR matrix have to be in range before it is used, rows are not checked again when interpolating
+template <typename MatrixType>
+void checkStructure(const FesomMatrix<MatrixType>& matrix, const std::string& file) {
+    auto fail = [&file](const std::string& what) {
+        throw eckit::SeriousBug("Invalid FESOM cache " + file + ": " + what, Here());
+    };
+    if (matrix.nnz > static_cast<size_t>(INT32_MAX) || matrix.nCols > static_cast<size_t>(INT32_MAX)
+        || matrix.nOutRows > static_cast<size_t>(INT32_MAX)) {
+        fail("dimensions exceed 32 bit indices");
+    }
+    if (matrix.rowStart[0] != 0 || static_cast<size_t>(matrix.rowStart[matrix.nRows]) != matrix.nnz) {
+        fail("row pointers do not span the non-zeros");
+    }
+    for (size_t iRow = 0; iRow < matrix.nRows; iRow++) {
+        if (matrix.rowStart[iRow + 1] < matrix.rowStart[iRow]) {
+            fail("row pointers are decreasing at row " + std::to_string(iRow));
+        }
+        if (matrix.landSeaMask[iRow] < 0 || static_cast<size_t>(matrix.landSeaMask[iRow]) >= matrix.nOutRows) {
+            fail("output point out of range at row " + std::to_string(iRow));
+        }
+    }
+    for (size_t i = 0; i < matrix.nnz; i++) {
+        if (matrix.colIdx[i] < 0 || static_cast<size_t>(matrix.colIdx[i]) >= matrix.nCols) {
+            fail("column index out of range at non-zero " + std::to_string(i));
+        }
+    }
+}
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw eckit::SeriousBug("Unable to open file: " + path + " (" + std::strerror(errno) + ")", Here());
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw eckit::SeriousBug("Unable to stat file: " + path + " (" + std::strerror(errno) + ")", Here());
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* addr = size_ > 0 ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            throw eckit::SeriousBug("Unable to map file: " + path + " (" + std::strerror(errno) + ")", Here());
+        }
+        data_ = static_cast<const char*>(addr);
+    }
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+template <typename MatrixType>
+struct MappedMatrix : FesomMatrix<MatrixType> {
+    explicit MappedMatrix(const std::string& file) : mapping{file} {
+        if (mapping.size() < sizeof(FlatCacheHeader)) {
+            throw eckit::SeriousBug("Flat cache too small: " + file, Here());
+        }
+        FlatCacheHeader header;
+        std::memcpy(&header, mapping.data(), sizeof(header));
+        if (std::memcmp(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0) {
+            throw eckit::SeriousBug("Not a flat FESOM cache: " + file, Here());
+        }
+        if (header.version != FLAT_VERSION) {
+            std::ostringstream os;
+            os << "Wrong version: " << header.version << " " << FLAT_VERSION << " in " << file;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        if (header.byteOrderMark != FLAT_BYTE_ORDER_MARK) {
+            throw eckit::SeriousBug("Flat cache " + file + " was written on a host of a different byte order", Here());
+        }
+        if (header.valueSize != sizeof(MatrixType)) {
+            throw eckit::SeriousBug("Flat cache " + file + " holds " + precisionName(header.valueSize)
+                                        + " precision weights, expected " + precisionName(sizeof(MatrixType)),
+                                    Here());
+        }
+
+        // Bounds the dimensions before the layout is computed from them
+        if (header.nRows > mapping.size() || header.nnz > mapping.size()) {
+            throw eckit::SeriousBug("Wrong dimensions in flat cache: " + file, Here());
+        }
+        const auto layout = flatLayout(header.nRows, header.nnz, header.valueSize);
+        if (mapping.size() != sizeof(FlatCacheHeader) + layout.back()) {
+            std::ostringstream os;
+            os << "Wrong size of flat cache " << file << ": " << mapping.size() << " "
+               << sizeof(FlatCacheHeader) + layout.back();
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+
+        const char* body = mapping.data() + sizeof(FlatCacheHeader);
+        if (util::contentHash(body, layout.back()) != header.checksum) {
+            throw eckit::SeriousBug("Checksum mismatch in flat cache: " + file, Here());
+        }
+
+        this->nnz = header.nnz;
+        this->nRows = header.nRows;
+        this->nCols = header.nCols;
+        this->nOutRows = header.nOutRows;
+        this->landSeaMask = reinterpret_cast<const std::int32_t*>(body + layout[0]);
+        this->rowStart = reinterpret_cast<const std::int32_t*>(body + layout[1]);
+        this->colIdx = reinterpret_cast<const std::int32_t*>(body + layout[2]);
+        this->values = reinterpret_cast<const MatrixType*>(body + layout[3]);
+
+        checkStructure<MatrixType>(*this, file);
+    }
+
+    MappedFile mapping;
+};
+
+template <typename MatrixType>
+struct LoadedMatrix : FesomMatrix<MatrixType> {
+    explicit LoadedMatrix(const std::string& file) {
+        INTERPOLATE_FESOM_OUT_STREAM << " - FesomMatrixStore: reading " << file << std::endl;
+        size_t version;
+        size_t NSideR;
+        size_t levelR;
+        atlas::io::RecordReader reader(file);
+        // Read the objects needed for the interpolation
+        reader.read("version", version);
+        reader.wait();
+        if (version != 0) {
+            std::ostringstream os;
+            os << "Wrong version: " << version << " " << 0 << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        reader.read("nside", NSideR);
+        reader.read("level", levelR);
+        reader.read("nnz", this->nnz);
+        reader.read("nRows", this->nRows);
+        reader.read("nCols", this->nCols);
+        reader.read("nOutRows", this->nOutRows);
+        reader.read("landSeaMask", landSeaMaskData);
+        reader.read("rowPtr", rowStartData);
+        reader.read("colIdx", colIdxData);
+        reader.read("weights", valuesData);
+        reader.wait();
+        // Check sizes
+        if (landSeaMaskData.size() != this->nRows) {
+            std::ostringstream os;
+            os << " - Wrong size of lenad sea mask: " << landSeaMaskData.size() << " " << this->nRows << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        if (rowStartData.size() != (this->nRows + 1)) {
+            std::ostringstream os;
+            os << " - Wrong size of rowstart: " << rowStartData.size() << " " << (this->nRows + 1) << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        if (colIdxData.size() != this->nnz) {
+            std::ostringstream os;
+            os << " - Wrong size of colidx: " << colIdxData.size() << " " << this->nnz << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        if (valuesData.size() != this->nnz) {
+            std::ostringstream os;
+            os << " - Wrong size of values: " << valuesData.size() << " " << this->nnz << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+
+        this->landSeaMask = landSeaMaskData.data();
+        this->rowStart = rowStartData.data();
+        this->colIdx = colIdxData.data();
+        this->values = valuesData.data();
+
+        checkStructure<MatrixType>(*this, file);
+    }
+
+    std::vector<std::int32_t> landSeaMaskData;
+    std::vector<std::int32_t> rowStartData;
+    std::vector<std::int32_t> colIdxData;
+    std::vector<MatrixType> valuesData;
+};
+
+}  // namespace
+
+
+template <typename MatrixType>
+void writeFlatCache(const std::string& file, size_t NSide, size_t level, const FesomMatrix<MatrixType>& matrix) {
+    const auto layout = flatLayout(matrix.nRows, matrix.nnz, sizeof(MatrixType));
+
+    std::vector<char> body(layout.back(), 0);
+    std::memcpy(body.data() + layout[0], matrix.landSeaMask, matrix.nRows * sizeof(std::int32_t));
+    std::memcpy(body.data() + layout[1], matrix.rowStart, (matrix.nRows + 1) * sizeof(std::int32_t));
+    std::memcpy(body.data() + layout[2], matrix.colIdx, matrix.nnz * sizeof(std::int32_t));
+    std::memcpy(body.data() + layout[3], matrix.values, matrix.nnz * sizeof(MatrixType));
+
+    FlatCacheHeader header{};
+    std::memcpy(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+    header.version = FLAT_VERSION;
+    header.byteOrderMark = FLAT_BYTE_ORDER_MARK;
+    header.valueSize = sizeof(MatrixType);
+    header.nside = NSide;
+    header.level = level;
+    header.nnz = matrix.nnz;
+    header.nRows = matrix.nRows;
+    header.nCols = matrix.nCols;
+    header.nOutRows = matrix.nOutRows;
+    header.checksum = util::contentHash(body.data(), body.size());
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(body.data(), body.size());
+    if (!out) {
+        throw eckit::SeriousBug("Unable to write flat cache: " + file, Here());
+    }
+}
+
+template void writeFlatCache<float>(const std::string&, size_t, size_t, const FesomMatrix<float>&);
+template void writeFlatCache<double>(const std::string&, size_t, size_t, const FesomMatrix<double>&);
+
+
+template <typename MatrixType>
+void writeAtlasCache(const std::string& file, size_t NSide, size_t level, const FesomMatrix<MatrixType>& matrix) {
+    atlas::io::RecordWriter record;
+    record.compression("none");
+    record.set("version", static_cast<size_t>(0));
+    record.set("nside", NSide);
+    record.set("level", level);
+    record.set("nnz", matrix.nnz);
+    record.set("nRows", matrix.nRows);
+    record.set("nCols", matrix.nCols);
+    record.set("nOutRows", matrix.nOutRows);
+    record.set("landSeaMask", atlas::io::ArrayReference(matrix.landSeaMask, std::vector<size_t>{matrix.nRows}));
+    record.set("rowPtr", atlas::io::ArrayReference(matrix.rowStart, std::vector<size_t>{matrix.nRows + 1}));
+    record.set("colIdx", atlas::io::ArrayReference(matrix.colIdx, std::vector<size_t>{matrix.nnz}));
+    record.set("weights", atlas::io::ArrayReference(matrix.values, std::vector<size_t>{matrix.nnz}));
+    record.write(file);
+}
+
+template void writeAtlasCache<float>(const std::string&, size_t, size_t, const FesomMatrix<float>&);
+template void writeAtlasCache<double>(const std::string&, size_t, size_t, const FesomMatrix<double>&);
+
+
+FesomMatrixStore& FesomMatrixStore::instance() {
+    static FesomMatrixStore store;
+    return store;
+}
+
+template <typename MatrixType>
+std::shared_ptr<const FesomMatrix<MatrixType>> FesomMatrixStore::get(const std::string& file) {
+    const std::string key = file + ":" + precisionName(sizeof(MatrixType));
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (auto search = matrices_.find(key); search != matrices_.end()) {
+            if (auto matrix = search->second.lock()) {
+                return std::static_pointer_cast<const FesomMatrix<MatrixType>>(matrix);
+            }
+        }
+    }
+
+    // Loaded without holding the lock, such that other matrices can be looked up (or loaded) meanwhile
+    std::shared_ptr<const FesomMatrix<MatrixType>> matrix;
+    if (isFlatCache(file)) {
+        matrix = std::make_shared<const MappedMatrix<MatrixType>>(file);
+    }
+    else {
+        matrix = std::make_shared<const LoadedMatrix<MatrixType>>(file);
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    // Entries of released matrices are dropped, as many caches (e.g. one per level) are used over a run
+    for (auto it = matrices_.begin(); it != matrices_.end();) {
+        if (it->second.expired() && it->first != key) {
+            it = matrices_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    auto& entry = matrices_[key];
+    if (auto loaded = entry.lock()) {
+        // Loaded concurrently by another user
+        return std::static_pointer_cast<const FesomMatrix<MatrixType>>(loaded);
+    }
+    entry = matrix;
+    return matrix;
+}
+
+template std::shared_ptr<const FesomMatrix<float>> FesomMatrixStore::get<float>(const std::string&);
+template std::shared_ptr<const FesomMatrix<double>> FesomMatrixStore::get<double>(const std::string&);
+
+namespace {
+
+template <typename WeightType, typename MatrixType>
+struct ConvertedWeights {
+    std::shared_ptr<const FesomMatrix<MatrixType>> matrix;
+    std::vector<WeightType> values;
+};
+
+}  // namespace
+
+template <typename WeightType, typename MatrixType>
+std::shared_ptr<const WeightType> FesomMatrixStore::convertedWeights(
+    const std::shared_ptr<const FesomMatrix<MatrixType>>& matrix) {
+    const auto key = std::make_pair(static_cast<const void*>(matrix.get()), sizeof(WeightType));
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (auto search = converted_.find(key); search != converted_.end()) {
+            if (auto weights = search->second.lock()) {
+                return std::static_pointer_cast<const WeightType>(weights);
+            }
+        }
+    }
+
+    // Converted without holding the lock, as matrices are loaded
+    auto owner = std::make_shared<ConvertedWeights<WeightType, MatrixType>>();
+    owner->matrix = matrix;
+    owner->values.assign(matrix->values, matrix->values + matrix->nnz);
+    std::shared_ptr<const WeightType> weights{owner, owner->values.data()};
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (auto it = converted_.begin(); it != converted_.end();) {
+        if (it->second.expired() && it->first != key) {
+            it = converted_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    auto& entry = converted_[key];
+    if (auto converted = entry.lock()) {
+        return std::static_pointer_cast<const WeightType>(converted);
+    }
+    entry = weights;
+    return weights;
+}
+
+template std::shared_ptr<const double> FesomMatrixStore::convertedWeights<double, float>(
+    const std::shared_ptr<const FesomMatrix<float>>&);
+template std::shared_ptr<const float> FesomMatrixStore::convertedWeights<float, double>(
+    const std::shared_ptr<const FesomMatrix<double>>&);
+
+size_t FesomMatrixStore::size() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    size_t count = 0;
+    for (auto it = matrices_.begin(); it != matrices_.end();) {
+        if (it->second.expired()) {
+            it = matrices_.erase(it);
+        }
+        else {
+            ++count;
+            ++it;
+        }
+    }
+    return count;
+}
+
+}  // namespace multio::action::interpolateFESOM
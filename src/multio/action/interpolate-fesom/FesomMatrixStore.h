@@ -0,0 +1,88 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+
+namespace multio::action::interpolateFESOM {
+
+/**
+ * Read-only CSR matrix of a FESOM to HEALPix cache. Row `i` holds the weights of HEALPix point `landSeaMask[i]`.
+ * The arrays either live in memory or in a memory-mapped flat cache file.
+ */
+template <typename MatrixType>
+struct FesomMatrix {
+    size_t nnz = 0;
+    size_t nRows = 0;
+    size_t nCols = 0;
+    size_t nOutRows = 0;
+
+    const std::int32_t* landSeaMask = nullptr;
+    const std::int32_t* rowStart = nullptr;
+    const std::int32_t* colIdx = nullptr;
+    const MatrixType* values = nullptr;
+};
+
+/**
+ * Flat cache files (extension `.csr`) can be memory-mapped as they are:
+ *
+ *   header | landSeaMask (int32 x nRows) | rowStart (int32 x nRows+1) | colIdx (int32 x nnz) | values (T x nnz)
+ *
+ * in native byte order, each array padded to 8 bytes. The header holds a byte order mark, the dimensions, the size of
+ * the values and an XXH64 checksum of everything following it, which is verified when the file is mapped. Caches
+ * written on a host of the other byte order are rejected, as are matrices with indices out of range.
+ */
+template <typename MatrixType>
+void writeFlatCache(const std::string& file, size_t NSide, size_t level, const FesomMatrix<MatrixType>& matrix);
+
+// Writes a matrix as an atlas-io record, the format of the caches written by the FESOM cache generator
+template <typename MatrixType>
+void writeAtlasCache(const std::string& file, size_t NSide, size_t level, const FesomMatrix<MatrixType>& matrix);
+
+/**
+ * Process-wide registry of cache matrices, shared read-only by all interpolate-fesom actions (and threads). A matrix
+ * is loaded once and released when the last user drops it. Flat caches are memory-mapped, atlas-io caches are read
+ * into memory.
+ */
+class FesomMatrixStore {
+public:
+    static FesomMatrixStore& instance();
+
+    template <typename MatrixType>
+    std::shared_ptr<const FesomMatrix<MatrixType>> get(const std::string& file);
+
+    // Weights of a matrix converted to another floating point precision. They are converted once and shared by all
+    // users of the matrix while any of them holds them, the returned array keeps the matrix alive.
+    template <typename WeightType, typename MatrixType>
+    std::shared_ptr<const WeightType> convertedWeights(const std::shared_ptr<const FesomMatrix<MatrixType>>& matrix);
+
+    // Number of matrices currently in use
+    size_t size();
+
+private:
+    FesomMatrixStore() = default;
+
+    std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<const void>> matrices_;
+    // Keyed by the address of the matrix, which cannot be reused while its converted weights are alive
+    std::map<std::pair<const void*, size_t>, std::weak_ptr<const void>> converted_;
+};
+
+}  // namespace multio::action::interpolateFESOM
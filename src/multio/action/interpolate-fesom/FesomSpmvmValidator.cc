@@ -20,6 +20,7 @@
 #include "eckit/option/CmdArgs.h"
 #include "eckit/option/SimpleOption.h"
 #include "multio/tools/MultioTool.h"
+#include "multio/util/Timing.h"
 
 #include "FesomInterpolationWeights.h"
 #include "InterpolateFesom.h"
@@ -128,6 +129,10 @@ private:
                            << "  ...  " << std::endl
                            << "rNROWSc1 rNROWSc2 rNROWSc3 ... rNROWScNCOLS" << std::endl
                            << " ---------------------------------------------" << std::endl
+                           << "With --batch=K the fields are also interpolated K at a time, the results are checked "
+                              "against the per-field interpolation and the timings of both are reported (best of "
+                              "--repeat runs). --threads=N runs the per-field interpolation on N threads."
+                           << std::endl
                            << std::endl;
     }
 
@@ -146,8 +151,13 @@ private:
     std::string fieldFile_;
     std::string outputPath_;
     std::string outputFile_;
+    size_t batch_;
+    size_t repeat_;
+    size_t threads_;
 
     std::vector<std::vector<double>> fields_;
+
+    void benchmark(Fesom2HEALPix<double>& cache, const std::vector<std::vector<double>>& reference) const;
 };
 
 
@@ -158,7 +168,10 @@ FesomCacheValidator::FesomCacheValidator(int argc, char** argv) :
     fieldPath_{"."},
     fieldFile_{"inputFields.csv"},
     outputPath_{"."},
-    outputFile_{"interpolated_fields.csv"} {
+    outputFile_{"interpolated_fields.csv"},
+    batch_{0},
+    repeat_{5},
+    threads_{1} {
 
     options_.push_back(
         new eckit::option::SimpleOption<std::string>("cachePath", "Name of the cache path. Default( \"./\" )"));
@@ -174,6 +187,12 @@ FesomCacheValidator::FesomCacheValidator(int argc, char** argv) :
         "outputPath", "Path of the output file with the interpolated fields. Default( \".\" )"));
     options_.push_back(new eckit::option::SimpleOption<std::string>(
         "outputFile", "Name of the output file Default(\"interpolated_fields.csv\")"));
+    options_.push_back(new eckit::option::SimpleOption<size_t>(
+        "batch", "Number of fields interpolated at once for the benchmark, 0 disables it. Default( 0 )"));
+    options_.push_back(
+        new eckit::option::SimpleOption<size_t>("repeat", "Number of benchmark repetitions. Default( 5 )"));
+    options_.push_back(new eckit::option::SimpleOption<size_t>(
+        "threads", "Number of threads of the per-field interpolation in the benchmark. Default( 1 )"));
 
     return;
 }
@@ -187,6 +206,9 @@ void FesomCacheValidator::init(const eckit::option::CmdArgs& args) {
     args.get("cacheFile", cacheFile_);
     args.get("fieldFile", fieldFile_);
     args.get("outputFile", outputFile_);
+    args.get("batch", batch_);
+    args.get("repeat", repeat_);
+    args.get("threads", threads_);
 
     fields_ = readCSV(fieldPath_, fieldFile_);
 
@@ -222,9 +244,70 @@ void FesomCacheValidator::execute(const eckit::option::CmdArgs& args) {
     }
 
     writeCSV(result, oFname);
+
+    if (batch_ > 0) {
+        benchmark(cache, result);
+    }
 };
 
 
+void FesomCacheValidator::benchmark(Fesom2HEALPix<double>& cache,
+                                    const std::vector<std::vector<double>>& reference) const {
+    const double missing = -999999.0;
+    const size_t nFields = fields_.size();
+
+    std::vector<std::vector<double>> result(nFields, std::vector<double>(cache.nOutRows()));
+
+    double perField = 0.0;
+    double batched = 0.0;
+    for (size_t r = 0; r < std::max<size_t>(repeat_, 1); ++r) {
+        util::Timing<> timing;
+        timing.tic();
+        for (size_t i = 0; i < nFields; ++i) {
+            cache.interpolate<double, double>(fields_[i].data(), result[i].data(), fields_[i].size(),
+                                              cache.nOutRows(), missing, threads_);
+        }
+        timing.toc();
+        timing.process();
+        perField = (r == 0) ? timing.elapsedTimeSeconds() : std::min(perField, timing.elapsedTimeSeconds());
+
+        util::Timing<> batchTiming;
+        batchTiming.tic();
+        for (size_t i = 0; i < nFields; i += batch_) {
+            const size_t n = std::min(batch_, nFields - i);
+            std::vector<const double*> inputs;
+            std::vector<double*> outputs;
+            for (size_t j = i; j < i + n; ++j) {
+                inputs.push_back(fields_[j].data());
+                outputs.push_back(result[j].data());
+            }
+            cache.interpolateBatch<double, double>(inputs.data(), outputs.data(), n, fields_[i].size(),
+                                                   cache.nOutRows(), missing);
+        }
+        batchTiming.toc();
+        batchTiming.process();
+        batched = (r == 0) ? batchTiming.elapsedTimeSeconds() : std::min(batched, batchTiming.elapsedTimeSeconds());
+    }
+
+    if (result != reference) {
+        throw eckit::SeriousBug("Batched interpolation differs from the per-field interpolation", Here());
+    }
+
+    for (size_t i = 0; i < nFields; ++i) {
+        cache.interpolate<double, double>(fields_[i].data(), result[i].data(), fields_[i].size(), cache.nOutRows(),
+                                          missing, threads_);
+    }
+    if (result != reference) {
+        throw eckit::SeriousBug("Interpolation on several threads differs from the serial interpolation", Here());
+    }
+
+    eckit::Log::info() << " - Interpolated " << nFields << " fields (nnz=" << cache.nnz() << ")" << std::endl
+                       << "   * per field (" << std::setw(3) << threads_ << " threads) : " << perField << "s"
+                       << std::endl
+                       << "   * batches of " << std::setw(8) << batch_ << "   : " << batched << "s" << std::endl;
+}
+
+
 void FesomCacheValidator::finish(const eckit::option::CmdArgs&) {}
 
 }  // namespace multio::action::interpolateFESOM
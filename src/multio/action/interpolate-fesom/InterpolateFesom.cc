@@ -12,10 +12,12 @@
 
 #include "multio/action/interpolate-fesom/InterpolateFesom.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "eckit/exception/Exceptions.h"
@@ -23,6 +25,7 @@
 
 #include "InterpolateFesom_debug.h"
 #include "eckit/filesystem/PathName.h"
+#include "eckit/log/Log.h"
 #include "multio/LibMultio.h"
 #include "multio/message/Message.h"
 #include "multio/util/PrecisionTag.h"
@@ -59,6 +62,24 @@ void fill_metadata(const message::Metadata& in_md, message::Metadata& out_md, si
     return;
 };
 
+// Level of the cache of a field (0-based)
+size_t cacheLevel(const message::Message& msg) {
+    size_t level = static_cast<size_t>(                             //
+        msg.metadata().getOpt<std::int64_t>("level").value_or(      //
+            msg.metadata().getOpt<double>("levelist").value_or(0))  //
+    );
+    if ((msg.metadata().get<std::string>("category") == "ocean-3d")
+        && (msg.metadata().get<std::string>("fesomLevelType") == "level")) {
+        if (level == 0) {
+            std::ostringstream os;
+            os << " - Wrong level for the oceal level" << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+        level--;
+    }
+    return level;
+}
+
 std::string fullFileName(const std::string& fname) {
     if (fname != "none") {
         const std::string fullFname = util::replaceCurly(fname, [](std::string_view replace) {
@@ -90,8 +111,24 @@ InterpolateFesom<T>::InterpolateFesom(const ComponentConfiguration& compConf) :
         orderingConvention_string2enum(compConf.parsedConfig().getString("ordering-convention", "ring"))},
     missingValue_{static_cast<T>(compConf.parsedConfig().getDouble("missing-value"))},
     outputPrecision_{compConf.parsedConfig().getString("output-precision", "from-message")},
-    cachePath_{fullFileName(compConf.parsedConfig().getString("cache-path", "."))} {
+    cachePath_{fullFileName(compConf.parsedConfig().getString("cache-path", "."))},
+    batchSize_{static_cast<size_t>(std::max(1L, compConf.parsedConfig().getLong("batch-size", 1)))},
+    threads_{static_cast<size_t>(std::max(1L, compConf.parsedConfig().getLong("threads", 1)))},
+    bufferPool_{static_cast<size_t>(std::max(0L, compConf.parsedConfig().getLong("buffer-pool-size", 16)))} {
     INTERPOLATE_FESOM_OUT_STREAM << " - InterpolateFesom :: enter constructor" << std::endl;
+    const auto& cfg = compConf.parsedConfig();
+    if (cfg.getBool("prefetch", false)) {
+        if (cfg.has("prefetch-levels")) {
+            prefetchLevels_.emplace();
+            for (auto level : cfg.getLongVector("prefetch-levels")) {
+                if (level < 0) {
+                    throw eckit::UserError("Negative value in prefetch-levels", Here());
+                }
+                prefetchLevels_->push_back(static_cast<size_t>(level));
+            }
+        }
+        prefetcher_ = std::make_unique<FesomMatrixPrefetcher<T>>();
+    }
     if (outputPrecision_ != "single" && outputPrecision_ != "double" && outputPrecision_ != "from-message") {
         std::ostringstream os;
         os << " - Wrong value for output precision,"
@@ -108,19 +145,7 @@ std::string InterpolateFesom<T>::generateKey(const message::Message& msg) const
     INTERPOLATE_FESOM_OUT_STREAM << " - InterpolateFesom :: enter generateKey" << std::endl;
     // TODO: Probably missing the kind of fesom grid in the name
     //       neeed to see the metadata to understand how to extract it
-    size_t level = static_cast<size_t>(                             //
-        msg.metadata().getOpt<std::int64_t>("level").value_or(      //
-            msg.metadata().getOpt<double>("levelist").value_or(0))  //
-    );
-    if ((msg.metadata().get<std::string>("category") == "ocean-3d")
-        && (msg.metadata().get<std::string>("fesomLevelType") == "level")) {
-        if (level == 0) {
-            std::ostringstream os;
-            os << " - Wrong level for the oceal level" << std::endl;
-            throw eckit::SeriousBug(os.str(), Here());
-        }
-        level--;
-    }
+    const size_t level = cacheLevel(msg);
     auto searchUnstructuredGridType = msg.metadata().find("unstructuredGridType");
     if (searchUnstructuredGridType == msg.metadata().end()) {
         std::ostringstream os;
@@ -154,6 +179,7 @@ void InterpolateFesom<T>::executeImpl(message::Message msg) {
         INTERPOLATE_FESOM_OUT_STREAM << " ============================================================================="
                                         "========================== "
                                      << std::endl;
+        flushBatches();
         executeNext(msg);
         return;
     }
@@ -161,8 +187,32 @@ void InterpolateFesom<T>::executeImpl(message::Message msg) {
     std::string key = generateKey(msg);
     if (Interpolators_.find(key) == Interpolators_.end()) {
         // no need to check for grid type since it is already checked in the generateKey function
-        Interpolators_[key] = std::make_unique<Fesom2HEALPix<T>>(
-            msg, cachePath_, msg.metadata().get<std::string>("unstructuredGridType"), NSide_, orderingConvention_);
+        const std::string fesomGridName = msg.metadata().get<std::string>("unstructuredGridType");
+        if (prefetcher_) {
+            prefetchLevels(fesomGridName, msg.domain());
+            const auto file = findFesomCache(cachePath_, fesomGridName, msg.domain(),
+                                             (sizeof(T) == 4 ? "single" : "double"), NSide_, orderingConvention_,
+                                             cacheLevel(msg));
+            if (!file) {
+                throw eckit::SeriousBug("Unable to find the cache file for: " + key, Here());
+            }
+            Interpolators_[key] = std::make_unique<Fesom2HEALPix<T>>(prefetcher_->get(*file));
+        }
+        else {
+            Interpolators_[key]
+                = std::make_unique<Fesom2HEALPix<T>>(msg, cachePath_, fesomGridName, NSide_, orderingConvention_);
+        }
+    }
+
+    if (batchSize_ > 1) {
+        std::string batchKey = key + (msg.precision() == util::PrecisionTag::Float ? "_single" : "_double");
+        auto& batch = batches_[batchKey];
+        batch.emplace_back(arrivals_++, std::move(msg));
+        if (batch.size() >= batchSize_) {
+            flushBatch(batchKey);
+        }
+        INTERPOLATE_FESOM_OUT_STREAM << " - exit executeImpl (on field, batched) " << std::endl;
+        return;
     }
 
     executeNext(util::dispatchPrecisionTag(msg.precision(), [&](auto in_pt) -> message::Message {
@@ -171,17 +221,18 @@ void InterpolateFesom<T>::executeImpl(message::Message msg) {
         return util::dispatchPrecisionTag(opt, [&](auto out_pt) -> message::Message {
             using InputPrecision = typename decltype(in_pt)::type;
             using OutputPrecision = typename decltype(out_pt)::type;
-            std::vector<OutputPrecision> outData;
             message::Metadata md;
             size_t inputSize = msg.payload().size() / sizeof(InputPrecision);
             size_t outputSize = 12 * NSide_ * NSide_;
-            outData.resize(outputSize);
+            auto buffer = bufferPool_.get(outputSize * sizeof(OutputPrecision));
             const InputPrecision* val = static_cast<const InputPrecision*>(msg.payload().data());
-            Interpolators_.at(key)->interpolate(val, outData.data(), inputSize, outputSize,
-                                                static_cast<OutputPrecision>(missingValue_));
-            eckit::Buffer buffer(reinterpret_cast<const char*>(outData.data()),
-                                 outData.size() * sizeof(OutputPrecision));
-            fill_metadata(msg.metadata(), md, NSide_, orderingConvention_, outData.size(), opt, missingValue_);
+            message::ValueStatistics stats;
+            Interpolators_.at(key)->interpolate(val, static_cast<OutputPrecision*>(buffer->data()), inputSize,
+                                                outputSize, static_cast<OutputPrecision>(missingValue_), threads_,
+                                                &stats);
+            ++fields_;
+            fill_metadata(msg.metadata(), md, NSide_, orderingConvention_, outputSize, opt, missingValue_);
+            message::setValueStatistics(md, stats);
             INTERPOLATE_FESOM_OUT_STREAM << " - InterpolateFesom :: Interpolation results:" << std::endl;
             INTERPOLATE_FESOM_OUT_STREAM << "       * FROM: " << msg.metadata() << " " << std::endl;
             INTERPOLATE_FESOM_OUT_STREAM << "       * TO  :" << md << std::endl;
@@ -192,15 +243,167 @@ void InterpolateFesom<T>::executeImpl(message::Message msg) {
             INTERPOLATE_FESOM_OUT_STREAM << std::endl << std::endl;
             return {
                 message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(), std::move(md)},
-                std::move(buffer)};
+                message::SharedPayload{std::move(buffer)}};
         });
     }));
 }
 
 
+template <typename T>
+void InterpolateFesom<T>::flushBatch(const std::string& batchKey) {
+    auto search = batches_.find(batchKey);
+    if (search == batches_.end()) {
+        return;
+    }
+    Batch batch = std::move(search->second);
+    batches_.erase(search);
+
+    for (auto& msg : interpolateBatch(batch)) {
+        executeNext(std::move(msg.second));
+    }
+}
+
+
+template <typename T>
+typename InterpolateFesom<T>::Batch InterpolateFesom<T>::interpolateBatch(const Batch& batch) {
+    if (batch.empty()) {
+        return {};
+    }
+
+    INTERPOLATE_FESOM_OUT_STREAM << " - InterpolateFesom :: enter interpolateBatch (" << batch.size() << " fields)"
+                                 << std::endl;
+
+    const auto& first = batch.front().second;
+    auto& interpolator = *Interpolators_.at(generateKey(first));
+    const util::PrecisionTag opt
+        = (outputPrecision_ == "from-message" ? first.precision() : util::decodePrecisionTag(outputPrecision_));
+
+    auto interpolated = util::dispatchPrecisionTag(first.precision(), [&](auto in_pt) {
+        return util::dispatchPrecisionTag(opt, [&](auto out_pt) -> Batch {
+            using InputPrecision = typename decltype(in_pt)::type;
+            using OutputPrecision = typename decltype(out_pt)::type;
+            const size_t inputSize = first.payload().size() / sizeof(InputPrecision);
+            const size_t outputSize = 12 * NSide_ * NSide_;
+
+            std::vector<const InputPrecision*> inputs;
+            std::vector<OutputPrecision*> outputs;
+            std::vector<std::shared_ptr<eckit::Buffer>> buffers;
+            inputs.reserve(batch.size());
+            outputs.reserve(batch.size());
+            buffers.reserve(batch.size());
+            for (const auto& [arrival, msg] : batch) {
+                if (msg.payload().size() != inputSize * sizeof(InputPrecision)) {
+                    std::ostringstream os;
+                    os << " - Wrong input size in batch: " << msg.payload().size() / sizeof(InputPrecision) << " "
+                       << inputSize << std::endl;
+                    throw eckit::SeriousBug(os.str(), Here());
+                }
+                inputs.push_back(static_cast<const InputPrecision*>(msg.payload().data()));
+                buffers.push_back(bufferPool_.get(outputSize * sizeof(OutputPrecision)));
+                outputs.push_back(static_cast<OutputPrecision*>(buffers.back()->data()));
+            }
+
+            std::vector<message::ValueStatistics> stats(batch.size());
+            interpolator.interpolateBatch(inputs.data(), outputs.data(), batch.size(), inputSize, outputSize,
+                                          static_cast<OutputPrecision>(missingValue_), stats.data());
+            fields_ += batch.size();
+
+            Batch result;
+            result.reserve(batch.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const auto& [arrival, msg] = batch[i];
+                message::Metadata md;
+                fill_metadata(msg.metadata(), md, NSide_, orderingConvention_, outputSize, opt, missingValue_);
+                message::setValueStatistics(md, stats[i]);
+                result.emplace_back(arrival, message::Message{message::Message::Header{message::Message::Tag::Field,
+                                                                                       msg.source(), msg.destination(),
+                                                                                       std::move(md)},
+                                                              message::SharedPayload{std::move(buffers[i])}});
+            }
+            return result;
+        });
+    });
+
+    INTERPOLATE_FESOM_OUT_STREAM << " - InterpolateFesom :: exit interpolateBatch" << std::endl;
+    return interpolated;
+}
+
+
+template <typename T>
+void InterpolateFesom<T>::prefetchLevels(const std::string& fesomGridName, const std::string& domain) {
+    if (!prefetched_.insert(fesomGridName + "_" + domain).second) {
+        return;
+    }
+    const std::string precision{sizeof(T) == 4 ? "single" : "double"};
+    if (prefetchLevels_) {
+        for (size_t level : *prefetchLevels_) {
+            if (auto file = findFesomCache(cachePath_, fesomGridName, domain, precision, NSide_, orderingConvention_,
+                                           level)) {
+                prefetcher_->prefetch(*file);
+            }
+        }
+        return;
+    }
+    // Levels are numbered contiguously from 0
+    for (size_t level = 0;; ++level) {
+        auto file = findFesomCache(cachePath_, fesomGridName, domain, precision, NSide_, orderingConvention_, level);
+        if (!file) {
+            break;
+        }
+        prefetcher_->prefetch(*file);
+    }
+}
+
+
+template <typename T>
+void InterpolateFesom<T>::flushBatches() {
+    // Fields of all batches are forwarded in the order they were received
+    Batch interpolated;
+    while (!batches_.empty()) {
+        Batch batch = std::move(batches_.begin()->second);
+        batches_.erase(batches_.begin());
+        for (auto& msg : interpolateBatch(batch)) {
+            interpolated.push_back(std::move(msg));
+        }
+    }
+    std::sort(interpolated.begin(), interpolated.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    for (auto& msg : interpolated) {
+        executeNext(std::move(msg.second));
+    }
+}
+
+
+template <typename T>
+InterpolateFesom<T>::~InterpolateFesom() {
+    // Plans may end without a final flush, fields waiting for their batch must not be lost
+    try {
+        flushBatches();
+    }
+    catch (const std::exception& e) {
+        eckit::Log::error() << "InterpolateFesom: pending fields could not be forwarded: " << e.what() << std::endl;
+    }
+    if (fields_ > 0) {
+        const auto counters = bufferPool_.counters();
+        eckit::Log::info() << " ** " << *this << " output buffers:" << std::endl
+                           << "    -- fields interpolated: " << fields_ << std::endl
+                           << "    -- buffers allocated: " << counters.allocations << " (" << counters.bytesAllocated
+                           << " bytes, " << counters.bytesAllocated / fields_ << " bytes per field)" << std::endl
+                           << "    -- buffers reused: " << counters.reuses << std::endl;
+    }
+    if (prefetcher_) {
+        eckit::Log::info() << " ** " << *this << " matrix loads:" << std::endl;
+        prefetcher_->report(eckit::Log::info());
+    }
+}
+
+
 template <typename T>
 void InterpolateFesom<T>::print(std::ostream& os) const {
     os << "interpolate-fesom-" << (sizeof(T) == 4 ? "single" : "double");
+    if (prefetcher_) {
+        os << "(prefetch=true)";
+    }
 }
 
 
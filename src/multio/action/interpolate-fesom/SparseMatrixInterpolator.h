@@ -0,0 +1,384 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "FesomInterpolationWeights.h"
+#include "FesomMatrixStore.h"
+#include "eckit/exception/Exceptions.h"
+#include "multio/LibMultio.h"
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/ParallelFor.h"
+
+namespace multio::action::interpolateFESOM {
+
+/**
+ * Interpolation with a precomputed sparse matrix in the format of the FESOM caches (see FesomMatrix): output point
+ * `landSeaMask[i]` is the dot product of row `i` with the input, output points without a row are missing values.
+ * Used by interpolate-fesom (Fesom2HEALPix) and interpolate-matrix, `name` identifies the user in log messages and
+ * errors.
+ */
+template <typename MatrixType, typename = std::enable_if_t<std::is_floating_point<MatrixType>::value>>
+class SparseMatrixInterpolator {
+private:
+    // Matrix shared with all other users of the same cache file (see FesomMatrixStore), the members below point into it
+    std::shared_ptr<const FesomMatrix<MatrixType>> matrix_;
+
+    size_t nnz_;
+    size_t nRows_;
+    size_t nCols_;
+    size_t nOutRows_;
+    const std::int32_t* landSeaMask_;
+    const std::int32_t* rowStart_;
+    const std::int32_t* colIdx_;
+    const MatrixType* values_;
+
+    // Weights in the other floating point precision, converted once by the store for all users of the matrix and
+    // looked up when first interpolating to that precision
+    using ConvertedType = std::conditional_t<std::is_same_v<MatrixType, float>, double, float>;
+    std::shared_ptr<const ConvertedType> convertedValues_;
+
+    // Whether each output point is written by at most one row and rows are sorted by output point (always the case for
+    // caches written by the cache generator). Only then rows can be split into blocks owning a range of the output.
+    bool sortedRows_ = false;
+
+    // Minimum number of non-zeros per thread
+    static constexpr size_t minBlockNnz_ = 1 << 15;
+
+    // Identifies the user of the interpolator in log messages and errors
+    std::string name_;
+
+protected:
+    explicit SparseMatrixInterpolator(std::string name) : name_{std::move(name)} {}
+
+    void readCache(const std::string& file) {
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": enter readCache" << std::endl;
+        bind(FesomMatrixStore::instance().get<MatrixType>(file));
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit readCache" << std::endl;
+        return;
+    }
+
+    void bind(std::shared_ptr<const FesomMatrix<MatrixType>> matrix) {
+        matrix_ = std::move(matrix);
+        convertedValues_.reset();
+        nnz_ = matrix_->nnz;
+        nRows_ = matrix_->nRows;
+        nCols_ = matrix_->nCols;
+        nOutRows_ = matrix_->nOutRows;
+        landSeaMask_ = matrix_->landSeaMask;
+        rowStart_ = matrix_->rowStart;
+        colIdx_ = matrix_->colIdx;
+        values_ = matrix_->values;
+        sortedRows_ = std::adjacent_find(landSeaMask_, landSeaMask_ + nRows_, std::greater_equal<std::int32_t>{})
+                   == landSeaMask_ + nRows_;
+    }
+
+private:
+    template <typename WeightType>
+    const WeightType* weights() {
+        if constexpr (std::is_same_v<WeightType, MatrixType>) {
+            return values_;
+        }
+        else {
+            if (!convertedValues_) {
+                convertedValues_ = FesomMatrixStore::instance().convertedWeights<ConvertedType>(matrix_);
+            }
+            return convertedValues_.get();
+        }
+    }
+
+    // Row boundaries of blocks with about the same number of non-zeros, one block per thread
+    std::vector<size_t> rowBlocks(size_t threads) const {
+        const size_t nBlocks = sortedRows_ ? util::numChunks(threads, nnz_, minBlockNnz_) : 1;
+        std::vector<size_t> blocks(nBlocks + 1, nRows_);
+        blocks[0] = 0;
+        for (size_t iBlock = 1; iBlock < nBlocks; iBlock++) {
+            const auto target = static_cast<std::int32_t>(iBlock * nnz_ / nBlocks);
+            const auto first = std::lower_bound(rowStart_, rowStart_ + nRows_, target);
+            blocks[iBlock] = std::max(blocks[iBlock - 1], static_cast<size_t>(first - rowStart_));
+        }
+        return blocks;
+    }
+
+    // Dot product of a row with the input. Products are formed eight at a time (gathers the compiler can vectorize)
+    // and summed up in order, so the result does not depend on how rows are distributed. Matching `interpolateBatch`
+    // bitwise also requires that products and sums are not fused (-ffp-contract=off, set in CMakeLists.txt).
+    template <typename InFieldType, typename OutFieldType>
+    OutFieldType rowValue(size_t iRow, const InFieldType* inputField, const OutFieldType* weights) const {
+        constexpr size_t width = 8;
+        OutFieldType sum = 0.0;
+        size_t colPtr = rowStart_[iRow];
+        const size_t rowEnd = rowStart_[iRow + 1];
+        for (; colPtr + width <= rowEnd; colPtr += width) {
+            OutFieldType products[width];
+            for (size_t i = 0; i < width; i++) {
+                products[i] = weights[colPtr + i] * static_cast<OutFieldType>(inputField[colIdx_[colPtr + i]]);
+            }
+            for (size_t i = 0; i < width; i++) {
+                sum += products[i];
+            }
+        }
+        for (; colPtr < rowEnd; colPtr++) {
+            sum += weights[colPtr] * static_cast<OutFieldType>(inputField[colIdx_[colPtr]]);
+        }
+        return sum;
+    }
+
+    // Statistics of an output field in a separate pass, only needed if rows may overwrite each other
+    template <typename OutFieldType>
+    message::ValueStatistics scanStatistics(const OutFieldType* outputField, OutFieldType missingValue) const {
+        message::ValueStatistics stats;
+        for (size_t i = 0; i < nOutRows_; i++) {
+            if (outputField[i] == missingValue) {
+                stats.missing++;
+            }
+            else {
+                stats.add(static_cast<double>(outputField[i]));
+            }
+        }
+        return stats;
+    }
+
+public:
+    SparseMatrixInterpolator(std::shared_ptr<const FesomMatrix<MatrixType>> matrix, std::string name) :
+        name_{std::move(name)} {
+        bind(std::move(matrix));
+    }
+
+    const std::string& name() const { return name_; }
+
+    size_t nnz() const { return nnz_; };
+    size_t nRows() const { return nRows_; };
+    size_t nCols() const { return nCols_; };
+    size_t nOutRows() const { return nOutRows_; };
+
+    // Rows are split into blocks of about equal numbers of non-zeros, interpolated by up to `threads` threads. Each
+    // block also fills the points of the output it owns that are not covered by the matrix with missing values, so
+    // the output is written once. The result is the same for any number of threads.
+    // If `stats` is given, the minimum, maximum and number of missing values of the output are collected on the way.
+    template <typename InFieldType, typename OutFieldType>
+    void interpolate(const InFieldType* inputField, OutFieldType* outputField, size_t inputSize, size_t outputSize,
+                     OutFieldType missingValue, size_t threads = 1, message::ValueStatistics* stats = nullptr) {
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": enter interpolate" << std::endl;
+
+        if (outputSize != nOutRows_) {
+            std::ostringstream os;
+            os << " - " << name_ << ": wrong output size: " << outputSize << " " << nOutRows_ << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+
+        const OutFieldType* w = weights<OutFieldType>();
+
+        if (!sortedRows_) {
+            LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": initialize to missing values" << std::endl;
+            std::fill(outputField, outputField + nOutRows_, missingValue);
+            for (size_t iRow = 0; iRow < nRows_; iRow++) {
+                outputField[landSeaMask_[iRow]] = rowValue(iRow, inputField, w);
+            }
+            if (stats) {
+                *stats = scanStatistics(outputField, missingValue);
+            }
+            LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit interpolate" << std::endl;
+            return;
+        }
+
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": do interpolation " << std::endl;
+        const auto blocks = rowBlocks(threads);
+        const size_t nBlocks = blocks.size() - 1;
+        // Output points owned by a block: from its first row up to the first row of the next block
+        auto ownedFrom = [&](size_t iBlock) -> size_t {
+            if (iBlock == 0) {
+                return 0;
+            }
+            return (iBlock == nBlocks || blocks[iBlock] == nRows_) ? nOutRows_ : landSeaMask_[blocks[iBlock]];
+        };
+        std::vector<message::ValueStatistics> blockStats(stats ? nBlocks : 0);
+        // Threads are started for each field rather than kept in a pool of the action: starting and joining them cost
+        // 17 us (2 threads), 55 us (4) and 175 us (8) per call on a single Xeon core, against about 6 ms to interpolate
+        // a field to NSide 256, and small matrices are not split at all (minBlockNnz_).
+        util::parallelFor(nBlocks, nBlocks, [&](size_t, size_t firstBlock, size_t lastBlock) {
+            for (size_t iBlock = firstBlock; iBlock < lastBlock; iBlock++) {
+                size_t next = ownedFrom(iBlock);
+                const size_t outEnd = ownedFrom(iBlock + 1);
+                message::ValueStatistics local;
+                for (size_t iRow = blocks[iBlock]; iRow < blocks[iBlock + 1]; iRow++) {
+                    const size_t outIdx = landSeaMask_[iRow];
+                    std::fill(outputField + next, outputField + outIdx, missingValue);
+                    const OutFieldType value = rowValue(iRow, inputField, w);
+                    outputField[outIdx] = value;
+                    if (stats) {
+                        local.missing += outIdx - next;
+                        local.add(static_cast<double>(value));
+                    }
+                    next = outIdx + 1;
+                }
+                std::fill(outputField + next, outputField + outEnd, missingValue);
+                if (stats) {
+                    local.missing += outEnd - next;
+                    blockStats[iBlock] = local;
+                }
+            }
+        });
+        if (stats) {
+            *stats = message::ValueStatistics{};
+            for (const auto& s : blockStats) {
+                stats->merge(s);
+            }
+        }
+
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit interpolate" << std::endl;
+        // Exit point
+        return;
+    }
+
+
+    // Interpolates `nFields` fields at once: the matrix is traversed a single time and each weight is applied to all
+    // fields. The fields are interleaved first, such that the innermost loop runs over contiguous values of all fields
+    // and can be vectorized. Each field sees the same operations in the same order as with `interpolate` (the results
+    // are identical as long as no fused multiply-adds are formed, see `rowValue`).
+    // If `stats` is given (one entry per field), the statistics of each output are collected as with `interpolate`.
+    // Whether this pays off depends on the locality of the matrix: on a synthetic NSide 256 matrix (550k rows, 3
+    // non-zeros each, 127k input points, single core) batches of 16 took 4.8-5.2 ms per field against 6.5-7.4 ms one
+    // at a time when neighbouring rows read neighbouring input points, but 12-14 ms against 5.7-6.4 ms when the input
+    // points are scattered at random, as the interleaved input no longer fits in cache.
+    template <typename InFieldType, typename OutFieldType>
+    void interpolateBatch(const InFieldType* const* inputFields, OutFieldType* const* outputFields, size_t nFields,
+                          size_t inputSize, size_t outputSize, OutFieldType missingValue,
+                          message::ValueStatistics* stats = nullptr) {
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": enter interpolateBatch (" << nFields << " fields)"
+                                     << std::endl;
+
+        if (outputSize != nOutRows_) {
+            std::ostringstream os;
+            os << " - " << name_ << ": wrong output size: " << outputSize << " " << nOutRows_ << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+
+        // Dense input block, row-major (input point x field)
+        std::vector<OutFieldType> batchInput(inputSize * nFields);
+        for (size_t iField = 0; iField < nFields; iField++) {
+            const InFieldType* field = inputFields[iField];
+            for (size_t iCol = 0; iCol < inputSize; iCol++) {
+                batchInput[iCol * nFields + iField] = static_cast<OutFieldType>(field[iCol]);
+            }
+        }
+
+        for (size_t iField = 0; iField < nFields; iField++) {
+            std::fill(outputFields[iField], outputFields[iField] + nOutRows_, missingValue);
+        }
+
+        if (stats) {
+            for (size_t iField = 0; iField < nFields; iField++) {
+                stats[iField] = message::ValueStatistics{};
+                stats[iField].missing = nOutRows_ - nRows_;
+            }
+        }
+
+        const OutFieldType* w = weights<OutFieldType>();
+        std::vector<OutFieldType> batchRow(nFields);
+        for (size_t iRow = 0; iRow < nRows_; iRow++) {
+            std::fill(batchRow.begin(), batchRow.end(), OutFieldType{0});
+            for (size_t colPtr = rowStart_[iRow]; colPtr < rowStart_[iRow + 1]; colPtr++) {
+                const OutFieldType weight = w[colPtr];
+                const OutFieldType* inpVal = batchInput.data() + static_cast<size_t>(colIdx_[colPtr]) * nFields;
+                OutFieldType* acc = batchRow.data();
+                for (size_t iField = 0; iField < nFields; iField++) {
+                    acc[iField] += weight * inpVal[iField];
+                }
+            }
+            const size_t outIdx = landSeaMask_[iRow];
+            for (size_t iField = 0; iField < nFields; iField++) {
+                outputFields[iField][outIdx] = batchRow[iField];
+            }
+            if (stats && sortedRows_) {
+                for (size_t iField = 0; iField < nFields; iField++) {
+                    stats[iField].add(static_cast<double>(batchRow[iField]));
+                }
+            }
+        }
+        if (stats && !sortedRows_) {
+            for (size_t iField = 0; iField < nFields; iField++) {
+                stats[iField] = scanStatistics(outputFields[iField], missingValue);
+            }
+        }
+
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit interpolateBatch" << std::endl;
+    }
+
+
+    void dumpCOO(const std::string& fileName) {
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": enter dumpCOO" << std::endl;
+
+        // Open the file for writing
+        std::ofstream file(fileName);
+
+        // Check if the file is opened successfully
+        if (!file.is_open()) {
+            std::ostringstream os;
+            os << " - " << name_ << ": unable to open output csv file" << std::endl;
+            throw eckit::SeriousBug(os.str(), Here());
+        }
+
+        // Perform the interpolation
+        for (size_t iRow = 0; iRow < nRows_; iRow++) {
+            size_t outIdx = landSeaMask_[iRow];
+            for (size_t colPtr = rowStart_[iRow]; colPtr < rowStart_[iRow + 1]; colPtr++) {
+                size_t iCol = colIdx_[colPtr];
+                MatrixType weight = values_[colPtr];
+                // Write to file
+                file << std::setw(10) << outIdx << "," << std::setw(10) << iCol << "," << std::setw(15) << std::fixed
+                     << std::setprecision(8) << weight << std::endl;
+            }
+        }
+
+        // Close the file
+        file.close();
+
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit dumpCOO" << std::endl;
+        // Exit point
+        return;
+    }
+
+
+    void getTriplets(std::vector<Tri>& triplets) {
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": enter getTriplets" << std::endl;
+
+        // Perform the interpolation
+        triplets.resize(0);
+        for (size_t iRow = 0; iRow < nRows_; iRow++) {
+            size_t outIdx = landSeaMask_[iRow];
+            for (size_t colPtr = rowStart_[iRow]; colPtr < rowStart_[iRow + 1]; colPtr++) {
+                size_t iCol = colIdx_[colPtr];
+                MatrixType weight = values_[colPtr];
+                // Fill triplets
+                triplets.emplace_back(outIdx, iCol, weight);
+            }
+        }
+
+        LOG_DEBUG_LIB(LibMultio) << " - " << name_ << ": exit getTriplets" << std::endl;
+        // Exit point
+        return;
+    }
+};
+
+}  // namespace multio::action::interpolateFESOM
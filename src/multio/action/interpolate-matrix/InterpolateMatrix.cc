@@ -0,0 +1,214 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#include "multio/action/interpolate-matrix/InterpolateMatrix.h"
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+
+#include "MatrixCache.h"
+#include "multio/LibMultio.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/Substitution.h"
+
+
+namespace multio::action::interpolateMatrix {
+
+namespace {
+
+// Keys describing the source grid, replaced by the target metadata
+const std::set<std::string> metadata_black_list{
+    "precision", "gridType", "unstructuredGridType", "unstructuredGridSubtype", "uuidOfHGrid", "globalSize", "domain"};
+
+std::string cachePath(const eckit::LocalConfiguration& cfg) {
+    const std::string path = util::replaceCurly(cfg.getString("cache-path", "."), [](std::string_view replace) {
+        std::string lookUpKey{replace};
+        char* env = ::getenv(lookUpKey.c_str());
+        return env ? std::optional<std::string>{env} : std::optional<std::string>{};
+    });
+    if (!eckit::PathName{path}.exists()) {
+        throw eckit::UserError("interpolate-matrix: cache path not found: " + path, Here());
+    }
+    return path;
+}
+
+std::string requiredString(const eckit::LocalConfiguration& cfg, const std::string& key) {
+    if (!cfg.has(key)) {
+        throw eckit::UserError("interpolate-matrix: \"" + key + "\" is required", Here());
+    }
+    return cfg.getString(key);
+}
+
+double requiredDouble(const eckit::LocalConfiguration& cfg, const std::string& key) {
+    if (!cfg.has(key)) {
+        throw eckit::UserError("interpolate-matrix: \"" + key + "\" is required", Here());
+    }
+    if (!cfg.isFloatingPoint(key) && !cfg.isIntegral(key)) {
+        throw eckit::UserError("interpolate-matrix: \"" + key + "\" has to be a number", Here());
+    }
+    return cfg.getDouble(key);
+}
+
+message::Metadata targetMetadata(const eckit::LocalConfiguration& cfg) {
+    if (!cfg.has("target-metadata")) {
+        return {};
+    }
+    return message::toMetadata(cfg.getSubConfiguration("target-metadata"));
+}
+
+std::string outputPrecision(const eckit::LocalConfiguration& cfg) {
+    auto precision = cfg.getString("output-precision", "from-message");
+    if (precision != "single" && precision != "double" && precision != "from-message") {
+        throw eckit::UserError(
+            "interpolate-matrix: output-precision has to be one of [single|double|from-message], got: " + precision,
+            Here());
+    }
+    return precision;
+}
+
+std::string precisionName(util::PrecisionTag tag) {
+    return tag == util::PrecisionTag::Float ? "single" : "double";
+}
+
+}  // namespace
+
+
+InterpolateMatrix::InterpolateMatrix(const ComponentConfiguration& compConf) :
+    ChainedAction{compConf},
+    cachePath_{cachePath(compConf.parsedConfig())},
+    targetGrid_{requiredString(compConf.parsedConfig(), "target-grid")},
+    targetMetadata_{targetMetadata(compConf.parsedConfig())},
+    missingValue_{requiredDouble(compConf.parsedConfig(), "missing-value")},
+    outputPrecision_{outputPrecision(compConf.parsedConfig())},
+    weightsPrecision_{util::decodePrecisionTag(compConf.parsedConfig().getString("weights-precision", "double"))},
+    threads_{static_cast<std::size_t>(std::max(1L, compConf.parsedConfig().getLong("threads", 1)))},
+    bufferPool_{static_cast<std::size_t>(std::max(0L, compConf.parsedConfig().getLong("buffer-pool-size", 16)))} {}
+
+
+template <typename MatrixType>
+SparseMatrixInterpolator<MatrixType>& InterpolateMatrix::interpolator(const std::string& uuidOfHGrid) {
+    auto& interpolators = [this]() -> auto& {
+        if constexpr (std::is_same_v<MatrixType, float>) {
+            return singleInterpolators_;
+        }
+        else {
+            return doubleInterpolators_;
+        }
+    }();
+
+    if (auto search = interpolators.find(uuidOfHGrid); search != interpolators.end()) {
+        ++statistics_.cacheHits_;
+        return *search->second;
+    }
+
+    ++statistics_.cacheMisses_;
+    const std::string precision = sizeof(MatrixType) == 4 ? "single" : "double";
+    const auto file = findMatrixCache(cachePath_, uuidOfHGrid, targetGrid_, precision);
+    if (!file) {
+        throw eckit::UserError("interpolate-matrix: no weights found for " + cachePath_ + "/"
+                                   + matrixCacheName(uuidOfHGrid, targetGrid_, precision) + ".{csr,atlas}",
+                               Here());
+    }
+    LOG_DEBUG_LIB(LibMultio) << "interpolate-matrix :: loading weights " << *file << std::endl;
+    auto interp = std::make_unique<SparseMatrixInterpolator<MatrixType>>(
+        interpolateFESOM::FesomMatrixStore::instance().get<MatrixType>(*file), "interpolate-matrix");
+    return *interpolators.emplace(uuidOfHGrid, std::move(interp)).first->second;
+}
+
+
+template <typename MatrixType>
+message::Message InterpolateMatrix::interpolate(message::Message&& msg) {
+    const auto uuid = msg.metadata().getOpt<std::string>("uuidOfHGrid");
+    if (!uuid) {
+        throw eckit::UserError("interpolate-matrix: \"uuidOfHGrid\" not present in the metadata", Here());
+    }
+    if (msg.metadata().getOpt<bool>(message::glossary().bitmapPresent).value_or(false)) {
+        throw eckit::UserError("interpolate-matrix: fields of grid " + *uuid
+                                   + " have missing values, masking of source points has to be part of the weights",
+                               Here());
+    }
+    auto& interp = interpolator<MatrixType>(*uuid);
+
+    const util::PrecisionTag outPrecision
+        = outputPrecision_ == "from-message" ? msg.precision() : util::decodePrecisionTag(outputPrecision_);
+
+    return util::dispatchPrecisionTag(msg.precision(), [&](auto in_pt) -> message::Message {
+        return util::dispatchPrecisionTag(outPrecision, [&](auto out_pt) -> message::Message {
+            using InputPrecision = typename decltype(in_pt)::type;
+            using OutputPrecision = typename decltype(out_pt)::type;
+
+            const std::size_t inputSize = msg.payload().size() / sizeof(InputPrecision);
+            if (inputSize != interp.nCols()) {
+                std::ostringstream os;
+                os << "interpolate-matrix: field of grid " << *uuid << " has " << inputSize
+                   << " values, the weights expect " << interp.nCols();
+                throw eckit::SeriousBug(os.str(), Here());
+            }
+            const std::size_t outputSize = interp.nOutRows();
+
+            auto buffer = bufferPool_.get(outputSize * sizeof(OutputPrecision));
+            message::ValueStatistics stats;
+            interp.interpolate(static_cast<const InputPrecision*>(msg.payload().data()),
+                               static_cast<OutputPrecision*>(buffer->data()), inputSize, outputSize,
+                               static_cast<OutputPrecision>(missingValue_), threads_, &stats);
+
+            message::Metadata md;
+            for (const auto& kv : msg.metadata()) {
+                if (metadata_black_list.find(kv.first) == metadata_black_list.end()) {
+                    md.set(kv.first, kv.second);
+                }
+            }
+            md.updateOverwrite(targetMetadata_);
+            md.set(message::glossary().globalSize, static_cast<std::int64_t>(outputSize));
+            md.set(message::glossary().precision, precisionName(outPrecision));
+            md.set(message::glossary().bitmapPresent, stats.missing > 0);
+            md.set(message::glossary().missingValue, missingValue_);
+            message::setValueStatistics(md, stats);
+
+            return {message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(),
+                                             std::move(md)},
+                    message::SharedPayload{std::move(buffer)}};
+        });
+    });
+}
+
+
+void InterpolateMatrix::executeImpl(message::Message msg) {
+    if (msg.tag() != message::Message::Tag::Field) {
+        executeNext(std::move(msg));
+        return;
+    }
+
+    executeNext(util::dispatchPrecisionTag(weightsPrecision_, [&](auto pt) -> message::Message {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+        using MatrixType = typename decltype(pt)::type;
+        return interpolate<MatrixType>(std::move(msg));
+    }));
+}
+
+
+void InterpolateMatrix::print(std::ostream& os) const {
+    os << "InterpolateMatrix(target-grid=" << targetGrid_ << ", weights-precision=" << precisionName(weightsPrecision_)
+       << ")";
+}
+
+
+static ActionBuilder<InterpolateMatrix> InterpolateMatrixBuilder("interpolate-matrix");
+
+}  // namespace multio::action::interpolateMatrix
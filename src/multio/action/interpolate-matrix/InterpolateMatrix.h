@@ -0,0 +1,73 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "multio/action/ChainedAction.h"
+#include "multio/action/interpolate-fesom/SparseMatrixInterpolator.h"
+#include "multio/message/Metadata.h"
+#include "multio/util/BufferPool.h"
+#include "multio/util/PrecisionTag.h"
+
+
+namespace multio::action::interpolateMatrix {
+
+using interpolateFESOM::SparseMatrixInterpolator;
+
+/**
+ * \class MultIO Action interpolating fields with precomputed sparse weights (e.g. conservative or bilinear remapping
+ * of NEMO/ORCA or ICON output), read from caches in the format of the FESOM caches. The cache of a field is selected
+ * by the grid of the field (`uuidOfHGrid`) and the `target-grid` of the action:
+ *
+ *   <cache-path>/matrix_<uuidOfHGrid>_to_<target-grid>_<weights-precision>.{csr,atlas}
+ *
+ * Caches are generated offline from weight triplets with multio-generate-matrix-cache. Target points without weights
+ * are set to `missing-value` (required). Masking of source points has to be part of the weights, fields with missing
+ * values (bitmapPresent) are rejected. The keys in `target-metadata` (e.g. gridType, Nside, orderingConvention)
+ * describe the target grid in the output metadata.
+ */
+class InterpolateMatrix final : public ChainedAction {
+public:
+    explicit InterpolateMatrix(const ComponentConfiguration& compConf);
+
+private:
+    void print(std::ostream&) const override;
+    void executeImpl(message::Message) override;
+
+    template <typename MatrixType>
+    message::Message interpolate(message::Message&& msg);
+
+    // Interpolator of a source grid, the matrix is loaded on first use (shared through the FesomMatrixStore)
+    template <typename MatrixType>
+    SparseMatrixInterpolator<MatrixType>& interpolator(const std::string& uuidOfHGrid);
+
+    const std::string cachePath_;
+    const std::string targetGrid_;
+    const message::Metadata targetMetadata_;
+    const double missingValue_;
+    const std::string outputPrecision_;
+    const util::PrecisionTag weightsPrecision_;
+    const std::size_t threads_;
+
+    std::map<std::string, std::unique_ptr<SparseMatrixInterpolator<float>>> singleInterpolators_;
+    std::map<std::string, std::unique_ptr<SparseMatrixInterpolator<double>>> doubleInterpolators_;
+
+    // Output payloads are written into buffers recycled once downstream actions release them, at most
+    // `buffer-pool-size` are kept
+    util::BufferPool bufferPool_;
+};
+
+}  // namespace multio::action::interpolateMatrix
@@ -0,0 +1,117 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "MatrixCache.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <tuple>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+
+
+namespace multio::action::interpolateMatrix {
+
+std::string matrixCacheName(const std::string& uuidOfHGrid, const std::string& targetGrid,
+                            const std::string& precision) {
+    return "matrix_" + uuidOfHGrid + "_to_" + targetGrid + "_" + precision;
+}
+
+
+std::optional<std::string> findMatrixCache(const std::string& cachePath, const std::string& uuidOfHGrid,
+                                           const std::string& targetGrid, const std::string& precision) {
+    const std::string base = cachePath + "/" + matrixCacheName(uuidOfHGrid, targetGrid, precision);
+    // Flat caches can be memory-mapped and are preferred if present
+    for (const auto& fname : {base + ".csr", base + ".atlas"}) {
+        if (eckit::PathName{fname}.exists()) {
+            return fname;
+        }
+    }
+    return std::nullopt;
+}
+
+
+template <typename MatrixType>
+FesomMatrix<MatrixType> MatrixWeights<MatrixType>::view() const {
+    FesomMatrix<MatrixType> matrix;
+    matrix.nnz = values.size();
+    matrix.nRows = landSeaMask.size();
+    matrix.nCols = nCols;
+    matrix.nOutRows = nOutRows;
+    matrix.landSeaMask = landSeaMask.data();
+    matrix.rowStart = rowStart.data();
+    matrix.colIdx = colIdx.data();
+    matrix.values = values.data();
+    return matrix;
+}
+
+
+template <typename MatrixType>
+MatrixWeights<MatrixType> buildMatrixWeights(std::vector<Triplet> triplets, size_t sourceSize, size_t targetSize) {
+    if (sourceSize > static_cast<size_t>(std::numeric_limits<std::int32_t>::max())
+        || targetSize > static_cast<size_t>(std::numeric_limits<std::int32_t>::max())) {
+        throw eckit::UserError("Grids too large for 32 bit indices", Here());
+    }
+    for (const auto& t : triplets) {
+        if (t.target < 0 || static_cast<size_t>(t.target) >= targetSize || t.source < 0
+            || static_cast<size_t>(t.source) >= sourceSize) {
+            std::ostringstream os;
+            os << "Weight outside of the grids: target " << t.target << " (of " << targetSize << "), source "
+               << t.source << " (of " << sourceSize << ")";
+            throw eckit::UserError(os.str(), Here());
+        }
+    }
+
+    std::sort(triplets.begin(), triplets.end(), [](const Triplet& a, const Triplet& b) {
+        return std::tie(a.target, a.source) < std::tie(b.target, b.source);
+    });
+
+    MatrixWeights<MatrixType> weights;
+    weights.nCols = sourceSize;
+    weights.nOutRows = targetSize;
+    weights.colIdx.reserve(triplets.size());
+    weights.values.reserve(triplets.size());
+
+    // Summed up in double precision, converted once
+    std::vector<double> sums;
+    sums.reserve(triplets.size());
+    for (size_t i = 0; i < triplets.size(); ++i) {
+        const auto& t = triplets[i];
+        if (i > 0 && t.target == triplets[i - 1].target && t.source == triplets[i - 1].source) {
+            sums.back() += t.weight;
+            continue;
+        }
+        if (weights.landSeaMask.empty() || t.target != weights.landSeaMask.back()) {
+            if (!weights.landSeaMask.empty()) {
+                weights.rowStart.push_back(static_cast<std::int32_t>(sums.size()));
+            }
+            weights.landSeaMask.push_back(t.target);
+        }
+        weights.colIdx.push_back(t.source);
+        sums.push_back(t.weight);
+    }
+    if (!weights.landSeaMask.empty()) {
+        weights.rowStart.push_back(static_cast<std::int32_t>(sums.size()));
+    }
+    weights.values.assign(sums.begin(), sums.end());
+    return weights;
+}
+
+
+template struct MatrixWeights<float>;
+template struct MatrixWeights<double>;
+
+template MatrixWeights<float> buildMatrixWeights<float>(std::vector<Triplet>, size_t, size_t);
+template MatrixWeights<double> buildMatrixWeights<double>(std::vector<Triplet>, size_t, size_t);
+
+}  // namespace multio::action::interpolateMatrix
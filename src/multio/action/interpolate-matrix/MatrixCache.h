@@ -0,0 +1,65 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "multio/action/interpolate-fesom/FesomMatrixStore.h"
+
+
+namespace multio::action::interpolateMatrix {
+
+using interpolateFESOM::FesomMatrix;
+
+// Name of the cache of the weights from a source grid (uuidOfHGrid) to a target grid, without extension
+std::string matrixCacheName(const std::string& uuidOfHGrid, const std::string& targetGrid,
+                            const std::string& precision);
+
+// Path of the cache in cachePath, the flat cache (`.csr`) if present, else the atlas cache. Empty if none exists.
+std::optional<std::string> findMatrixCache(const std::string& cachePath, const std::string& uuidOfHGrid,
+                                           const std::string& targetGrid, const std::string& precision);
+
+// Weight of a source point in the value of a target point
+struct Triplet {
+    std::int32_t target;
+    std::int32_t source;
+    double weight;
+};
+
+/**
+ * Interpolation matrix in the layout of the FESOM caches, holding its arrays. Row `i` holds the weights of target
+ * point `landSeaMask[i]`; target points without weights (e.g. land points of an ocean grid) are set to the missing
+ * value by the interpolation.
+ */
+template <typename MatrixType>
+struct MatrixWeights {
+    size_t nCols = 0;
+    size_t nOutRows = 0;
+    std::vector<std::int32_t> landSeaMask;
+    std::vector<std::int32_t> rowStart{0};
+    std::vector<std::int32_t> colIdx;
+    std::vector<MatrixType> values;
+
+    FesomMatrix<MatrixType> view() const;
+};
+
+// Sorts the triplets by target and source point, weights given more than once for the same pair are summed up.
+// Throws if a point is outside of the grids.
+template <typename MatrixType>
+MatrixWeights<MatrixType> buildMatrixWeights(std::vector<Triplet> triplets, size_t sourceSize, size_t targetSize);
+
+}  // namespace multio::action::interpolateMatrix
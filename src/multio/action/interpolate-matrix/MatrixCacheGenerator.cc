@@ -0,0 +1,191 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/log/Log.h"
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+#include "multio/tools/MultioTool.h"
+
+#include "MatrixCache.h"
+
+namespace multio::action::interpolateMatrix {
+
+class MatrixCacheGenerator final : public multio::MultioTool {
+public:  // methods
+    MatrixCacheGenerator(int argc, char** argv);
+
+private:
+    void usage(const std::string& tool) const override {
+        eckit::Log::info() << std::endl << "Usage: " << tool << " [options]" << std::endl;
+        eckit::Log::info()
+            << "EXAMPLE: " << std::endl
+            << "multio-generate-matrix-cache --inputFile=eORCA1_to_H32.csv --uuidOfHGrid=<uuid> --targetGrid=H32_ring "
+               "--sourceSize=120184 --targetSize=12288"
+            << std::endl
+            << "The input file holds one weight per line: target index, source index, weight (0-based, separated by "
+               "blanks or commas), e.g. converted from the output of an offline remapping tool (conservative, "
+               "bilinear, ...). The caches are written as "
+            << matrixCacheName("<uuidOfHGrid>", "<targetGrid>", "<precision>")
+            << ".{atlas,csr} and read by the interpolate-matrix action." << std::endl
+            << std::endl;
+    }
+
+    void init(const eckit::option::CmdArgs& args) override;
+
+    void finish(const eckit::option::CmdArgs&) override;
+
+    void execute(const eckit::option::CmdArgs& args) override;
+
+    int numberOfPositionalArguments() const override { return 0; }
+    int minimumPositionalArguments() const override { return 0; }
+
+    std::vector<Triplet> loadTriplets() const;
+
+    template <typename MatrixType>
+    void writeCache(const std::vector<Triplet>& triplets) const;
+
+    std::string inputFile_;
+    std::string outputPath_;
+    std::string uuidOfHGrid_;
+    std::string targetGrid_;
+    std::string format_;
+    std::string precision_;
+    long sourceSize_;
+    long targetSize_;
+};
+
+
+MatrixCacheGenerator::MatrixCacheGenerator(int argc, char** argv) :
+    multio::MultioTool{argc, argv},
+    outputPath_{"."},
+    format_{"flat"},
+    precision_{"both"},
+    sourceSize_{0},
+    targetSize_{0} {
+
+    options_.push_back(new eckit::option::SimpleOption<std::string>("inputFile", "File with the weight triplets"));
+    options_.push_back(new eckit::option::SimpleOption<std::string>(
+        "outputPath", "Path of the output cache files. Default( \".\" )"));
+    options_.push_back(
+        new eckit::option::SimpleOption<std::string>("uuidOfHGrid", "uuidOfHGrid of the source grid of the fields"));
+    options_.push_back(new eckit::option::SimpleOption<std::string>(
+        "targetGrid", "Name of the target grid, as given to the action by target-grid"));
+    options_.push_back(new eckit::option::SimpleOption<long>("sourceSize", "Number of points of the source grid"));
+    options_.push_back(new eckit::option::SimpleOption<long>("targetSize", "Number of points of the target grid"));
+    options_.push_back(new eckit::option::SimpleOption<std::string>(
+        "format", "Format of the cache files [atlas, flat, both]. Default( \"flat\" )"));
+    options_.push_back(new eckit::option::SimpleOption<std::string>(
+        "precision", "Precision of the weights [single, double, both]. Default( \"both\" )"));
+}
+
+
+std::vector<Triplet> MatrixCacheGenerator::loadTriplets() const {
+    std::ifstream file(inputFile_);
+    if (!file.good()) {
+        throw eckit::SeriousBug("Unable to read the input file: " + inputFile_, Here());
+    }
+
+    static const std::regex lineGrammar(
+        "\\s*([0-9]+)\\s*[,\\s]\\s*([0-9]+)\\s*[,\\s]\\s*([-+]?([0-9]*[.])?[0-9]+([eE][-+]?[0-9]+)?)\\s*");
+    std::vector<Triplet> triplets;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::smatch matchLine;
+        if (!std::regex_match(line, matchLine, lineGrammar)) {
+            throw eckit::SeriousBug("Unable to parse line: " + line, Here());
+        }
+        triplets.push_back(Triplet{static_cast<std::int32_t>(std::stol(matchLine[1].str())),
+                                   static_cast<std::int32_t>(std::stol(matchLine[2].str())),
+                                   std::stod(matchLine[3].str())});
+    }
+    return triplets;
+}
+
+
+void MatrixCacheGenerator::init(const eckit::option::CmdArgs& args) {
+    args.get("inputFile", inputFile_);
+    args.get("outputPath", outputPath_);
+    args.get("uuidOfHGrid", uuidOfHGrid_);
+    args.get("targetGrid", targetGrid_);
+    args.get("sourceSize", sourceSize_);
+    args.get("targetSize", targetSize_);
+    args.get("format", format_);
+    args.get("precision", precision_);
+
+    if (inputFile_.empty() || uuidOfHGrid_.empty() || targetGrid_.empty()) {
+        throw eckit::UserError("inputFile, uuidOfHGrid and targetGrid are required", Here());
+    }
+    if (sourceSize_ <= 0 || targetSize_ <= 0) {
+        throw eckit::UserError("sourceSize and targetSize have to be positive", Here());
+    }
+    if (format_ != "atlas" && format_ != "flat" && format_ != "both") {
+        throw eckit::UserError("Unknown cache format: " + format_, Here());
+    }
+    if (precision_ != "single" && precision_ != "double" && precision_ != "both") {
+        throw eckit::UserError("Unknown precision: " + precision_, Here());
+    }
+
+    eckit::PathName inputFile_tmp{inputFile_};
+    ASSERT(inputFile_tmp.exists());
+    eckit::PathName outputPath_tmp{outputPath_};
+    outputPath_tmp.mkdir();
+}
+
+
+template <typename MatrixType>
+void MatrixCacheGenerator::writeCache(const std::vector<Triplet>& triplets) const {
+    const std::string precision = sizeof(MatrixType) == 4 ? "single" : "double";
+    const auto weights = buildMatrixWeights<MatrixType>(triplets, static_cast<size_t>(sourceSize_),
+                                                        static_cast<size_t>(targetSize_));
+    const std::string base = outputPath_ + "/" + matrixCacheName(uuidOfHGrid_, targetGrid_, precision);
+
+    if (format_ != "flat") {
+        interpolateFESOM::writeAtlasCache(base + ".atlas", 0, 0, weights.view());
+    }
+    if (format_ != "atlas") {
+        interpolateFESOM::writeFlatCache(base + ".csr", 0, 0, weights.view());
+    }
+
+    eckit::Log::info() << "Written " << base << " (" << weights.values.size() << " weights, "
+                       << weights.landSeaMask.size() << " of " << targetSize_ << " target points)" << std::endl;
+}
+
+
+void MatrixCacheGenerator::execute(const eckit::option::CmdArgs&) {
+    const auto triplets = loadTriplets();
+    if (precision_ != "double") {
+        writeCache<float>(triplets);
+    }
+    if (precision_ != "single") {
+        writeCache<double>(triplets);
+    }
+}
+
+
+void MatrixCacheGenerator::finish(const eckit::option::CmdArgs&) {}
+
+}  // namespace multio::action::interpolateMatrix
+
+
+int main(int argc, char** argv) {
+    multio::action::interpolateMatrix::MatrixCacheGenerator tool(argc, argv);
+    return tool.start();
+}
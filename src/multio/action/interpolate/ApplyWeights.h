@@ -0,0 +1,86 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include "eckit/linalg/SparseMatrix.h"
+
+#include "multio/message/ValueStatistics.h"
+
+
+namespace multio::action::interpolate {
+
+// Applies the weights as MIR does by default for fields with missing values (non-linear:
+// missing-if-heaviest-missing): a row is missing if its heaviest weight refers to a missing value, otherwise the
+// weights of missing values are dropped and the remaining ones renormalised. Rows without missing values are a plain
+// dot product. Input and output may be single precision, sums are always accumulated in double precision.
+// The statistics of the output values are collected on the way.
+template <typename In, typename Out>
+void applyWeights(const eckit::linalg::SparseMatrix& W, const In* in, Out* out,
+                  const std::optional<double>& missingValue, message::ValueStatistics& stats) {
+    const auto* outer = W.outer();
+    const auto* inner = W.inner();
+    const auto* weights = W.data();
+
+    stats = message::ValueStatistics{};
+    auto store = [&](std::size_t row, double value) {
+        out[row] = static_cast<Out>(value);
+        stats.add(static_cast<double>(out[row]));
+    };
+
+    for (std::size_t row = 0; row < W.rows(); ++row) {
+        double sum = 0.0;
+        if (!missingValue) {
+            for (auto k = outer[row]; k < outer[row + 1]; ++k) {
+                sum += weights[k] * static_cast<double>(in[inner[k]]);
+            }
+            store(row, sum);
+            continue;
+        }
+
+        double weightSum = 0.0;
+        double heaviest = 0.0;
+        bool heaviestMissing = false;
+        bool anyMissing = false;
+        for (auto k = outer[row]; k < outer[row + 1]; ++k) {
+            const double value = static_cast<double>(in[inner[k]]);
+            const bool missing = value == *missingValue;
+            if (k == outer[row] || weights[k] > heaviest) {
+                heaviest = weights[k];
+                heaviestMissing = missing;
+            }
+            if (missing) {
+                anyMissing = true;
+            }
+            else {
+                sum += weights[k] * value;
+                weightSum += weights[k];
+            }
+        }
+
+        if (!anyMissing) {
+            store(row, sum);
+        }
+        else if (heaviestMissing || weightSum == 0.0) {
+            out[row] = static_cast<Out>(*missingValue);
+            ++stats.missing;
+        }
+        else {
+            store(row, sum / weightSum);
+        }
+    }
+}
+
+}  // namespace multio::action::interpolate
@@ -14,12 +14,15 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/linalg/SparseMatrix.h"
 #include "eckit/mpi/Comm.h"
 #include "eckit/parser/YAMLParser.h"
 #include "eckit/types/Fraction.h"
@@ -33,8 +36,10 @@
 #include "mir/repres/gauss/reduced/Reduced.h"
 
 #include "multio/LibMultio.h"
+#include "multio/action/interpolate/ApplyWeights.h"
 #include "multio/message/Glossary.h"
 #include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
 #include "multio/util/PrecisionTag.h"
 #include "multio/util/Substitution.h"
 
@@ -46,7 +51,8 @@ using message::MetadataTypes;
 
 namespace {
 
-// Quick and dirty fix to avoid encoding problems with spherical harmonics
+// Quick and dirty fix to avoid encoding problems with spherical harmonics. The statistics of the input values do not
+// hold for the interpolated ones (the encoder would pack with the wrong range), they are set again where known.
 const std::vector<typename MetadataTypes::KeyType> metadata_black_list{glossary().sphericalHarmonics,
                                                                        glossary().complexPacking,
                                                                        glossary().pentagonalResolutionParameterJ,
@@ -54,7 +60,10 @@ const std::vector<typename MetadataTypes::KeyType> metadata_black_list{glossary(
                                                                        glossary().pentagonalResolutionParameterM,
                                                                        glossary().subSetJ,
                                                                        glossary().subSetK,
-                                                                       glossary().subSetM};
+                                                                       glossary().subSetM,
+                                                                       glossary().minimumValue,
+                                                                       glossary().maximumValue,
+                                                                       glossary().numberOfMissingValues};
 
 const std::vector<double> full_area{90.0, 0.0, -90.0, 360.0};
 
@@ -177,6 +186,77 @@ std::string generateKey(const message::Message& msg, const std::string& cache_pa
     return cache_path + "/" + key;
 }
 
+// Keys of the MARS post-processing language (grid, area, rotation, ...)
+struct PostProcKeys : std::vector<std::string> {
+    PostProcKeys() {
+        const auto yaml = eckit::YAMLParser::decodeFile(metkit::mars::MarsLanguage::languageYamlFile());
+        for (const auto& key : yaml["_postproc"].keys().as<eckit::ValueList>()) {
+            emplace_back(key.as<std::string>());
+        }
+    }
+    bool contains(const std::string& key) const { return std::find(begin(), end(), key) != end(); }
+};
+
+const PostProcKeys& postprocKeys() {
+    static const PostProcKeys postproc;
+    return postproc;
+}
+
+std::string interpolationMatrixFile(const eckit::LocalConfiguration& cfg, const message::Message& msg, size_t NSide) {
+    const auto cache_path = cfg.has("cache-path") ? cfg.getString("cache-path") : "";
+    const auto expanded_cache_path = util::replaceCurly(cache_path, [](std::string_view replace) {
+        std::string lookUpKey{replace};
+        char* env = ::getenv(lookUpKey.c_str());
+        return env ? std::optional<std::string>{env} : std::optional<std::string>{};
+    });
+    return generateKey<double>(msg, expanded_cache_path, NSide, "ring");
+}
+
+// Nside of the output grid if it is configured as HEALPix (e.g. `grid: H128`)
+std::optional<size_t> outputHEALPixNSide(const eckit::LocalConfiguration& cfg) {
+    if (!cfg.has("grid") || !cfg.isString("grid")) {
+        return std::nullopt;
+    }
+    const std::string input = util::replaceCurly(cfg.getString("grid"), [](std::string_view replace) {
+        std::string lookUpKey{replace};
+        char* env = ::getenv(lookUpKey.c_str());
+        return env ? std::optional<std::string>{env} : std::optional<std::string>{};
+    });
+    static const std::regex H("([h|H])([1-9][0-9]*)");
+    std::smatch matchH;
+    if (std::regex_match(input, matchH, H)) {
+        return static_cast<size_t>(std::stol(matchH[2].str()));
+    }
+    return std::nullopt;
+}
+
+bool interpolationMatrixRequested(const eckit::LocalConfiguration& cfg) {
+    return cfg.has("options") && cfg.getSubConfiguration("options").has("interpolation")
+        && cfg.getSubConfiguration("options").getString("interpolation") == "matrix";
+}
+
+// Whether applying the weights of the interpolation matrix is all MIR would do with this configuration. Any other
+// post-processing (area, rotation, ...) or treatment of missing values is left to MIR.
+bool weightsSufficient(const eckit::LocalConfiguration& cfg) {
+    for (const auto& key : postprocKeys()) {
+        if (key != "grid" && cfg.has(key)) {
+            return false;
+        }
+    }
+    const auto options = cfg.getSubConfiguration("options");
+    for (const auto& key : options.keys()) {
+        if (key == "non-linear") {
+            if (!options.isString(key) || options.getString(key) != "missing-if-heaviest-missing") {
+                return false;
+            }
+        }
+        else if (key != "interpolation" && key != "missing_value") {
+            return false;
+        }
+    }
+    return true;
+}
+
 }  // namespace
 
 void fill_out_metadata(const message::Metadata& in_md, message::Metadata& out_md) {
@@ -309,15 +389,7 @@ void fill_input(const eckit::LocalConfiguration& cfg, mir::param::SimpleParametr
 void fill_job(const eckit::LocalConfiguration& cfg, mir::param::SimpleParametrisation& destination,
               message::Metadata& md, const message::MetadataValue& inp, const message::Message& msg) {
 
-    static const struct PostProcKeys : std::vector<std::string> {
-        PostProcKeys() {
-            const auto yaml = eckit::YAMLParser::decodeFile(metkit::mars::MarsLanguage::languageYamlFile());
-            for (const auto& key : yaml["_postproc"].keys().as<eckit::ValueList>()) {
-                emplace_back(key.as<std::string>());
-            }
-        }
-        bool contains(const std::string& key) const { return std::find(begin(), end(), key) != end(); }
-    } postproc;
+    const auto& postproc = postprocKeys();
 
     ASSERT(not postproc.contains("input"));
     ASSERT(not postproc.contains("options"));
@@ -420,15 +492,7 @@ void fill_job(const eckit::LocalConfiguration& cfg, mir::param::SimpleParametris
                     os << " - interpolation matrix supported only for fesom -> Healpix" << std::endl;
                     throw eckit::SeriousBug(os.str(), Here());
                 }
-                const auto& options = cfg.getSubConfiguration("options");
-                const auto cache_path = cfg.has("cache-path") ? cfg.getString("cache-path") : "";
-                const auto expanded_cache_path = util::replaceCurly(cache_path, [](std::string_view replace) {
-                    std::string lookUpKey{replace};
-                    char* env = ::getenv(lookUpKey.c_str());
-                    return env ? std::optional<std::string>{env} : std::optional<std::string>{};
-                });
-                const auto weights_file = generateKey<double>(msg, expanded_cache_path, grid[0], "ring");
-                destination.set("interpolation-matrix", weights_file);
+                destination.set("interpolation-matrix", interpolationMatrixFile(cfg, msg, grid[0]));
             }
         }
         else {
@@ -437,77 +501,198 @@ void fill_job(const eckit::LocalConfiguration& cfg, mir::param::SimpleParametris
     }
 }
 
-template <>
-message::Message Interpolate::InterpolateMessage<double>(message::Message&& msg) const {
-    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: Metadata of the input message :: " << std::endl
-                             << msg.metadata() << std::endl
-                             << std::endl;
+struct InterpolationPlan {
+    // Description of the input grid, including the missing value
+    mir::param::SimpleParametrisation input;
+    mir::api::MIRJob job;
 
-    const auto& config = Action::compConf_.parsedConfig();
+    // Metadata describing the output grid
+    message::Metadata gridMetadata;
 
-    const double* data = reinterpret_cast<const double*>(msg.payload().data());
-    const size_t size = msg.payload().size() / sizeof(double);
+    // Weights of `interpolation: matrix`, applied in place of running the MIR job if that is all the job would do
+    std::unique_ptr<eckit::linalg::SparseMatrix> weights;
 
-    message::Metadata md;
-    fill_out_metadata(msg.metadata(), md);
-    md.set("precision", "double");
+    std::optional<double> missingValue;
+};
 
-    mir::param::SimpleParametrisation inputPar;
-    auto inp = getInputGrid(config, md);
-    fill_input(config, inputPar, size, msg.metadata().getOpt<std::string>(glossary().domain).value_or(""), inp);
+namespace {
+
+std::optional<double> inputMissingValue(const eckit::LocalConfiguration& config, const message::Message& msg) {
     auto searchMissingValue = msg.metadata().find("missingValue");
     auto searchBitmapPresent = msg.metadata().find("bitmapPresent");
     if (searchMissingValue != msg.metadata().end() && searchBitmapPresent != msg.metadata().end()) {
-        inputPar.set("missing_value", searchMissingValue->second.get<double>());
+        return searchMissingValue->second.get<double>();
     }
-    else if (config.getSubConfiguration("options").has("missing_value")) {
-        inputPar.set("missing_value", config.getSubConfiguration("options").getDouble("missing_value"));
+    if (config.getSubConfiguration("options").has("missing_value")) {
+        return config.getSubConfiguration("options").getDouble("missing_value");
     }
+    return std::nullopt;
+}
 
-    mir::input::RawInput input(data, size, inputPar);
+// Everything the plan depends on besides the configuration of the action
+std::string planKey(const eckit::LocalConfiguration& config, const message::Message& msg,
+                    const message::MetadataValue& inp, size_t size, const std::optional<double>& missingValue) {
+    std::ostringstream os;
+    os << inp << ";" << msg.metadata().getOpt<std::string>(glossary().domain).value_or("") << ";" << size << ";";
+    if (missingValue) {
+        os << std::setprecision(17) << *missingValue;
+    }
+    if (interpolationMatrixRequested(config)) {
+        if (const auto NSide = outputHEALPixNSide(config)) {
+            os << ";" << interpolationMatrixFile(config, msg, *NSide);
+        }
+    }
+    return os.str();
+}
 
-    mir::api::MIRJob job;
-    fill_job(config, job, md, inp, msg);
-
-    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: input :: " << std::endl << inputPar << std::endl << std::endl;
-
-    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: job " << std::endl << job << std::endl << std::endl;
-
-    std::vector<double> outData;
-    mir::param::SimpleParametrisation outMetadata;
-    mir::output::ResizableOutput output(outData, outMetadata);
-
-    // TODO: Probably this operation needs to be done when plans are called, in this way
-    //       it is valid for all the IO actions as it should be
-    auto& originalComm = eckit::mpi::comm();
-    eckit::mpi::setCommDefault("self");
-    job.execute(input, output);
-    eckit::mpi::setCommDefault(originalComm.name().c_str());
-    md.set<std::int64_t>("globalSize", outData.size());
-
-    // Forward the metadata from mir to multIO (at the moment only missingValue)
-    if (outMetadata.has("missing_value")) {
-        double v;
-        outMetadata.get("missing_value", v);
-        md.set("missingValue", v);
-        md.set("bitmapPresent", true);
+std::unique_ptr<InterpolationPlan> makePlan(const eckit::LocalConfiguration& config, const message::Message& msg,
+                                            const message::MetadataValue& inp, size_t size,
+                                            const std::optional<double>& missingValue) {
+    auto plan = std::make_unique<InterpolationPlan>();
+    plan->missingValue = missingValue;
+
+    fill_input(config, plan->input, size, msg.metadata().getOpt<std::string>(glossary().domain).value_or(""), inp);
+    if (missingValue) {
+        plan->input.set("missing_value", *missingValue);
     }
 
-    eckit::Buffer buffer(reinterpret_cast<const char*>(outData.data()), outData.size() * sizeof(double));
+    fill_job(config, plan->job, plan->gridMetadata, inp, msg);
 
-    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: Metadata of the output message :: " << std::endl
-                             << md << std::endl
-                             << std::endl;
+    if (interpolationMatrixRequested(config) && weightsSufficient(config)) {
+        if (const auto NSide = outputHEALPixNSide(config)) {
+            plan->weights = std::make_unique<eckit::linalg::SparseMatrix>();
+            plan->weights->load(eckit::PathName{interpolationMatrixFile(config, msg, *NSide)});
+            if (plan->weights->cols() != size) {
+                std::ostringstream os;
+                os << "action-interpolate :: interpolation matrix expects " << plan->weights->cols()
+                   << " input values, got " << size;
+                throw eckit::SeriousBug(os.str(), Here());
+            }
+        }
+    }
+
+    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: input :: " << std::endl << plan->input << std::endl << std::endl;
+
+    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: job " << std::endl << plan->job << std::endl << std::endl;
+
+    return plan;
+}
+
+std::string outputPrecision(const eckit::LocalConfiguration& config) {
+    const auto precision = config.getString("output-precision", "double");
+    if (precision != "single" && precision != "double" && precision != "from-message") {
+        throw eckit::UserError(
+            "action-interpolate :: output-precision has to be one of [single|double|from-message], got " + precision,
+            Here());
+    }
+    return precision;
+}
+
+}  // namespace
+
+Interpolate::Interpolate(const ComponentConfiguration& compConf) :
+    ChainedAction{compConf},
+    outputPrecision_{outputPrecision(compConf.parsedConfig())},
+    plans_{static_cast<std::size_t>(std::max(0L, compConf.parsedConfig().getLong("plan-cache-size", 64)))},
+    bufferPool_{static_cast<std::size_t>(std::max(0L, compConf.parsedConfig().getLong("buffer-pool-size", 16)))} {}
+
+Interpolate::~Interpolate() = default;
 
+InterpolationPlan& Interpolate::plan(const message::Message& msg, const message::MetadataValue& inp, size_t size,
+                                     const std::optional<double>& missingValue) {
+    const auto& config = Action::compConf_.parsedConfig();
 
-    return {message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(), std::move(md)},
-            std::move(buffer)};
+    auto key = plans_.capacity() == 0 ? std::string{} : planKey(config, msg, inp, size, missingValue);
+    auto& plan = plans_.get(key, [&]() { return makePlan(config, msg, inp, size, missingValue); });
+    statistics_.cacheHits_ = plans_.hits();
+    statistics_.cacheMisses_ = plans_.misses();
+    return plan;
 }
 
-template <>
-message::Message Interpolate::InterpolateMessage<float>(message::Message&& msg) const {
-    // convert single/double precision, interpolate, convert double/single
-    return InterpolateMessage<double>(message::convert_precision<float, double>(std::move(msg)));
+template <typename T>
+message::Message Interpolate::InterpolateMessage(message::Message&& msg) {
+    LOG_DEBUG_LIB(LibMultio) << "Interpolate :: Metadata of the input message :: " << std::endl
+                             << msg.metadata() << std::endl
+                             << std::endl;
+
+    const auto& config = Action::compConf_.parsedConfig();
+
+    const T* data = reinterpret_cast<const T*>(msg.payload().data());
+    const size_t size = msg.payload().size() / sizeof(T);
+
+    message::Metadata md;
+    fill_out_metadata(msg.metadata(), md);
+
+    auto inp = getInputGrid(config, md);
+    const auto& plan = this->plan(msg, inp, size, inputMissingValue(config, msg));
+
+    md.updateOverwrite(plan.gridMetadata);
+
+    const auto outPrecision
+        = (outputPrecision_ == "from-message" ? msg.precision() : util::decodePrecisionTag(outputPrecision_));
+
+    return util::dispatchPrecisionTag(outPrecision, [&](auto pt) -> message::Message {
+        using Out = typename decltype(pt)::type;
+
+        md.set("precision", sizeof(Out) == 4 ? "single" : "double");
+
+        std::shared_ptr<eckit::Buffer> buffer;
+        if (plan.weights) {
+            // Weights are applied directly to a pooled payload, single precision fields are never converted
+            buffer = bufferPool_.get(plan.weights->rows() * sizeof(Out));
+            message::ValueStatistics stats;
+            applyWeights(*plan.weights, data, static_cast<Out*>(buffer->data()), plan.missingValue, stats);
+            md.set<std::int64_t>("globalSize", plan.weights->rows());
+            if (plan.missingValue) {
+                md.set("missingValue", *plan.missingValue);
+                md.set("bitmapPresent", true);
+            }
+            message::setValueStatistics(md, stats);
+        }
+        else {
+            // MIR only interpolates double precision values
+            std::vector<double> converted;
+            const double* values = nullptr;
+            if constexpr (std::is_same_v<T, double>) {
+                values = data;
+            }
+            else {
+                converted.assign(data, data + size);
+                values = converted.data();
+            }
+            mir::input::RawInput input(values, size, plan.input);
+
+            std::vector<double> outData;
+            mir::param::SimpleParametrisation outMetadata;
+            mir::output::ResizableOutput output(outData, outMetadata);
+
+            // TODO: Probably this operation needs to be done when plans are called, in this way
+            //       it is valid for all the IO actions as it should be
+            auto& originalComm = eckit::mpi::comm();
+            eckit::mpi::setCommDefault("self");
+            plan.job.execute(input, output);
+            eckit::mpi::setCommDefault(originalComm.name().c_str());
+            md.set<std::int64_t>("globalSize", outData.size());
+
+            // Forward the metadata from mir to multIO (at the moment only missingValue)
+            if (outMetadata.has("missing_value")) {
+                double v;
+                outMetadata.get("missing_value", v);
+                md.set("missingValue", v);
+                md.set("bitmapPresent", true);
+            }
+
+            buffer = bufferPool_.get(outData.size() * sizeof(Out));
+            std::copy(outData.begin(), outData.end(), static_cast<Out*>(buffer->data()));
+        }
+
+        LOG_DEBUG_LIB(LibMultio) << "Interpolate :: Metadata of the output message :: " << std::endl
+                                 << md << std::endl
+                                 << std::endl;
+
+        return {message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(), std::move(md)},
+                message::SharedPayload{std::move(buffer)}};
+    });
 }
 
 void Interpolate::executeImpl(message::Message msg) {
@@ -525,7 +710,7 @@ void Interpolate::executeImpl(message::Message msg) {
 
 
 void Interpolate::print(std::ostream& os) const {
-    os << "Interpolate";
+    os << "Interpolate(output-precision=" << outputPrecision_ << ")";
 }
 
 
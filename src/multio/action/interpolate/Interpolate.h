@@ -12,25 +12,50 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "multio/action/interpolate/PlanCache.h"
 #include "multio/action/ChainedAction.h"
+#include "multio/util/BufferPool.h"
 
 
 namespace multio::action::interpolate {
 
+struct InterpolationPlan;
+
 
 /**
  * \class MultIO Action for interpolation/regridding
  */
 class Interpolate final : public ChainedAction {
 public:
-    using ChainedAction::ChainedAction;
+    explicit Interpolate(const ComponentConfiguration& compConf);
+    ~Interpolate() override;
 
 private:
     template <typename T>
-    message::Message InterpolateMessage(message::Message&&) const;
+    message::Message InterpolateMessage(message::Message&&);
 
     void print(std::ostream&) const override;
     void executeImpl(message::Message) override;
+
+    InterpolationPlan& plan(const message::Message& msg, const message::MetadataValue& inp, std::size_t size,
+                            const std::optional<double>& missingValue);
+
+    // Precision of the interpolated fields: single, double (default) or from-message
+    const std::string outputPrecision_;
+
+    // Interpolation plans (MIR job setup, output grid metadata and, if available, the weights) are reused for all
+    // fields with the same input grid and missing value handling. The output grid, area and method are given by the
+    // configuration of the action. At most `plan-cache-size` plans are kept, the cache is dropped as a whole once
+    // full. 0 disables caching.
+    PlanCache<InterpolationPlan> plans_;
+
+    // Output payloads are written into buffers recycled once downstream actions release them, at most
+    // `buffer-pool-size` are kept
+    util::BufferPool bufferPool_;
 };
 
 
@@ -0,0 +1,68 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+namespace multio::action::interpolate {
+
+/**
+ * Plans keyed by everything they depend on besides the configuration of the action. At most `capacity` plans are
+ * kept, the cache is dropped as a whole once full. With a capacity of 0 every request makes a new plan.
+ */
+template <typename Plan>
+class PlanCache {
+public:
+    explicit PlanCache(std::size_t capacity) : capacity_{capacity} {}
+
+    // Returns the plan of key, calling make() to create it if it is not cached
+    template <typename Make>
+    Plan& get(const std::string& key, Make&& make) {
+        if (capacity_ == 0) {
+            ++misses_;
+            uncached_ = make();
+            return *uncached_;
+        }
+
+        if (auto search = plans_.find(key); search != plans_.end()) {
+            ++hits_;
+            return *search->second;
+        }
+
+        ++misses_;
+        if (plans_.size() >= capacity_) {
+            plans_.clear();
+        }
+        return *plans_.emplace(key, make()).first->second;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return plans_.size(); }
+
+    std::size_t hits() const { return hits_; }
+    std::size_t misses() const { return misses_; }
+
+private:
+    const std::size_t capacity_;
+    std::unordered_map<std::string, std::unique_ptr<Plan>> plans_;
+    std::unique_ptr<Plan> uncached_;
+
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+}  // namespace multio::action::interpolate
@@ -15,6 +15,7 @@
 #include "eckit/log/Log.h"
 
 #include "multio/domain/Mask.h"
+#include "multio/message/ValueStatistics.h"
 
 #include "multio/util/PrecisionTag.h"
 
@@ -60,15 +61,22 @@ message::Message Mask::createMasked(message::Message msg) const {
     msg.acquire();
     // Now metadata and payload can be modified
 
+    const bool offset = setContains(offsetFields_, msg.name());
     if (applyBitmap_) {
         applyMask<Precision>(msg);
     }
 
-    if (setContains(offsetFields_, msg.name())) {
+    if (offset) {
         applyOffset<Precision>(msg);
     }
 
-    message::Metadata& md = msg.modifyMetadata();
+    // Statistics of the values collected upstream no longer hold (copies shared metadata, only if they are present)
+    if ((applyBitmap_ || offset) && message::hasValueStatistics(msg.metadata())) {
+        message::eraseValueStatistics(msg.modifyMetadata());
+    }
+
+    // Set on top of the metadata shared with other messages instead of copying it
+    message::Metadata& md = msg.modifyMetadataOverlay();
     md.set("missingValue", missingValue_);
     md.set("bitmapPresent", true);
 
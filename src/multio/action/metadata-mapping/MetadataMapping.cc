@@ -25,12 +25,10 @@ MetadataMapping::MetadataMapping(const ComponentConfiguration& compConf) :
 void MetadataMapping::executeImpl(message::Message msg) {
     switch (msg.tag()) {
         case (message::Message::Tag::Field): {
-            // TODO optimize for mappings that do not have to match and avoid copying medata
-
-            // Get own copy of metadata in the message
+            // Mapped keys are set on top of the metadata shared with other messages instead of copying it
             msg.header().acquireMetadata();
 
-            applyInplace(msg.modifyMetadata());
+            applyInplace(msg.header().modifySharedMetadata());
             executeNext(std::move(msg));
             break;
         }
@@ -41,7 +39,7 @@ void MetadataMapping::executeImpl(message::Message msg) {
     };
 };
 
-void MetadataMapping::applyInplace(message::Metadata& md) const {
+void MetadataMapping::applyInplace(message::SharedMetadata& md) const {
     for (const auto& m : mappings_) {
         m.applyInplace(md, options_);
     }
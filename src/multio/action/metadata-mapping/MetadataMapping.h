@@ -30,7 +30,7 @@ public:
     void executeImpl(message::Message msg) override;
 
 protected:
-    void applyInplace(message::Metadata& md) const;
+    void applyInplace(message::SharedMetadata& md) const;
 
 private:
     void print(std::ostream& os) const override;
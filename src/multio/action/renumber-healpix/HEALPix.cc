@@ -152,7 +152,8 @@ int HEALPix::ring_to_nest(int r) const {
     int ifp = 1 + ((phi - 1 - ((1 - tmp + 2 * Nside_) >> 1)) >> k_);
     int f = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : (ifm + 8));
 
-    return to_nest(f, ring, Nring, phi, ring & 1);
+    // Rings with the first pixel shifted alternate starting from ring Nside (which is not shifted for Nside = 1)
+    return to_nest(f, ring, Nring, phi, (ring + Nside_) & 1);
 }
 
 
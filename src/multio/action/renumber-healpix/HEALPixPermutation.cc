@@ -0,0 +1,72 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "HEALPixPermutation.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "eckit/exception/Exceptions.h"
+
+#include "HEALPix.h"
+
+namespace multio::action {
+
+namespace {
+
+// Nested ordering requires a power of two, ring indices have to fit into uint32 (and the int of HEALPix)
+std::size_t checkNside(std::size_t Nside) {
+    if (Nside == 0 || (Nside & (Nside - 1)) != 0 || Nside > (1 << 13)) {
+        std::ostringstream oss;
+        oss << "HEALPixPermutation: Nside has to be a power of two up to 8192, got: " << Nside;
+        throw eckit::UserError(oss.str(), Here());
+    }
+    return Nside;
+}
+
+// Side of a tile: 64x64 pixels, or a whole base pixel for lower resolutions
+std::size_t tileSize(std::size_t Nside) {
+    const std::size_t side = std::min<std::size_t>(Nside, 64);
+    return side * side;
+}
+
+}  // namespace
+
+
+HEALPixPermutation::HEALPixPermutation(std::size_t Nside, std::size_t threads) :
+    Nside_{checkNside(Nside)}, tileSize_{tileSize(Nside)}, ring_(12 * Nside * Nside) {
+    const HEALPix healpix(static_cast<int>(Nside_));
+    std::uint32_t* ring = ring_.data();
+    forEachTile(threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t n = begin; n < end; ++n) {
+            ring[n] = static_cast<std::uint32_t>(healpix.nest_to_ring(static_cast<int>(n)));
+        }
+    });
+}
+
+
+HEALPixPermutation::HEALPixPermutation(std::size_t Nside, const std::vector<std::size_t>& ringToNest) :
+    Nside_{checkNside(Nside)}, tileSize_{tileSize(Nside)}, ring_(12 * Nside * Nside) {
+    if (ringToNest.size() != ring_.size()) {
+        std::ostringstream oss;
+        oss << "HEALPixPermutation: expected map size : " << ring_.size() << ", got: " << ringToNest.size();
+        throw eckit::UserError(oss.str(), Here());
+    }
+    for (std::size_t r = 0; r < ringToNest.size(); ++r) {
+        if (ringToNest[r] >= ring_.size()) {
+            std::ostringstream oss;
+            oss << "HEALPixPermutation: nested index out of range: " << ringToNest[r];
+            throw eckit::UserError(oss.str(), Here());
+        }
+        ring_[ringToNest[r]] = static_cast<std::uint32_t>(r);
+    }
+}
+
+}  // namespace multio::action
@@ -0,0 +1,85 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "multio/util/ParallelFor.h"
+
+namespace multio::action {
+
+/**
+ * Permutation between the ring and the nested ordering of a HEALPix grid (Nside a power of two), held as the ring
+ * index of each nested pixel (uint32, enough for Nside up to 2^13).
+ *
+ * Fields are reordered tile by tile. A tile is an aligned block of nested pixels, i.e. a square of a base pixel, whose
+ * ring indices lie on a few neighbouring rings: the nested side is accessed contiguously and the ring side stays in
+ * cache. Tiles are distributed over threads.
+ */
+class HEALPixPermutation {
+public:
+    // Computes the permutation analytically, on up to `threads` threads
+    explicit HEALPixPermutation(std::size_t Nside, std::size_t threads = 1);
+
+    // From a map of ring indices to nested indices (as stored in the cache files of multio-generate-healpix-cache)
+    HEALPixPermutation(std::size_t Nside, const std::vector<std::size_t>& ringToNest);
+
+    std::size_t nside() const { return Nside_; }
+    std::size_t size() const { return ring_.size(); }
+
+    // Ring index of a nested pixel
+    std::uint32_t ring(std::size_t nest) const { return ring_[nest]; }
+
+    template <typename T>
+    void ringToNest(const T* ring, T* nest, std::size_t threads = 1) const {
+        const std::uint32_t* idx = ring_.data();
+        forEachTile(threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t n = begin; n < end; ++n) {
+                nest[n] = ring[idx[n]];
+            }
+        });
+    }
+
+    template <typename T>
+    void nestToRing(const T* nest, T* ring, std::size_t threads = 1) const {
+        const std::uint32_t* idx = ring_.data();
+        forEachTile(threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t n = begin; n < end; ++n) {
+                ring[idx[n]] = nest[n];
+            }
+        });
+    }
+
+private:
+    // Calls func(begin, end) on ranges of whole tiles of nested pixels
+    template <typename Func>
+    void forEachTile(std::size_t threads, Func&& func) const {
+        const std::size_t nTiles = size() / tileSize_;
+        const std::size_t nChunks = util::numChunks(threads, nTiles, std::max<std::size_t>(1, minChunk_ / tileSize_));
+        util::parallelFor(nChunks, nTiles, [&](std::size_t, std::size_t first, std::size_t last) {
+            for (std::size_t tile = first; tile < last; ++tile) {
+                func(tile * tileSize_, (tile + 1) * tileSize_);
+            }
+        });
+    }
+
+    // Minimum number of pixels per thread
+    static constexpr std::size_t minChunk_ = 1 << 16;
+
+    std::size_t Nside_;
+    std::size_t tileSize_;
+    std::vector<std::uint32_t> ring_;
+};
+
+}  // namespace multio::action
@@ -15,6 +15,7 @@
 
 #include "HEALPix_ring2nest.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <string>
 
@@ -34,12 +35,10 @@ namespace multio::action {
 namespace {
 std::string parseCacheFileName(const ComponentConfiguration& compConf) {
 
-    // Check necessary options
+    // Without a cache file the permutations are computed
     const auto cfg = compConf.parsedConfig();
     if (!cfg.has("cache-file-name")) {
-        std::ostringstream oss;
-        oss << "HEALPix_ring2nest: expected \"cache-file-name\" option" << std::endl;
-        throw eckit::UserError(oss.str(), Here());
+        return "";
     }
 
     // Expand file name
@@ -56,7 +55,18 @@ std::string parseCacheFileName(const ComponentConfiguration& compConf) {
     return cacheFileName;
 }
 
-void checkMetadata(const message::Metadata& md) {
+bool parseDirection(const ComponentConfiguration& compConf) {
+    const auto direction = compConf.parsedConfig().getString("direction", "ring2nest");
+    if (direction != "ring2nest" && direction != "nest2ring") {
+        std::ostringstream oss;
+        oss << "HEALPix_ring2nest: expected \"direction\" to be one of [ring2nest|nest2ring], got: " << direction
+            << std::endl;
+        throw eckit::UserError(oss.str(), Here());
+    }
+    return direction == "ring2nest";
+}
+
+void checkMetadata(const message::Metadata& md, bool toNested) {
     auto searchGridType = md.find("gridType");
     if (searchGridType == md.end()) {
         std::ostringstream oss;
@@ -85,15 +95,18 @@ void checkMetadata(const message::Metadata& md) {
         throw eckit::UserError(oss.str(), Here());
     }
     if (const std::string& orderingConvention = searchOrderingConvention->second.get<std::string>();
-        orderingConvention != "ring") {
+        orderingConvention != (toNested ? "ring" : "nested")) {
         std::ostringstream oss;
-        oss << "HEALPix_ring2nest: expected \"orderingConvention\" = \"ring\", instead it is equal to: "
-            << orderingConvention << std::endl;
+        oss << "HEALPix_ring2nest: expected \"orderingConvention\" = \"" << (toNested ? "ring" : "nested")
+            << "\", instead it is equal to: " << orderingConvention << std::endl;
         throw eckit::UserError(oss.str(), Here());
     }
 }
 
-std::vector<size_t> makeMapping(size_t Nside, const std::string& cacheFileName) {
+HEALPixPermutation makeMapping(size_t Nside, const std::string& cacheFileName, size_t threads) {
+    if (cacheFileName.empty()) {
+        return HEALPixPermutation{Nside, threads};
+    }
     std::vector<size_t> map;
     atlas::io::RecordReader reader(cacheFileName);
     std::ostringstream os;
@@ -104,13 +117,34 @@ std::vector<size_t> makeMapping(size_t Nside, const std::string& cacheFileName)
         oss << "HEALPix_ring2nest: expected map size : " << 12 * Nside * Nside << ", got: " << map.size() << std::endl;
         throw eckit::UserError(oss.str(), Here());
     }
-    return map;
+    return HEALPixPermutation{Nside, map};
 }
 }  // namespace
 
 
 HEALPixRingToNest::HEALPixRingToNest(const ComponentConfiguration& compConf) :
-    ChainedAction(compConf), cacheFileName_{parseCacheFileName(compConf)} {}
+    ChainedAction(compConf),
+    cacheFileName_{parseCacheFileName(compConf)},
+    toNested_{parseDirection(compConf)},
+    threads_{static_cast<size_t>(std::max(1L, compConf.parsedConfig().getLong("threads", 1)))} {
+    const auto cfg = compConf.parsedConfig();
+    if (cfg.has("nside")) {
+        const auto nsides = cfg.isList("nside") ? cfg.getLongVector("nside")
+                                                : std::vector<long>{cfg.getLong("nside")};
+        for (auto Nside : nsides) {
+            permutation(static_cast<size_t>(Nside));
+        }
+    }
+}
+
+
+const HEALPixPermutation& HEALPixRingToNest::permutation(size_t Nside) {
+    auto search = mapping_.find(Nside);
+    if (search == mapping_.end()) {
+        search = mapping_.emplace(Nside, makeMapping(Nside, cacheFileName_, threads_)).first;
+    }
+    return search->second;
+}
 
 
 void HEALPixRingToNest::executeImpl(message::Message msg) {
@@ -121,14 +155,10 @@ void HEALPixRingToNest::executeImpl(message::Message msg) {
         return;
     }
 
-    checkMetadata(msg.metadata());
+    checkMetadata(msg.metadata(), toNested_);
 
     // Lookup cache
-    auto key = static_cast<size_t>(msg.metadata().get<std::int64_t>("Nside"));
-    if (mapping_.find(key) == mapping_.end()) {
-        mapping_[key] = makeMapping(static_cast<size_t>(msg.metadata().get<std::int64_t>("Nside")), cacheFileName_);
-    }
-    const auto& map = mapping_.at(key);
+    const auto& map = permutation(static_cast<size_t>(msg.metadata().get<std::int64_t>("Nside")));
 
     // Remap field
     executeNext(dispatchPrecisionTag(msg.precision(), [&](auto pt) -> message::Message {
@@ -139,7 +169,9 @@ void HEALPixRingToNest::executeImpl(message::Message msg) {
 
 
 void HEALPixRingToNest::print(std::ostream& os) const {
-    os << "HEALPixRingToNest";
+    os << "HEALPixRingToNest(direction=" << (toNested_ ? "ring2nest" : "nest2ring")
+       << ", cache-file-name=" << (cacheFileName_.empty() ? "none" : cacheFileName_) << ", threads=" << threads_
+       << ")";
 }
 
 
@@ -15,9 +15,11 @@
 
 #pragma once
 
+#include <map>
 #include <sstream>
 #include <string>
 
+#include "HEALPixPermutation.h"
 #include "multio/action/ChainedAction.h"
 #include "multio/config/ComponentConfiguration.h"
 #include "multio/message/Message.h"
@@ -33,7 +35,7 @@ public:
 
 private:
     template <typename Precision>
-    message::Message applyMap(const message::Message&& msg, const std::vector<size_t>& map) const {
+    message::Message applyMap(const message::Message&& msg, const HEALPixPermutation& map) const {
 
         if (map.size() != msg.size() / sizeof(Precision)) {
             std::ostringstream oss;
@@ -42,24 +44,36 @@ private:
             throw eckit::SeriousBug(oss.str(), Here());
         }
 
-        std::vector<Precision> out(map.size(), 0.0);
+        eckit::Buffer buffer(map.size() * sizeof(Precision));
         auto in = reinterpret_cast<const Precision*>(msg.payload().data());
-        for (size_t i = 0; i < map.size(); ++i) {
-            out[map[i]] = in[i];
+        auto out = reinterpret_cast<Precision*>(buffer.data());
+        if (toNested_) {
+            map.ringToNest(in, out, threads_);
+        }
+        else {
+            map.nestToRing(in, out, threads_);
         }
 
         message::Metadata md = msg.metadata();
-        md.set("orderingConvention", "nested");
-        eckit::Buffer buffer(reinterpret_cast<const char*>(out.data()), out.size() * sizeof(Precision));
+        md.set("orderingConvention", toNested_ ? "nested" : "ring");
         return message::Message{
             message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(), std::move(md)},
             std::move(buffer)};
     }
 
+    const HEALPixPermutation& permutation(size_t Nside);
+
     void print(std::ostream& os) const override;
 
-    std::map<size_t, std::vector<size_t>> mapping_;
+    // Permutations by Nside, read from `cache-file-name` if given, else computed (for the Nsides listed in `nside` at
+    // construction, for others when their first field arrives)
+    std::map<size_t, HEALPixPermutation> mapping_;
     std::string cacheFileName_;
+
+    // `direction`: ring2nest (default) or nest2ring
+    bool toNested_;
+    // Number of threads computing and applying the permutations (`threads`)
+    size_t threads_;
 };
 
 }  // namespace multio::action
@@ -17,6 +17,7 @@
 #include "eckit/message/Message.h"
 
 #include "multio/LibMultio.h"
+#include "multio/message/Glossary.h"
 
 namespace multio::action {
 
@@ -45,6 +46,12 @@ void Sink::executeImpl(Message msg) {
 void Sink::write(Message msg) {
     util::ScopedTiming timing{statistics_.actionTiming_};
 
+    // Batch of encoded messages (see the `batch-size` option of encode)
+    if (auto offsets = msg.metadata().getOpt<std::vector<std::int64_t>>(message::glossary().batchOffsets)) {
+        mio_.writeBatch(msg.payload().data(), msg.size(), std::vector<std::size_t>(offsets->begin(), offsets->end()));
+        return;
+    }
+
     eckit::message::Message blob = to_eckit_message(msg);
 
     mio_.write(blob);
@@ -0,0 +1,84 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#include "GridWeights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "eckit/exception/Exceptions.h"
+
+#include "atlas/grid.h"
+#include "atlas/parallel/mpi/mpi.h"
+
+#include "multio/LibMultio.h"
+
+namespace multio::action {
+
+namespace {
+
+std::shared_ptr<const GridWeights> computeGridWeights(const std::string& atlasNamedGrid) {
+    const atlas::StructuredGrid grid = [&atlasNamedGrid]() {
+        atlas::mpi::Scope mpi_scope("self");
+        return atlas::StructuredGrid{atlas::Grid{atlasNamedGrid}};
+    }();
+
+    if (!grid) {
+        throw eckit::UserError{"Spatial statistics are only supported on structured grids :: " + atlasNamedGrid,
+                               Here()};
+    }
+
+    auto weights = std::make_shared<GridWeights>();
+    const std::size_t ny = grid.ny();
+    weights->name = atlasNamedGrid;
+    weights->latitudes.resize(ny);
+    weights->rowWeights.resize(ny);
+    weights->rowOffsets.resize(ny + 1, 0);
+
+    constexpr double deg2rad = M_PI / 180.0;
+    double total = 0.0;
+    for (std::size_t j = 0; j < ny; ++j) {
+        const auto nx = static_cast<std::size_t>(grid.nx(j));
+        const double lat = grid.y(j);
+        // Clip tiny negative values at the poles of regular lat-lon grids
+        const double w = std::max(0.0, std::cos(lat * deg2rad)) / static_cast<double>(nx);
+        weights->latitudes[j] = lat;
+        weights->rowWeights[j] = w;
+        weights->rowOffsets[j + 1] = weights->rowOffsets[j] + nx;
+        total += w * static_cast<double>(nx);
+    }
+
+    ASSERT(total > 0.0);
+    for (auto& w : weights->rowWeights) {
+        w /= total;
+    }
+
+    LOG_DEBUG_LIB(LibMultio) << "Computed area weights for grid " << atlasNamedGrid << " :: rows=" << ny
+                             << ", points=" << weights->size() << std::endl;
+    return weights;
+}
+
+}  // namespace
+
+
+std::shared_ptr<const GridWeights> gridWeights(const std::string& atlasNamedGrid) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const GridWeights>> cache;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (auto it = cache.find(atlasNamedGrid); it != cache.end()) {
+        return it->second;
+    }
+    return cache.emplace(atlasNamedGrid, computeGridWeights(atlasNamedGrid)).first->second;
+}
+
+}  // namespace multio::action
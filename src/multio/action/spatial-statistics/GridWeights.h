@@ -0,0 +1,36 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace multio::action {
+
+// Area weights of a structured atlas grid (reduced/regular gaussian, regular lat-lon).
+// All points of a row share the same weight, so only one weight per row is stored:
+//   weight(row) = cos(latitude(row)) / nx(row), normalised such that the sum over all points is 1
+struct GridWeights {
+    std::string name;
+    std::vector<double> latitudes;
+    std::vector<double> rowWeights;
+    std::vector<std::size_t> rowOffsets;  // Size is number of rows + 1
+
+    std::size_t rows() const { return latitudes.size(); }
+    std::size_t size() const { return rowOffsets.back(); }
+};
+
+// Weights are computed once per grid and shared by all the actions of the process
+std::shared_ptr<const GridWeights> gridWeights(const std::string& atlasNamedGrid);
+
+}  // namespace multio::action
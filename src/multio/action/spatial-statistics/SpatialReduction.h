@@ -0,0 +1,168 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "GridWeights.h"
+
+namespace multio::action::spatialStatistics {
+
+// Partial sums of a contiguous range of rows
+struct Partial {
+    explicit Partial(std::size_t bands) : bandSum(bands, 0.0), bandWeight(bands, 0.0) {}
+
+    double sum = 0.0;
+    double weight = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::vector<double> bandSum;
+    std::vector<double> bandWeight;
+
+    void merge(const Partial& other) {
+        sum += other.sum;
+        weight += other.weight;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (std::size_t b = 0; b < bandSum.size(); ++b) {
+            bandSum[b] += other.bandSum[b];
+            bandWeight[b] += other.bandWeight[b];
+        }
+    }
+};
+
+// Bands of equal latitude width, starting from the north pole
+inline std::vector<std::size_t> rowBands(const GridWeights& weights, long bands) {
+    const double bandWidth = 180.0 / static_cast<double>(bands);
+    std::vector<std::size_t> rowBand(weights.rows());
+    for (std::size_t j = 0; j < weights.rows(); ++j) {
+        const auto band = static_cast<long>(std::floor((90.0 - weights.latitudes[j]) / bandWidth));
+        rowBand[j] = static_cast<std::size_t>(std::clamp(band, 0L, bands - 1));
+    }
+    return rowBand;
+}
+
+// Branch-free inner loops so that the compiler can vectorize them
+template <typename Precision>
+void reduceRows(const Precision* values, const GridWeights& weights, const std::vector<std::size_t>& rowBand,
+                std::size_t rowBegin, std::size_t rowEnd, bool haveMissing, Precision missing, Partial& partial) {
+    for (std::size_t j = rowBegin; j < rowEnd; ++j) {
+        const Precision* row = values + weights.rowOffsets[j];
+        const std::size_t nx = weights.rowOffsets[j + 1] - weights.rowOffsets[j];
+
+        double rowSum = 0.0;
+        double rowCount = 0.0;
+        Precision rowMin = std::numeric_limits<Precision>::max();
+        Precision rowMax = std::numeric_limits<Precision>::lowest();
+        if (haveMissing) {
+            for (std::size_t i = 0; i < nx; ++i) {
+                const Precision v = row[i];
+                const bool valid = v != missing;
+                rowSum += valid ? static_cast<double>(v) : 0.0;
+                rowCount += valid ? 1.0 : 0.0;
+                rowMin = valid && v < rowMin ? v : rowMin;
+                rowMax = valid && v > rowMax ? v : rowMax;
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < nx; ++i) {
+                const Precision v = row[i];
+                rowSum += static_cast<double>(v);
+                rowMin = v < rowMin ? v : rowMin;
+                rowMax = v > rowMax ? v : rowMax;
+            }
+            rowCount = static_cast<double>(nx);
+        }
+
+        if (rowCount > 0.0) {
+            const double w = weights.rowWeights[j];
+            partial.sum += w * rowSum;
+            partial.weight += w * rowCount;
+            partial.min = std::min(partial.min, static_cast<double>(rowMin));
+            partial.max = std::max(partial.max, static_cast<double>(rowMax));
+            partial.bandSum[rowBand[j]] += w * rowSum;
+            partial.bandWeight[rowBand[j]] += w * rowCount;
+        }
+    }
+}
+
+// Smallest value such that the weight of the points below or equal is at least target, the largest value if rounding
+// leaves the total weight short of it. Weighted quickselect: the points are reordered, linear time on average
+template <typename Precision>
+Precision weightedSelect(std::vector<std::pair<Precision, double>>& points, double target) {
+    auto lo = points.begin();
+    auto hi = points.end();
+    while (hi - lo > 1) {
+        const auto mid = lo + (hi - lo) / 2;
+        const Precision a = lo->first;
+        const Precision b = mid->first;
+        const Precision c = (hi - 1)->first;
+        const Precision pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+        // [lo, lt) < pivot, [lt, gt) == pivot, [gt, hi) > pivot
+        const auto lt = std::partition(lo, hi, [pivot](const auto& p) { return p.first < pivot; });
+        const auto gt = std::partition(lt, hi, [pivot](const auto& p) { return !(pivot < p.first); });
+
+        double below = 0.0;
+        for (auto it = lo; it != lt; ++it) {
+            below += it->second;
+        }
+        if (lt != lo && target <= below) {
+            hi = lt;
+            continue;
+        }
+        double equal = 0.0;
+        for (auto it = lt; it != gt; ++it) {
+            equal += it->second;
+        }
+        if (gt == hi || target <= below + equal) {
+            return pivot;
+        }
+        target -= below + equal;
+        lo = gt;
+    }
+    return lo->first;
+}
+
+// Area-weighted percentiles: the smallest value such that the weight of the points below or equal is at least p%
+template <typename Precision>
+std::vector<double> weightedPercentiles(const Precision* values, const GridWeights& weights, bool haveMissing,
+                                        Precision missing, const std::vector<double>& percentiles) {
+    std::vector<std::pair<Precision, double>> points;
+    points.reserve(weights.size());
+    double total = 0.0;
+    for (std::size_t j = 0; j < weights.rows(); ++j) {
+        for (std::size_t i = weights.rowOffsets[j]; i < weights.rowOffsets[j + 1]; ++i) {
+            if (!haveMissing || values[i] != missing) {
+                points.emplace_back(values[i], weights.rowWeights[j]);
+                total += weights.rowWeights[j];
+            }
+        }
+    }
+
+    std::vector<double> result(percentiles.size(), static_cast<double>(missing));
+    if (points.empty()) {
+        return result;
+    }
+
+    // One selection per requested percentile instead of sorting the whole field
+    for (std::size_t k = 0; k < percentiles.size(); ++k) {
+        result[k] = static_cast<double>(weightedSelect(points, percentiles[k] / 100.0 * total));
+    }
+    return result;
+}
+
+}  // namespace multio::action::spatialStatistics
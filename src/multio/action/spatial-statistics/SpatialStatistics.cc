@@ -0,0 +1,216 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#include "SpatialStatistics.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "multio/LibMultio.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/ParallelFor.h"
+#include "multio/util/PrecisionTag.h"
+
+#include "SpatialReduction.h"
+
+namespace multio::action {
+
+using message::glossary;
+using spatialStatistics::Partial;
+
+namespace {
+
+// Points processed by one thread at least, below that threading costs more than it saves
+constexpr std::size_t MIN_POINTS_PER_THREAD = 1 << 16;
+
+const std::vector<std::string>& validOperations() {
+    static const std::vector<std::string> ops{"mean", "minimum", "maximum", "zonal-mean", "percentile"};
+    return ops;
+}
+
+std::vector<std::string> parseOperations(const eckit::LocalConfiguration& cfg) {
+    auto ops = cfg.getStringVector("operations", std::vector<std::string>{"mean"});
+    for (const auto& op : ops) {
+        if (std::find(validOperations().begin(), validOperations().end(), op) == validOperations().end()) {
+            throw eckit::UserError{"SpatialStatistics: unknown operation :: " + op, Here()};
+        }
+    }
+    return ops;
+}
+
+std::vector<double> parsePercentiles(const eckit::LocalConfiguration& cfg) {
+    auto percentiles = cfg.getDoubleVector("percentiles", std::vector<double>{5.0, 50.0, 95.0});
+    for (const auto p : percentiles) {
+        if (p < 0.0 || p > 100.0) {
+            std::ostringstream os;
+            os << "SpatialStatistics: percentiles must be in [0, 100] :: " << p;
+            throw eckit::UserError{os.str(), Here()};
+        }
+    }
+    return percentiles;
+}
+
+// The outputs are not on the grid of the input any more: its description is dropped and the grid type set to "none"
+void eraseGrid(message::Metadata& md) {
+    for (const auto& key :
+         {glossary().nside, glossary().orderingConvention, glossary().ni, glossary().nj, glossary().north,
+          glossary().west, glossary().south, glossary().east, glossary().westEastIncrement,
+          glossary().southNorthIncrement, glossary().unstructuredGridType, glossary().unstructuredGridSubtype,
+          glossary().uuidOfHGrid}) {
+        md.erase(key);
+    }
+    md.set(glossary().gridType, "none");
+}
+
+}  // namespace
+
+
+SpatialStatistics::SpatialStatistics(const ComponentConfiguration& compConf) :
+    ChainedAction{compConf},
+    operations_{parseOperations(compConf.parsedConfig())},
+    percentiles_{parsePercentiles(compConf.parsedConfig())},
+    zonalBands_{compConf.parsedConfig().getLong("zonal-bands", 18)},
+    threads_{static_cast<std::size_t>(std::max(1L, compConf.parsedConfig().getLong("threads", 1)))},
+    weights_{gridWeights(compConf.parsedConfig().getString("grid"))} {
+    if (zonalBands_ <= 0) {
+        throw eckit::UserError{"SpatialStatistics: zonal-bands must be positive", Here()};
+    }
+    rowBand_ = spatialStatistics::rowBands(*weights_, zonalBands_);
+}
+
+
+void SpatialStatistics::executeImpl(message::Message msg) {
+    if (msg.tag() != message::Message::Tag::Field) {
+        executeNext(std::move(msg));
+        return;
+    }
+
+    util::dispatchPrecisionTag(msg.precision(), [&](auto pt) {
+        using Precision = typename decltype(pt)::type;
+        reduce<Precision>(msg);
+    });
+}
+
+
+template <typename Precision>
+void SpatialStatistics::reduce(const message::Message& msg) {
+    std::vector<message::Message> outputs;
+    {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+
+        const GridWeights& weights = *weights_;
+        const std::size_t size = msg.size() / sizeof(Precision);
+        if (size != weights.size()) {
+            std::ostringstream os;
+            os << "SpatialStatistics: field has " << size << " values but grid " << weights.name << " has "
+               << weights.size() << " points";
+            throw eckit::SeriousBug{os.str(), Here()};
+        }
+
+        const auto& md = msg.metadata();
+        const auto missingValue = md.getOpt<double>(glossary().missingValue);
+        const bool haveMissing = missingValue && md.getOpt<bool>(glossary().bitmapPresent).value_or(false);
+        const auto missing = static_cast<Precision>(missingValue.value_or(0.0));
+        const auto* values = static_cast<const Precision*>(msg.payload().data());
+
+        // Deterministic reduction: partials are always combined in the same order for a given configuration
+        const std::size_t nChunks = util::numChunks(threads_, size, MIN_POINTS_PER_THREAD);
+        std::vector<Partial> partials(nChunks, Partial{static_cast<std::size_t>(zonalBands_)});
+        util::parallelFor(nChunks, weights.rows(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            spatialStatistics::reduceRows(values, weights, rowBand_, begin, end, haveMissing, missing,
+                                          partials[chunk]);
+        });
+
+        Partial total{static_cast<std::size_t>(zonalBands_)};
+        for (const auto& p : partials) {
+            total.merge(p);
+        }
+
+        // Outputs without any valid point (e.g. empty zonal bands) are set to missing
+        const double missingOut = missingValue.value_or(static_cast<double>(std::numeric_limits<float>::max()));
+        const bool empty = total.weight <= 0.0;
+
+        auto emit = [&](const std::string& op, const std::vector<double>& result, bool withMissing,
+                        message::Metadata outMd) {
+            eckit::Buffer payload{result.size() * sizeof(Precision)};
+            auto* out = static_cast<Precision*>(payload.data());
+            std::transform(result.begin(), result.end(), out, [](double v) { return static_cast<Precision>(v); });
+            message::eraseValueStatistics(outMd);
+            eraseGrid(outMd);
+            outMd.set("spatial-operation", op);
+            outMd.set(glossary().globalSize, static_cast<std::int64_t>(result.size()));
+            outMd.set(glossary().bitmapPresent, withMissing);
+            if (withMissing) {
+                outMd.set(glossary().missingValue, missingOut);
+            }
+            outputs.emplace_back(message::Message{
+                message::Message::Header{message::Message::Tag::Field, msg.source(), msg.destination(),
+                                         std::move(outMd)},
+                std::move(payload)});
+        };
+
+        for (const auto& op : operations_) {
+            if (op == "mean") {
+                emit(op, {empty ? missingOut : total.sum / total.weight}, empty, md);
+            }
+            else if (op == "minimum") {
+                emit(op, {empty ? missingOut : total.min}, empty, md);
+            }
+            else if (op == "maximum") {
+                emit(op, {empty ? missingOut : total.max}, empty, md);
+            }
+            else if (op == "zonal-mean") {
+                std::vector<double> result(zonalBands_);
+                bool withMissing = false;
+                for (long b = 0; b < zonalBands_; ++b) {
+                    const bool valid = total.bandWeight[b] > 0.0;
+                    result[b] = valid ? total.bandSum[b] / total.bandWeight[b] : missingOut;
+                    withMissing = withMissing || !valid;
+                }
+                auto outMd = md;
+                outMd.set("zonal-bands", zonalBands_);
+                emit(op, result, withMissing, std::move(outMd));
+            }
+            else if (op == "percentile") {
+                const auto result = spatialStatistics::weightedPercentiles(values, weights, haveMissing, missing, percentiles_);
+                for (std::size_t k = 0; k < percentiles_.size(); ++k) {
+                    auto outMd = md;
+                    outMd.set("percentile", percentiles_[k]);
+                    emit(op, {empty ? missingOut : result[k]}, empty, std::move(outMd));
+                }
+            }
+        }
+    }
+
+    for (auto& out : outputs) {
+        executeNext(std::move(out));
+    }
+}
+
+
+void SpatialStatistics::print(std::ostream& os) const {
+    os << "SpatialStatistics(grid=" << weights_->name << ", operations=";
+    bool first = true;
+    for (const auto& op : operations_) {
+        os << (first ? "" : ", ") << op;
+        first = false;
+    }
+    os << ", zonal-bands=" << zonalBands_ << ", threads=" << threads_ << ")";
+}
+
+
+static ActionBuilder<SpatialStatistics> SpatialStatisticsBuilder("spatial-statistics");
+
+}  // namespace multio::action
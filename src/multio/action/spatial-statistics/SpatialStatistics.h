@@ -0,0 +1,49 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GridWeights.h"
+#include "multio/action/ChainedAction.h"
+
+namespace multio::action {
+
+// Reduces each field to a few area-weighted scalars (mean, minimum, maximum, percentiles)
+// or to zonal means over latitude bands. Non-field messages are forwarded untouched.
+// The outputs do not describe the input grid any more: its keys are removed and gridType is set to "none".
+// The GRIB encoder refuses such fields, they are written with the chunked-array format.
+class SpatialStatistics : public ChainedAction {
+public:
+    explicit SpatialStatistics(const ComponentConfiguration& compConf);
+
+    void executeImpl(message::Message msg) override;
+
+private:
+    template <typename Precision>
+    void reduce(const message::Message& msg);
+
+    void print(std::ostream& os) const override;
+
+    const std::vector<std::string> operations_;
+    const std::vector<double> percentiles_;
+    const long zonalBands_;
+    const std::size_t threads_;
+    const std::shared_ptr<const GridWeights> weights_;
+
+    // Band index of each row of the grid
+    std::vector<std::size_t> rowBand_;
+};
+
+}  // namespace multio::action
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -22,12 +23,26 @@
 #include "multio/action/statistics/operations/Instant.h"
 #include "multio/action/statistics/operations/Maximum.h"
 #include "multio/action/statistics/operations/Minimum.h"
+#include "multio/action/statistics/operations/Percentile.h"
 
 #include "multio/action/statistics/operations/DeAccumulate.h"
 #include "multio/action/statistics/operations/FixedWindowFluxAverage.h"
 
 namespace multio::action {
 
+// "percentile-<p>" with p an integer in [0, 100], GRIB only encodes integer percentiles
+inline double parsePercentile(const std::string& opname) {
+    const std::string value = opname.substr(std::string{"percentile-"}.size());
+    const bool digits = !value.empty() && value.size() <= 3
+                     && std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; });
+    const int percentile = digits ? std::stoi(value) : -1;
+    if (percentile < 0 || percentile > 100) {
+        throw eckit::UserError(
+            "Invalid percentile in statistics operation :: " + opname + ", expected an integer in [0, 100]", Here());
+    }
+    return static_cast<double>(percentile);
+}
+
 template <typename Precision>
 std::unique_ptr<Operation> make_operation(const std::string& opname, long sz, std::shared_ptr<StatisticsIO>& IOmanager,
                                           const OperationWindow& win, const StatisticsConfiguration& cfg) {
@@ -64,6 +79,11 @@ std::unique_ptr<Operation> make_operation(const std::string& opname, long sz, st
         return cfg.readRestart() ? std::make_unique<FixedWindowFluxAverage<Precision>>(opname, sz, win, IOmanager, cfg)
                                  : std::make_unique<FixedWindowFluxAverage<Precision>>(opname, sz, win, cfg);
     }
+    if (opname.rfind("percentile-", 0) == 0) {
+        const double p = parsePercentile(opname);
+        return cfg.readRestart() ? std::make_unique<Percentile<Precision>>(opname, p, sz, win, IOmanager, cfg)
+                                 : std::make_unique<Percentile<Precision>>(opname, p, sz, win, cfg);
+    }
 
     std::ostringstream os;
     os << "Invalid opname in statistics operation :: " << opname << std::endl;
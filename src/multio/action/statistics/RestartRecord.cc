@@ -0,0 +1,102 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "RestartRecord.h"
+
+#include <array>
+#include <cstring>
+
+#include "eckit/io/compression/Compressor.h"
+#include "eckit/log/Log.h"
+
+#include "multio/LibMultio.h"
+
+namespace multio::action::restart {
+
+std::uint64_t checksum(const std::uint64_t* data, std::size_t size) {
+    // Four independent lanes break the dependency chain of the legacy checksum and allow the compiler to vectorize
+    constexpr std::uint64_t prime = 0x100000001B3ULL;
+    std::array<std::uint64_t, 4> lanes{1979339339ULL, 2654435761ULL, 2246822519ULL, 3266489917ULL};
+    const std::size_t blocked = size - size % lanes.size();
+    for (std::size_t i = 0; i < blocked; i += lanes.size()) {
+        for (std::size_t l = 0; l < lanes.size(); ++l) {
+            lanes[l] = (lanes[l] ^ data[i + l]) * prime;
+        }
+    }
+    for (std::size_t i = blocked; i < size; ++i) {
+        lanes[0] = (lanes[0] ^ data[i]) * prime;
+    }
+    std::uint64_t checksum = size;
+    for (const auto lane : lanes) {
+        checksum = (checksum ^ lane) * prime;
+    }
+    return checksum;
+}
+
+void byteShuffle(const void* in, void* out, std::size_t count, std::size_t elementSize) {
+    const auto* src = static_cast<const unsigned char*>(in);
+    auto* dst = static_cast<unsigned char*>(out);
+    for (std::size_t b = 0; b < elementSize; ++b) {
+        unsigned char* plane = dst + b * count;
+        for (std::size_t i = 0; i < count; ++i) {
+            plane[i] = src[i * elementSize + b];
+        }
+    }
+}
+
+void byteUnshuffle(const void* in, void* out, std::size_t count, std::size_t elementSize) {
+    const auto* src = static_cast<const unsigned char*>(in);
+    auto* dst = static_cast<unsigned char*>(out);
+    for (std::size_t b = 0; b < elementSize; ++b) {
+        const unsigned char* plane = src + b * count;
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[i * elementSize + b] = plane[i];
+        }
+    }
+}
+
+std::uint64_t packName(const std::string& name) {
+    if (name.size() > sizeof(std::uint64_t)) {
+        throw eckit::SeriousBug{"ERROR : compressor name too long for restart record : " + name, Here()};
+    }
+    std::uint64_t word = 0;
+    std::memcpy(&word, name.data(), name.size());
+    return word;
+}
+
+std::string unpackName(std::uint64_t word) {
+    char name[sizeof(std::uint64_t) + 1] = {0};
+    std::memcpy(name, &word, sizeof(std::uint64_t));
+    return std::string{name};
+}
+
+bool isCompressorAvailable(const std::string& compressor) {
+    return compressor == "none" || eckit::CompressorFactory::instance().has(compressor);
+}
+
+std::size_t compress(const std::string& compressor, const void* in, std::size_t len, eckit::Buffer& out) {
+    std::unique_ptr<eckit::Compressor> c{eckit::CompressorFactory::instance().build(compressor)};
+    const std::size_t sz = c->compress(in, len, out);
+    LOG_DEBUG_LIB(LibMultio) << " - Restart record compressed with " << compressor << " :: " << len << " -> " << sz
+                             << " bytes" << std::endl;
+    return sz;
+}
+
+void uncompress(const std::string& compressor, const void* in, std::size_t len, eckit::Buffer& out,
+                std::size_t outlen) {
+    if (!isCompressorAvailable(compressor)) {
+        throw eckit::SeriousBug{"ERROR : restart record compressed with unavailable compressor : " + compressor,
+                                Here()};
+    }
+    std::unique_ptr<eckit::Compressor> c{eckit::CompressorFactory::instance().build(compressor)};
+    c->uncompress(in, len, out, outlen);
+}
+
+}  // namespace multio::action::restart
@@ -0,0 +1,200 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+
+#include "multio/action/statistics/StatisticsIO.h"
+
+namespace multio::action {
+
+// Typed restart record
+//
+//   word 0            : magic number, used to distinguish the record from the legacy format
+//   word 1            : version | element size << 8 | number of arrays << 16 | byte-shuffle << 24
+//   word 2            : number of elements in each array
+//   word 3            : name of the compressor (8 characters, zero padded)
+//   word 4            : size in bytes of the (compressed) payload
+//   word 5 ... n-2    : payload, padded to a multiple of 8 bytes
+//   word n-1          : checksum
+//
+// The legacy record is the concatenation of all arrays widened to double, followed by the legacy checksum.
+namespace restart {
+
+constexpr std::uint64_t MAGIC = 0x5254534F49544C4DULL;  // "MLTIOSTR"
+constexpr std::uint64_t VERSION = 1;
+constexpr std::size_t HEADER_SIZE = 5;
+
+std::uint64_t checksum(const std::uint64_t* data, std::size_t size);
+
+void byteShuffle(const void* in, void* out, std::size_t count, std::size_t elementSize);
+void byteUnshuffle(const void* in, void* out, std::size_t count, std::size_t elementSize);
+
+std::uint64_t packName(const std::string& name);
+std::string unpackName(std::uint64_t word);
+
+std::size_t compress(const std::string& compressor, const void* in, std::size_t len, eckit::Buffer& out);
+void uncompress(const std::string& compressor, const void* in, std::size_t len, eckit::Buffer& out,
+                std::size_t outlen);
+
+bool isCompressorAvailable(const std::string& compressor);
+
+}  // namespace restart
+
+template <typename T>
+class RestartRecord {
+public:
+    RestartRecord(const std::string& name, const std::string& compressor) : name_{name}, compressor_{compressor} {}
+
+    void dump(std::shared_ptr<StatisticsIO>& IOmanager, const std::vector<const std::vector<T>*>& arrays) const {
+        const std::size_t count = arrays.front()->size();
+        const std::size_t rawSize = count * sizeof(T) * arrays.size();
+        const bool shuffle = compressor_ != "none";
+
+        eckit::Buffer raw{rawSize};
+        char* pos = static_cast<char*>(raw.data());
+        for (const auto* a : arrays) {
+            ASSERT(a->size() == count);
+            std::memcpy(pos, a->data(), count * sizeof(T));
+            pos += count * sizeof(T);
+        }
+
+        std::size_t payloadSize = rawSize;
+        eckit::Buffer payload;
+        if (shuffle) {
+            eckit::Buffer shuffled{rawSize};
+            restart::byteShuffle(raw.data(), shuffled.data(), count * arrays.size(), sizeof(T));
+            payloadSize = restart::compress(compressor_, shuffled.data(), rawSize, payload);
+        }
+        const void* src = shuffle ? payload.data() : raw.data();
+
+        const std::size_t payloadWords = (payloadSize + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+        const std::size_t recordSize = restart::HEADER_SIZE + payloadWords + 1;
+
+        IOBuffer record{IOmanager->getBuffer(recordSize)};
+        record.zero();
+        record[0] = restart::MAGIC;
+        record[1] = restart::VERSION | (sizeof(T) << 8) | (arrays.size() << 16) | (std::uint64_t{shuffle} << 24);
+        record[2] = count;
+        record[3] = restart::packName(compressor_);
+        record[4] = payloadSize;
+        std::memcpy(record.data() + restart::HEADER_SIZE, src, payloadSize);
+        record[recordSize - 1] = restart::checksum(record.data(), recordSize - 1);
+
+        IOmanager->write(name_, recordSize);
+        IOmanager->flush();
+    }
+
+    void load(std::shared_ptr<StatisticsIO>& IOmanager, const std::vector<std::vector<T>*>& arrays) const {
+        const std::size_t recordSize = IOmanager->readRecord(name_);
+        const IOBuffer record{IOmanager->getBuffer(recordSize)};
+
+        if (recordSize > restart::HEADER_SIZE && record[0] == restart::MAGIC) {
+            loadTyped(record, arrays);
+        }
+        else {
+            loadLegacy(record, arrays);
+        }
+    }
+
+private:
+    void loadTyped(const IOBuffer& record, const std::vector<std::vector<T>*>& arrays) const {
+        const std::size_t recordSize = record.size();
+        if (record[recordSize - 1] != restart::checksum(record.data(), recordSize - 1)) {
+            throw eckit::SeriousBug{"ERROR : wrong checksum in restart record (" + name_ + ")", Here()};
+        }
+
+        const std::uint64_t descriptor = record[1];
+        const std::size_t version = descriptor & 0xFF;
+        const std::size_t elementSize = (descriptor >> 8) & 0xFF;
+        const std::size_t nArrays = (descriptor >> 16) & 0xFF;
+        const bool shuffle = (descriptor >> 24) & 0xFF;
+        const std::size_t count = record[2];
+        const std::string compressor = restart::unpackName(record[3]);
+        const std::size_t payloadSize = record[4];
+
+        // Floating point records can be converted between single and double precision, others need an exact match
+        const bool convertible
+            = std::is_floating_point_v<T> && (elementSize == sizeof(float) || elementSize == sizeof(double));
+        if (version != restart::VERSION || nArrays != arrays.size() || count != arrays.front()->size()
+            || (elementSize != sizeof(T) && !convertible)) {
+            std::ostringstream os;
+            os << "ERROR : restart record (" << name_ << ") does not match the operation :: version=" << version
+               << ", element size=" << elementSize << ", arrays=" << nArrays << ", count=" << count;
+            throw eckit::SeriousBug{os.str(), Here()};
+        }
+
+        const std::size_t rawSize = count * elementSize * nArrays;
+        eckit::Buffer raw{rawSize};
+        if (shuffle) {
+            eckit::Buffer shuffled{rawSize};
+            restart::uncompress(compressor, record.data() + restart::HEADER_SIZE, payloadSize, shuffled, rawSize);
+            restart::byteUnshuffle(shuffled.data(), raw.data(), count * nArrays, elementSize);
+        }
+        else {
+            ASSERT(payloadSize == rawSize);
+            std::memcpy(raw.data(), record.data() + restart::HEADER_SIZE, rawSize);
+        }
+
+        // Restart files written with a different precision are converted on load
+        const char* pos = static_cast<const char*>(raw.data());
+        for (auto* a : arrays) {
+            if (elementSize == sizeof(T)) {
+                std::memcpy(a->data(), pos, count * sizeof(T));
+            }
+            else if (elementSize == sizeof(float)) {
+                const float* v = reinterpret_cast<const float*>(pos);
+                std::transform(v, v + count, a->begin(), [](float f) { return static_cast<T>(f); });
+            }
+            else {
+                const double* v = reinterpret_cast<const double*>(pos);
+                std::transform(v, v + count, a->begin(), [](double d) { return static_cast<T>(d); });
+            }
+            pos += count * elementSize;
+        }
+    }
+
+    void loadLegacy(const IOBuffer& record, const std::vector<std::vector<T>*>& arrays) const {
+        const std::size_t count = arrays.front()->size();
+        if (record.size() != count * arrays.size() + 1) {
+            std::ostringstream os;
+            os << "ERROR : wrong file size for restart : (" << name_ << ")";
+            throw eckit::SeriousBug{os.str(), Here()};
+        }
+        record.checkChecksum();
+        std::size_t offset = 0;
+        for (auto* a : arrays) {
+            std::transform(record.cbegin() + offset, record.cbegin() + offset + count, a->begin(),
+                           [](std::uint64_t v) {
+                               double dv;
+                               std::memcpy(&dv, &v, sizeof(double));
+                               return static_cast<T>(dv);
+                           });
+            offset += count;
+        }
+    }
+
+    const std::string name_;
+    const std::string compressor_;
+};
+
+}  // namespace multio::action
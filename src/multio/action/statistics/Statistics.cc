@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 #include "TemporalStatistics.h"
@@ -19,6 +21,7 @@
 #include "multio/LibMultio.h"
 #include "multio/message/Glossary.h"
 #include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
 #include "multio/util/Timing.h"
 
 namespace multio::action {
@@ -34,48 +37,49 @@ Statistics::Statistics(const ComponentConfiguration& compConf) :
     IOmanager_{StatisticsIOFactory::instance().build(cfg_.restartLib(), cfg_.restartPath(), cfg_.restartPrefix())} {}
 
 
+// Fields in the order of their textual key, the hashed lookup table has no stable order
+std::vector<std::pair<const StatisticsKey*, TemporalStatistics*>> Statistics::sortedFields() const {
+    std::vector<std::pair<const StatisticsKey*, TemporalStatistics*>> fields;
+    fields.reserve(fieldStats_.size());
+    for (const auto& [key, stats] : fieldStats_) {
+        fields.emplace_back(&key, stats.get());
+    }
+    std::sort(fields.begin(), fields.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.second->key() < rhs.second->key(); });
+    return fields;
+}
+
+
 void Statistics::DumpRestart() {
     if (cfg_.writeRestart()) {
         IOmanager_->reset();
         IOmanager_->setSuffix(periodUpdater_->name());
-        for (auto it = fieldStats_.begin(); it != fieldStats_.end(); it++) {
-            LOG_DEBUG_LIB(LibMultio) << "Restart for field with key :: " << it->first << ", "
-                                     << it->second->cwin().currPointInSteps() << std::endl;
-            IOmanager_->setCurrStep(it->second->cwin().currPointInSteps());
-            IOmanager_->setPrevStep(it->second->cwin().lastFlushInSteps());
-            IOmanager_->setKey(it->first);
-            it->second->dump(IOmanager_, cfg_);
-            it->second->win().updateFlush();
+        for (const auto& field : sortedFields()) {
+            auto* stats = field.second;
+            LOG_DEBUG_LIB(LibMultio) << "Restart for field with key :: " << stats->key() << ", "
+                                     << stats->cwin().currPointInSteps() << std::endl;
+            IOmanager_->setCurrStep(stats->cwin().currPointInSteps());
+            IOmanager_->setPrevStep(stats->cwin().lastFlushInSteps());
+            IOmanager_->setKey(stats->key());
+            stats->dump(IOmanager_, cfg_);
+            stats->win().updateFlush();
         }
     }
 }
 
 
-std::string Statistics::generateKey(const message::Message& msg) const {
-    std::ostringstream os;
-    os << msg.metadata().getOpt<std::string>(glossary().param).value_or("") << "-"
-       << msg.metadata().getOpt<std::int64_t>(glossary().paramId).value_or(0) << "-"
-       << msg.metadata().getOpt<std::int64_t>(glossary().level).value_or(0) << "-"
-       << msg.metadata().getOpt<std::int64_t>(glossary().levelist).value_or(0) << "-"
-       << msg.metadata().getOpt<std::string>(glossary().levtype).value_or("unknown") << "-"
-       << msg.metadata().getOpt<std::string>(glossary().gridType).value_or("unknown") << "-"
-       << msg.metadata().getOpt<std::string>(glossary().precision).value_or("unknown") << "-"
-       << std::to_string(std::hash<std::string>{}(msg.source()));
-    LOG_DEBUG_LIB(LibMultio) << "Generating key for the field :: " << os.str() << std::endl;
-    return os.str();
-}
-
-
 message::Metadata Statistics::outputMetadata(const message::Metadata& inputMetadata, const StatisticsConfiguration& cfg,
-                                             const std::string& key) const {
-    auto& win = fieldStats_.at(key)->cwin();
+                                             const TemporalStatistics& stats) const {
+    auto& win = stats.cwin();
     if (win.endPointInSeconds() % 3600 != 0L) {
         std::ostringstream os;
-        os << "Step in seconds needs to be a multiple of 3600 :: " << fieldStats_.at(key)->win().endPointInSeconds()
+        os << "Step in seconds needs to be a multiple of 3600 :: " << win.endPointInSeconds()
            << std::endl;
         throw eckit::SeriousBug(os.str(), Here());
     }
     auto md = inputMetadata;
+    // The statistics of the input values do not apply to the output
+    message::eraseValueStatistics(md);
 
     // util::DateTimeDiff lastPointsDiff = win.lastPointsDiff();
 
@@ -103,8 +107,59 @@ message::Metadata Statistics::outputMetadata(const message::Metadata& inputMetad
 }
 
 
+void Statistics::emitPartial(TemporalStatistics& stats, const message::Message::Header& header,
+                             const StatisticsConfiguration& cfg) {
+    if (stats.cwin().count() == 0) {
+        return;
+    }
+
+    // Same as a regular output, but the window ends at the current point and is not reset.
+    // Operations compute into a freshly allocated payload, so the emitted snapshot does not
+    // share any storage with the accumulators and later updates are not affected.
+    auto md = outputMetadata(header.metadata(), cfg, stats);
+    const auto& win = stats.cwin();
+    md.set(glossary().currentDate, win.currPoint().date().yyyymmdd());
+    md.set(glossary().currentTime, win.currPoint().time().hhmmss());
+    md.set("endStepInHours", win.currPointInHours());
+    md.set("partial", true);
+
+    LOG_DEBUG_LIB(LibMultio) << "Partial output for field with key :: " << stats.key() << ", " << win.currPointInSteps()
+                             << std::endl;
+
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+        eckit::Buffer payload;
+        payload.resize((*it)->byte_size());
+        payload.zero();
+        auto opMd = md;
+        opMd.set("operation", (*it)->operation());
+        opMd.set("operation-frequency", compConf_.parsedConfig().getString("output-frequency"));
+        (*it)->fillMetadata(opMd);
+        (*it)->compute(payload);
+        executeNext(message::Message{message::Message::Header{message::Message::Tag::Field, header.source(),
+                                                              header.destination(), std::move(opMd)},
+                                     std::move(payload)});
+    }
+}
+
+
+void Statistics::emitAllPartial() {
+    for (const auto& [key, stats] : sortedFields()) {
+        if (auto header = lastHeader_.find(*key); header != lastHeader_.end()) {
+            emitPartial(*stats, header->second, stats->cfg());
+        }
+    }
+}
+
+
 void Statistics::executeImpl(message::Message msg) {
 
+    if (msg.tag() == message::Message::Tag::Notification && cfg_.partialOutputOnNotification()) {
+        util::ScopedTiming timing{statistics_.actionTiming_};
+        emitAllPartial();
+        executeNext(msg);
+        return;
+    }
+
     if (msg.tag() == message::Message::Tag::Flush) {
         DumpRestart();
         executeNext(msg);
@@ -116,40 +171,59 @@ void Statistics::executeImpl(message::Message msg) {
         return;
     }
 
-    std::string key = generateKey(msg);
-    StatisticsConfiguration cfg{cfg_, msg};
-    IOmanager_->reset();
-    IOmanager_->setCurrStep(cfg.restartStep());
-    IOmanager_->setKey(key);
-
-
     util::ScopedTiming timing{statistics_.actionTiming_};
 
-    if (fieldStats_.find(key) == fieldStats_.end()) {
-        fieldStats_[key] = std::make_unique<TemporalStatistics>(periodUpdater_, operations_, msg, IOmanager_, cfg);
+    // One lookup per message, the configuration of a field is only built when the field is first seen
+    StatisticsKey key{msg};
+    auto it = fieldStats_.find(key);
+    if (it == fieldStats_.end()) {
+        StatisticsConfiguration cfg{cfg_, msg};
+        const auto keyStr = key.str();
+        IOmanager_->reset();
+        IOmanager_->setCurrStep(cfg.restartStep());
+        IOmanager_->setKey(keyStr);
+        it = fieldStats_
+                 .emplace(key,
+                          std::make_unique<TemporalStatistics>(periodUpdater_, operations_, msg, IOmanager_, cfg, keyStr))
+                 .first;
         if (cfg.solver_send_initial_condition()) {
             return;
         }
     }
+    else {
+        it->second->updateConfiguration(msg);
+    }
+
+    auto& stats = *it->second;
+    const auto& cfg = stats.cfg();
 
-    fieldStats_.at(key)->updateData(msg, cfg);
+    stats.updateData(msg, cfg);
 
-    if (fieldStats_.at(key)->isEndOfWindow(msg, cfg)) {
-        auto md = outputMetadata(msg.metadata(), cfg, key);
-        for (auto it = fieldStats_.at(key)->begin(); it != fieldStats_.at(key)->end(); ++it) {
+    if (stats.isEndOfWindow(msg, cfg)) {
+        auto md = outputMetadata(msg.metadata(), cfg, stats);
+        for (auto op = stats.begin(); op != stats.end(); ++op) {
             eckit::Buffer payload;
-            payload.resize((*it)->byte_size());
+            payload.resize((*op)->byte_size());
             payload.zero();
-            md.set("operation", (*it)->operation());
-            md.set("operation-frequency", compConf_.parsedConfig().getString("output-frequency"));
-            (*it)->compute(payload);
+            auto opMd = md;
+            opMd.set("operation", (*op)->operation());
+            opMd.set("operation-frequency", compConf_.parsedConfig().getString("output-frequency"));
+            (*op)->fillMetadata(opMd);
+            (*op)->compute(payload);
             executeNext(message::Message{message::Message::Header{message::Message::Tag::Field, msg.source(),
-                                                                  msg.destination(), message::Metadata{md}},
+                                                                  msg.destination(), std::move(opMd)},
                                          std::move(payload)});
         }
 
 
-        fieldStats_.at(key)->updateWindow(msg, cfg);
+        stats.updateWindow(msg, cfg);
+    }
+    else if (cfg.partialOutputFrequency() > 0 && stats.cwin().count() % cfg.partialOutputFrequency() == 0) {
+        emitPartial(stats, msg.header(), cfg);
+    }
+
+    if (cfg.partialOutputOnNotification()) {
+        lastHeader_.insert_or_assign(std::move(key), msg.header());
     }
 
     return;
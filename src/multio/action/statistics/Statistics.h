@@ -15,10 +15,14 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "PeriodUpdater.h"
 #include "StatisticsConfiguration.h"
 #include "StatisticsIO.h"
+#include "StatisticsKey.h"
 #include "multio/action/ChainedAction.h"
 
 namespace eckit {
@@ -34,11 +38,14 @@ public:
     explicit Statistics(const ComponentConfiguration& compConf);
     void executeImpl(message::Message msg) override;
     message::Metadata outputMetadata(const message::Metadata& inputMetadata, const StatisticsConfiguration& opt,
-                                     const std::string& key) const;
+                                     const TemporalStatistics& stats) const;
 
 private:
     void DumpRestart();
-    std::string generateKey(const message::Message& msg) const;
+    std::vector<std::pair<const StatisticsKey*, TemporalStatistics*>> sortedFields() const;
+    void emitPartial(TemporalStatistics& stats, const message::Message::Header& header,
+                     const StatisticsConfiguration& cfg);
+    void emitAllPartial();
     void print(std::ostream& os) const override;
     const StatisticsConfiguration cfg_;
     const std::vector<std::string> operations_;
@@ -46,7 +53,10 @@ private:
     std::shared_ptr<StatisticsIO> IOmanager_;
 
 
-    std::map<std::string, std::unique_ptr<TemporalStatistics>> fieldStats_;
+    // Hashed for the per-message lookup, restarts and partial outputs iterate it through sortedFields()
+    std::unordered_map<StatisticsKey, std::unique_ptr<TemporalStatistics>, StatisticsKey::Hash> fieldStats_;
+    // Header of the last message received for each field, used to emit partial outputs on notification
+    std::unordered_map<StatisticsKey, message::Message::Header, StatisticsKey::Hash> lastHeader_;
 };
 
 }  // namespace multio::action
@@ -7,11 +7,14 @@
 
 #include "eckit/exception/Exceptions.h"
 #include "eckit/filesystem/PathName.h"
+#include "eckit/log/Log.h"
 
 #include "multio/LibMultio.h"
 #include "multio/message/Glossary.h"
 #include "multio/util/Substitution.h"
 
+#include "RestartRecord.h"
+
 
 namespace multio::action {
 
@@ -30,11 +33,19 @@ StatisticsConfiguration::StatisticsConfiguration(const config::ComponentConfigur
     step_{-1},
     restartStep_{-1},
     solverSendInitStep_{false},
+    partialOutputFrequency_{0},
+    partialOutputOnNotification_{false},
+    percentileBins_{100},
+    havePercentileRange_{false},
+    percentileMin_{0.0},
+    percentileMax_{0.0},
     haveMissingValue_{false},
     missingValue_{9999.0},
     restartPath_{"."},
     restartPrefix_{"StatisticsRestartFile"},
     restartLib_{"fstream_io"},
+    restartFormat_{"legacy"},
+    restartCompression_{"none"},
     logPrefix_{"Plan"},
     accumulatedFieldsResetFreqency_{"month"} {
 
@@ -57,6 +68,9 @@ StatisticsConfiguration::StatisticsConfiguration(const config::ComponentConfigur
     parseRestartPath(compConf, cfg);
     parseRestartPrefix(compConf, cfg);
     parseRestartLib(cfg);
+    parseRestartFormat(cfg);
+    parsePartialOutput(cfg);
+    parsePercentiles(cfg);
     parseLogPrefix(compConf, cfg);
     parseSolverResetAccumulatedFields(compConf, cfg);
 
@@ -74,11 +88,19 @@ StatisticsConfiguration::StatisticsConfiguration(const StatisticsConfiguration&
     step_{-1},
     restartStep_{-1},
     solverSendInitStep_{cfg.solver_send_initial_condition()},
+    partialOutputFrequency_{cfg.partialOutputFrequency()},
+    partialOutputOnNotification_{cfg.partialOutputOnNotification()},
+    percentileBins_{cfg.percentileBins()},
+    havePercentileRange_{cfg.havePercentileRange()},
+    percentileMin_{cfg.percentileMin()},
+    percentileMax_{cfg.percentileMax()},
     haveMissingValue_{false},
     missingValue_{9999.0},
     restartPath_{cfg.restartPath()},
     restartPrefix_{cfg.restartPrefix()},
     restartLib_{cfg.restartLib()},
+    restartFormat_{cfg.restartFormat()},
+    restartCompression_{cfg.restartCompression()},
     logPrefix_{""},
     accumulatedFieldsResetFreqency_{cfg.solverResetAccumulatedFields()} {
 
@@ -96,6 +118,21 @@ StatisticsConfiguration::StatisticsConfiguration(const StatisticsConfiguration&
     return;
 };
 
+void StatisticsConfiguration::update(const message::Message& msg) {
+    // Only the values that can change from one message to the next of the same field are read again
+    readStartTime(msg);
+    readStartDate(msg);
+    readStep(msg);
+    readRestartStep(msg);
+    readTimeStep(msg);
+    readStepFrequency(msg);
+    readMissingValue(msg);
+
+    dumpConfiguration();
+
+    return;
+};
+
 
 void StatisticsConfiguration::parseUseDateTime(const eckit::LocalConfiguration& cfg) {
     // In nemo startDate and startTime are used, while in ifs
@@ -173,6 +210,62 @@ void StatisticsConfiguration::parseRestartLib(const eckit::LocalConfiguration& c
     return;
 };
 
+void StatisticsConfiguration::parseRestartFormat(const eckit::LocalConfiguration& cfg) {
+    // Format of the restart records of the operations:
+    //  - "legacy" : values are widened to double (files are twice as large for single precision fields)
+    //  - "typed"  : values are stored in their native precision, optionally byte-shuffled and compressed
+    // Both formats are always accepted on read, so restarts written by older versions can be continued with
+    // "typed" and the switch only changes the files written from then on
+    restartFormat_ = cfg.getString("restart-format", "legacy");
+    if (restartFormat_ != "typed" && restartFormat_ != "legacy") {
+        std::ostringstream os;
+        os << "Invalid restart format :: " << restartFormat_ << std::endl;
+        throw eckit::UserError(os.str(), Here());
+    }
+    restartCompression_ = cfg.getString("restart-compression", "none");
+    if (!restart::isCompressorAvailable(restartCompression_)) {
+        eckit::Log::warning() << "Statistics: compressor \"" << restartCompression_
+                              << "\" not available, restart files will not be compressed" << std::endl;
+        restartCompression_ = "none";
+    }
+    return;
+};
+
+void StatisticsConfiguration::parsePartialOutput(const eckit::LocalConfiguration& cfg) {
+    // Emit the current state of the operations ("running" statistics) every N input
+    // steps and/or when a notification is received. The window is not reset.
+    // Default value is 0, i.e. no partial outputs
+    partialOutputFrequency_ = cfg.getLong("partial-output-frequency", 0L);
+    if (partialOutputFrequency_ < 0) {
+        std::ostringstream os;
+        os << "Invalid partial output frequency :: " << partialOutputFrequency_ << std::endl;
+        throw eckit::UserError(os.str(), Here());
+    }
+    partialOutputOnNotification_ = cfg.getBool("partial-output-on-notification", false);
+    return;
+};
+
+void StatisticsConfiguration::parsePercentiles(const eckit::LocalConfiguration& cfg) {
+    // Percentiles are estimated from per-gridpoint histograms with "percentile-bins" equally spaced
+    // bins over "percentile-range". The error is bounded by the width of a bin
+    percentileBins_ = cfg.getLong("percentile-bins", 100L);
+    if (percentileBins_ <= 0 || percentileBins_ > 65535) {
+        std::ostringstream os;
+        os << "Invalid number of percentile bins :: " << percentileBins_ << std::endl;
+        throw eckit::UserError(os.str(), Here());
+    }
+    if (cfg.has("percentile-range")) {
+        const auto range = cfg.getDoubleVector("percentile-range");
+        if (range.size() != 2 || !(range[0] < range[1])) {
+            throw eckit::UserError("Invalid percentile range, expected [min, max]", Here());
+        }
+        havePercentileRange_ = true;
+        percentileMin_ = range[0];
+        percentileMax_ = range[1];
+    }
+    return;
+};
+
 
 void StatisticsConfiguration::parseSolverResetAccumulatedFields(const config::ComponentConfiguration& compConf,
                                                                 const eckit::LocalConfiguration& cfg) {
@@ -283,7 +376,6 @@ void StatisticsConfiguration::createLoggingPrefix(const StatisticsConfiguration&
     else if (cfg.restartPrefix() != "StatisticsRestartFile") {
         os << "(prefix=" << cfg.restartPrefix();
     }
-    os << ", step=" << std::left << std::setw(6) << step_;
     if (auto param = md.getOpt<std::string>(glossary().param); param) {
         os << ", param=" << std::left << std::setw(10) << *param;
     }
@@ -319,11 +411,19 @@ void StatisticsConfiguration::dumpConfiguration() {
     LOG_DEBUG_LIB(LibMultio) << " + step_                       :: " << step_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + restartStep_                :: " << restartStep_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + solverSendInitStep_         :: " << solverSendInitStep_ << ";" << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + partialOutputFrequency_     :: " << partialOutputFrequency_ << ";" << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + partialOutputOnNotif_       :: " << partialOutputOnNotification_ << ";"
+                             << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + percentileBins_             :: " << percentileBins_ << ";" << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + percentileRange_            :: " << percentileMin_ << ", " << percentileMax_ << ";"
+                             << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + haveMissingValue_           :: " << haveMissingValue_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + missingValue_               :: " << missingValue_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + restartPath_                :: " << restartPath_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + restartPrefix_              :: " << restartPrefix_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + restartLib_                 :: " << restartLib_ << ";" << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + restartFormat_              :: " << restartFormat_ << ";" << std::endl;
+    LOG_DEBUG_LIB(LibMultio) << " + restartCompression_         :: " << restartCompression_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + logPrefix_                  :: " << logPrefix_ << ";" << std::endl;
     LOG_DEBUG_LIB(LibMultio) << " + resetAccumulatedFieldsFreq_ :: " << accumulatedFieldsResetFreqency_ << ";"
                              << std::endl;
@@ -368,6 +468,31 @@ void StatisticsConfiguration::usage() {
               << "type=string, "
               << "default=\"fstream_io\"     : "
               << "library used to write/read the restart files" << std::endl;
+    std::cout << "restart-format            : "
+              << "type=string, "
+              << "default=\"legacy\"         : "
+              << "format of the restart files written (\"legacy\" or \"typed\"), both are accepted on read"
+              << std::endl;
+    std::cout << "restart-compression       : "
+              << "type=string, "
+              << "default=\"none\"           : "
+              << "compressor used for typed restart files (e.g. \"lz4\"), applied after byte-shuffling" << std::endl;
+    std::cout << "partial-output-frequency  : "
+              << "type=int,    "
+              << "default=0                  : "
+              << "emit partial (running) statistics every N input steps, 0 to disable" << std::endl;
+    std::cout << "partial-output-on-notification : "
+              << "type=bool,   "
+              << "default=false              : "
+              << "emit partial (running) statistics when a notification is received" << std::endl;
+    std::cout << "percentile-bins           : "
+              << "type=int,    "
+              << "default=100                : "
+              << "number of histogram bins used to estimate \"percentile-<p>\" operations" << std::endl;
+    std::cout << "percentile-range          : "
+              << "type=list,   "
+              << "default=none               : "
+              << "[min, max] range of the histogram bins, required by \"percentile-<p>\" operations" << std::endl;
     std::cout << "solver-reset-accumulate-fields-every : "
               << "type=string, "
               << "default=\"month\"     : "
@@ -395,6 +520,14 @@ const std::string& StatisticsConfiguration::restartLib() const {
     return restartLib_;
 };
 
+const std::string& StatisticsConfiguration::restartFormat() const {
+    return restartFormat_;
+};
+
+const std::string& StatisticsConfiguration::restartCompression() const {
+    return restartCompression_;
+};
+
 const std::string& StatisticsConfiguration::logPrefix() const {
     return logPrefix_;
 };
@@ -430,6 +563,30 @@ bool StatisticsConfiguration::solver_send_initial_condition() const {
     return solverSendInitStep_;
 }
 
+long StatisticsConfiguration::partialOutputFrequency() const {
+    return partialOutputFrequency_;
+}
+
+bool StatisticsConfiguration::partialOutputOnNotification() const {
+    return partialOutputOnNotification_;
+}
+
+long StatisticsConfiguration::percentileBins() const {
+    return percentileBins_;
+}
+
+bool StatisticsConfiguration::havePercentileRange() const {
+    return havePercentileRange_;
+}
+
+double StatisticsConfiguration::percentileMin() const {
+    return percentileMin_;
+}
+
+double StatisticsConfiguration::percentileMax() const {
+    return percentileMax_;
+}
+
 bool StatisticsConfiguration::haveMissingValue() const {
     return haveMissingValue_;
 };
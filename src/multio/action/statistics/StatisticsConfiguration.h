@@ -24,6 +24,12 @@ private:
     long step_;
     long restartStep_;
     bool solverSendInitStep_;
+    long partialOutputFrequency_;
+    bool partialOutputOnNotification_;
+    long percentileBins_;
+    bool havePercentileRange_;
+    double percentileMin_;
+    double percentileMax_;
 
     int haveMissingValue_;
     double missingValue_;
@@ -31,6 +37,8 @@ private:
     std::string restartPath_;
     std::string restartPrefix_;
     std::string restartLib_;
+    std::string restartFormat_;
+    std::string restartCompression_;
     std::string logPrefix_;
     std::string accumulatedFieldsResetFreqency_;
 
@@ -38,6 +46,9 @@ public:
     StatisticsConfiguration(const config::ComponentConfiguration& compConf);
     StatisticsConfiguration(const StatisticsConfiguration& cfg, const message::Message& msg);
 
+    // Refresh the message dependent part of a per-field configuration
+    void update(const message::Message& msg);
+
     bool useDateTime() const;
     long stepFreq() const;
     long timeStep() const;
@@ -48,9 +59,17 @@ public:
     long step() const;
     long restartStep() const;
     bool solver_send_initial_condition() const;
+    long partialOutputFrequency() const;
+    bool partialOutputOnNotification() const;
+    long percentileBins() const;
+    bool havePercentileRange() const;
+    double percentileMin() const;
+    double percentileMax() const;
     const std::string& restartPath() const;
     const std::string& restartPrefix() const;
     const std::string& restartLib() const;
+    const std::string& restartFormat() const;
+    const std::string& restartCompression() const;
     const std::string& logPrefix() const;
     const std::string& solverResetAccumulatedFields() const;
 
@@ -66,6 +85,9 @@ private:
     void parseRestartPath(const config::ComponentConfiguration& compConf, const eckit::LocalConfiguration& cfg);
     void parseRestartPrefix(const config::ComponentConfiguration& compConf, const eckit::LocalConfiguration& cfg);
     void parseRestartLib(const eckit::LocalConfiguration& cfg);
+    void parseRestartFormat(const eckit::LocalConfiguration& cfg);
+    void parsePartialOutput(const eckit::LocalConfiguration& cfg);
+    void parsePercentiles(const eckit::LocalConfiguration& cfg);
     void parseLogPrefix(const config::ComponentConfiguration& compConf, const eckit::LocalConfiguration& cfg);
     void parseSolverResetAccumulatedFields(const config::ComponentConfiguration& compConf,
                                            const eckit::LocalConfiguration& cfg);
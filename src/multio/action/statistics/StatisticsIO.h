@@ -58,6 +58,8 @@ public:
 
     virtual void write(const std::string& name, size_t writeSize) = 0;
     virtual void read(const std::string& name, size_t readSize) = 0;
+    // Read a record of unknown size into the internal buffer and return its size (in words)
+    virtual size_t readRecord(const std::string& name) = 0;
     virtual void flush() = 0;
 
 
@@ -0,0 +1,55 @@
+#include "StatisticsKey.h"
+
+#include <functional>
+#include <sstream>
+
+#include "multio/LibMultio.h"
+#include "multio/message/Glossary.h"
+
+namespace multio::action {
+
+using message::glossary;
+
+namespace {
+template <typename T>
+void hashCombine(std::size_t& seed, const T& v) {
+    seed ^= std::hash<T>{}(v) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+}  // namespace
+
+StatisticsKey::StatisticsKey(const message::Message& msg) :
+    param_{msg.metadata().getOpt<std::string>(glossary().param).value_or("")},
+    paramId_{msg.metadata().getOpt<std::int64_t>(glossary().paramId).value_or(0)},
+    level_{msg.metadata().getOpt<std::int64_t>(glossary().level).value_or(0)},
+    levelist_{msg.metadata().getOpt<std::int64_t>(glossary().levelist).value_or(0)},
+    levtype_{msg.metadata().getOpt<std::string>(glossary().levtype).value_or("unknown")},
+    gridType_{msg.metadata().getOpt<std::string>(glossary().gridType).value_or("unknown")},
+    precision_{msg.metadata().getOpt<std::string>(glossary().precision).value_or("unknown")},
+    source_{msg.source()},
+    hash_{0} {
+    hashCombine(hash_, paramId_);
+    hashCombine(hash_, level_);
+    hashCombine(hash_, levelist_);
+    hashCombine(hash_, param_);
+    hashCombine(hash_, levtype_);
+    hashCombine(hash_, gridType_);
+    hashCombine(hash_, precision_);
+    hashCombine(hash_, source_.group());
+    hashCombine(hash_, source_.id());
+}
+
+bool StatisticsKey::operator==(const StatisticsKey& rhs) const {
+    return hash_ == rhs.hash_ && paramId_ == rhs.paramId_ && level_ == rhs.level_ && levelist_ == rhs.levelist_
+        && param_ == rhs.param_ && levtype_ == rhs.levtype_ && gridType_ == rhs.gridType_
+        && precision_ == rhs.precision_ && source_ == rhs.source_;
+}
+
+std::string StatisticsKey::str() const {
+    std::ostringstream os;
+    os << param_ << "-" << paramId_ << "-" << level_ << "-" << levelist_ << "-" << levtype_ << "-" << gridType_ << "-"
+       << precision_ << "-" << std::to_string(std::hash<std::string>{}(message::Peer{source_}));
+    LOG_DEBUG_LIB(LibMultio) << "Generating key for the field :: " << os.str() << std::endl;
+    return os.str();
+}
+
+}  // namespace multio::action
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "multio/message/Message.h"
+
+namespace multio::action {
+
+// Identifies the field a message belongs to. Built with one metadata lookup per component and compared/hashed
+// directly, the string representation (used to name the restart files) is only generated when needed.
+class StatisticsKey {
+public:
+    explicit StatisticsKey(const message::Message& msg);
+
+    bool operator==(const StatisticsKey& rhs) const;
+    bool operator!=(const StatisticsKey& rhs) const { return !(*this == rhs); }
+
+    std::size_t hash() const { return hash_; }
+
+    // Legacy textual key, stable across versions since restart files are named after it
+    std::string str() const;
+
+    struct Hash {
+        std::size_t operator()(const StatisticsKey& key) const { return key.hash(); }
+    };
+
+private:
+    std::string param_;
+    std::int64_t paramId_;
+    std::int64_t level_;
+    std::int64_t levelist_;
+    std::string levtype_;
+    std::string gridType_;
+    std::string precision_;
+    message::Peer source_;
+    std::size_t hash_;
+};
+
+}  // namespace multio::action
@@ -13,10 +13,26 @@ namespace multio::action {
 
 TemporalStatistics::TemporalStatistics(const std::shared_ptr<PeriodUpdater>& periodUpdater,
                                        const std::vector<std::string>& operations, const message::Message& msg,
-                                       std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) :
+                                       std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg,
+                                       const std::string& key) :
     periodUpdater_{periodUpdater},
-    window_{periodUpdater_->initPeriod(msg, IOmanager, cfg)},
-    statistics_{make_operations(operations, msg, IOmanager, window_, cfg)} {}
+    key_{key},
+    cfg_{cfg},
+    window_{periodUpdater_->initPeriod(msg, IOmanager, cfg_)},
+    statistics_{make_operations(operations, msg, IOmanager, window_, cfg_)} {}
+
+
+const StatisticsConfiguration& TemporalStatistics::cfg() const {
+    return cfg_;
+}
+
+void TemporalStatistics::updateConfiguration(const message::Message& msg) {
+    cfg_.update(msg);
+}
+
+const std::string& TemporalStatistics::key() const {
+    return key_;
+}
 
 
 void TemporalStatistics::dump(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) const {
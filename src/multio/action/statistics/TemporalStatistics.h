@@ -22,7 +22,13 @@ public:
 
     TemporalStatistics(const std::shared_ptr<PeriodUpdater>& periodUpdater, const std::vector<std::string>& operations,
                        const message::Message& msg, std::shared_ptr<StatisticsIO>& IOmanager,
-                       const StatisticsConfiguration& cfg);
+                       const StatisticsConfiguration& cfg, const std::string& key);
+
+    // Per-field configuration, resolved with the first message and refreshed with each new one
+    const StatisticsConfiguration& cfg() const;
+    void updateConfiguration(const message::Message& msg);
+
+    const std::string& key() const;
 
     bool isEndOfWindow(message::Message& msg, const StatisticsConfiguration& cfg);
 
@@ -38,6 +44,8 @@ public:
 
 private:
     const std::shared_ptr<PeriodUpdater>& periodUpdater_;
+    const std::string key_;
+    StatisticsConfiguration cfg_;
     OperationWindow window_;
     std::vector<std::unique_ptr<Operation>> statistics_;
 
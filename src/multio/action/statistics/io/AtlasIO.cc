@@ -1,6 +1,7 @@
 
 #include "AtlasIO.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <iomanip>
@@ -82,6 +83,19 @@ void AtlasIO::read(const std::string& name, std::size_t readSize) {
     return;
 };
 
+std::size_t AtlasIO::readRecord(const std::string& name) {
+    LOG_DEBUG_LIB(LibMultio) << " - The name of the operation read file is :: " << generateCurrFileName(name)
+                             << std::endl;
+    const std::string fname = generateCurrFileName(name);
+    checkFileExist(fname);
+    atlas::io::RecordReader record(fname);
+    std::vector<std::uint64_t> dat;
+    record.read(name, dat).wait();
+    getBuffer(dat.size());
+    std::copy(dat.begin(), dat.end(), buffer_.begin());
+    return dat.size();
+};
+
 void AtlasIO::flush() {
     // TODO: Decide what to do when flush is called. Flush partial statistics when the Tag::Flush is received is
     // probably okay
@@ -22,6 +22,7 @@ public:
     AtlasIO(const std::string& path, const std::string& prefix);
     void write(const std::string& name, std::size_t writeSize) override;
     void read(const std::string& name, std::size_t writeSize) override;
+    std::size_t readRecord(const std::string& name) override;
     void flush() override;
 
 private:
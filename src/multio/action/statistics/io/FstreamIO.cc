@@ -1,6 +1,7 @@
 #include "FstreamIO.h"
 
 #include <cstdio>
+#include <sstream>
 
 #include "eckit/exception/Exceptions.h"
 #include "eckit/filesystem/PathName.h"
@@ -16,9 +17,20 @@ void FstreamIO::write(const std::string& name, std::size_t writeSize) {
     removeCurrFile(name);
     const std::string fname = generateCurrFileName(name);
     std::FILE* fp = std::fopen(fname.c_str(), "w");
-    std::fwrite(buffer_.data(), sizeof(std::uint64_t), writeSize, fp);
-    std::fflush(fp);
+    if (!fp) {
+        std::ostringstream os;
+        os << "ERROR : unable to open restart file : (" << fname << ")";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
+    const std::size_t words = std::fwrite(buffer_.data(), sizeof(std::uint64_t), writeSize, fp);
+    const bool flushed = std::fflush(fp) == 0;
     std::fclose(fp);
+    if (words != writeSize || !flushed) {
+        std::ostringstream os;
+        os << "ERROR : short write of restart file : (" << fname << ") :: " << words << " of " << writeSize
+           << " words";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
     removePrevFile(name);
     return;
 };
@@ -29,12 +41,27 @@ void FstreamIO::read(const std::string& name, std::size_t readSize) {
     const std::string fname = generateCurrFileName(name);
     checkFileExist(fname);
     checkFileSize(fname, readSize * sizeof(std::uint64_t));
-    std::FILE* fp = std::fopen(fname.c_str(), "r");
-    std::fread(buffer_.data(), sizeof(uint64_t), readSize, fp);
-    std::fclose(fp);
+    readFile(fname, readSize);
     return;
 };
 
+std::size_t FstreamIO::readRecord(const std::string& name) {
+    LOG_DEBUG_LIB(LibMultio) << " - The name of the operation read file is :: " << generateCurrFileName(name)
+                             << std::endl;
+    const std::string fname = generateCurrFileName(name);
+    checkFileExist(fname);
+    const std::size_t fileSize = eckit::PathName{fname}.size();
+    if (fileSize % sizeof(std::uint64_t) != 0) {
+        std::ostringstream os;
+        os << "ERROR : wrong file size for restart : (" << fname << ")";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
+    const std::size_t readSize = fileSize / sizeof(std::uint64_t);
+    getBuffer(readSize);
+    readFile(fname, readSize);
+    return readSize;
+};
+
 void FstreamIO::flush() {
     // TODO: Decide what to do when flush is called. Flush partial statistics when the Tag::Flush is received is
     // probably okay
@@ -42,6 +69,24 @@ void FstreamIO::flush() {
 };
 
 
+void FstreamIO::readFile(const std::string& fname, std::size_t readSize) {
+    std::FILE* fp = std::fopen(fname.c_str(), "r");
+    if (!fp) {
+        std::ostringstream os;
+        os << "ERROR : unable to open restart file : (" << fname << ")";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
+    const std::size_t words = std::fread(buffer_.data(), sizeof(std::uint64_t), readSize, fp);
+    std::fclose(fp);
+    if (words != readSize) {
+        std::ostringstream os;
+        os << "ERROR : short read of restart file : (" << fname << ") :: " << words << " of " << readSize
+           << " words";
+        throw eckit::SeriousBug{os.str(), Here()};
+    }
+    return;
+};
+
 void FstreamIO::checkFileExist(const std::string& name) const {
     eckit::PathName file{name};
     if (!file.exists()) {
@@ -12,9 +12,11 @@ public:
     FstreamIO(const std::string& path, const std::string& prefix);
     void write(const std::string& name, std::size_t writeSize) override;
     void read(const std::string& name, std::size_t readSize) override;
+    std::size_t readRecord(const std::string& name) override;
     void flush() override;
 
 private:
+    void readFile(const std::string& fname, std::size_t readSize);
     void checkFileExist(const std::string& fname) const;
     void checkFileSize(const std::string& fname, size_t expectedSize) const;
 };
@@ -36,6 +36,9 @@ public:
     virtual void init(const message::Message& msg, const StatisticsConfiguration& cfg) = 0;
     virtual bool needStepZero() const = 0;
 
+    // Additional metadata describing the output of the operation
+    virtual void fillMetadata(message::Metadata& md) const {};
+
 protected:
     virtual void print(std::ostream& os) const = 0;
 
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "multio/action/statistics/RestartRecord.h"
 #include "multio/action/statistics/operations/Operation.h"
 
 namespace multio::action {
@@ -53,7 +54,10 @@ public:
     size_t byte_size() const override { return values_.size() * sizeof(T); };
 
     void dump(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) const override {
-        if (needRestart_) {
+        if (needRestart_ && cfg.restartFormat() == "typed") {
+            RestartRecord<T>{name_, cfg.restartCompression()}.dump(IOmanager, {&values_});
+        }
+        else if (needRestart_) {
             IOBuffer restartState{IOmanager->getBuffer(restartSize())};
             restartState.zero();
             serialize(restartState);
@@ -65,10 +69,8 @@ public:
 
     void load(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) override {
         if (needRestart_) {
-            IOBuffer restartState{IOmanager->getBuffer(restartSize())};
-            IOmanager->read(name_, restartSize());
-            deserialize(restartState);
-            restartState.zero();
+            // Reads both typed and legacy restart records
+            RestartRecord<T>{name_, cfg.restartCompression()}.load(IOmanager, {&values_});
         }
         return;
     };
@@ -84,17 +86,6 @@ protected:
         return;
     };
 
-    void deserialize(const IOBuffer& restartState) {
-        restartState.checkChecksum();
-        auto last = restartState.cend();
-        std::transform(restartState.cbegin(), --last, values_.begin(), [](const std::uint64_t& v) {
-            std::uint64_t lv = v;
-            double dv = *reinterpret_cast<double*>(&lv);
-            return static_cast<T>(dv);
-        });
-        return;
-    };
-
     void checkSize(long sz) {
         if (values_.size() != static_cast<long>(sz / sizeof(T))) {
             throw eckit::AssertionFailed(logHeader_ + " :: Expected size: " + std::to_string(values_.size())
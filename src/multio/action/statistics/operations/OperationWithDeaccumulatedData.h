@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "multio/action/statistics/RestartRecord.h"
 #include "multio/action/statistics/TimeUtils.h"
 #include "multio/action/statistics/operations/Operation.h"
 
@@ -83,7 +84,10 @@ public:
     size_t byte_size() const override { return values_.size() * sizeof(T); };
 
     void dump(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) const override {
-        if (needRestart_) {
+        if (needRestart_ && cfg.restartFormat() == "typed") {
+            RestartRecord<T>{name_, cfg.restartCompression()}.dump(IOmanager, {&initValues_, &values_});
+        }
+        else if (needRestart_) {
             IOBuffer restartState{IOmanager->getBuffer(restartSize())};
             restartState.zero();
             serialize(restartState);
@@ -95,10 +99,8 @@ public:
 
     void load(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) override {
         if (needRestart_) {
-            IOBuffer restartState{IOmanager->getBuffer(restartSize())};
-            IOmanager->read(name_, restartSize());
-            deserialize(restartState);
-            restartState.zero();
+            // Reads both typed and legacy restart records
+            RestartRecord<T>{name_, cfg.restartCompression()}.load(IOmanager, {&initValues_, &values_});
         }
         return;
     };
@@ -120,22 +122,6 @@ protected:
         return;
     };
 
-    void deserialize(const IOBuffer& restartState) {
-        restartState.checkChecksum();
-        size_t sz = values_.size();
-        for (size_t i = 0; i < sz; ++i) {
-            std::uint64_t lv = restartState[i];
-            double dv = *reinterpret_cast<double*>(&lv);
-            initValues_[i] = static_cast<T>(dv);
-        }
-        for (size_t i = 0; i < sz; ++i) {
-            std::uint64_t lv = restartState[sz + i];
-            double dv = *reinterpret_cast<double*>(&lv);
-            values_[i] = static_cast<T>(dv);
-        }
-        return;
-    };
-
     void checkSize(long sz) {
         if (values_.size() != static_cast<long>(sz / sizeof(T))) {
             throw eckit::AssertionFailed(logHeader_ + " :: Expected size: " + std::to_string(values_.size())
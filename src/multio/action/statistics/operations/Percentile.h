@@ -0,0 +1,191 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "multio/LibMultio.h"
+#include "multio/action/statistics/RestartRecord.h"
+#include "multio/action/statistics/operations/Operation.h"
+
+namespace multio::action {
+
+// Streaming per-gridpoint percentile estimated from a fixed-bin histogram.
+//
+// Bins are equally spaced over the configured range (values outside are clamped into the first/last bin, missing
+// and NaN values are skipped),
+// the percentile is linearly interpolated inside the bin it falls into, so the error is bounded by
+// (max - min) / bins. Counts are stored bin-major (one contiguous array of gridpoints per bin) as 16 bit
+// integers, which limits a window to 65534 samples.
+template <typename T, typename = std::enable_if_t<std::is_floating_point_v<T>>>
+class Percentile final : public Operation {
+public:
+    using Count = std::uint16_t;
+
+    Percentile(const std::string& name, double percentile, long sz, const OperationWindow& win,
+               const StatisticsConfiguration& cfg) :
+        Operation{name, "percentile", win, cfg},
+        percentile_{percentile},
+        size_{static_cast<std::size_t>(sz) / sizeof(T)},
+        bins_{static_cast<std::size_t>(cfg.percentileBins())},
+        min_{cfg.percentileMin()},
+        max_{cfg.percentileMax()},
+        needRestart_{cfg.writeRestart()},
+        counts_(bins_ * size_, 0) {
+        if (!(percentile_ >= 0.0 && percentile_ <= 100.0)) {
+            throw eckit::UserError{logHeader_ + " :: percentile must be in [0, 100]", Here()};
+        }
+        if (!cfg.havePercentileRange()) {
+            throw eckit::UserError{logHeader_ + " :: \"percentile-range\" needs to be configured", Here()};
+        }
+    }
+
+    Percentile(const std::string& name, double percentile, long sz, const OperationWindow& win,
+               std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) :
+        Percentile{name, percentile, sz, win, cfg} {
+        load(IOmanager, cfg);
+    }
+
+    void updateData(const void* data, long sz) override {
+        checkSize(sz);
+        LOG_DEBUG_LIB(LibMultio) << logHeader_ << ".update().count=" << win_.count() << std::endl;
+        if (win_.count() >= static_cast<long>(std::numeric_limits<Count>::max())) {
+            throw eckit::SeriousBug{logHeader_ + " :: too many samples in the window for the histogram", Here()};
+        }
+        const T* val = static_cast<const T*>(data);
+        cfg_.haveMissingValue() ? updateWithMissing(val) : updateWithoutMissing(val);
+        return;
+    }
+
+    void updateWindow(const void* data, long sz, const message::Message& msg,
+                      const StatisticsConfiguration& cfg) override {
+        std::fill(counts_.begin(), counts_.end(), Count{0});
+    }
+
+    void updateWindow(const message::Message& msg, const StatisticsConfiguration& cfg) override {
+        std::fill(counts_.begin(), counts_.end(), Count{0});
+    }
+
+    void dump(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) const override {
+        // Histograms are always written in the typed format, there is no legacy representation
+        if (needRestart_) {
+            RestartRecord<Count>{name_, cfg.restartCompression()}.dump(IOmanager, {&counts_});
+        }
+    }
+
+    void load(std::shared_ptr<StatisticsIO>& IOmanager, const StatisticsConfiguration& cfg) override {
+        if (needRestart_) {
+            RestartRecord<Count>{name_, cfg.restartCompression()}.load(IOmanager, {&counts_});
+        }
+    }
+
+    size_t byte_size() const override { return size_ * sizeof(T); }
+
+    void compute(eckit::Buffer& buf) override {
+        LOG_DEBUG_LIB(LibMultio) << logHeader_ << ".compute().count=" << win_.count() << std::endl;
+        T* out = static_cast<T*>(buf.data());
+
+        // Number of valid samples of each gridpoint
+        std::vector<std::uint32_t> total(size_, 0);
+        for (std::size_t b = 0; b < bins_; ++b) {
+            const Count* c = counts_.data() + b * size_;
+            for (std::size_t i = 0; i < size_; ++i) {
+                total[i] += c[i];
+            }
+        }
+
+        // Walk the bins once for all gridpoints, keeping the data access contiguous
+        const double width = (max_ - min_) / static_cast<double>(bins_);
+        const double p = percentile_ / 100.0;
+        std::vector<std::uint32_t> cumulative(size_, 0);
+        std::vector<bool> done(size_, false);
+        for (std::size_t b = 0; b < bins_; ++b) {
+            const Count* c = counts_.data() + b * size_;
+            for (std::size_t i = 0; i < size_; ++i) {
+                if (done[i] || c[i] == 0) {
+                    continue;
+                }
+                const double target = p * static_cast<double>(total[i]);
+                if (static_cast<double>(cumulative[i] + c[i]) >= target) {
+                    const double frac = (target - static_cast<double>(cumulative[i])) / static_cast<double>(c[i]);
+                    out[i] = static_cast<T>(min_ + (static_cast<double>(b) + frac) * width);
+                    done[i] = true;
+                }
+                cumulative[i] += c[i];
+            }
+        }
+
+        // Gridpoints without any valid sample
+        const T missing = static_cast<T>(cfg_.missingValue());
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (total[i] == 0) {
+                out[i] = missing;
+            }
+        }
+        return;
+    }
+
+    void init(const void* data, long sz, const message::Message& msg, const StatisticsConfiguration& cfg) override {
+        return;
+    }
+
+    void init(const message::Message& msg, const StatisticsConfiguration& cfg) override { return; }
+
+    bool needStepZero() const override { return false; }
+
+    void fillMetadata(message::Metadata& md) const override { md.set("percentile", percentile_); }
+
+private:
+    std::size_t bin(T v) const {
+        const double x = (static_cast<double>(v) - min_) * static_cast<double>(bins_) / (max_ - min_);
+        return static_cast<std::size_t>(std::clamp(x, 0.0, static_cast<double>(bins_ - 1)));
+    }
+
+    void updateWithoutMissing(const T* val) {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (!std::isnan(val[i])) {
+                ++counts_[bin(val[i]) * size_ + i];
+            }
+        }
+    }
+
+    void updateWithMissing(const T* val) {
+        const T m = static_cast<T>(cfg_.missingValue());
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (val[i] != m && !std::isnan(val[i])) {
+                ++counts_[bin(val[i]) * size_ + i];
+            }
+        }
+    }
+
+    void checkSize(long sz) const {
+        if (size_ != static_cast<std::size_t>(sz) / sizeof(T)) {
+            throw eckit::AssertionFailed(logHeader_ + " :: Expected size: " + std::to_string(size_)
+                                         + " -- actual size: " + std::to_string(sz));
+        }
+    }
+
+    void print(std::ostream& os) const override { os << logHeader_; }
+
+    const double percentile_;
+    const std::size_t size_;
+    const std::size_t bins_;
+    const double min_;
+    const double max_;
+    const bool needRestart_;
+    std::vector<Count> counts_;
+};
+
+}  // namespace multio::action
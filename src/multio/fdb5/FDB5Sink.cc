@@ -16,6 +16,7 @@
 #include "multio/LibMultio.h"
 
 #include "eckit/config/LocalConfiguration.h"
+#include "eckit/io/MemoryHandle.h"
 #include "eckit/value/Value.h"
 #include "fdb5/config/Config.h"
 #include "multio/util/Substitution.h"
@@ -74,6 +75,14 @@ void FDB5Sink::write(eckit::message::Message msg) {
     fdb_.archive(msg);
 }
 
+void FDB5Sink::writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets) {
+    LOG_DEBUG_LIB(LibMultio) << "FDB5Sink::writeBatch() with " << offsets.size() << " messages" << std::endl;
+
+    // One archive call for the whole batch, FDB splits the handle into messages
+    eckit::MemoryHandle handle{data, length};
+    fdb_.archive(handle);
+}
+
 void FDB5Sink::flush() {
     LOG_DEBUG_LIB(LibMultio) << "FDB5Sink::flush()" << std::endl;
 
@@ -33,6 +33,8 @@ public:
 private:
     void write(eckit::message::Message msg) override;
 
+    void writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets) override;
+
     void flush() override;
 
     void print(std::ostream&) const override;
@@ -250,6 +250,7 @@ Encoding EncodeBitsPerValue::getEncoding(int paramid, const std::string& lv) {
     encode = tabulatedBitsPerValue(paramid, levtype);
     if (encode.defined()) {
         LOG_DEBUG(multio_debug, LibMultio) << "EncodeBitsPerValue FOUND in TABLE " << encode << std::endl;
+        cacheBitsPerValue(paramid, levtype, encode);
         return encode;
     }
 
@@ -265,8 +266,14 @@ Encoding EncodeBitsPerValue::getEncoding(int paramid, const std::string& lv) {
 
 
 int EncodeBitsPerValue::getBitsPerValue(int paramid, const std::string& lv, double min, double max) {
+    // For adaptive encodings the cached decision is the error target, the bits follow from min and max of each field
     Encoding encode = getEncoding(paramid, lv);
-    return encode.computeBitsPerValue(min, max);
+    int bpv = encode.computeBitsPerValue(min, max);
+    if (encode.adaptive()) {
+        LOG_DEBUG(multio_debug, LibMultio) << "EncodeBitsPerValue ADAPTIVE " << encode << " min " << min << " max "
+                                           << max << " -> bitsPerValue " << bpv << std::endl;
+    }
+    return bpv;
 }
 
 }  // namespace multio
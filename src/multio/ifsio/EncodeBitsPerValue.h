@@ -11,6 +11,7 @@
 /// @author Tiago Quintino
 /// @date June 2020
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <map>
@@ -35,9 +36,18 @@ struct Encoding {
     int decimalScaleFactor = 0;
     float precision = 0;
 
+    /// Adaptive encoding: maximum error of the decoded values, either absolute or relative to the largest
+    /// absolute value of the field. The minimum number of bits meeting the target is chosen for each field.
+    double absoluteError = 0;
+    double relativeError = 0;
+
     /// indentifier for missing decimal scale factor
     static constexpr int marker() { return std::numeric_limits<int>::min(); }
 
+    /// bounds of the adaptively chosen bitsPerValue
+    static constexpr int minAdaptiveBitsPerValue() { return 1; }
+    static constexpr int maxAdaptiveBitsPerValue() { return 32; }
+
 public:
     explicit Encoding(int bpv = 0, int dsf = marker(), float p = 0) :
         bitsPerValue(bpv), decimalScaleFactor(dsf), precision(p) {}
@@ -46,15 +56,29 @@ public:
         bitsPerValue = cfg.getInt("bitsPerValue", 0);
         decimalScaleFactor = cfg.getInt("decimalScaleFactor", marker());
         precision = cfg.getFloat("precision", 0.);
-        if (bitsPerValue <= 0 and decimalScaleFactor == marker() and precision <= 0) {
-            throw eckit::BadValue("Invalid bitsPerValue or decimalScaleFactor or precision", Here());
+        absoluteError = cfg.getDouble("absoluteError", 0.);
+        relativeError = cfg.getDouble("relativeError", 0.);
+        if (bitsPerValue <= 0 and decimalScaleFactor == marker() and precision <= 0 and not adaptive()) {
+            throw eckit::BadValue(
+                "Invalid bitsPerValue or decimalScaleFactor or precision or absoluteError or relativeError", Here());
+        }
+        if (absoluteError > 0 and relativeError > 0) {
+            throw eckit::BadValue("Only one of absoluteError and relativeError may be given", Here());
         }
     }
 
+    bool adaptive() const { return absoluteError > 0 || relativeError > 0; }
+
     int computeBitsPerValue(double min, double max) const {
         if (bitsPerValue)
             return bitsPerValue;
 
+        if (adaptive()) {
+            const double error
+                = absoluteError > 0 ? absoluteError : relativeError * std::max(std::abs(min), std::abs(max));
+            return adaptiveBitsPerValue(min, max, error);
+        }
+
         if (decimalScaleFactor != marker()) {
             const int& p = decimalScaleFactor;
 
@@ -69,12 +93,48 @@ public:
         }
     }
 
-    bool defined() const { return (bitsPerValue || decimalScaleFactor != marker() || precision > 0); }
+    bool defined() const { return (bitsPerValue || decimalScaleFactor != marker() || precision > 0 || adaptive()); }
+
+    /// Minimum bitsPerValue for which simple packing (decimalScaleFactor 0) of values in [min, max] decodes
+    /// all values with an error of at most maxError.
+    ///
+    /// The packer uses the largest float not above min as reference value R and the smallest binary scale
+    /// factor E for which (max - R) / 2^E fits into bitsPerValue bits. Values are rounded to the nearest
+    /// multiple of 2^E, so the error is bounded by 2^(E-1). With Emax the largest E for which 2^(E-1) does
+    /// not exceed maxError, the error target is met by all b with (2^b - 1) * 2^Emax >= max - R.
+    static int adaptiveBitsPerValue(double min, double max, double maxError) {
+        float reference = static_cast<float>(min);
+        if (reference > min) {
+            reference = std::nextafter(reference, -std::numeric_limits<float>::infinity());
+        }
+        const double range = max - static_cast<double>(reference);
+        if (!(range > 0) || !(maxError > 0)) {
+            return range > 0 ? maxAdaptiveBitsPerValue() : minAdaptiveBitsPerValue();
+        }
+
+        int exponent = 0;
+        std::frexp(2 * maxError, &exponent);
+        const int maxBinaryScaleFactor = exponent - 1;
+
+        for (int bits = minAdaptiveBitsPerValue(); bits < maxAdaptiveBitsPerValue(); ++bits) {
+            if (std::ldexp(std::ldexp(1., bits) - 1, maxBinaryScaleFactor) >= range) {
+                return bits;
+            }
+        }
+        return maxAdaptiveBitsPerValue();
+    }
 
 private:
     void print(std::ostream& s) const {
         s << "Encoding(bitsPerValue=" << bitsPerValue << ",decimalScaleFactor=" << decimalScaleFactor
-          << ",precision=" << precision << ")";
+          << ",precision=" << precision;
+        if (absoluteError > 0) {
+            s << ",absoluteError=" << absoluteError;
+        }
+        if (relativeError > 0) {
+            s << ",relativeError=" << relativeError;
+        }
+        s << ")";
     }
 
     friend std::ostream& operator<<(std::ostream& s, const Encoding& v) {
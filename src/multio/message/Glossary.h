@@ -115,6 +115,12 @@ struct Glossary {
     const KeyType bitsPerValue{"bitsPerValue"};
     const KeyType bitmapPresent{"bitmapPresent"};
 
+    // Statistics of the values of the payload, set by actions computing them on the fly (see
+    // message/ValueStatistics.h) and to be dropped by any action changing the values
+    const KeyType minimumValue{"minimumValue"};
+    const KeyType maximumValue{"maximumValue"};
+    const KeyType numberOfMissingValues{"numberOfMissingValues"};
+
     // Grib general
     const KeyType typeOfGeneratingProcess{"typeOfGeneratingProcess"};  // Analog to mars type
     const KeyType generatingProcessIdentifier{"generatingProcessIdentifier"};
@@ -244,6 +250,9 @@ struct Glossary {
     const KeyType westEastIncrement{"west_east_increment"};
     const KeyType southNorthIncrement{"south_north_increment"};
 
+    // Batched encoding: offsets of the GRIB messages stored contiguously in the payload
+    const KeyType batchOffsets{"batchOffsets"};
+
 
     static const Glossary& instance() {
         static Glossary glossary;
@@ -117,6 +117,18 @@ Metadata& Message::modifyMetadata() {
     return header_.modifyMetadata();
 }
 
+const SharedMetadata& Message::sharedMetadata() const {
+    return header_.sharedMetadata();
+}
+
+Metadata& Message::modifyMetadataOverlay() {
+    return header_.modifyMetadataOverlay();
+}
+
+void Message::mergeMetadataOverlay() {
+    header_.mergeMetadataOverlay();
+}
+
 SharedPayload& Message::payload() {
     return payload_;
 }
@@ -107,6 +107,15 @@ public:  // types
 
         Metadata& modifyMetadata();
 
+        // Metadata including keys pending in the overlay, to be read through a MetadataOverlay view
+        const SharedMetadata& sharedMetadata() const;
+        SharedMetadata& modifySharedMetadata();
+
+        // Sets keys without copying shared metadata (see SharedMetadata::modifyOverlay)
+        Metadata& modifyMetadataOverlay();
+        // Merges pending keys, required before `metadata()` can be read
+        void mergeMetadataOverlay();
+
 
         // Copy or acquire metadata object if only owned by this object
         SharedMetadata moveOrCopyMetadata() const;
@@ -174,6 +183,10 @@ public:
     const Metadata& metadata() const;
     Metadata& modifyMetadata();
 
+    const SharedMetadata& sharedMetadata() const;
+    Metadata& modifyMetadataOverlay();
+    void mergeMetadataOverlay();
+
     SharedPayload& payload();
     const SharedPayload& payload() const;
 
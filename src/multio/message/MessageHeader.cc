@@ -60,6 +60,21 @@ Metadata& Message::Header::modifyMetadata() {
     return metadata_.modify();
 }
 
+const SharedMetadata& Message::Header::sharedMetadata() const {
+    return metadata_;
+}
+SharedMetadata& Message::Header::modifySharedMetadata() {
+    fieldId_ = std::nullopt;
+    return metadata_;
+}
+Metadata& Message::Header::modifyMetadataOverlay() {
+    fieldId_ = std::nullopt;
+    return metadata_.modifyOverlay();
+}
+void Message::Header::mergeMetadataOverlay() {
+    metadata_.mergeOverlay();
+}
+
 // Metadata&& Message::Header::metadata() && {
 //     return std::move(metadata_);
 // }
@@ -76,35 +91,35 @@ void Message::Header::acquireMetadata() {
 
 
 std::string Message::Header::name() const {
-    if (auto optVal = metadata_.read().getOpt<std::string>(glossary().name); optVal) {
+    if (auto optVal = metadata_.getOpt<std::string>(glossary().name); optVal) {
         return *optVal;
     }
     throw MetadataMissingKeyException(glossary().name, Here());
 }
 
 std::string Message::Header::category() const {
-    if (auto optVal = metadata_.read().getOpt<std::string>(glossary().category); optVal) {
+    if (auto optVal = metadata_.getOpt<std::string>(glossary().category); optVal) {
         return *optVal;
     }
     throw MetadataMissingKeyException(glossary().category, Here());
 }
 
 std::int64_t Message::Header::globalSize() const {
-    if (auto optVal = metadata_.read().getOpt<std::int64_t>(glossary().globalSize); optVal) {
+    if (auto optVal = metadata_.getOpt<std::int64_t>(glossary().globalSize); optVal) {
         return *optVal;
     }
     throw MetadataMissingKeyException(glossary().globalSize, Here());
 }
 
 std::string Message::Header::domain() const {
-    if (auto optVal = metadata_.read().getOpt<std::string>(glossary().domain); optVal) {
+    if (auto optVal = metadata_.getOpt<std::string>(glossary().domain); optVal) {
         return *optVal;
     }
     throw MetadataMissingKeyException(glossary().domain, Here());
 }
 
 util::PrecisionTag Message::Header::precision() const {
-    if (auto optVal = metadata_.read().getOpt<std::string>(glossary().precision); optVal) {
+    if (auto optVal = metadata_.getOpt<std::string>(glossary().precision); optVal) {
         return util::decodePrecisionTag(*optVal);
     }
     throw MetadataMissingKeyException(glossary().precision, Here());
@@ -112,7 +127,15 @@ util::PrecisionTag Message::Header::precision() const {
 
 const std::string& Message::Header::fieldId() const {
     if (!fieldId_) {
-        fieldId_ = metadata_.read().toString();
+        if (const auto* overlay = metadata_.overlay(); overlay) {
+            // Keys pending in the overlay are merged into a temporary, the shared metadata is not modified
+            Metadata merged{metadata_.base()};
+            merged.updateOverwrite(*overlay);
+            fieldId_ = merged.toString();
+        }
+        else {
+            fieldId_ = metadata_.read().toString();
+        }
     }
     return *fieldId_;
 }
@@ -1,6 +1,9 @@
 
 #include "MetadataMapping.h"
 
+#include "multio/message/MetadataOverlay.h"
+#include "multio/message/SharedMetadata.h"
+
 
 #include "eckit/exception/Exceptions.h"
 
@@ -113,7 +116,8 @@ MetadataMapping::MetadataMapping(const MatchKeyType& metadataKey, const KeyMappi
     MetadataMapping(metadataKey, constructDataMapping(metadataKey, mappings, optionalMappings, source), targetPath) {}
 
 
-void MetadataMapping::applyInplace(Metadata& m, MetadataMappingOptions options) const {
+template <typename Source>
+void MetadataMapping::applyTo(const Source& m, Metadata& target, MetadataMappingOptions options) const {
     auto searchLookUpKey = m.find(metadataKey_);
     if (searchLookUpKey == m.end()) {
         if (options.enforceMatch) {
@@ -136,19 +140,37 @@ void MetadataMapping::applyInplace(Metadata& m, MetadataMappingOptions options)
     }
 
     // TODO handle internals without LocalConfiguration
-    std::optional<Metadata> targetConfMaybe{};
-    Metadata& ms = targetPath_ ? (targetConfMaybe = m.get<Metadata>(*targetPath_), *targetConfMaybe) : m;
+    if (targetPath_) {
+        Metadata ms = m.template get<Metadata>(*targetPath_);
+        if (options.overwriteExisting) {
+            ms.updateOverwrite(searchMappingData->second);
+        }
+        else {
+            ms.updateNoOverwrite(searchMappingData->second);
+        }
+        target.set(*targetPath_, std::move(ms));
+        return;
+    }
 
     if (options.overwriteExisting) {
-        ms.updateOverwrite(searchMappingData->second);
+        target.updateOverwrite(searchMappingData->second);
+        return;
     }
-    else {
-        ms.updateNoOverwrite(searchMappingData->second);
+    for (const auto& kv : searchMappingData->second) {
+        if (m.find(kv.first) == m.end()) {
+            target.set(kv.first, kv.second);
+        }
     }
+}
 
-    if (targetPath_) {
-        m.set(*targetPath_, ms);
-    }
+void MetadataMapping::applyInplace(Metadata& m, MetadataMappingOptions options) const {
+    applyTo(m, m, options);
+}
+
+void MetadataMapping::applyInplace(SharedMetadata& m, MetadataMappingOptions options) const {
+    // Obtain the target first, the view must include a newly created overlay
+    auto& target = m.modifyOverlay();
+    applyTo(MetadataOverlay{m}, target, options);
 }
 
 
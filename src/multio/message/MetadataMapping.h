@@ -21,6 +21,7 @@
 #include "eckit/exception/Exceptions.h"
 
 #include "multio/message/Metadata.h"
+#include "multio/message/SharedMetadata.h"
 
 #include <optional>
 
@@ -96,6 +97,9 @@ public:
 
     void applyInplace(Metadata&, MetadataMappingOptions options = MetadataMappingOptions{}) const;
 
+    // Writes mapped keys to the overlay of shared metadata instead of copying it
+    void applyInplace(SharedMetadata&, MetadataMappingOptions options = MetadataMappingOptions{}) const;
+
 
     Metadata apply(Metadata&&, MetadataMappingOptions options = MetadataMappingOptions{}) const;
 
@@ -103,6 +107,10 @@ public:
 
 
 private:
+    // Looks up the source key in `source` and writes mapped keys to `target`
+    template <typename Source>
+    void applyTo(const Source& source, Metadata& target, MetadataMappingOptions options) const;
+
     MatchKeyType metadataKey_;  // Describes the key to be looked for in the metadata
     DataMapping mapData_;       // Input data on which the mapping is performed
     std::optional<KeyType>
@@ -0,0 +1,87 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "multio/message/MetadataOverlay.h"
+
+#include "eckit/exception/Exceptions.h"
+
+#include "multio/message/SharedMetadata.h"
+
+namespace multio::message {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MetadataOverlay::MetadataOverlay(const Metadata& base) {
+    push(base);
+}
+
+MetadataOverlay::MetadataOverlay(const SharedMetadata& base) {
+    push(base.base());
+    if (const auto* overlay = base.overlay(); overlay) {
+        push(*overlay);
+    }
+}
+
+MetadataOverlay& MetadataOverlay::push(const Metadata& layer) {
+    ASSERT_MSG(numLayers_ < MaxLayers, "MetadataOverlay: too many layers");
+    layers_[numLayers_++] = &layer;
+    return *this;
+}
+
+MetadataOverlay::ConstIterator MetadataOverlay::find(const KeyType& k) const {
+    if (auto search = top_.find(k); search != top_.end()) {
+        return ConstIterator{&*search};
+    }
+    for (std::size_t i = numLayers_; i-- > 0;) {
+        if (auto search = layers_[i]->find(k); search != layers_[i]->end()) {
+            return ConstIterator{&*search};
+        }
+    }
+    return end();
+}
+
+const MetadataValue& MetadataOverlay::get(const KeyType& k) const {
+    if (auto search = find(k); search != end()) {
+        return search->second;
+    }
+    throw MetadataMissingKeyException(k, Here());
+}
+
+std::optional<MetadataValue> MetadataOverlay::getOpt(const KeyType& k) const noexcept {
+    if (auto search = find(k); search != end()) {
+        return std::optional<MetadataValue>{search->second};
+    }
+    return std::nullopt;
+}
+
+bool MetadataOverlay::shadowed(const KeyType& k, std::size_t layer) const {
+    if (top_.find(k) != top_.end()) {
+        return true;
+    }
+    for (std::size_t i = layer + 1; i < numLayers_; ++i) {
+        if (layers_[i]->find(k) != layers_[i]->end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Metadata MetadataOverlay::flatten() const {
+    Metadata md;
+    for (std::size_t i = 0; i < numLayers_; ++i) {
+        md.updateOverwrite(*layers_[i]);
+    }
+    md.updateOverwrite(top_);
+    return md;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::message
@@ -0,0 +1,146 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include "multio/message/Metadata.h"
+
+#include <array>
+
+
+namespace multio::message {
+
+class SharedMetadata;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Layered view on metadata: look ups go through a stack of read-only layers (e.g. the shared metadata of a message
+ * and per-action additional metadata) and keys set on the view are kept in a small own layer on top.
+ * The layers themselves are never copied and must outlive the view.
+ *
+ * The interface follows `Metadata` where it is used for look ups (`find`/`end`, `get`, `getOpt`, `set`), such that
+ * code templated on the metadata type works on both.
+ */
+class MetadataOverlay {
+public:
+    using KeyType = typename Metadata::KeyType;
+    using ValueType = typename Metadata::MapType::value_type;
+
+    static constexpr std::size_t MaxLayers = 4;
+
+    // Refers to a single entry - only supports dereferencing and comparison with `end()`
+    class ConstIterator {
+    public:
+        ConstIterator() noexcept = default;
+        explicit ConstIterator(const ValueType* entry) noexcept : entry_{entry} {}
+
+        const ValueType& operator*() const noexcept { return *entry_; }
+        const ValueType* operator->() const noexcept { return entry_; }
+
+        bool operator==(const ConstIterator& other) const noexcept { return entry_ == other.entry_; }
+        bool operator!=(const ConstIterator& other) const noexcept { return entry_ != other.entry_; }
+
+    private:
+        const ValueType* entry_ = nullptr;
+    };
+
+    explicit MetadataOverlay(const Metadata& base);
+
+    // Views the metadata of a message including keys set with `SharedMetadata::modifyOverlay`
+    explicit MetadataOverlay(const SharedMetadata& base);
+
+    MetadataOverlay(const MetadataOverlay&) = default;
+    MetadataOverlay(MetadataOverlay&&) noexcept = default;
+
+    MetadataOverlay& operator=(const MetadataOverlay&) = default;
+    MetadataOverlay& operator=(MetadataOverlay&&) noexcept = default;
+
+    // Adds a read-only layer taking precedence over all layers pushed before (keys set on the view still win)
+    MetadataOverlay& push(const Metadata& layer);
+
+    ConstIterator find(const KeyType& k) const;
+    ConstIterator end() const noexcept { return ConstIterator{}; }
+
+    bool has(const KeyType& k) const { return find(k) != end(); }
+
+    const MetadataValue& get(const KeyType& k) const;
+
+    template <typename T>
+    const T& get(const KeyType& k) const {
+        if (auto search = find(k); search != end()) {
+            try {
+                return search->second.template get<T>();
+            }
+            catch (const MetadataException& err) {
+                std::throw_with_nested(MetadataKeyException(k, err.what(), Here()));
+            }
+        }
+        throw MetadataMissingKeyException(k, Here());
+    }
+
+    std::optional<MetadataValue> getOpt(const KeyType& k) const noexcept;
+
+    template <typename T>
+    std::optional<T> getOpt(const KeyType& k) const {
+        if (auto search = find(k); search != end()) {
+            try {
+                return search->second.template get<T>();
+            }
+            catch (const MetadataException& err) {
+                std::throw_with_nested(MetadataKeyException(k, err.what(), Here()));
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename V>
+    void set(KeyType&& k, V&& v) {
+        top_.set(std::move(k), std::forward<V>(v));
+    }
+
+    template <typename V>
+    void set(const KeyType& k, V&& v) {
+        top_.set(k, std::forward<V>(v));
+    }
+
+    // Calls `func` once for each visible key/value pair, in no particular order
+    template <typename Func>
+    void forEach(Func&& func) const {
+        for (const auto& kv : top_) {
+            func(kv);
+        }
+        for (std::size_t i = numLayers_; i-- > 0;) {
+            for (const auto& kv : *layers_[i]) {
+                if (!shadowed(kv.first, i)) {
+                    func(kv);
+                }
+            }
+        }
+    }
+
+    // Keys set on the view
+    const Metadata& overlay() const noexcept { return top_; }
+
+    // Materializes all layers into a single metadata object
+    Metadata flatten() const;
+
+private:
+    // Whether a key of layer `layer` is hidden by a layer above
+    bool shadowed(const KeyType& k, std::size_t layer) const;
+
+    std::array<const Metadata*, MaxLayers> layers_{};
+    std::size_t numLayers_ = 0;
+    Metadata top_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::message
@@ -15,6 +15,8 @@
 
 #include "multio/message/SharedMetadata.h"
 
+#include "eckit/exception/Exceptions.h"
+
 namespace multio::message {
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -32,10 +34,12 @@ SharedMetadata::SharedMetadata(std::shared_ptr<Metadata> m, bool moveOrCopy) :
 
 
 const Metadata& SharedMetadata::read() const {
+    ASSERT_MSG(!overlay_, "SharedMetadata: keys pending in the overlay have to be merged before reading the metadata");
     return *metadata_;
 }
 
 Metadata& SharedMetadata::modify() {
+    mergeOverlay();
     if (moveOrCopy_ && metadata_.use_count() != 1) {
         metadata_ = std::make_shared<Metadata>(*metadata_);
         moveOrCopy_ = false;
@@ -43,13 +47,48 @@ Metadata& SharedMetadata::modify() {
     return *metadata_;
 }
 
+Metadata& SharedMetadata::modifyOverlay() {
+    if (!overlay_) {
+        if (!moveOrCopy_ || metadata_.use_count() == 1) {
+            return *metadata_;
+        }
+        overlay_ = std::make_shared<Metadata>();
+    }
+    else if (overlay_.use_count() != 1) {
+        overlay_ = std::make_shared<Metadata>(*overlay_);
+    }
+    return *overlay_;
+}
+
+const Metadata& SharedMetadata::base() const {
+    return *metadata_;
+}
+
+const Metadata* SharedMetadata::overlay() const {
+    return overlay_.get();
+}
+
+void SharedMetadata::mergeOverlay() {
+    if (!overlay_) {
+        return;
+    }
+    if (moveOrCopy_ && metadata_.use_count() != 1) {
+        metadata_ = std::make_shared<Metadata>(*metadata_);
+        moveOrCopy_ = false;
+    }
+    metadata_->updateOverwrite(*overlay_);
+    overlay_.reset();
+}
+
 
 void SharedMetadata::acquire() {
     moveOrCopy_ = true;
 }
 
 SharedMetadata SharedMetadata::moveOrCopy() const {
-    return SharedMetadata{metadata_, true};
+    SharedMetadata ret{metadata_, true};
+    ret.overlay_ = overlay_;
+    return ret;
 }
 
 std::weak_ptr<Metadata> SharedMetadata::weakRef() const {
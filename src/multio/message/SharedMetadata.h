@@ -17,6 +17,7 @@
 #include "multio/message/Metadata.h"
 
 #include <memory>
+#include <optional>
 
 
 namespace multio::message {
@@ -39,9 +40,34 @@ public:
     This& operator=(This&& other) noexcept = default;
 
     // WARNING TO USERS: NEVER STORE THESE REFERENCES
+    // The full metadata can only be read once keys pending in the overlay have been merged (see `mergeOverlay`),
+    // reading never copies. Modifying merges the overlay (copying the shared metadata once).
     const Metadata& read() const;
     Metadata& modify();
 
+    // Returns a metadata object to set keys on top of the shared metadata without copying it. If the metadata is not
+    // shared this is the metadata itself. Pending keys are seen by `getOpt` and `MetadataOverlay` views.
+    Metadata& modifyOverlay();
+
+    // Merges keys pending in the overlay into the metadata, copying it if it is shared
+    void mergeOverlay();
+
+    // Shared metadata without the keys pending in the overlay
+    const Metadata& base() const;
+    // Keys set with `modifyOverlay` that have not yet been merged, nullptr if there are none
+    const Metadata* overlay() const;
+
+    // Looks up a key through the overlay without merging it
+    template <typename T>
+    std::optional<T> getOpt(const typename Metadata::KeyType& k) const {
+        if (overlay_) {
+            if (auto val = overlay_->getOpt<T>(k); val) {
+                return val;
+            }
+        }
+        return metadata_->getOpt<T>(k);
+    }
+
     void acquire();
     SharedMetadata moveOrCopy() const;
 
@@ -52,6 +78,7 @@ public:
 
 private:
     std::shared_ptr<Metadata> metadata_;
+    std::shared_ptr<Metadata> overlay_;
     bool moveOrCopy_ = false;
 };
 
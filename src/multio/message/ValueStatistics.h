@@ -0,0 +1,73 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "multio/message/Glossary.h"
+#include "multio/message/Metadata.h"
+
+namespace multio::message {
+
+/**
+ * Minimum, maximum and number of missing values of a field, collected by actions while they produce the values (e.g.
+ * interpolations) such that consumers like the encoder do not need another pass over the field. Statistics of parts
+ * are merged in a fixed order to stay reproducible.
+ */
+struct ValueStatistics {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::size_t valid = 0;
+    std::size_t missing = 0;
+
+    void add(double value) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        ++valid;
+    }
+
+    void merge(const ValueStatistics& other) {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        valid += other.valid;
+        missing += other.missing;
+    }
+};
+
+/// Sets numberOfMissingValues, and minimumValue/maximumValue if there is at least one valid value
+inline void setValueStatistics(Metadata& md, const ValueStatistics& stats) {
+    md.set<std::int64_t>(glossary().numberOfMissingValues, static_cast<std::int64_t>(stats.missing));
+    if (stats.valid > 0) {
+        md.set(glossary().minimumValue, stats.min);
+        md.set(glossary().maximumValue, stats.max);
+    }
+    else {
+        md.erase(glossary().minimumValue);
+        md.erase(glossary().maximumValue);
+    }
+}
+
+/// To be called by actions changing the values of a field while keeping its metadata
+inline void eraseValueStatistics(Metadata& md) {
+    md.erase(glossary().minimumValue);
+    md.erase(glossary().maximumValue);
+    md.erase(glossary().numberOfMissingValues);
+}
+
+inline bool hasValueStatistics(const Metadata& md) {
+    return md.find(glossary().numberOfMissingValues) != md.end() || md.find(glossary().minimumValue) != md.end()
+        || md.find(glossary().maximumValue) != md.end();
+}
+
+}  // namespace multio::message
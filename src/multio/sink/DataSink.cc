@@ -18,6 +18,8 @@
 
 #include "eckit/exception/Exceptions.h"
 
+#include "metkit/codes/UserDataContent.h"
+
 #include "multio/LibMultio.h"
 
 namespace multio::sink {
@@ -93,6 +95,15 @@ bool DataSink::ready() const {
     return true;  // default for synchronous sinks
 }
 
+void DataSink::writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets) {
+    const auto* bytes = static_cast<const char*>(data);
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        const std::size_t end = (i + 1 < offsets.size()) ? offsets[i + 1] : length;
+        ASSERT(offsets[i] <= end && end <= length);
+        write(eckit::message::Message{new metkit::codes::UserDataContent(bytes + offsets[i], end - offsets[i])});
+    }
+}
+
 void DataSink::flush() {}
 
 void DataSink::setId(int id) {
@@ -38,6 +38,10 @@ public:  // methods
 
     virtual void write(eckit::message::Message message) = 0;
 
+    /// Writes a batch of encoded messages stored contiguously in memory, offsets holds the start of each message.
+    /// Sinks that can write a batch at once override this, by default each message is written separately.
+    virtual void writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets);
+
     /// No further writes to this sink
     virtual void flush();
 
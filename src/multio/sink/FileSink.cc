@@ -61,6 +61,12 @@ void FileSink::write(eckit::message::Message msg) {
     msg.write(*handle_);
 }
 
+void FileSink::writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>&) {
+    // The messages are stored contiguously, the whole batch is written at once
+    std::lock_guard<std::mutex> lock(mutex_);
+    handle_->write(data, length);
+}
+
 void FileSink::flush() {
     eckit::Log::info() << "Flushing ";
     print(eckit::Log::info());
@@ -23,6 +23,8 @@
 #include "eckit/utils/Translator.h"
 #include "eckit/value/Value.h"
 
+#include "metkit/codes/UserDataContent.h"
+
 
 #include <multio/LibMultio.h>
 #include <multio/util/Substitution.h>
@@ -99,6 +101,28 @@ void MultIO::write(eckit::message::Message message) {
     trigger_.events(message);
 }
 
+void MultIO::writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    {
+        StatsTimer stTimer{timer_, std::bind(&IOStats::logWrite, &stats_, length, _1)};
+        for (const auto& sink : sinks_) {
+            sink->writeBatch(data, length, offsets);
+        }
+    }
+
+    const auto* bytes = static_cast<const char*>(data);
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        const std::size_t end = (i + 1 < offsets.size()) ? offsets[i + 1] : length;
+        eckit::message::Message message{new metkit::codes::UserDataContent(bytes + offsets[i], end - offsets[i])};
+
+        LOG_DEBUG_LIB(LibMultio) << "Trigger events for message " << message << std::endl;
+
+        trigger_.events(message);
+    }
+}
+
 void MultIO::trigger(const eckit::StringDict& metadata) const {
     trigger_.events(metadata);
 }
@@ -45,6 +45,8 @@ public:
 
     void write(eckit::message::Message message) override;
 
+    void writeBatch(const void* data, std::size_t length, const std::vector<std::size_t>& offsets) override;
+
     void flush() override;
 
     void trigger(const eckit::StringDict& metadata) const;
@@ -0,0 +1,90 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+
+namespace multio::util {
+
+/// Recycles the payload buffers of messages. A buffer handed out by get() goes back to the pool once the last message
+/// (or copy of its shared_ptr) referring to it is gone, and is handed out again for a request of the same size. At
+/// most maxBuffers are kept, buffers released beyond that are freed. Buffers may outlive the pool.
+class BufferPool {
+public:
+    struct Counters {
+        std::size_t allocations = 0;
+        std::size_t bytesAllocated = 0;
+        std::size_t reuses = 0;
+    };
+
+    explicit BufferPool(std::size_t maxBuffers) : state_{std::make_shared<State>()} { state_->maxBuffers = maxBuffers; }
+
+    /// Buffer of exactly `size` bytes, its content is undefined
+    std::shared_ptr<eckit::Buffer> get(std::size_t size) {
+        std::unique_ptr<eckit::Buffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock{state_->mutex};
+            auto& free = state_->free;
+            for (auto it = free.begin(); it != free.end(); ++it) {
+                if ((*it)->size() == size) {
+                    buffer = std::move(*it);
+                    free.erase(it);
+                    ++state_->counters.reuses;
+                    break;
+                }
+            }
+            if (!buffer) {
+                ++state_->counters.allocations;
+                state_->counters.bytesAllocated += size;
+            }
+        }
+        if (!buffer) {
+            buffer = std::make_unique<eckit::Buffer>(size);
+        }
+
+        return std::shared_ptr<eckit::Buffer>(buffer.release(), [state = state_](eckit::Buffer* released) {
+            std::unique_ptr<eckit::Buffer> owned{released};
+            std::lock_guard<std::mutex> lock{state->mutex};
+            if (owned->size() > 0 && state->free.size() < state->maxBuffers) {
+                state->free.push_back(std::move(owned));
+            }
+        });
+    }
+
+    Counters counters() const {
+        std::lock_guard<std::mutex> lock{state_->mutex};
+        return state_->counters;
+    }
+
+    /// Number of buffers ready to be reused
+    std::size_t available() const {
+        std::lock_guard<std::mutex> lock{state_->mutex};
+        return state_->free.size();
+    }
+
+private:
+    // Shared with the deleters of the buffers handed out
+    struct State {
+        mutable std::mutex mutex;
+        std::size_t maxBuffers = 0;
+        std::vector<std::unique_ptr<eckit::Buffer>> free;
+        Counters counters;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+}  // namespace multio::util
@@ -0,0 +1,118 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace multio::util {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+constexpr std::uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl64(std::uint64_t x, int r) noexcept {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t read64(const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint32_t read32(const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t xxhRound(std::uint64_t acc, std::uint64_t input) noexcept {
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+inline std::uint64_t xxhMergeRound(std::uint64_t acc, std::uint64_t val) noexcept {
+    acc ^= xxhRound(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+}  // namespace detail
+
+// Fast non-cryptographic 64 bit hash of a memory block (XXH64, values as on little endian machines).
+// The main loop keeps four independent accumulators over 32 byte stripes, which the compiler can
+// interleave or vectorize. Used to detect repeated payloads, not for anything security related.
+inline std::uint64_t contentHash(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+    using namespace detail;
+
+    const auto* p = static_cast<const unsigned char*>(data);
+    const auto* const end = p + size;
+    std::uint64_t h;
+
+    if (size >= 32) {
+        const auto* const limit = end - 32;
+        std::uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        std::uint64_t v2 = seed + XXH_PRIME64_2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - XXH_PRIME64_1;
+        do {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMergeRound(h, v1);
+        h = xxhMergeRound(h, v2);
+        h = xxhMergeRound(h, v3);
+        h = xxhMergeRound(h, v4);
+    }
+    else {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += static_cast<std::uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<std::uint64_t>(read32(p)) * XXH_PRIME64_1;
+        h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace multio::util
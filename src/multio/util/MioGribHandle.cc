@@ -1,6 +1,11 @@
 #include "MioGribHandle.h"
 
+#include <algorithm>
 #include <iomanip>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "eckit/exception/Exceptions.h"
 #include "eckit/utils/MD5.h"
@@ -29,11 +34,73 @@ void codesCheckRelaxed(int ret, const char* name, const T& value) {
     }
     CODES_CHECK(ret, NULL);
 }
+
+// Conversion buffer for single precision values, reused by all handles of a thread to avoid an allocation per field.
+// It only grows, so it stays as large as the largest field encoded by the thread.
+const double* toDouble(const float* values, size_t count) {
+    thread_local std::vector<double> buffer;
+    if (buffer.size() < count) {
+        buffer.resize(count);
+    }
+    std::copy(values, values + count, buffer.begin());
+    return buffer.data();
+}
+
+// Packing types and keys for which ecCodes reported that it can not pack single precision values directly. Other
+// packing types of the same process may still support them, so the fallback is remembered for each one
+std::mutex floatUnsupportedMutex;
+std::set<std::string> floatUnsupported;
+
+std::string floatSupportKey(const std::string& packingType, const std::string& key) {
+    return packingType + ":" + key;
+}
+
+std::string packingType(codes_handle* hdl) {
+    char value[128] = {0};
+    size_t length = sizeof(value);
+    if (codes_get_string(hdl, "packingType", value, &length) != 0) {
+        return {};
+    }
+    return value;
+}
+
+// Passes single precision values to ecCodes without conversion. Returns false if ecCodes does not support it for this
+// key (older versions or packing types without a float implementation), the caller then converts to double precision
+bool trySetFloatArray(codes_handle* hdl, const char* key, const float* values, size_t count) {
+#if defined(ECCODES_VERSION) && ECCODES_VERSION >= 23000
+    const auto packing = packingType(hdl);
+    if (!MioGribHandle::floatValuesSupported(packing, key)) {
+        return false;
+    }
+    LOG_DEBUG_LIB(LibMultio) << "*** Setting " << count << " float values for key " << key << std::endl;
+    int ret = codes_set_float_array(hdl, key, values, count);
+    if (ret == CODES_NOT_IMPLEMENTED) {
+        LOG_DEBUG_LIB(LibMultio) << "*** Single precision values not supported for key " << key
+                                 << " with packing type " << packing << ", converting to double precision" << std::endl;
+        MioGribHandle::setFloatValuesUnsupported(packing, key);
+        return false;
+    }
+    codesCheckRelaxed(ret, key, "<float array ...>");
+    return true;
+#else
+    return false;
+#endif
+}
 }  // namespace
 
 
 MioGribHandle::MioGribHandle(codes_handle* hdl) : metkit::grib::GribHandle{hdl} {};
 
+bool MioGribHandle::floatValuesSupported(const std::string& packingType, const std::string& key) {
+    std::lock_guard<std::mutex> lock{floatUnsupportedMutex};
+    return floatUnsupported.find(floatSupportKey(packingType, key)) == floatUnsupported.end();
+}
+
+void MioGribHandle::setFloatValuesUnsupported(const std::string& packingType, const std::string& key) {
+    std::lock_guard<std::mutex> lock{floatUnsupportedMutex};
+    floatUnsupported.insert(floatSupportKey(packingType, key));
+}
+
 std::unique_ptr<MioGribHandle> MioGribHandle::duplicate() const {
     codes_handle* h = codes_handle_clone(raw());
     if (!h) {
@@ -91,6 +158,12 @@ void MioGribHandle::setValue(const char* key, bool value) {
     codesCheckRelaxed(codes_set_long(raw(), key, longValue), key, value);
 }
 
+long MioGribHandle::getLongValue(const char* key) const {
+    long value = 0;
+    codesCheckRelaxed(codes_get_long(raw(), key, &value), key, "<get>");
+    return value;
+}
+
 void MioGribHandle::setMissing(const char* key) {
     LOG_DEBUG_LIB(LibMultio) << "*** Setting missing for key " << key << std::endl;
     codesCheckRelaxed(codes_set_missing(raw(), key), key, "missing");
@@ -129,12 +202,11 @@ void MioGribHandle::setValue(const char* key, const std::vector<double>& values)
     codesCheckRelaxed(codes_set_double_array(raw(), key, values.data(), values.size()), key, "<double array ...>");
 }
 void MioGribHandle::setValue(const char* key, const std::vector<float>& values) {
-    std::vector<double> vec;
-    vec.reserve(values.size());
-    for (float f : values) {
-        vec.push_back(f);
+    if (trySetFloatArray(raw(), key, values.data(), values.size())) {
+        return;
     }
-    setValue(key, vec);
+    codesCheckRelaxed(codes_set_double_array(raw(), key, toDouble(values.data(), values.size()), values.size()), key,
+                      "<double array ...>");
 }
 
 namespace {
@@ -177,12 +249,15 @@ void MioGribHandle::setValue(const char* key, const std::vector<std::int8_t>& va
 
 // Set values
 void MioGribHandle::setDataValues(const float* data, size_t count) {
-    setDataValues(std::vector<double>{data, data + count});
+    if (trySetFloatArray(raw(), "values", data, count)) {
+        return;
+    }
+    setDataValues(toDouble(data, count), count);
     return;
 }
 
 void MioGribHandle::setDataValues(const std::vector<float>& data) {
-    setDataValues(std::vector<double>{data.begin(), data.end()});
+    setDataValues(data.data(), data.size());
     return;
 }
 
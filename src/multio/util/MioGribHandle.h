@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include "metkit/codes/GribHandle.h"
 
@@ -67,12 +68,19 @@ public:
     void setValue(const std::string& key, const std::vector<std::int16_t>& values) { setValue(key.c_str(), values); };
     void setValue(const std::string& key, const std::vector<std::int8_t>& values) { setValue(key.c_str(), values); };
 
+    long getLongValue(const char* key) const;
+
     void setMissing(const char* key);
     void setMissing(const std::string& key) { setMissing(key.c_str()); };
 
     // Set values
     void setDataValues(const float* data, size_t count);
 
+    // Single precision values are passed to ecCodes directly unless it reported that it does not implement them for
+    // the packing type and key, they are then converted to double precision
+    static bool floatValuesSupported(const std::string& packingType, const std::string& key);
+    static void setFloatValuesUnsupported(const std::string& packingType, const std::string& key);
+
     void setDataValues(const std::vector<double>& data);
     void setDataValues(const std::vector<float>& data);
 };
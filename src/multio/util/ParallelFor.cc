@@ -0,0 +1,97 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "ParallelFor.h"
+
+namespace multio::util {
+
+ParallelForPool& ParallelForPool::instance() {
+    static ParallelForPool pool;
+    return pool;
+}
+
+ParallelForPool::~ParallelForPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+    queued_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ParallelForPool::run(std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+
+    Group group;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (workers_.size() < tasks.size() - 1) {
+            addWorkers(tasks.size() - 1 - workers_.size());
+        }
+        group.pending = tasks.size() - 1;
+        for (std::size_t i = 1; i < tasks.size(); ++i) {
+            queue_.push_back(Task{&tasks[i], &group});
+        }
+    }
+    queued_.notify_all();
+
+    tasks[0]();
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (group.pending > 0) {
+        if (!queue_.empty()) {
+            auto task = queue_.front();
+            queue_.pop_front();
+            runTask(task, lock);
+        }
+        else {
+            finished_.wait(lock);
+        }
+    }
+}
+
+std::size_t ParallelForPool::workers() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return workers_.size();
+}
+
+void ParallelForPool::addWorkers(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        workers_.emplace_back([this]() { work(); });
+    }
+}
+
+void ParallelForPool::work() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        queued_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;
+        }
+        auto task = queue_.front();
+        queue_.pop_front();
+        runTask(task, lock);
+    }
+}
+
+void ParallelForPool::runTask(Task task, std::unique_lock<std::mutex>& lock) {
+    lock.unlock();
+    (*task.func)();
+    lock.lock();
+    if (--task.group->pending == 0) {
+        finished_.notify_all();
+    }
+}
+
+}  // namespace multio::util
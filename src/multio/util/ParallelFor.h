@@ -0,0 +1,104 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace multio::util {
+
+/// Number of chunks [0, size) is split into by parallelFor. Chunks are never smaller than minChunkSize
+/// (unless there is a single one), and the number of chunks only depends on the arguments, so results
+/// combined in chunk order are reproducible for a given configuration.
+inline std::size_t numChunks(std::size_t nThreads, std::size_t size, std::size_t minChunkSize) {
+    const std::size_t maxChunks = std::max<std::size_t>(1, size / std::max<std::size_t>(1, minChunkSize));
+    return std::max<std::size_t>(1, std::min(nThreads, maxChunks));
+}
+
+/// Process-wide worker threads running the chunks of parallelFor. Workers are started on first use and only added
+/// when a call needs more of them than exist, so repeated calls do not pay for thread creation.
+class ParallelForPool {
+public:
+    static ParallelForPool& instance();
+
+    /// Runs tasks[0] on the calling thread and the other tasks on the workers, returns when all of them are done.
+    /// While waiting, the calling thread runs queued tasks itself, so nested calls cannot deadlock. Tasks must not throw.
+    void run(std::vector<std::function<void()>>& tasks);
+
+    std::size_t workers() const;
+
+private:
+    struct Group {
+        std::size_t pending = 0;
+    };
+
+    struct Task {
+        std::function<void()>* func;
+        Group* group;
+    };
+
+    ParallelForPool() = default;
+    ~ParallelForPool();
+
+    void addWorkers(std::size_t count);
+    void work();
+    void runTask(Task task, std::unique_lock<std::mutex>& lock);
+
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable finished_;
+    std::deque<Task> queue_;
+    std::vector<std::thread> workers_;
+    bool stop_ = false;
+};
+
+/// Split [0, size) into nChunks contiguous ranges and call func(chunk, begin, end) on each range.
+/// The calling thread processes the first chunk, the others run on the workers of ParallelForPool. The first
+/// exception thrown by any chunk is rethrown once all of them are done.
+template <typename Func>
+void parallelFor(std::size_t nChunks, std::size_t size, Func&& func) {
+    nChunks = std::max<std::size_t>(1, std::min(nChunks, std::max<std::size_t>(1, size)));
+
+    if (nChunks == 1) {
+        func(std::size_t{0}, std::size_t{0}, size);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(nChunks);
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(nChunks);
+    for (std::size_t chunk = 0; chunk < nChunks; ++chunk) {
+        tasks.emplace_back([&, chunk]() {
+            try {
+                func(chunk, chunk * size / nChunks, (chunk + 1) * size / nChunks);
+            }
+            catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        });
+    }
+    ParallelForPool::instance().run(tasks);
+
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+}  // namespace multio::util
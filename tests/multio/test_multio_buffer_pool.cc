@@ -0,0 +1,151 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdint>
+#include <memory>
+
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/message/Glossary.h"
+#include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
+#include "multio/util/BufferPool.h"
+
+namespace multio::test {
+
+using multio::message::glossary;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+using multio::message::SharedPayload;
+using multio::message::ValueStatistics;
+using multio::util::BufferPool;
+
+namespace {
+
+constexpr std::size_t FIELD_SIZE = 12 * 64 * 64 * sizeof(double);
+
+Message makeField(BufferPool& pool) {
+    auto buffer = pool.get(FIELD_SIZE);
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, Metadata{}},
+                   SharedPayload{std::move(buffer)}};
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Buffers are reused once the messages are gone") {
+    BufferPool pool{4};
+
+    const void* data = nullptr;
+    {
+        auto msg = makeField(pool);
+        data = msg.payload().data();
+        EXPECT_EQUAL(pool.available(), 0);
+    }
+    EXPECT_EQUAL(pool.available(), 1);
+
+    // Fields streamed through one at a time only allocate once
+    constexpr std::size_t nFields = 100;
+    for (std::size_t i = 0; i < nFields; ++i) {
+        auto msg = makeField(pool);
+        EXPECT(msg.payload().data() == data);
+    }
+
+    const auto counters = pool.counters();
+    EXPECT_EQUAL(counters.allocations, 1);
+    EXPECT_EQUAL(counters.bytesAllocated, FIELD_SIZE);
+    EXPECT_EQUAL(counters.reuses, nFields);
+
+    eckit::Log::info() << "Payload bytes allocated per field: " << counters.bytesAllocated / (nFields + 1)
+                       << " (without pool: " << FIELD_SIZE << ")" << std::endl;
+}
+
+CASE("Buffers are only reused for the same size and up to the limit") {
+    BufferPool pool{2};
+    {
+        auto a = pool.get(16);
+        auto b = pool.get(16);
+        auto c = pool.get(16);
+    }
+    EXPECT_EQUAL(pool.available(), 2);
+
+    auto other = pool.get(32);
+    EXPECT_EQUAL(pool.counters().allocations, 4);
+    EXPECT_EQUAL(pool.counters().reuses, 0);
+
+    auto same = pool.get(16);
+    EXPECT_EQUAL(pool.counters().reuses, 1);
+    EXPECT_EQUAL(pool.available(), 1);
+}
+
+CASE("Buffers acquired by downstream actions still return to the pool") {
+    BufferPool pool{4};
+    {
+        auto msg = makeField(pool);
+        Message copy = msg;
+        // Shared payload, acquiring copies into an unpooled buffer
+        copy.acquire();
+        EXPECT(copy.payload().data() != msg.payload().data());
+
+        // Unique payload, acquiring moves the pooled buffer
+        Message moved = std::move(msg);
+        moved.acquire();
+    }
+    EXPECT_EQUAL(pool.available(), 1);
+    EXPECT_EQUAL(pool.counters().allocations, 1);
+}
+
+CASE("Buffers may outlive the pool") {
+    std::shared_ptr<eckit::Buffer> buffer;
+    {
+        BufferPool pool{4};
+        buffer = pool.get(FIELD_SIZE);
+    }
+    EXPECT_EQUAL(buffer->size(), FIELD_SIZE);
+    buffer.reset();
+}
+
+CASE("Value statistics are set and erased in the metadata") {
+    ValueStatistics stats;
+    ValueStatistics part;
+    part.add(2.0);
+    part.add(-1.0);
+    part.missing = 3;
+    stats.merge(part);
+    stats.add(5.0);
+
+    Metadata md;
+    message::setValueStatistics(md, stats);
+    EXPECT_EQUAL(md.get<double>(glossary().minimumValue), -1.0);
+    EXPECT_EQUAL(md.get<double>(glossary().maximumValue), 5.0);
+    EXPECT_EQUAL(md.get<std::int64_t>(glossary().numberOfMissingValues), 3);
+
+    // Fields of missing values only have no range
+    ValueStatistics allMissing;
+    allMissing.missing = 10;
+    message::setValueStatistics(md, allMissing);
+    EXPECT(!md.getOpt<double>(glossary().minimumValue));
+    EXPECT(!md.getOpt<double>(glossary().maximumValue));
+    EXPECT(message::hasValueStatistics(md));
+
+    message::eraseValueStatistics(md);
+    EXPECT(!message::hasValueStatistics(md));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,227 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/Action.h"
+#include "multio/action/coarsen/BlockReduction.h"
+#include "multio/action/coarsen/Coarsen.h"
+#include "multio/config/ComponentConfiguration.h"
+#include "multio/config/MultioConfiguration.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/Metadata.h"
+
+namespace multio::test {
+
+using multio::action::Action;
+using multio::action::ActionFactory;
+using multio::action::coarsen::Cells;
+using multio::action::coarsen::Layout;
+using multio::action::coarsen::Operation;
+using multio::action::coarsen::reduceCells;
+using multio::action::coarsen::reduceValues;
+using multio::action::coarsen::setGeometry;
+using multio::action::coarsen::writeCells;
+using multio::message::glossary;
+using multio::message::Message;
+using multio::message::Metadata;
+
+namespace {
+
+constexpr float MISSING = 9999.0;
+
+// Values 0, 1, 2, ... with every seventh point missing
+std::vector<float> testField(std::size_t size) {
+    std::vector<float> values(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        values[i] = i % 7 == 3 ? MISSING : static_cast<float>(i);
+    }
+    return values;
+}
+
+class Discard final : public Action {
+public:
+    explicit Discard(const config::ComponentConfiguration& compConf) : Action{compConf} {}
+
+private:
+    void executeImpl(Message) override {}
+
+    void print(std::ostream& os) const override { os << "Discard()"; }
+};
+
+action::ActionBuilder<Discard> DiscardBuilder("test-discard");
+
+std::unique_ptr<Action> makeAction(const eckit::LocalConfiguration& operation) {
+    static config::MultioConfiguration multioConf{};
+
+    eckit::LocalConfiguration next;
+    next.set("type", "test-discard");
+
+    eckit::LocalConfiguration conf = operation;
+    conf.set("type", "coarsen");
+    conf.set("levels", std::vector<long>{1});
+    conf.set("next", next);
+    return ActionFactory::instance().build("coarsen", config::ComponentConfiguration{conf, multioConf});
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Blocks of nested HEALPix pixels are reduced skipping missing values") {
+    const auto layout = Layout::healpixNested(2);
+    auto values = testField(layout.size());
+    // All children of pixel 5 of Nside 1 are missing
+    for (std::size_t i = 20; i < 24; ++i) {
+        values[i] = MISSING;
+    }
+
+    Cells cells;
+    reduceValues(values.data(), layout, 2, true, MISSING, cells);
+    EXPECT(cells.size() == 12);
+
+    // Pixel 0: 0, 1, 2 (3 is missing)
+    EXPECT(cells.count[0] == 3);
+    EXPECT(cells.sum[0] == 3.0);
+    EXPECT(cells.min[0] == 0.0);
+    EXPECT(cells.max[0] == 2.0);
+
+    std::vector<float> out(cells.size());
+    for (auto op : {Operation::Mean, Operation::Minimum, Operation::Maximum}) {
+        const auto stats = writeCells(cells, op, MISSING, out.data());
+        EXPECT(out[5] == MISSING);
+        EXPECT(stats.missing == 1);
+        EXPECT(stats.valid == 11);
+    }
+    EXPECT(writeCells(cells, Operation::Mean, MISSING, out.data()).min == 1.0);
+    EXPECT(out[0] == 1.0);
+    EXPECT(out[1] == 5.5);  // 4, 5, 6, 7
+}
+
+CASE("Coarser levels reduced from partial reductions match direct reductions") {
+    const auto layout = Layout::healpixNested(8);
+    const auto values = testField(layout.size());
+
+    Cells level1;
+    Cells level3;
+    Cells direct;
+    reduceValues(values.data(), layout, 2, true, MISSING, level1);
+    reduceCells(level1, layout.coarsen(2), 4, level3);
+    reduceValues(values.data(), layout, 8, true, MISSING, direct);
+
+    EXPECT(level3.size() == 12);
+    EXPECT(level3.count == direct.count);
+    EXPECT(level3.min == direct.min);
+    EXPECT(level3.max == direct.max);
+    for (std::size_t c = 0; c < direct.size(); ++c) {
+        EXPECT(std::abs(level3.sum[c] - direct.sum[c]) <= 1e-9 * std::abs(direct.sum[c]));
+    }
+}
+
+CASE("Blocks of regular grids are squares, incomplete blocks are dropped") {
+    // 5 x 3 points, row by row
+    const auto layout = Layout::regular(5, 3);
+    std::vector<double> values(layout.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<double>(i);
+    }
+
+    Cells cells;
+    reduceValues(values.data(), layout, 2, false, 0.0, cells);
+    EXPECT(layout.coarsen(2).ni == 2);
+    EXPECT(layout.coarsen(2).nj == 1);
+    EXPECT(cells.count == (std::vector<std::uint32_t>{4, 4}));
+    EXPECT(cells.sum == (std::vector<double>{0.0 + 1.0 + 5.0 + 6.0, 2.0 + 3.0 + 7.0 + 8.0}));
+    EXPECT(cells.min == (std::vector<double>{0.0, 2.0}));
+    EXPECT(cells.max == (std::vector<double>{6.0, 8.0}));
+}
+
+CASE("Threaded reductions give the same results") {
+    const auto layout = Layout::healpixNested(128);
+    const auto values = testField(layout.size());
+
+    Cells serial;
+    Cells threaded;
+    reduceValues(values.data(), layout, 2, true, MISSING, serial, 1);
+    reduceValues(values.data(), layout, 2, true, MISSING, threaded, 4);
+    EXPECT(serial.sum == threaded.sum);
+    EXPECT(serial.count == threaded.count);
+
+    std::vector<float> serialOut(serial.size());
+    std::vector<float> threadedOut(threaded.size());
+    const auto serialStats = writeCells(serial, Operation::Maximum, MISSING, serialOut.data(), 1);
+    const auto threadedStats = writeCells(threaded, Operation::Maximum, MISSING, threadedOut.data(), 4);
+    EXPECT(serialOut == threadedOut);
+    EXPECT(serialStats.max == threadedStats.max);
+    EXPECT(serialStats.missing == threadedStats.missing);
+}
+
+CASE("Coarse regular grids are described by the centres of the blocks") {
+    // 1 degree global grid, the last 3 columns and the last row do not fill a block of 4 x 4
+    Metadata md;
+    md.set(glossary().ni, std::int64_t{363});
+    md.set(glossary().nj, std::int64_t{181});
+    md.set(glossary().north, 90.0);
+    md.set(glossary().west, 0.0);
+    md.set(glossary().south, -90.0);
+    md.set(glossary().east, 362.0);
+    md.set(glossary().westEastIncrement, 1.0);
+    md.set(glossary().southNorthIncrement, 1.0);
+
+    setGeometry(md, Layout::regular(363, 181), 4);
+    EXPECT(md.get<std::int64_t>(glossary().ni) == 90);
+    EXPECT(md.get<std::int64_t>(glossary().nj) == 45);
+    EXPECT(md.get<double>(glossary().westEastIncrement) == 4.0);
+    EXPECT(md.get<double>(glossary().southNorthIncrement) == 4.0);
+    EXPECT(md.get<double>(glossary().north) == 88.5);
+    EXPECT(md.get<double>(glossary().west) == 1.5);
+    EXPECT(md.get<double>(glossary().south) == 88.5 - 44 * 4.0);
+    EXPECT(md.get<double>(glossary().east) == 1.5 + 89 * 4.0);
+}
+
+CASE("Coarse nested HEALPix grids have a lower Nside") {
+    Metadata md;
+    md.set(glossary().nside, std::int64_t{64});
+    setGeometry(md, Layout::healpixNested(64), 4);
+    EXPECT(md.get<std::int64_t>(glossary().nside) == 16);
+}
+
+CASE("Each coarsen action applies a single operation") {
+    eckit::LocalConfiguration conf;
+    EXPECT_NO_THROW(makeAction(conf));
+
+    conf.set("operation", "maximum");
+    EXPECT_NO_THROW(makeAction(conf));
+
+    conf.set("operation", "median");
+    EXPECT_THROWS_AS(makeAction(conf), eckit::UserError);
+
+    // Fields of several operations could not be told apart once encoded
+    eckit::LocalConfiguration several;
+    several.set("operations", std::vector<std::string>{"mean", "maximum"});
+    EXPECT_THROWS_AS(makeAction(several), eckit::UserError);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,235 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/TmpFile.h"
+#include "eckit/io/StdFile.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/action/Action.h"
+#include "multio/config/ComponentConfiguration.h"
+#include "multio/config/MultioConfiguration.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/Message.h"
+
+namespace multio::test {
+
+using multio::action::Action;
+using multio::action::ActionFactory;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+
+namespace {
+
+// Last action of the test plans, keeps everything it receives
+std::vector<Message> captured;
+
+class Capture final : public Action {
+public:
+    explicit Capture(const config::ComponentConfiguration& compConf) : Action{compConf} {}
+
+private:
+    void executeImpl(Message msg) override { captured.push_back(std::move(msg)); }
+
+    void print(std::ostream& os) const override { os << "Capture()"; }
+};
+
+action::ActionBuilder<Capture> CaptureBuilder("test-capture");
+
+config::MultioConfiguration& multioConfig() {
+    static config::MultioConfiguration multioConf{};
+    return multioConf;
+}
+
+// The encode action reads its template from a file, the GRIB2 sample is written to one
+struct GribTemplate {
+    GribTemplate() {
+        codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+        EXPECT(sample != nullptr);
+        codes_get_size(sample, "values", &size);
+
+        const void* message = nullptr;
+        std::size_t length = 0;
+        codes_get_message(sample, &message, &length);
+        eckit::AutoStdFile out{path, "w"};
+        EXPECT_EQUAL(std::fwrite(message, 1, length, out), length);
+        codes_handle_delete(sample);
+    }
+
+    eckit::TmpFile path;
+    std::size_t size = 0;
+};
+
+const GribTemplate& gribTemplate() {
+    static const GribTemplate tmpl;
+    return tmpl;
+}
+
+std::unique_ptr<Action> makeEncode(long batchSize, long batchBytes) {
+    eckit::LocalConfiguration next;
+    next.set("type", "test-capture");
+
+    eckit::LocalConfiguration conf;
+    conf.set("type", "encode");
+    conf.set("format", "grib");
+    conf.set("template", gribTemplate().path.asString());
+    conf.set("batch-size", batchSize);
+    conf.set("batch-bytes", batchBytes);
+    conf.set("next", next);
+
+    captured.clear();
+    return ActionFactory::instance().build("encode", config::ComponentConfiguration{conf, multioConfig()});
+}
+
+Message makeField(std::int64_t step) {
+    const auto size = gribTemplate().size;
+
+    Metadata md;
+    md.set("paramId", std::int64_t{130});
+    md.set("typeOfLevel", std::string{"isobaricInhPa"});
+    md.set("level", std::int64_t{500});
+    md.set("levtype", std::string{"pl"});
+    md.set("startDate", std::int64_t{20240101});
+    md.set("startTime", std::int64_t{0});
+    md.set("step", step);
+    md.set("type", std::string{"fc"});
+    md.set("class", std::string{"od"});
+    md.set("stream", std::string{"oper"});
+    md.set("expver", std::string{"0001"});
+    md.set("globalSize", static_cast<std::int64_t>(size));
+    md.set("precision", std::string{"double"});
+
+    eckit::Buffer payload{size * sizeof(double)};
+    auto* values = static_cast<double*>(payload.data());
+    for (std::size_t i = 0; i < size; ++i) {
+        values[i] = 273.15 + 0.5 * static_cast<double>(i % 37) + static_cast<double>(step);
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+Message makeFlush() {
+    return Message{Message::Header{Message::Tag::Flush, Peer{"test", 0}, Peer{"test", 1}}};
+}
+
+// The GRIB message the action forwards for a field when batching is off, leaves the captured messages untouched
+Message encodeAlone(std::int64_t step) {
+    std::vector<Message> saved;
+    std::swap(saved, captured);
+
+    auto encode = makeEncode(1, 1L << 30);
+    encode->execute(makeField(step));
+    EXPECT_EQUAL(captured.size(), 1);
+    auto encoded = std::move(captured.front());
+
+    std::swap(saved, captured);
+    return encoded;
+}
+
+// Checks that a batch holds the GRIB messages of the given fields, in order, at the stored offsets
+void checkBatch(const Message& batch, const std::vector<std::int64_t>& steps) {
+    EXPECT(batch.tag() == Message::Tag::Field);
+    const auto offsets = batch.metadata().get<std::vector<std::int64_t>>(message::glossary().batchOffsets);
+    EXPECT_EQUAL(offsets.size(), steps.size());
+
+    const auto* data = static_cast<const char*>(batch.payload().data());
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        const auto encoded = encodeAlone(steps[i]);
+        EXPECT_EQUAL(offsets[i], static_cast<std::int64_t>(offset));
+        EXPECT(offset + encoded.size() <= batch.size());
+        EXPECT(std::memcmp(data + offset, "GRIB", 4) == 0);
+        EXPECT(std::memcmp(data + offset, encoded.payload().data(), encoded.size()) == 0);
+        offset += encoded.size();
+    }
+    EXPECT_EQUAL(offset, batch.size());
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Batches are forwarded when batch-size is reached and on flush") {
+    auto encode = makeEncode(3, 1L << 30);
+    for (std::int64_t step = 1; step <= 7; ++step) {
+        encode->execute(makeField(step));
+        EXPECT_EQUAL(captured.size(), static_cast<std::size_t>(step / 3));
+    }
+
+    encode->execute(makeFlush());
+    EXPECT_EQUAL(captured.size(), 4);
+    checkBatch(captured[0], {1, 2, 3});
+    checkBatch(captured[1], {4, 5, 6});
+    checkBatch(captured[2], {7});
+    EXPECT(captured[3].tag() == Message::Tag::Flush);
+
+    // Nothing is pending after a flush
+    encode->execute(makeFlush());
+    EXPECT_EQUAL(captured.size(), 5);
+    EXPECT(captured[4].tag() == Message::Tag::Flush);
+}
+
+CASE("Batches are forwarded when batch-bytes is reached") {
+    const auto messageSize = static_cast<long>(encodeAlone(1).size());
+
+    // The third message reaches the limit
+    auto encode = makeEncode(100, 2 * messageSize + 1);
+    for (std::int64_t step = 1; step <= 5; ++step) {
+        encode->execute(makeField(step));
+    }
+    EXPECT_EQUAL(captured.size(), 1);
+    checkBatch(captured[0], {1, 2, 3});
+
+    encode->execute(makeFlush());
+    EXPECT_EQUAL(captured.size(), 3);
+    checkBatch(captured[1], {4, 5});
+}
+
+CASE("Pending batches are forwarded when the action is destroyed") {
+    auto encode = makeEncode(10, 1L << 30);
+    encode->execute(makeField(1));
+    encode->execute(makeField(2));
+    EXPECT(captured.empty());
+
+    encode.reset();
+    EXPECT_EQUAL(captured.size(), 1);
+    checkBatch(captured[0], {1, 2});
+}
+
+CASE("Without batching every message is forwarded on its own") {
+    auto encode = makeEncode(1, 1L << 30);
+    encode->execute(makeField(1));
+    encode->execute(makeField(2));
+    EXPECT_EQUAL(captured.size(), 2);
+    for (std::size_t i = 0; i < captured.size(); ++i) {
+        const auto encoded = encodeAlone(static_cast<std::int64_t>(i + 1));
+        EXPECT(captured[i].metadata().find(message::glossary().batchOffsets) == captured[i].metadata().end());
+        EXPECT_EQUAL(captured[i].size(), encoded.size());
+        EXPECT(std::memcmp(captured[i].payload().data(), encoded.payload().data(), encoded.size()) == 0);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -8,10 +8,16 @@
  * does it submit to any jurisdiction.
  */
 
+#include <cmath>
 #include <fstream>
+#include <limits>
+#include <vector>
+
+#include "eccodes.h"
 
 #include "eckit/filesystem/TmpFile.h"
 #include "eckit/io/DataHandle.h"
+#include "eckit/log/Log.h"
 #include "eckit/testing/Test.h"
 
 #include "multio/ifsio/EncodeBitsPerValue.h"
@@ -29,6 +35,10 @@ std::string create_table() {
                 "precipitation": {
                     "decimalScaleFactor": 1,
                     "paramIDs": [128144]
+                },
+                "adaptive": {
+                    "absoluteError": 0.01,
+                    "paramIDs": [128167]
                 }
             },
             "pl": {
@@ -45,6 +55,10 @@ std::string create_table() {
                 "precipitation": {
                     "bitsPerValue": 8,
                     "paramIDs": [124]
+                },
+                "adaptive": {
+                    "relativeError": 0.001,
+                    "paramIDs": [133]
                 }
             }
           }
@@ -261,6 +275,124 @@ CASE("Encode") {
     }
 }
 
+CASE("adaptive bitspervalue") {
+
+    TestHarness test;
+
+    int bpv = 0;
+    int paramid = 0;
+
+    SECTION("from table, paramid = 128167 with absoluteError") {
+        std::string levtype = "sfc";
+        paramid = 128167;
+        double min = 200.;
+        double max = 300.;
+        // Binary scale factor at most -6 (error 2^-7 < 0.01), 100 / 2^-6 = 6400 steps need 13 bits
+        EXPECT(imultio_encode_bitspervalue_(&bpv, &paramid, levtype.c_str(), &min, &max, levtype.size()) == 0);
+        EXPECT_EQUAL(bpv, 13);
+
+        // Same error target, the bits follow the range of each field
+        max = 201.;
+        EXPECT(imultio_encode_bitspervalue_(&bpv, &paramid, levtype.c_str(), &min, &max, levtype.size()) == 0);
+        EXPECT_EQUAL(bpv, 7);
+    }
+
+    SECTION("from table, paramid = 133 with relativeError") {
+        std::string levtype = "ML";
+        paramid = 133;
+        double min = 0.;
+        double max = 0.02;
+        // Error 2e-5, binary scale factor at most -15, 0.02 / 2^-15 = 655.36 steps need 10 bits
+        EXPECT(imultio_encode_bitspervalue_(&bpv, &paramid, levtype.c_str(), &min, &max, levtype.size()) == 0);
+        EXPECT_EQUAL(bpv, 10);
+    }
+
+    SECTION("constant fields") {
+        std::string levtype = "sfc";
+        paramid = 128167;
+        double min = 5.;
+        double max = 5.;
+        EXPECT(imultio_encode_bitspervalue_(&bpv, &paramid, levtype.c_str(), &min, &max, levtype.size()) == 0);
+        EXPECT_EQUAL(bpv, multio::Encoding::minAdaptiveBitsPerValue());
+    }
+}
+
+namespace {
+
+// Packs the values with ecCodes (grid_simple, no decimal scaling) and returns the largest decoding error
+double packingError(const std::vector<double>& values, int bitsPerValue) {
+    codes_handle* h = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(h != nullptr);
+
+    size_t size = 0;
+    codes_get_size(h, "values", &size);
+    EXPECT(size >= values.size());
+    std::vector<double> field(size);
+    for (size_t i = 0; i < size; ++i) {
+        field[i] = values[i % values.size()];
+    }
+
+    EXPECT(codes_set_long(h, "decimalScaleFactor", 0) == 0);
+    EXPECT(codes_set_long(h, "bitsPerValue", bitsPerValue) == 0);
+    EXPECT(codes_set_double_array(h, "values", field.data(), size) == 0);
+
+    std::vector<double> decoded(size);
+    EXPECT(codes_get_double_array(h, "values", decoded.data(), &size) == 0);
+    codes_handle_delete(h);
+
+    double maxError = 0;
+    for (size_t i = 0; i < size; ++i) {
+        maxError = std::max(maxError, std::abs(decoded[i] - field[i]));
+    }
+    return maxError;
+}
+
+}  // namespace
+
+CASE("adaptive bitspervalue meets the error target") {
+
+    struct Field {
+        double min;
+        double max;
+        double absoluteError;
+    };
+
+    const std::vector<Field> fields{{200., 300., 0.01},     {-1.e-3, 2.e-3, 1.e-7}, {0., 1., 0.5},
+                                    {101325., 103000., 0.8}, {-40.3, 51.7, 0.05},    {1.e-9, 3.e-9, 1.e-12}};
+
+    for (const auto& f : fields) {
+        const int bpv = multio::Encoding::adaptiveBitsPerValue(f.min, f.max, f.absoluteError);
+
+        std::vector<double> values;
+        const int n = 400;
+        for (int i = 0; i < n; ++i) {
+            // Covers both ends of the range and values in between that are not multiples of the quantization step
+            values.push_back(f.min + (f.max - f.min) * std::fmod(i * 0.618033988749895, 1.0));
+        }
+        values.front() = f.min;
+        values.back() = f.max;
+
+        const double error = packingError(values, bpv);
+        eckit::Log::info() << "Adaptive bitsPerValue: range [" << f.min << ", " << f.max << "], target "
+                           << f.absoluteError << " -> " << bpv << " bits, error " << error << std::endl;
+
+        EXPECT(bpv >= multio::Encoding::minAdaptiveBitsPerValue());
+        EXPECT(bpv <= multio::Encoding::maxAdaptiveBitsPerValue());
+        EXPECT(error <= f.absoluteError);
+
+        // One bit less no longer guarantees the target, i.e. the chosen number of bits is minimal
+        if (bpv > multio::Encoding::minAdaptiveBitsPerValue()) {
+            float reference = static_cast<float>(f.min);
+            if (reference > f.min) {
+                reference = std::nextafter(reference, -std::numeric_limits<float>::infinity());
+            }
+            int exponent = 0;
+            std::frexp(2 * f.absoluteError, &exponent);
+            EXPECT(std::ldexp(std::ldexp(1., bpv - 1) - 1, exponent - 1) < f.max - reference);
+        }
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace multio::test
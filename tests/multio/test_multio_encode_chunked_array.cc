@@ -0,0 +1,195 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/compression/Compressor.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/encode/ChunkedArray.h"
+#include "multio/message/Message.h"
+
+namespace multio::test {
+
+using multio::action::ChunkedArrayEncoder;
+using multio::action::ChunkedArrayOptions;
+using multio::action::ChunkedArrayReader;
+using multio::action::ChunkedArrayRecord;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::MetadataOverlay;
+using multio::message::Peer;
+
+namespace {
+
+template <typename T>
+Message makeField(std::int64_t paramId, std::size_t size) {
+    Metadata md;
+    md.set("paramId", paramId);
+    md.set("level", std::int64_t{1});
+    md.set("step", std::int64_t{6});
+    md.set("globalSize", static_cast<std::int64_t>(size));
+    md.set("precision", std::string{sizeof(T) == 4 ? "single" : "double"});
+    md.set("notIndexed", std::string{"x"});
+
+    eckit::Buffer payload{size * sizeof(T)};
+    auto* values = static_cast<T*>(payload.data());
+    for (std::size_t i = 0; i < size; ++i) {
+        values[i] = static_cast<T>(273.15 + 0.25 * static_cast<double>(i % 113) + static_cast<double>(paramId));
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+// Encodes a float and a double field, concatenates the records as a file sink would and reads them back
+void roundTrip(const ChunkedArrayOptions& options) {
+    const ChunkedArrayEncoder encoder{options};
+
+    const std::size_t size = 1000;
+    const std::vector<Message> fields{makeField<float>(130, size), makeField<double>(167, size)};
+
+    std::vector<char> file;
+    for (const auto& field : fields) {
+        const auto encoded = encoder.encodeField(field, MetadataOverlay{field.metadata()});
+        const auto* data = static_cast<const char*>(encoded.payload().data());
+        file.insert(file.end(), data, data + encoded.size());
+    }
+
+    ChunkedArrayReader reader{file.data(), file.size()};
+    for (const auto& field : fields) {
+        ChunkedArrayRecord record;
+        EXPECT(reader.next(record));
+        EXPECT_EQUAL(record.count, size);
+        EXPECT_EQUAL(record.dtype, std::string{field.payload().size() == size * 4 ? "float32" : "float64"});
+        EXPECT_EQUAL(record.values.size(), field.payload().size());
+        EXPECT(std::memcmp(record.values.data(), field.payload().data(), field.payload().size()) == 0);
+
+        EXPECT_EQUAL(record.metadata.get<std::int64_t>("paramId"), field.metadata().get<std::int64_t>("paramId"));
+        EXPECT_EQUAL(record.metadata.get<std::int64_t>("step"), 6);
+        EXPECT(record.metadata.find("notIndexed") == record.metadata.end());
+    }
+
+    ChunkedArrayRecord record;
+    EXPECT(!reader.next(record));
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Byte shuffle is reversible") {
+    std::vector<double> values{1.0, -2.5, 3.25, 1e300, 0.0, 42.0, -1e-300};
+    std::vector<double> shuffled(values.size());
+    std::vector<double> restored(values.size());
+
+    action::shuffleBytes(values.data(), shuffled.data(), values.size(), sizeof(double));
+    action::unshuffleBytes(shuffled.data(), restored.data(), values.size(), sizeof(double));
+
+    EXPECT(std::memcmp(values.data(), restored.data(), values.size() * sizeof(double)) == 0);
+
+    // The most significant bytes of all values end up together
+    const auto* bytes = reinterpret_cast<const unsigned char*>(shuffled.data());
+    EXPECT_EQUAL(bytes[7 * values.size()], reinterpret_cast<const unsigned char*>(values.data())[7]);
+}
+
+CASE("Uncompressed records spanning several chunks are read back exactly") {
+    ChunkedArrayOptions options;
+    options.chunkSize = 128;
+    options.threads = 3;
+    options.indexKeys = {"paramId", "level", "step"};
+    roundTrip(options);
+
+    options.shuffle = false;
+    roundTrip(options);
+}
+
+CASE("Compressed records are read back exactly") {
+    for (const std::string compression : {"lz4", "snappy", "aec"}) {
+        if (!eckit::CompressorFactory::instance().has(compression)) {
+            continue;
+        }
+        ChunkedArrayOptions options;
+        options.chunkSize = 300;
+        options.threads = 2;
+        options.compression = compression;
+        options.indexKeys = {"paramId", "level", "step"};
+        roundTrip(options);
+    }
+}
+
+CASE("Options are read from the encode configuration") {
+    eckit::LocalConfiguration conf;
+    conf.set("chunk-size", 64);
+    conf.set("shuffle", false);
+    conf.set("compression", "none");
+
+    const auto options = ChunkedArrayOptions::fromConfig(conf);
+    EXPECT_EQUAL(options.chunkSize, 64);
+    EXPECT(!options.shuffle);
+    EXPECT(!options.indexKeys.empty());
+
+    const auto& keys = options.indexKeys;
+    EXPECT(std::find(keys.begin(), keys.end(), "missingValue") != keys.end());
+    EXPECT(std::find(keys.begin(), keys.end(), "bitmapPresent") != keys.end());
+
+    conf.set("batch-size", 8);
+    EXPECT_THROWS_AS(ChunkedArrayOptions::fromConfig(conf), eckit::UserError);
+    conf.set("batch-size", 1);
+
+    conf.set("compression", "no-such-compressor");
+    EXPECT_THROWS_AS(ChunkedArrayOptions::fromConfig(conf), eckit::UserError);
+}
+
+CASE("Records written on hosts of the other byte order are swapped") {
+    const std::uint16_t probe = 1;
+    const bool littleEndian = reinterpret_cast<const unsigned char*>(&probe)[0] == 1;
+
+    const std::vector<double> values{1.0, -2.5, 273.15, 1e300};
+    std::vector<unsigned char> swapped(values.size() * sizeof(double));
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(&values[i]);
+        std::reverse_copy(bytes, bytes + sizeof(double), swapped.begin() + i * sizeof(double));
+    }
+
+    const std::string byteOrder = littleEndian ? "big" : "little";
+    const std::string index = "{\"dtype\":\"float64\",\"byte-order\":\"" + byteOrder
+                            + "\",\"count\":4,\"chunk-size\":4,\"shuffle\":false,\"compression\":\"none\","
+                            + "\"chunk-sizes\":[32],\"metadata\":{}}";
+
+    // Magic, version 2 and index length (little-endian), index and a single chunk
+    std::vector<unsigned char> file{'M', 'I', 'O', 'C', 'H', 'U', 'N', 'K', 2, 0, 0, 0};
+    for (std::size_t i = 0; i < 4; ++i) {
+        file.push_back(static_cast<unsigned char>((index.size() >> (8 * i)) & 0xff));
+    }
+    file.insert(file.end(), index.begin(), index.end());
+    file.insert(file.end(), swapped.begin(), swapped.end());
+
+    ChunkedArrayReader reader{file.data(), file.size()};
+    ChunkedArrayRecord record;
+    EXPECT(reader.next(record));
+    EXPECT_EQUAL(record.count, values.size());
+    EXPECT(std::memcmp(record.values.data(), values.data(), values.size() * sizeof(double)) == 0);
+    EXPECT(!reader.next(record));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
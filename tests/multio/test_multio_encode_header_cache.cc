@@ -0,0 +1,181 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/action/encode/GribEncoder.h"
+#include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
+
+namespace multio::test {
+
+using multio::action::GribEncoder;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+using multio::message::ValueStatistics;
+
+namespace {
+
+constexpr std::int64_t NPARAMS = 10;
+constexpr std::int64_t NLEVELS = 10;
+constexpr std::int64_t NSTEPS = 100;
+
+const std::int64_t paramIds[NPARAMS] = {129, 130, 131, 132, 133, 135, 138, 155, 157, 203};
+
+std::unique_ptr<GribEncoder> makeEncoder(long headerCacheSize) {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    eckit::LocalConfiguration config;
+    config.set("header-cache-size", headerCacheSize);
+    return std::make_unique<GribEncoder>(sample, config);
+}
+
+std::int64_t sampleSize() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    size_t size = 0;
+    codes_get_size(sample, "values", &size);
+    codes_handle_delete(sample);
+    return static_cast<std::int64_t>(size);
+}
+
+Message makeField(std::int64_t paramId, std::int64_t level, std::int64_t step, std::int64_t size,
+                  bool withStatistics = false) {
+    Metadata md;
+    md.set("paramId", paramId);
+    md.set("typeOfLevel", std::string{"isobaricInhPa"});
+    md.set("level", level);
+    md.set("levtype", std::string{"pl"});
+    md.set("startDate", std::int64_t{20240101});
+    md.set("startTime", std::int64_t{0});
+    md.set("step", step);
+    md.set("type", std::string{"fc"});
+    md.set("class", std::string{"od"});
+    md.set("stream", std::string{"oper"});
+    md.set("expver", std::string{"0001"});
+    md.set("globalSize", size);
+    md.set("precision", std::string{"double"});
+
+    eckit::Buffer payload{size * sizeof(double)};
+    auto* values = static_cast<double*>(payload.data());
+    for (std::int64_t i = 0; i < size; ++i) {
+        values[i] = static_cast<double>(paramId + level) + 0.01 * static_cast<double>((i + step) % 100);
+    }
+
+    // As attached by an interpolation, the range of the values changes with every step
+    if (withStatistics) {
+        ValueStatistics stats;
+        for (std::int64_t i = 0; i < size; ++i) {
+            values[i] += 0.5 * static_cast<double>(step);
+            stats.add(values[i]);
+        }
+        message::setValueStatistics(md, stats);
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+// Encodes all fields in step-major order (as produced by a model) and returns the encoded messages
+std::vector<Message> encodeAll(GribEncoder& encoder, double& seconds) {
+    const auto size = sampleSize();
+    std::vector<Message> encoded;
+    encoded.reserve(NPARAMS * NLEVELS * NSTEPS);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::int64_t step = 0; step < NSTEPS; ++step) {
+        for (std::int64_t level = 1; level <= NLEVELS; ++level) {
+            for (const auto paramId : paramIds) {
+                encoded.push_back(encoder.encodeField(makeField(paramId, level * 100, step, size), {}, {}));
+            }
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return encoded;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Cached headers encode identical messages") {
+    auto uncached = makeEncoder(0);
+    auto cached = makeEncoder(1024);
+
+    double uncachedSeconds = 0;
+    double cachedSeconds = 0;
+    const auto reference = encodeAll(*uncached, uncachedSeconds);
+    const auto result = encodeAll(*cached, cachedSeconds);
+
+    EXPECT_EQUAL(reference.size(), result.size());
+    for (std::size_t i = 0; i < reference.size(); ++i) {
+        EXPECT_EQUAL(reference[i].size(), result[i].size());
+        EXPECT(std::memcmp(reference[i].payload().data(), result[i].payload().data(), reference[i].size()) == 0);
+    }
+
+    // Only the first step needs to prepare a header for each param and level
+    EXPECT_EQUAL(uncached->headerCacheHits() + uncached->headerCacheMisses(), 0);
+    EXPECT_EQUAL(cached->headerCacheMisses(), NPARAMS * NLEVELS);
+    EXPECT_EQUAL(cached->headerCacheHits(), NPARAMS * NLEVELS * (NSTEPS - 1));
+
+    eckit::Log::info() << "Encoded " << reference.size() << " fields :: without header cache " << uncachedSeconds
+                       << "s, with header cache " << cachedSeconds << "s (hit rate "
+                       << 100.0 * cached->headerCacheHits() / (cached->headerCacheHits() + cached->headerCacheMisses())
+                       << "%)" << std::endl;
+}
+
+CASE("Fields differing only in their value statistics share a cached header") {
+    auto uncached = makeEncoder(0);
+    auto cached = makeEncoder(1024);
+    const auto size = sampleSize();
+
+    for (std::int64_t step = 0; step < 5; ++step) {
+        for (const auto paramId : paramIds) {
+            const auto reference = uncached->encodeField(makeField(paramId, 500, step, size, true), {}, {});
+            const auto result = cached->encodeField(makeField(paramId, 500, step, size, true), {}, {});
+            EXPECT_EQUAL(reference.size(), result.size());
+            EXPECT(std::memcmp(reference.payload().data(), result.payload().data(), reference.size()) == 0);
+        }
+    }
+
+    EXPECT_EQUAL(cached->headerCacheMisses(), NPARAMS);
+    EXPECT_EQUAL(cached->headerCacheHits(), 4 * NPARAMS);
+}
+
+CASE("A full header cache is dropped and rebuilt") {
+    auto cached = makeEncoder(4);
+    const auto size = sampleSize();
+
+    for (std::int64_t step = 0; step < 3; ++step) {
+        for (const auto paramId : paramIds) {
+            cached->encodeField(makeField(paramId, 500, step, size), {}, {});
+        }
+    }
+
+    // More shapes than entries, every field misses
+    EXPECT_EQUAL(cached->headerCacheHits(), 0);
+    EXPECT_EQUAL(cached->headerCacheMisses(), 3 * NPARAMS);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
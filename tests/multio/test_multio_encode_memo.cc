@@ -0,0 +1,140 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/action/encode/GribEncoder.h"
+#include "multio/message/Message.h"
+#include "multio/util/ContentHash.h"
+
+namespace multio::test {
+
+using multio::action::GribEncoder;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+
+namespace {
+
+std::unique_ptr<GribEncoder> makeEncoder(std::int64_t memoSize) {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    eckit::LocalConfiguration config;
+    config.set("memo-size", memoSize);
+    return std::make_unique<GribEncoder>(sample, config);
+}
+
+std::int64_t sampleSize() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    size_t size = 0;
+    codes_get_size(sample, "values", &size);
+    codes_handle_delete(sample);
+    return static_cast<std::int64_t>(size);
+}
+
+// Orography-like constant field, optionally perturbed to emulate a field that changes between steps
+Message makeField(std::int64_t paramId, std::int64_t step, std::int64_t size, double offset = 0.0) {
+    Metadata md;
+    md.set("paramId", paramId);
+    md.set("typeOfLevel", std::string{"surface"});
+    md.set("levtype", std::string{"sfc"});
+    md.set("startDate", std::int64_t{20240101});
+    md.set("startTime", std::int64_t{0});
+    md.set("step", step);
+    md.set("type", std::string{"fc"});
+    md.set("class", std::string{"od"});
+    md.set("stream", std::string{"oper"});
+    md.set("expver", std::string{"0001"});
+    md.set("globalSize", size);
+    md.set("precision", std::string{"double"});
+
+    eckit::Buffer payload{size * sizeof(double)};
+    auto* values = static_cast<double*>(payload.data());
+    for (std::int64_t i = 0; i < size; ++i) {
+        values[i] = 100.0 + 0.5 * static_cast<double>(i % 997) + offset;
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+bool equal(const Message& lhs, const Message& rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.payload().data(), rhs.payload().data(), lhs.size()) == 0;
+}
+
+std::string hex(std::uint64_t value) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+    return buf;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Content hash matches the XXH64 reference values") {
+    const std::string abc = "abc";
+    const std::string sentence = "Nobody inspects the spammish repetition";
+
+    EXPECT_EQUAL(hex(util::contentHash(nullptr, 0)), "ef46db3751d8e999");
+    EXPECT_EQUAL(hex(util::contentHash(abc.data(), abc.size())), "44bc2cf5ad770999");
+    EXPECT_EQUAL(hex(util::contentHash(sentence.data(), sentence.size())), "fbcea83c8a378bf1");
+}
+
+CASE("Memoized constant fields are identical to fully encoded ones") {
+    const auto size = sampleSize();
+    auto reference = makeEncoder(0);
+    auto memoized = makeEncoder(16);
+
+    for (std::int64_t step = 0; step < 24; step += 6) {
+        const auto expected = reference->encodeField(makeField(129, step, size), {}, {});
+        const auto result = memoized->encodeField(makeField(129, step, size), {}, {});
+        EXPECT(equal(expected, result));
+    }
+
+    EXPECT_EQUAL(memoized->memoMisses(), 1);
+    EXPECT_EQUAL(memoized->memoHits(), 3);
+    EXPECT_EQUAL(reference->memoHits(), 0);
+}
+
+CASE("Changed values or headers are encoded again") {
+    const auto size = sampleSize();
+    auto reference = makeEncoder(0);
+    auto memoized = makeEncoder(16);
+
+    const std::vector<std::pair<std::int64_t, double>> fields{{129, 0.0}, {129, 1.0}, {172, 1.0}, {172, 1.0}};
+    std::int64_t step = 0;
+    for (const auto& [paramId, offset] : fields) {
+        const auto expected = reference->encodeField(makeField(paramId, step, size, offset), {}, {});
+        const auto result = memoized->encodeField(makeField(paramId, step, size, offset), {}, {});
+        EXPECT(equal(expected, result));
+        step += 1;
+    }
+
+    // Only the last field repeats the payload of a field with the same header
+    EXPECT_EQUAL(memoized->memoMisses(), 3);
+    EXPECT_EQUAL(memoized->memoHits(), 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
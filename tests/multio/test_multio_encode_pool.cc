@@ -0,0 +1,204 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/action/encode/EncoderPool.h"
+#include "multio/action/encode/GribEncoder.h"
+#include "multio/message/Message.h"
+
+namespace multio::test {
+
+using multio::action::EncoderPool;
+using multio::action::GribEncoder;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+
+namespace {
+
+constexpr std::int64_t NFIELDS = 200;
+
+std::unique_ptr<GribEncoder> makeEncoder() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    return std::make_unique<GribEncoder>(sample, eckit::LocalConfiguration{});
+}
+
+std::vector<std::unique_ptr<GribEncoder>> makeEncoders(std::size_t count) {
+    std::vector<std::unique_ptr<GribEncoder>> encoders;
+    for (std::size_t i = 0; i < count; ++i) {
+        encoders.push_back(makeEncoder());
+    }
+    return encoders;
+}
+
+std::int64_t sampleSize() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    size_t size = 0;
+    codes_get_size(sample, "values", &size);
+    codes_handle_delete(sample);
+    return static_cast<std::int64_t>(size);
+}
+
+Message makeField(std::int64_t step, std::int64_t size) {
+    Metadata md;
+    md.set("paramId", std::int64_t{130});
+    md.set("typeOfLevel", std::string{"isobaricInhPa"});
+    md.set("level", std::int64_t{500});
+    md.set("levtype", std::string{"pl"});
+    md.set("startDate", std::int64_t{20240101});
+    md.set("startTime", std::int64_t{0});
+    md.set("step", step);
+    md.set("type", std::string{"fc"});
+    md.set("class", std::string{"od"});
+    md.set("stream", std::string{"oper"});
+    md.set("expver", std::string{"0001"});
+    md.set("globalSize", size);
+    md.set("precision", std::string{"double"});
+
+    eckit::Buffer payload{size * sizeof(double)};
+    auto* values = static_cast<double*>(payload.data());
+    for (std::int64_t i = 0; i < size; ++i) {
+        values[i] = 250.0 + 0.01 * static_cast<double>((i + step) % 1000);
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+EncoderPool::Task encodeTask(std::int64_t step, std::int64_t size) {
+    return [step, size](GribEncoder& encoder) { return encoder.encodeField(makeField(step, size), {}, {}); };
+}
+
+std::vector<Message> encodeAll(EncoderPool& pool, double& seconds) {
+    const auto size = sampleSize();
+    std::vector<Message> encoded;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::int64_t step = 0; step < NFIELDS; ++step) {
+        for (auto& msg : pool.submit(encodeTask(step, size))) {
+            encoded.push_back(std::move(msg));
+        }
+    }
+    for (auto& msg : pool.flush()) {
+        encoded.push_back(std::move(msg));
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return encoded;
+}
+
+bool equal(const Message& lhs, const Message& rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.payload().data(), rhs.payload().data(), lhs.size()) == 0;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Fields are forwarded in arrival order") {
+    EncoderPool serial{makeEncoders(1), true, 1};
+    EncoderPool parallel{makeEncoders(4), true, 8};
+
+    double serialSeconds = 0;
+    double parallelSeconds = 0;
+    const auto reference = encodeAll(serial, serialSeconds);
+    const auto result = encodeAll(parallel, parallelSeconds);
+
+    EXPECT_EQUAL(reference.size(), NFIELDS);
+    EXPECT_EQUAL(result.size(), NFIELDS);
+    for (std::size_t i = 0; i < reference.size(); ++i) {
+        EXPECT(equal(reference[i], result[i]));
+    }
+
+    eckit::Log::info() << "Encoded " << NFIELDS << " fields :: 1 thread " << serialSeconds << "s, 4 threads "
+                       << parallelSeconds << "s" << std::endl;
+}
+
+CASE("Fields forwarded as ready are all forwarded once") {
+    EncoderPool serial{makeEncoders(1), true, 1};
+    EncoderPool parallel{makeEncoders(4), false, 8};
+
+    double seconds = 0;
+    const auto reference = encodeAll(serial, seconds);
+    const auto result = encodeAll(parallel, seconds);
+
+    EXPECT_EQUAL(result.size(), reference.size());
+    std::vector<bool> found(reference.size(), false);
+    for (const auto& msg : result) {
+        const auto step = msg.metadata().get<std::int64_t>("step");
+        EXPECT(!found[step]);
+        found[step] = true;
+        EXPECT(equal(reference[step], msg));
+    }
+}
+
+CASE("Flush waits for all pending fields") {
+    EncoderPool pool{makeEncoders(3), true, 64};
+    const auto size = sampleSize();
+
+    std::size_t forwarded = 0;
+    for (std::int64_t step = 0; step < 10; ++step) {
+        forwarded += pool.submit(encodeTask(step, size)).size();
+    }
+    forwarded += pool.flush().size();
+    EXPECT_EQUAL(forwarded, 10);
+    EXPECT(pool.flush().empty());
+}
+
+CASE("Encoding errors are rethrown on the submitting thread") {
+    EncoderPool pool{makeEncoders(2), true, 4};
+    const auto size = sampleSize();
+
+    pool.submit(encodeTask(0, size));
+    pool.submit([](GribEncoder&) -> Message { throw eckit::SeriousBug("encoding failed"); });
+    EXPECT_THROWS_AS(pool.flush(), eckit::SeriousBug);
+}
+
+CASE("The pool stays usable after an encoding error") {
+    EncoderPool pool{makeEncoders(2), true, 8};
+    const auto size = sampleSize();
+
+    pool.submit([](GribEncoder&) -> Message { throw eckit::SeriousBug("encoding failed"); });
+    for (std::int64_t step = 1; step < 6; ++step) {
+        pool.submit(encodeTask(step, size));
+    }
+    EXPECT_THROWS_AS(pool.flush(), eckit::SeriousBug);
+
+    // Results ready with the failed one were consumed with it, the others are still forwarded once
+    pool.flush();
+    EXPECT(pool.flush().empty());
+
+    auto out = pool.submit(encodeTask(6, size));
+    for (auto& msg : pool.flush()) {
+        out.push_back(std::move(msg));
+    }
+    EXPECT_EQUAL(out.size(), 1);
+    EXPECT_EQUAL(out[0].metadata().get<std::int64_t>("step"), 6);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,204 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/action/encode/SimplePacking.h"
+#include "multio/util/MioGribHandle.h"
+
+namespace multio::test {
+
+using multio::action::encodeSimplePacked;
+using multio::action::SimplePackingOptions;
+using multio::action::ValueRange;
+using multio::util::MioGribHandle;
+
+namespace {
+
+// Global 0.25 degree lat-lon grid, about 1M points
+constexpr std::int64_t NI = 1440;
+constexpr std::int64_t NJ = 721;
+constexpr std::int64_t BITS_PER_VALUE = 16;
+
+std::unique_ptr<MioGribHandle> makeHandle() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    auto handle = std::make_unique<MioGribHandle>(sample);
+    handle->setValue("Ni", NI);
+    handle->setValue("Nj", NJ);
+    handle->setValue("bitsPerValue", BITS_PER_VALUE);
+    return handle;
+}
+
+std::vector<double> decode(const eckit::Buffer& message) {
+    codes_handle* h = codes_handle_new_from_message(nullptr, message.data(), message.size());
+    EXPECT(h != nullptr);
+    size_t size = 0;
+    codes_get_size(h, "values", &size);
+    std::vector<double> values(size);
+    codes_get_double_array(h, "values", values.data(), &size);
+    codes_handle_delete(h);
+    return values;
+}
+
+template <typename T>
+std::vector<T> makeField(std::size_t size) {
+    std::vector<T> values(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const double lat = 90.0 - 180.0 * static_cast<double>(i / NI) / (NJ - 1);
+        const double lon = 360.0 * static_cast<double>(i % NI) / NI;
+        values[i] = static_cast<T>(273.15 + 30.0 * std::cos(lat * M_PI / 180.0) + 5.0 * std::sin(3 * lon * M_PI / 180.0));
+    }
+    return values;
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Native simple packing matches ecCodes") {
+    auto handle = makeHandle();
+    const auto size = static_cast<std::size_t>(handle->getDataValuesSize());
+    const auto values = makeField<float>(size);
+
+    // Reference: packing by ecCodes
+    auto reference = handle->duplicate();
+    auto start = std::chrono::steady_clock::now();
+    reference->setDataValues(values.data(), size);
+    eckit::Buffer referenceMessage{reference->length()};
+    reference->write(referenceMessage);
+    const double ecCodesSeconds = seconds(start);
+
+    eckit::Buffer header{handle->length()};
+    handle->write(header);
+
+    // Validation mode decodes with ecCodes and throws on any bitwise difference to the intended values
+    auto validated = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{1, true});
+    EXPECT(validated.has_value());
+
+    const auto fromEcCodes = decode(referenceMessage);
+    const auto fromNative = decode(*validated);
+    EXPECT_EQUAL(fromEcCodes.size(), size);
+    EXPECT_EQUAL(fromNative.size(), size);
+
+    // Both are within half a quantization step of the input: 16 bits over a range of about 70
+    for (std::size_t i = 0; i < size; ++i) {
+        EXPECT(std::abs(fromNative[i] - values[i]) < 1e-3);
+        EXPECT(std::abs(fromNative[i] - fromEcCodes[i]) < 2e-3);
+    }
+
+    for (const std::size_t threads : {1, 4}) {
+        start = std::chrono::steady_clock::now();
+        auto packed = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{threads, false});
+        const double nativeSeconds = seconds(start);
+        EXPECT(packed.has_value());
+        EXPECT_EQUAL(packed->size(), validated->size());
+        EXPECT(std::memcmp(packed->data(), validated->data(), packed->size()) == 0);
+
+        eckit::Log::info() << "Packed " << size << " values :: ecCodes " << ecCodesSeconds << "s, native (" << threads
+                           << " threads) " << nativeSeconds << "s, speed-up " << ecCodesSeconds / nativeSeconds
+                           << std::endl;
+    }
+}
+
+CASE("Constant fields are encoded by their reference value") {
+    auto handle = makeHandle();
+    const auto size = static_cast<std::size_t>(handle->getDataValuesSize());
+    const std::vector<double> values(size, 1.5);
+
+    eckit::Buffer header{handle->length()};
+    handle->write(header);
+
+    auto packed = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{1, true});
+    EXPECT(packed.has_value());
+    for (const auto v : decode(*packed)) {
+        EXPECT_EQUAL(v, 1.5);
+    }
+}
+
+CASE("A known range of the values gives the same message") {
+    auto handle = makeHandle();
+    const auto size = static_cast<std::size_t>(handle->getDataValuesSize());
+    const auto values = makeField<float>(size);
+
+    eckit::Buffer header{handle->length()};
+    handle->write(header);
+
+    const auto [min, max] = std::minmax_element(values.begin(), values.end());
+    const ValueRange range{static_cast<double>(*min), static_cast<double>(*max)};
+
+    auto scanned = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{});
+    auto ranged = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{1, true}, range);
+    EXPECT(scanned.has_value());
+    EXPECT(ranged.has_value());
+    EXPECT_EQUAL(ranged->size(), scanned->size());
+    EXPECT(std::memcmp(ranged->data(), scanned->data(), ranged->size()) == 0);
+}
+
+CASE("Values outside of a known range are packed with their actual range") {
+    auto handle = makeHandle();
+    const auto size = static_cast<std::size_t>(handle->getDataValuesSize());
+    const auto values = makeField<double>(size);
+
+    eckit::Buffer header{handle->length()};
+    handle->write(header);
+
+    auto scanned = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{});
+    EXPECT(scanned.has_value());
+
+    // E.g. statistics of the first part of an aggregated field, or of the values before an action changed them
+    const auto [min, max] = std::minmax_element(values.begin(), values.end());
+    for (const auto& range : {ValueRange{*min + 1.0, *max}, ValueRange{*min, *max - 1.0}, ValueRange{*min, *min}}) {
+        auto ranged
+            = encodeSimplePacked(header, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{1, true}, range);
+        EXPECT(ranged.has_value());
+        EXPECT_EQUAL(ranged->size(), scanned->size());
+        EXPECT(std::memcmp(ranged->data(), scanned->data(), ranged->size()) == 0);
+    }
+}
+
+CASE("Unsupported layouts are left to ecCodes") {
+    auto handle = makeHandle();
+    const auto size = static_cast<std::size_t>(handle->getDataValuesSize());
+    const auto values = makeField<double>(size);
+
+    eckit::Buffer header{handle->length()};
+    handle->write(header);
+
+    // Number of values not matching the grid
+    EXPECT(!encodeSimplePacked(header, values.data(), size - 1, BITS_PER_VALUE, SimplePackingOptions{}).has_value());
+
+    // Bitmap present
+    handle->setValue("bitmapPresent", true);
+    eckit::Buffer bitmapHeader{handle->length()};
+    handle->write(bitmapHeader);
+    EXPECT(!encodeSimplePacked(bitmapHeader, values.data(), size, BITS_PER_VALUE, SimplePackingOptions{}).has_value());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,161 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/interpolate-fesom/FesomMatrixPrefetcher.h"
+#include "multio/action/interpolate-fesom/FesomMatrixStore.h"
+
+namespace multio::test {
+
+using multio::action::interpolateFESOM::FesomMatrix;
+using multio::action::interpolateFESOM::FesomMatrixPrefetcher;
+using multio::action::interpolateFESOM::FesomMatrixStore;
+using multio::action::interpolateFESOM::writeFlatCache;
+
+namespace {
+
+// Small matrix: 3 of 6 output points, 4 input points, 5 non-zeros
+struct TestMatrix {
+    std::vector<std::int32_t> landSeaMask{1, 3, 4};
+    std::vector<std::int32_t> rowStart{0, 2, 3, 5};
+    std::vector<std::int32_t> colIdx{0, 1, 2, 1, 3};
+    std::vector<double> values{0.25, 0.75, 1.0, 0.5, 0.5};
+
+    FesomMatrix<double> matrix() const {
+        FesomMatrix<double> m;
+        m.nnz = values.size();
+        m.nRows = landSeaMask.size();
+        m.nCols = 4;
+        m.nOutRows = 6;
+        m.landSeaMask = landSeaMask.data();
+        m.rowStart = rowStart.data();
+        m.colIdx = colIdx.data();
+        m.values = values.data();
+        return m;
+    }
+};
+
+std::string writeTestCache() {
+    const std::string file = "test_multio_fesom_matrix_store.csr";
+    writeFlatCache(file, 1, 0, TestMatrix{}.matrix());
+    return file;
+}
+
+}  // namespace
+
+CASE("Flat caches are read back unchanged") {
+    const std::string file = writeTestCache();
+    const TestMatrix expected;
+    {
+        auto matrix = FesomMatrixStore::instance().get<double>(file);
+        EXPECT(matrix->nnz == expected.values.size());
+        EXPECT(matrix->nRows == expected.landSeaMask.size());
+        EXPECT(matrix->nCols == 4);
+        EXPECT(matrix->nOutRows == 6);
+        EXPECT(std::vector<std::int32_t>(matrix->landSeaMask, matrix->landSeaMask + matrix->nRows)
+               == expected.landSeaMask);
+        EXPECT(std::vector<std::int32_t>(matrix->rowStart, matrix->rowStart + matrix->nRows + 1)
+               == expected.rowStart);
+        EXPECT(std::vector<std::int32_t>(matrix->colIdx, matrix->colIdx + matrix->nnz) == expected.colIdx);
+        EXPECT(std::vector<double>(matrix->values, matrix->values + matrix->nnz) == expected.values);
+    }
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Matrices are shared while in use and released afterwards") {
+    const std::string file = writeTestCache();
+    auto& store = FesomMatrixStore::instance();
+    const size_t before = store.size();
+    {
+        auto first = store.get<double>(file);
+        auto second = store.get<double>(file);
+        EXPECT(first.get() == second.get());
+        EXPECT(store.size() == before + 1);
+    }
+    EXPECT(store.size() == before);
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Weights are converted once for all users of a matrix") {
+    const std::string file = writeTestCache();
+    {
+        auto& store = FesomMatrixStore::instance();
+        auto matrix = store.get<double>(file);
+        auto first = store.convertedWeights<float>(matrix);
+        auto second = store.convertedWeights<float>(store.get<double>(file));
+        EXPECT(first.get() == second.get());
+        EXPECT(std::vector<float>(first.get(), first.get() + matrix->nnz)
+               == std::vector<float>(matrix->values, matrix->values + matrix->nnz));
+    }
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Caches of the wrong precision are rejected") {
+    const std::string file = writeTestCache();
+    EXPECT_THROWS_AS(FesomMatrixStore::instance().get<float>(file), eckit::SeriousBug);
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Corrupted caches fail the checksum") {
+    const std::string file = writeTestCache();
+    {
+        std::fstream f(file, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-1, std::ios::end);
+        f.put('\x7f');
+    }
+    EXPECT_THROWS_AS(FesomMatrixStore::instance().get<double>(file), eckit::SeriousBug);
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Caches with indices out of range are rejected") {
+    const std::string file = "test_multio_fesom_matrix_store_invalid.csr";
+    for (const auto& corrupt : std::vector<void (*)(TestMatrix&)>{
+             [](TestMatrix& m) { m.colIdx[2] = 4; },        // column beyond the input
+             [](TestMatrix& m) { m.landSeaMask[1] = 6; },   // output point beyond the output
+             [](TestMatrix& m) { m.rowStart[1] = 4; },      // decreasing row pointers
+             [](TestMatrix& m) { m.rowStart[3] = 4; }}) {  // row pointers not spanning the non-zeros
+        TestMatrix invalid;
+        corrupt(invalid);
+        writeFlatCache(file, 1, 0, invalid.matrix());
+        EXPECT_THROWS_AS(FesomMatrixStore::instance().get<double>(file), eckit::SeriousBug);
+        eckit::PathName{file}.unlink();
+    }
+}
+
+CASE("Prefetched matrices are handed over on request") {
+    const std::string file = writeTestCache();
+    {
+        FesomMatrixPrefetcher<double> prefetcher;
+        prefetcher.prefetch(file);
+        prefetcher.prefetch("test_multio_fesom_matrix_store_missing.csr");
+
+        auto prefetched = prefetcher.get(file);
+        EXPECT(prefetched->nnz == TestMatrix{}.values.size());
+        // Loaded on request this time, but shared with the prefetched one
+        EXPECT(prefetcher.get(file).get() == prefetched.get());
+
+        EXPECT_THROWS_AS(prefetcher.get("test_multio_fesom_matrix_store_missing.csr"), eckit::SeriousBug);
+    }
+    eckit::PathName{file}.unlink();
+}
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -108,6 +108,18 @@ CASE("FileSink appends to existing file") {
     EXPECT(file_content(file_path) == std::string{quote} + std::string{quote});
 }
 
+CASE("FileSink writes batches of messages") {
+    const eckit::PathName& file_path = eckit::TmpFile();
+    auto sink = make_configured_file_sink(file_path);
+    const std::string first = "All was quiet in the deep dark wood.";
+    const std::string second = "The mouse found a nut and the nut was good.";
+    const std::string batch = first + second;
+
+    sink->writeBatch(batch.data(), batch.size(), {0, first.size()});
+
+    EXPECT(file_content(file_path) == batch);
+}
+
 }  // namespace multio::test
 
 int main(int argc, char** argv) {
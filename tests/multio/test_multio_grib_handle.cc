@@ -0,0 +1,114 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "multio/util/MioGribHandle.h"
+
+namespace multio::test {
+
+using multio::util::MioGribHandle;
+
+namespace {
+
+std::unique_ptr<MioGribHandle> makeHandle() {
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    return std::make_unique<MioGribHandle>(sample);
+}
+
+std::vector<double> decodeValues(const MioGribHandle& handle) {
+    size_t size = handle.getDataValuesSize();
+    std::vector<double> values(size);
+    handle.getDataValues(values.data(), size);
+    return values;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Single precision values are packed like double precision values") {
+    auto floatHandle = makeHandle();
+    auto doubleHandle = makeHandle();
+
+    const size_t size = floatHandle->getDataValuesSize();
+    std::vector<float> floats(size);
+    std::vector<double> doubles(size);
+    for (size_t i = 0; i < size; ++i) {
+        floats[i] = 250.0f + 0.125f * static_cast<float>(i % 400);
+        doubles[i] = floats[i];
+    }
+
+    floatHandle->setValue("bitsPerValue", std::int64_t{16});
+    doubleHandle->setValue("bitsPerValue", std::int64_t{16});
+
+    // Repeated to make sure a reused conversion buffer does not leak values of previous fields
+    for (int repeat = 0; repeat < 2; ++repeat) {
+        floatHandle->setDataValues(floats.data(), size);
+        doubleHandle->setDataValues(doubles.data(), size);
+
+        const auto fromFloat = decodeValues(*floatHandle);
+        const auto fromDouble = decodeValues(*doubleHandle);
+        EXPECT_EQUAL(fromFloat.size(), size);
+        EXPECT_EQUAL(fromDouble.size(), size);
+
+        // 16 bits over a range of 50 give a precision of about 1e-3
+        for (size_t i = 0; i < size; ++i) {
+            EXPECT(std::abs(fromFloat[i] - fromDouble[i]) < 1e-3);
+            EXPECT(std::abs(fromFloat[i] - doubles[i]) < 1e-3);
+        }
+
+        for (auto& f : floats) {
+            f += 1.0f;
+        }
+        for (auto& d : doubles) {
+            d += 1.0;
+        }
+    }
+}
+
+CASE("Packing types without single precision support fall back to double precision") {
+    auto floatHandle = makeHandle();
+    auto doubleHandle = makeHandle();
+    floatHandle->setValue("packingType", std::string{"grid_simple"});
+    doubleHandle->setValue("packingType", std::string{"grid_simple"});
+
+    // As if ecCodes had returned CODES_NOT_IMPLEMENTED for this packing type
+    MioGribHandle::setFloatValuesUnsupported("grid_simple", "values");
+    EXPECT(!MioGribHandle::floatValuesSupported("grid_simple", "values"));
+    EXPECT(MioGribHandle::floatValuesSupported("grid_ccsds", "values"));
+    EXPECT(MioGribHandle::floatValuesSupported("grid_simple", "pv"));
+
+    const size_t size = floatHandle->getDataValuesSize();
+    std::vector<float> floats(size);
+    std::vector<double> doubles(size);
+    for (size_t i = 0; i < size; ++i) {
+        floats[i] = -20.0f + 0.25f * static_cast<float>(i % 160);
+        doubles[i] = floats[i];
+    }
+
+    floatHandle->setDataValues(floats.data(), size);
+    doubleHandle->setDataValues(doubles.data(), size);
+    EXPECT(decodeValues(*floatHandle) == decodeValues(*doubleHandle));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,75 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "multio/action/encode/GridGeometry.h"
+
+namespace multio::test {
+
+using multio::action::GaussianGeometry;
+using multio::action::GridGeometryCache;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Gaussian geometries are computed once and shared") {
+    auto& cache = GridGeometryCache::instance();
+    const auto first = cache.gaussian("O32");
+    const auto second = cache.gaussian("O32");
+    EXPECT(first == second);
+
+    // Octahedral grid: 20 points in the first row, 4 more in each row up to the equator
+    EXPECT_EQUAL(first->N, 32);
+    EXPECT_EQUAL(first->pl.size(), 64);
+    EXPECT_EQUAL(first->pl.front(), 20);
+    EXPECT_EQUAL(first->pl[31], 144);
+    EXPECT_EQUAL(std::accumulate(first->pl.begin(), first->pl.end(), 0L), 4 * 32 * (32 + 9));
+    EXPECT(first->latitudeOfFirstGridPointInDegrees == -first->latitudeOfLastGridPointInDegrees);
+    EXPECT(first->longitudeOfFirstGridPointInDegrees == 0.0);
+    EXPECT(first->longitudeOfLastGridPointInDegrees == 357.5);
+
+    EXPECT(cache.gaussian("N32") != first);
+}
+
+CASE("Regular lat-lon geometries are computed once and shared") {
+    auto& cache = GridGeometryCache::instance();
+    const auto first = cache.regularLatLon("L360x181");
+    EXPECT(cache.regularLatLon("L360x181") == first);
+    EXPECT_EQUAL(first->Ni, 360);
+    EXPECT_EQUAL(first->Nj, 181);
+}
+
+CASE("Concurrent requests get the same entry") {
+    std::vector<std::shared_ptr<const GaussianGeometry>> results(8);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&results, i]() { results[i] = GridGeometryCache::instance().gaussian("O48"); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const auto& r : results) {
+        EXPECT(r == results.front());
+    }
+    EXPECT(GridGeometryCache::instance().gaussian("O48") == results.front());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
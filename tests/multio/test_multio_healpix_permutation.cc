@@ -0,0 +1,111 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/renumber-healpix/HEALPix.h"
+#include "multio/action/renumber-healpix/HEALPixPermutation.h"
+
+namespace multio::test {
+
+using multio::action::HEALPixPermutation;
+
+CASE("Permutation matches the HEALPix reference") {
+    // Nside = 1: both orderings are the same
+    const HEALPixPermutation one{1};
+    for (std::size_t n = 0; n < one.size(); ++n) {
+        EXPECT(one.ring(n) == n);
+    }
+
+    // First nested pixels of Nside = 2 and 1024 (nest2ring of the HEALPix library)
+    const HEALPixPermutation two{2};
+    const std::vector<std::uint32_t> two_ref{13, 5, 4, 0, 15, 7, 6, 1, 17, 9, 8, 2, 19, 11, 10, 3};
+    for (std::size_t n = 0; n < two_ref.size(); ++n) {
+        EXPECT(two.ring(n) == two_ref[n]);
+    }
+
+    const HEALPixPermutation high{1024, 4};
+    EXPECT(high.ring(0) == 6285824);
+    EXPECT(high.ring(1) == 6281728);
+    EXPECT(high.ring(5000000) == 5466164);
+    EXPECT(high.ring(12 * 1024 * 1024 - 1) == 6297088);
+}
+
+CASE("Permutation is a bijection, independent of the number of threads") {
+    for (std::size_t Nside : {2, 8, 64, 256}) {
+        const HEALPixPermutation serial{Nside};
+        const HEALPixPermutation threaded{Nside, 4};
+        EXPECT(serial.size() == 12 * Nside * Nside);
+
+        std::vector<bool> seen(serial.size(), false);
+        for (std::size_t n = 0; n < serial.size(); ++n) {
+            EXPECT(serial.ring(n) == threaded.ring(n));
+            EXPECT(!seen[serial.ring(n)]);
+            seen[serial.ring(n)] = true;
+        }
+    }
+}
+
+CASE("Fields are reordered in both directions") {
+    const std::size_t Nside = 128;
+    const HEALPixPermutation map{Nside};
+
+    std::vector<double> ring(map.size());
+    std::iota(ring.begin(), ring.end(), 0.0);
+
+    std::vector<double> nest(map.size());
+    map.ringToNest(ring.data(), nest.data(), 3);
+    for (std::size_t n = 0; n < nest.size(); ++n) {
+        EXPECT(nest[n] == static_cast<double>(map.ring(n)));
+    }
+
+    std::vector<double> back(map.size());
+    map.nestToRing(nest.data(), back.data(), 3);
+    EXPECT(back == ring);
+}
+
+CASE("Ring to nested conversion is the inverse of the permutation") {
+    // Nside = 1: the equatorial rings are the only rings
+    for (std::size_t Nside : {1, 2, 8, 64}) {
+        const HEALPix healpix(static_cast<int>(Nside));
+        const HEALPixPermutation map{Nside};
+        for (std::size_t n = 0; n < map.size(); ++n) {
+            EXPECT(static_cast<std::size_t>(healpix.ring_to_nest(static_cast<int>(map.ring(n)))) == n);
+        }
+    }
+}
+
+CASE("Permutation from a ring to nest map") {
+    const std::size_t Nside = 16;
+    const HEALPixPermutation computed{Nside};
+    std::vector<std::size_t> ringToNest(computed.size());
+    for (std::size_t n = 0; n < computed.size(); ++n) {
+        ringToNest[computed.ring(n)] = n;
+    }
+    const HEALPixPermutation loaded{Nside, ringToNest};
+    for (std::size_t n = 0; n < computed.size(); ++n) {
+        EXPECT(loaded.ring(n) == computed.ring(n));
+    }
+
+    ringToNest.pop_back();
+    EXPECT_THROWS_AS(HEALPixPermutation(Nside, ringToNest), eckit::UserError);
+    EXPECT_THROWS_AS(HEALPixPermutation(12), eckit::UserError);
+}
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
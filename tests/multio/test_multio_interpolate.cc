@@ -0,0 +1,457 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/linalg/SparseMatrix.h"
+#include "eckit/linalg/Triplet.h"
+#include "eckit/testing/Test.h"
+
+#include "eccodes.h"
+
+#include "mir/api/MIRJob.h"
+#include "mir/input/RawInput.h"
+#include "mir/output/ResizableOutput.h"
+#include "mir/param/SimpleParametrisation.h"
+
+#include "multio/action/Action.h"
+#include "multio/action/ChainedAction.h"
+#include "multio/action/interpolate/ApplyWeights.h"
+#include "multio/action/interpolate/PlanCache.h"
+#include "multio/config/ComponentConfiguration.h"
+#include "multio/config/MultioConfiguration.h"
+#include "multio/message/Glossary.h"
+#include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
+
+namespace multio::test {
+
+using multio::action::Action;
+using multio::action::ActionFactory;
+using multio::action::ChainedAction;
+using multio::action::interpolate::applyWeights;
+using multio::action::interpolate::PlanCache;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+
+namespace {
+
+constexpr std::size_t SOURCE_SIZE = 6;
+constexpr std::size_t TARGET_SIZE = 12;  // HEALPix H1
+constexpr double MISSING = 9999.0;
+
+// Three distinct weights per row, so that the heaviest one is well defined
+const std::string& testMatrix() {
+    static const std::string path = [] {
+        std::vector<eckit::linalg::Triplet> triplets;
+        for (std::size_t row = 0; row < TARGET_SIZE; ++row) {
+            triplets.emplace_back(row, row % SOURCE_SIZE, 0.5);
+            triplets.emplace_back(row, (row + 1) % SOURCE_SIZE, 0.3);
+            triplets.emplace_back(row, (row + 3) % SOURCE_SIZE, 0.2);
+        }
+        const std::string path = "test_multio_interpolate_H1.mat";
+        eckit::linalg::SparseMatrix{TARGET_SIZE, SOURCE_SIZE, triplets}.save(eckit::PathName{path});
+        return path;
+    }();
+    return path;
+}
+
+// Source point 2 is the heaviest of rows 2 and 8, the second of rows 1 and 7 and the lightest of rows 5 and 11
+std::vector<double> testValues(bool withMissing) {
+    std::vector<double> values{271.5, 280.25, 265.0, 290.75, 301.0, 255.5};
+    if (withMissing) {
+        values[2] = MISSING;
+    }
+    return values;
+}
+
+std::vector<double> mirInterpolate(const std::vector<double>& values, const std::optional<double>& missingValue) {
+    mir::param::SimpleParametrisation input;
+    input.set("gridded", true);
+    input.set("gridType", "unstructured_grid");
+    input.set("numberOfPoints", values.size());
+    if (missingValue) {
+        input.set("missing_value", *missingValue);
+    }
+
+    mir::api::MIRJob job;
+    job.set("grid", "H1");
+    job.set("interpolation", "matrix");
+    job.set("interpolation-matrix", testMatrix());
+
+    mir::input::RawInput in(values.data(), values.size(), input);
+    std::vector<double> out;
+    mir::param::SimpleParametrisation outMetadata;
+    mir::output::ResizableOutput output(out, outMetadata);
+    job.execute(in, output);
+    return out;
+}
+
+void compareWithMIR(bool withMissing) {
+    const auto values = testValues(withMissing);
+    const auto missingValue = withMissing ? std::optional<double>{MISSING} : std::nullopt;
+
+    eckit::linalg::SparseMatrix W;
+    W.load(eckit::PathName{testMatrix()});
+
+    std::vector<double> out(TARGET_SIZE);
+    message::ValueStatistics stats;
+    applyWeights(W, values.data(), out.data(), missingValue, stats);
+
+    const auto expected = mirInterpolate(values, missingValue);
+    EXPECT_EQUAL(expected.size(), out.size());
+
+    std::size_t missing = 0;
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        if (expected[i] == MISSING) {
+            ++missing;
+            EXPECT_EQUAL(out[i], MISSING);
+        }
+        else {
+            EXPECT(std::abs(out[i] - expected[i]) <= 1e-12 * std::abs(expected[i]));
+        }
+    }
+    EXPECT_EQUAL(stats.missing, missing);
+    EXPECT_EQUAL(missing, withMissing ? 2 : 0);
+}
+
+// Single precision input and/or output against double precision weights applied to the same values
+template <typename In, typename Out>
+void compareWithDouble(bool withMissing) {
+    const auto values = testValues(withMissing);
+    const auto missingValue = withMissing ? std::optional<double>{MISSING} : std::nullopt;
+
+    eckit::linalg::SparseMatrix W;
+    W.load(eckit::PathName{testMatrix()});
+
+    std::vector<double> expected(TARGET_SIZE);
+    message::ValueStatistics expectedStats;
+    applyWeights(W, values.data(), expected.data(), missingValue, expectedStats);
+
+    // All test values are exact in single precision
+    const std::vector<In> in(values.begin(), values.end());
+    std::vector<Out> out(TARGET_SIZE);
+    message::ValueStatistics stats;
+    applyWeights(W, in.data(), out.data(), missingValue, stats);
+
+    EXPECT_EQUAL(stats.missing, expectedStats.missing);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        EXPECT_EQUAL(out[i], static_cast<Out>(expected[i]));
+    }
+}
+
+// Last action of the test plans, keeps everything it receives
+std::vector<Message> captured;
+
+class Capture final : public Action {
+public:
+    explicit Capture(const config::ComponentConfiguration& compConf) : Action{compConf} {}
+
+private:
+    void executeImpl(Message msg) override { captured.push_back(std::move(msg)); }
+
+    void print(std::ostream& os) const override { os << "Capture()"; }
+};
+
+action::ActionBuilder<Capture> CaptureBuilder("test-capture");
+
+config::MultioConfiguration& multioConfig() {
+    static config::MultioConfiguration multioConf{};
+    return multioConf;
+}
+
+// Interpolates from 1/1 to 2/2 with MIR
+std::unique_ptr<Action> makeInterpolate(const std::string& outputPrecision) {
+    eckit::LocalConfiguration next;
+    next.set("type", "test-capture");
+
+    eckit::LocalConfiguration conf;
+    conf.set("type", "interpolate");
+    conf.set("input", "1/1");
+    conf.set("grid", std::vector<double>{2.0, 2.0});
+    conf.set("output-precision", outputPrecision);
+    conf.set("next", next);
+
+    captured.clear();
+    return ActionFactory::instance().build("interpolate", config::ComponentConfiguration{conf, multioConfig()});
+}
+
+constexpr std::size_t LATLON_SIZE = 360 * 181;
+
+// Values are exact in single precision, every 7th point is missing with withMissing
+template <typename T>
+Message makeLatLonField(bool withMissing) {
+    Metadata md;
+    md.set("paramId", std::int64_t{167});
+    md.set("globalSize", static_cast<std::int64_t>(LATLON_SIZE));
+    md.set("precision", std::string{sizeof(T) == 4 ? "single" : "double"});
+    if (withMissing) {
+        md.set("missingValue", MISSING);
+        md.set("bitmapPresent", true);
+    }
+
+    eckit::Buffer payload{LATLON_SIZE * sizeof(T)};
+    auto* values = static_cast<T*>(payload.data());
+    for (std::size_t i = 0; i < LATLON_SIZE; ++i) {
+        values[i] = (withMissing && i % 7 == 0) ? static_cast<T>(MISSING) : static_cast<T>(250.0 + 0.25 * (i % 301));
+    }
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+template <typename Out>
+std::vector<Out> interpolatedValues(const Message& msg) {
+    EXPECT_EQUAL(msg.metadata().get<std::string>("precision"), std::string{sizeof(Out) == 4 ? "single" : "double"});
+    EXPECT_EQUAL(msg.payload().size() % sizeof(Out), 0);
+    const auto* values = static_cast<const Out*>(msg.payload().data());
+    return {values, values + msg.payload().size() / sizeof(Out)};
+}
+
+bool hasMissingValue(const Message& msg) {
+    return msg.metadata().find("missingValue") != msg.metadata().end();
+}
+
+// Single precision fields are interpolated like double precision ones, the output is rounded only once
+void compareSinglePrecisionFields(bool withMissing) {
+    makeInterpolate("double")->execute(makeLatLonField<double>(withMissing));
+    EXPECT_EQUAL(captured.size(), 1);
+    const auto expected = interpolatedValues<double>(captured[0]);
+    EXPECT_EQUAL(expected.size(), 180 * 91);
+    EXPECT_EQUAL(hasMissingValue(captured[0]), withMissing);
+
+    makeInterpolate("double")->execute(makeLatLonField<float>(withMissing));
+    EXPECT_EQUAL(captured.size(), 1);
+    EXPECT(interpolatedValues<double>(captured[0]) == expected);
+    EXPECT_EQUAL(hasMissingValue(captured[0]), withMissing);
+
+    makeInterpolate("single")->execute(makeLatLonField<float>(withMissing));
+    EXPECT_EQUAL(captured.size(), 1);
+    EXPECT(interpolatedValues<float>(captured[0]) == std::vector<float>(expected.begin(), expected.end()));
+    EXPECT_EQUAL(hasMissingValue(captured[0]), withMissing);
+
+    if (withMissing) {
+        std::size_t missing = 0;
+        for (const auto value : expected) {
+            missing += value == MISSING ? 1 : 0;
+        }
+        EXPECT(missing > 0);
+    }
+}
+
+// Sets the statistics of the values of a field, as actions producing values do (e.g. an interpolation)
+class SetStatistics final : public ChainedAction {
+public:
+    explicit SetStatistics(const config::ComponentConfiguration& compConf) : ChainedAction{compConf} {}
+
+private:
+    void executeImpl(Message msg) override {
+        const auto* values = static_cast<const double*>(msg.payload().data());
+        message::ValueStatistics stats;
+        for (std::size_t i = 0; i < msg.payload().size() / sizeof(double); ++i) {
+            stats.add(values[i]);
+        }
+        Metadata md{msg.metadata()};
+        message::setValueStatistics(md, stats);
+        executeNext(Message{Message::Header{msg.tag(), msg.source(), msg.destination(), std::move(md)}, msg.payload()});
+    }
+
+    void print(std::ostream& os) const override { os << "SetStatistics()"; }
+};
+
+action::ActionBuilder<SetStatistics> SetStatisticsBuilder("test-set-statistics");
+
+// GRIB template of the encoder
+std::string writeTemplate() {
+    const std::string file = "test_multio_interpolate_template.grib";
+    codes_handle* sample = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    EXPECT(sample != nullptr);
+    const void* data = nullptr;
+    std::size_t size = 0;
+    EXPECT(codes_get_message(sample, &data, &size) == 0);
+    std::FILE* out = std::fopen(file.c_str(), "wb");
+    EXPECT(out != nullptr);
+    EXPECT(std::fwrite(data, 1, size, out) == size);
+    std::fclose(out);
+    codes_handle_delete(sample);
+    return file;
+}
+
+// Statistics of the input -> nearest neighbour interpolation from 1/1 to 2/2 [-> native GRIB encoding]
+std::unique_ptr<Action> makeStatisticsPlan(const std::string& tmpl) {
+    eckit::LocalConfiguration next;
+    next.set("type", "test-capture");
+
+    if (!tmpl.empty()) {
+        eckit::LocalConfiguration encode;
+        encode.set("type", "encode");
+        encode.set("format", "grib");
+        encode.set("template", tmpl);
+        encode.set("packing", "native");
+        encode.set("next", next);
+        next = encode;
+    }
+
+    eckit::LocalConfiguration options;
+    options.set("interpolation", "nearest-neighbour");
+
+    eckit::LocalConfiguration interpolate;
+    interpolate.set("type", "interpolate");
+    interpolate.set("input", "1/1");
+    interpolate.set("grid", std::vector<double>{2.0, 2.0});
+    interpolate.set("options", options);
+    interpolate.set("next", next);
+
+    eckit::LocalConfiguration conf;
+    conf.set("type", "test-set-statistics");
+    conf.set("next", interpolate);
+
+    captured.clear();
+    return ActionFactory::instance().build("test-set-statistics", config::ComponentConfiguration{conf, multioConfig()});
+}
+
+// A spike on a point of 1/1 that is not on 2/2: the range of the input is far wider than the one of the output
+Message makeSpikeField() {
+    Metadata md;
+    md.set("paramId", std::int64_t{167});
+    md.set("typeOfLevel", std::string{"surface"});
+    md.set("levtype", std::string{"sfc"});
+    md.set("startDate", std::int64_t{20240101});
+    md.set("startTime", std::int64_t{0});
+    md.set("step", std::int64_t{6});
+    md.set("type", std::string{"fc"});
+    md.set("class", std::string{"od"});
+    md.set("stream", std::string{"oper"});
+    md.set("expver", std::string{"0001"});
+    md.set("globalSize", static_cast<std::int64_t>(LATLON_SIZE));
+    md.set("precision", std::string{"double"});
+
+    eckit::Buffer payload{LATLON_SIZE * sizeof(double)};
+    auto* values = static_cast<double*>(payload.data());
+    for (std::size_t i = 0; i < LATLON_SIZE; ++i) {
+        values[i] = 250.0 + 0.25 * static_cast<double>(i % 301);
+    }
+    values[360 + 1] = 1e6;
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Applying the weights matches MIR") {
+    compareWithMIR(false);
+}
+
+CASE("Applying the weights matches MIR with missing values") {
+    compareWithMIR(true);
+}
+
+CASE("Single precision values are weighted like double precision ones") {
+    compareWithDouble<float, float>(false);
+    compareWithDouble<float, double>(false);
+    compareWithDouble<float, float>(true);
+    compareWithDouble<float, double>(true);
+}
+
+CASE("Single precision fields are interpolated by MIR like double precision ones") {
+    compareSinglePrecisionFields(false);
+}
+
+CASE("Single precision fields with missing values are interpolated by MIR like double precision ones") {
+    compareSinglePrecisionFields(true);
+}
+
+CASE("Statistics of the input are not used to encode interpolated fields") {
+    makeStatisticsPlan("")->execute(makeSpikeField());
+    EXPECT_EQUAL(captured.size(), 1);
+    EXPECT(!message::hasValueStatistics(captured[0].metadata()));
+    const auto expected = interpolatedValues<double>(captured[0]);
+    const auto [min, max] = std::minmax_element(expected.begin(), expected.end());
+    EXPECT(*max < 1000.0);
+
+    const auto tmpl = writeTemplate();
+    makeStatisticsPlan(tmpl)->execute(makeSpikeField());
+    EXPECT_EQUAL(captured.size(), 1);
+
+    codes_handle* h = codes_handle_new_from_message(nullptr, captured[0].payload().data(), captured[0].size());
+    EXPECT(h != nullptr);
+    long bitsPerValue = 0;
+    EXPECT(codes_get_long(h, "bitsPerValue", &bitsPerValue) == 0);
+    std::size_t size = 0;
+    EXPECT(codes_get_size(h, "values", &size) == 0);
+    std::vector<double> decoded(size);
+    EXPECT(codes_get_double_array(h, "values", decoded.data(), &size) == 0);
+    codes_handle_delete(h);
+
+    // Packed with the range of the interpolated values, not the one of the input (which contains the spike)
+    const double tolerance = 2.0 * (*max - *min) / std::ldexp(1.0, static_cast<int>(bitsPerValue));
+    EXPECT_EQUAL(decoded.size(), expected.size());
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+        EXPECT(std::abs(decoded[i] - expected[i]) <= tolerance);
+    }
+
+    eckit::PathName{tmpl}.unlink();
+}
+
+CASE("Plans are cached up to the capacity, then the cache is dropped") {
+    PlanCache<int> cache{2};
+    int made = 0;
+    auto make = [&made]() { return std::make_unique<int>(++made); };
+
+    EXPECT_EQUAL(cache.get("a", make), 1);
+    EXPECT_EQUAL(cache.get("a", make), 1);
+    EXPECT_EQUAL(cache.get("b", make), 2);
+    EXPECT_EQUAL(cache.size(), 2);
+    EXPECT_EQUAL(cache.hits(), 1);
+    EXPECT_EQUAL(cache.misses(), 2);
+
+    // The cache is full, all plans are evicted
+    EXPECT_EQUAL(cache.get("c", make), 3);
+    EXPECT_EQUAL(cache.size(), 1);
+    EXPECT_EQUAL(cache.get("a", make), 4);
+    EXPECT_EQUAL(cache.get("c", make), 3);
+    EXPECT_EQUAL(cache.size(), 2);
+    EXPECT_EQUAL(cache.hits(), 2);
+    EXPECT_EQUAL(cache.misses(), 4);
+}
+
+CASE("Without capacity every plan is made anew") {
+    PlanCache<int> cache{0};
+    int made = 0;
+    auto make = [&made]() { return std::make_unique<int>(++made); };
+
+    EXPECT_EQUAL(cache.get("a", make), 1);
+    EXPECT_EQUAL(cache.get("a", make), 2);
+    EXPECT_EQUAL(cache.size(), 0);
+    EXPECT_EQUAL(cache.hits(), 0);
+    EXPECT_EQUAL(cache.misses(), 2);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
@@ -0,0 +1,327 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/Action.h"
+#include "multio/action/interpolate-fesom/InterpolateFesom.h"
+#include "multio/config/ComponentConfiguration.h"
+#include "multio/config/MultioConfiguration.h"
+#include "multio/message/Message.h"
+#include "multio/message/ValueStatistics.h"
+
+namespace multio::test {
+
+using multio::action::Action;
+using multio::action::ActionFactory;
+using multio::action::interpolateFESOM::Fesom2HEALPix;
+using multio::action::interpolateFESOM::fesomCacheName;
+using multio::action::interpolateFESOM::FesomMatrix;
+using multio::action::interpolateFESOM::orderingConvention_e;
+using multio::action::interpolateFESOM::writeFlatCache;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+using multio::message::ValueStatistics;
+
+namespace {
+
+constexpr std::size_t NSIDE = 1;
+constexpr std::size_t SOURCE_SIZE = 8;
+constexpr std::size_t TARGET_SIZE = 12 * NSIDE * NSIDE;
+constexpr double MISSING = -999.0;
+
+constexpr std::size_t LARGE_SOURCE_SIZE = 20011;
+constexpr std::int32_t LARGE_TARGET_SIZE = 12 * 64 * 64;
+
+// Matrix with rows of 1 to 11 non-zeros. With `exact`, weights and input values are multiples of powers of two, so
+// that all products and sums are exact and the comparisons do not depend on floating point contraction.
+struct TestMatrix {
+    std::vector<std::int32_t> landSeaMask;
+    std::vector<std::int32_t> rowStart{0};
+    std::vector<std::int32_t> colIdx;
+    std::vector<double> values;
+    FesomMatrix<double> matrix;
+
+    TestMatrix(std::vector<std::int32_t> outputs, std::size_t nCols, std::size_t nOutRows, bool exact) :
+        landSeaMask{std::move(outputs)} {
+        for (std::size_t iRow = 0; iRow < landSeaMask.size(); ++iRow) {
+            const std::size_t nnz = 1 + (5 * iRow) % 11;
+            for (std::size_t k = 0; k < nnz; ++k) {
+                colIdx.push_back(static_cast<std::int32_t>((iRow + 3 * k) % nCols));
+                values.push_back(exact ? 0.125 * static_cast<double>(1 + (iRow + k) % 7)
+                                       : 1.0 / static_cast<double>(3 + (iRow + k) % 7));
+            }
+            rowStart.push_back(static_cast<std::int32_t>(colIdx.size()));
+        }
+        matrix.nnz = values.size();
+        matrix.nRows = landSeaMask.size();
+        matrix.nCols = nCols;
+        matrix.nOutRows = nOutRows;
+        matrix.landSeaMask = landSeaMask.data();
+        matrix.rowStart = rowStart.data();
+        matrix.colIdx = colIdx.data();
+        matrix.values = values.data();
+    }
+};
+
+// Matrix on HEALPix H1, rows sorted by output point (as written by the cache generator) and not
+std::shared_ptr<const FesomMatrix<double>> makeMatrix(bool sorted) {
+    auto owner = std::make_shared<TestMatrix>(sorted ? std::vector<std::int32_t>{0, 2, 3, 5, 6, 7, 9, 11}
+                                                     : std::vector<std::int32_t>{7, 0, 11, 3, 9, 2, 6, 5},
+                                              SOURCE_SIZE, TARGET_SIZE, true);
+    return {owner, &owner->matrix};
+}
+
+// Matrix on HEALPix H64 large enough to be split between threads, two of three output points are covered
+std::shared_ptr<const FesomMatrix<double>> makeLargeMatrix() {
+    std::vector<std::int32_t> outputs;
+    for (std::int32_t i = 0; i < LARGE_TARGET_SIZE; ++i) {
+        if (i % 3 != 1) {
+            outputs.push_back(i);
+        }
+    }
+    auto owner = std::make_shared<TestMatrix>(std::move(outputs), LARGE_SOURCE_SIZE, LARGE_TARGET_SIZE, false);
+    return {owner, &owner->matrix};
+}
+
+template <typename T>
+std::vector<std::vector<T>> makeFields(std::size_t nFields) {
+    std::vector<std::vector<T>> fields(nFields, std::vector<T>(SOURCE_SIZE));
+    for (std::size_t iField = 0; iField < nFields; ++iField) {
+        for (std::size_t i = 0; i < SOURCE_SIZE; ++i) {
+            fields[iField][i] = static_cast<T>(0.25 * static_cast<double>((7 * i + 3 * iField) % 29) - 3.0);
+        }
+    }
+    return fields;
+}
+
+bool sameStatistics(const ValueStatistics& a, const ValueStatistics& b) {
+    return a.min == b.min && a.max == b.max && a.valid == b.valid && a.missing == b.missing;
+}
+
+template <typename In, typename Out>
+void compareBatchWithFields(bool sorted) {
+    constexpr std::size_t nFields = 5;
+    Fesom2HEALPix<double> interpolator{makeMatrix(sorted)};
+    const auto fields = makeFields<In>(nFields);
+
+    std::vector<std::vector<Out>> expected(nFields, std::vector<Out>(TARGET_SIZE));
+    std::vector<ValueStatistics> expectedStats(nFields);
+    for (std::size_t iField = 0; iField < nFields; ++iField) {
+        interpolator.interpolate(fields[iField].data(), expected[iField].data(), SOURCE_SIZE, TARGET_SIZE,
+                                 static_cast<Out>(MISSING), 1, &expectedStats[iField]);
+    }
+
+    std::vector<std::vector<Out>> outputs(nFields, std::vector<Out>(TARGET_SIZE));
+    std::vector<const In*> in;
+    std::vector<Out*> out;
+    for (std::size_t iField = 0; iField < nFields; ++iField) {
+        in.push_back(fields[iField].data());
+        out.push_back(outputs[iField].data());
+    }
+    std::vector<ValueStatistics> stats(nFields);
+    interpolator.interpolateBatch(in.data(), out.data(), nFields, SOURCE_SIZE, TARGET_SIZE, static_cast<Out>(MISSING),
+                                  stats.data());
+
+    for (std::size_t iField = 0; iField < nFields; ++iField) {
+        EXPECT(outputs[iField] == expected[iField]);
+        EXPECT(sameStatistics(stats[iField], expectedStats[iField]));
+        EXPECT_EQUAL(stats[iField].missing, TARGET_SIZE - 8);
+    }
+}
+
+template <typename Out>
+void compareThreads() {
+    Fesom2HEALPix<double> interpolator{makeLargeMatrix()};
+    std::vector<double> field(LARGE_SOURCE_SIZE);
+    for (std::size_t i = 0; i < field.size(); ++i) {
+        field[i] = 280.0 + std::sin(0.001 * static_cast<double>(i)) / 3.0;
+    }
+
+    std::vector<Out> expected(LARGE_TARGET_SIZE);
+    ValueStatistics expectedStats;
+    interpolator.interpolate(field.data(), expected.data(), field.size(), expected.size(), static_cast<Out>(MISSING), 1,
+                             &expectedStats);
+    EXPECT_EQUAL(expectedStats.missing, static_cast<std::size_t>(LARGE_TARGET_SIZE / 3));
+
+    for (const std::size_t threads : {2, 3, 4, 8}) {
+        std::vector<Out> out(LARGE_TARGET_SIZE);
+        ValueStatistics stats;
+        interpolator.interpolate(field.data(), out.data(), field.size(), out.size(), static_cast<Out>(MISSING),
+                                 threads, &stats);
+        EXPECT(std::memcmp(out.data(), expected.data(), out.size() * sizeof(Out)) == 0);
+        EXPECT(sameStatistics(stats, expectedStats));
+    }
+}
+
+// Last action of the test plans, keeps everything it receives
+std::vector<Message> captured;
+
+class Capture final : public Action {
+public:
+    explicit Capture(const config::ComponentConfiguration& compConf) : Action{compConf} {}
+
+private:
+    void executeImpl(Message msg) override { captured.push_back(std::move(msg)); }
+
+    void print(std::ostream& os) const override { os << "Capture()"; }
+};
+
+action::ActionBuilder<Capture> CaptureBuilder("test-capture");
+
+config::MultioConfiguration& multioConfig() {
+    static config::MultioConfiguration multioConf{};
+    return multioConf;
+}
+
+std::string writeTestCache() {
+    const std::string file = "./" + fesomCacheName("test", "ocean", "double", NSIDE, orderingConvention_e::RING, 0)
+                           + ".csr";
+    writeFlatCache(file, NSIDE, 0, *makeMatrix(true));
+    return file;
+}
+
+std::unique_ptr<Action> makeInterpolateFesom(long batchSize) {
+    eckit::LocalConfiguration next;
+    next.set("type", "test-capture");
+
+    eckit::LocalConfiguration conf;
+    conf.set("type", "interpolate-fesom-double");
+    conf.set("nside", static_cast<long>(NSIDE));
+    conf.set("missing-value", MISSING);
+    conf.set("cache-path", ".");
+    conf.set("batch-size", batchSize);
+    conf.set("next", next);
+
+    captured.clear();
+    return ActionFactory::instance().build("interpolate-fesom-double",
+                                           config::ComponentConfiguration{conf, multioConfig()});
+}
+
+template <typename T>
+Message makeField(const std::vector<T>& values) {
+    Metadata md;
+    md.set("unstructuredGridType", std::string{"test"});
+    md.set("domain", std::string{"ocean"});
+    md.set("category", std::string{"ocean-2d"});
+    md.set("precision", std::string{sizeof(T) == 4 ? "single" : "double"});
+    md.set("globalSize", static_cast<std::int64_t>(values.size()));
+
+    eckit::Buffer payload{values.size() * sizeof(T)};
+    std::memcpy(payload.data(), values.data(), values.size() * sizeof(T));
+
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                   std::move(payload)};
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Batches are interpolated like single fields") {
+    compareBatchWithFields<double, double>(true);
+    compareBatchWithFields<float, double>(true);
+    compareBatchWithFields<float, float>(true);
+    compareBatchWithFields<double, float>(true);
+}
+
+CASE("Batches are interpolated like single fields with unsorted rows") {
+    compareBatchWithFields<double, double>(false);
+    compareBatchWithFields<float, float>(false);
+}
+
+CASE("The output does not depend on the number of threads") {
+    EXPECT(makeLargeMatrix()->nnz > 4 * (1 << 15));
+    compareThreads<double>();
+    compareThreads<float>();
+}
+
+CASE("Pending batches are forwarded when the action is destroyed") {
+    const auto file = writeTestCache();
+    const auto fields = makeFields<double>(2);
+
+    auto single = makeInterpolateFesom(1);
+    single->execute(makeField(fields[0]));
+    single->execute(makeField(fields[1]));
+    EXPECT_EQUAL(captured.size(), 2);
+    const auto expected = captured;
+
+    auto batched = makeInterpolateFesom(3);
+    batched->execute(makeField(fields[0]));
+    batched->execute(makeField(fields[1]));
+    EXPECT(captured.empty());
+
+    batched.reset();
+    EXPECT_EQUAL(captured.size(), 2);
+    for (std::size_t i = 0; i < captured.size(); ++i) {
+        EXPECT_EQUAL(captured[i].size(), expected[i].size());
+        EXPECT(std::memcmp(captured[i].payload().data(), expected[i].payload().data(), expected[i].size()) == 0);
+        EXPECT_EQUAL(captured[i].metadata().get<double>("minimumValue"),
+                     expected[i].metadata().get<double>("minimumValue"));
+        EXPECT_EQUAL(captured[i].metadata().get<double>("maximumValue"),
+                     expected[i].metadata().get<double>("maximumValue"));
+    }
+
+    single.reset();
+    eckit::PathName{file}.unlink();
+}
+
+CASE("Pending batches are forwarded in the order the fields were received") {
+    const auto file = writeTestCache();
+    const auto fields = makeFields<double>(2);
+    const auto floatFields = makeFields<float>(2);
+
+    // Fields of different precisions are batched separately
+    std::vector<Message> received{makeField(fields[0]), makeField(floatFields[1]), makeField(fields[1])};
+
+    auto single = makeInterpolateFesom(1);
+    for (const auto& msg : received) {
+        single->execute(msg);
+    }
+    EXPECT_EQUAL(captured.size(), 3);
+    const auto expected = captured;
+
+    auto batched = makeInterpolateFesom(3);
+    for (const auto& msg : received) {
+        batched->execute(msg);
+    }
+    EXPECT(captured.empty());
+
+    batched.reset();
+    EXPECT_EQUAL(captured.size(), 3);
+    for (std::size_t i = 0; i < captured.size(); ++i) {
+        EXPECT_EQUAL(captured[i].metadata().get<std::string>("precision"),
+                     expected[i].metadata().get<std::string>("precision"));
+        EXPECT_EQUAL(captured[i].size(), expected[i].size());
+        EXPECT(std::memcmp(captured[i].payload().data(), expected[i].payload().data(), expected[i].size()) == 0);
+    }
+
+    single.reset();
+    eckit::PathName{file}.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
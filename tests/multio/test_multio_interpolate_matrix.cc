@@ -0,0 +1,184 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/Action.h"
+#include "multio/action/interpolate-fesom/FesomMatrixStore.h"
+#include "multio/action/interpolate-matrix/InterpolateMatrix.h"
+#include "multio/action/interpolate-matrix/MatrixCache.h"
+#include "multio/config/ComponentConfiguration.h"
+#include "multio/config/MultioConfiguration.h"
+#include "multio/message/Message.h"
+
+namespace multio::test {
+
+using multio::action::Action;
+using multio::action::ActionFactory;
+using multio::action::interpolateFESOM::FesomMatrixStore;
+using multio::action::interpolateFESOM::writeAtlasCache;
+using multio::action::interpolateFESOM::writeFlatCache;
+using multio::action::interpolateMatrix::buildMatrixWeights;
+using multio::action::interpolateMatrix::SparseMatrixInterpolator;
+using multio::action::interpolateMatrix::findMatrixCache;
+using multio::action::interpolateMatrix::matrixCacheName;
+using multio::action::interpolateMatrix::Triplet;
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::Peer;
+
+namespace {
+
+constexpr std::size_t SOURCE_SIZE = 4;
+constexpr std::size_t TARGET_SIZE = 6;
+
+// Unsorted, with a weight split over two triplets. Target points 0, 2 and 5 have no weights (e.g. land points).
+std::vector<Triplet> testTriplets() {
+    return {{4, 3, 0.5}, {1, 1, 0.75}, {3, 2, 1.0}, {1, 0, 0.25}, {4, 1, 0.25}, {4, 1, 0.25}};
+}
+
+// Last action of the test plans, drops everything it receives
+class Discard final : public Action {
+public:
+    explicit Discard(const config::ComponentConfiguration& compConf) : Action{compConf} {}
+
+private:
+    void executeImpl(Message) override {}
+
+    void print(std::ostream& os) const override { os << "Discard()"; }
+};
+
+action::ActionBuilder<Discard> DiscardBuilder("test-discard");
+
+config::MultioConfiguration& multioConfig() {
+    static config::MultioConfiguration multioConf{};
+    return multioConf;
+}
+
+// Without missing-value
+eckit::LocalConfiguration actionConfig() {
+    eckit::LocalConfiguration next;
+    next.set("type", "test-discard");
+
+    eckit::LocalConfiguration conf;
+    conf.set("type", "interpolate-matrix");
+    conf.set("cache-path", ".");
+    conf.set("target-grid", "test6");
+    conf.set("next", next);
+    return conf;
+}
+
+std::unique_ptr<Action> makeAction(const eckit::LocalConfiguration& conf) {
+    return ActionFactory::instance().build("interpolate-matrix", config::ComponentConfiguration{conf, multioConfig()});
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Weights are sorted into rows of target points") {
+    const auto weights = buildMatrixWeights<double>(testTriplets(), SOURCE_SIZE, TARGET_SIZE);
+    EXPECT(weights.nCols == SOURCE_SIZE);
+    EXPECT(weights.nOutRows == TARGET_SIZE);
+    EXPECT(weights.landSeaMask == (std::vector<std::int32_t>{1, 3, 4}));
+    EXPECT(weights.rowStart == (std::vector<std::int32_t>{0, 2, 3, 5}));
+    EXPECT(weights.colIdx == (std::vector<std::int32_t>{0, 1, 2, 1, 3}));
+    EXPECT(weights.values == (std::vector<double>{0.25, 0.75, 1.0, 0.5, 0.5}));
+}
+
+CASE("Weights outside of the grids are rejected") {
+    EXPECT_THROWS_AS(buildMatrixWeights<double>({{6, 0, 1.0}}, SOURCE_SIZE, TARGET_SIZE), eckit::UserError);
+    EXPECT_THROWS_AS(buildMatrixWeights<double>({{0, 4, 1.0}}, SOURCE_SIZE, TARGET_SIZE), eckit::UserError);
+    EXPECT_THROWS_AS(buildMatrixWeights<double>({{-1, 0, 1.0}}, SOURCE_SIZE, TARGET_SIZE), eckit::UserError);
+}
+
+CASE("Caches are found by source grid and target grid, flat caches first") {
+    const std::string uuid = "0123456789abcdef0123456789abcdef";
+    const auto weights = buildMatrixWeights<double>(testTriplets(), SOURCE_SIZE, TARGET_SIZE);
+    const std::string base = "./" + matrixCacheName(uuid, "test6", "double");
+
+    EXPECT(!findMatrixCache(".", uuid, "test6", "double"));
+    writeAtlasCache(base + ".atlas", 0, 0, weights.view());
+    EXPECT(findMatrixCache(".", uuid, "test6", "double") == base + ".atlas");
+    writeFlatCache(base + ".csr", 0, 0, weights.view());
+    EXPECT(findMatrixCache(".", uuid, "test6", "double") == base + ".csr");
+    EXPECT(!findMatrixCache(".", uuid, "other", "double"));
+    EXPECT(!findMatrixCache(".", uuid, "test6", "single"));
+
+    // Both formats hold the same interpolation
+    const std::vector<float> source{1.0, 2.0, 3.0, 4.0};
+    const float missing = -999.0;
+    const std::vector<float> expected{missing, 1.75, missing, 3.0, 3.0, missing};
+    for (const auto& file : {base + ".csr", base + ".atlas"}) {
+        SparseMatrixInterpolator<double> interp{FesomMatrixStore::instance().get<double>(file), "test"};
+        EXPECT(interp.nCols() == SOURCE_SIZE);
+        std::vector<float> target(TARGET_SIZE);
+        multio::message::ValueStatistics stats;
+        interp.interpolate(source.data(), target.data(), SOURCE_SIZE, TARGET_SIZE, missing, 1, &stats);
+        EXPECT(target == expected);
+        EXPECT(stats.missing == 3);
+        EXPECT(stats.min == 1.75);
+        EXPECT(stats.max == 3.0);
+
+        // Errors name the user of the interpolator
+        try {
+            interp.interpolate(source.data(), target.data(), SOURCE_SIZE, TARGET_SIZE - 1, missing);
+            EXPECT(false);
+        }
+        catch (const eckit::SeriousBug& e) {
+            EXPECT(std::string{e.what()}.find("test: wrong output size") != std::string::npos);
+        }
+    }
+
+    eckit::PathName{base + ".atlas"}.unlink();
+    eckit::PathName{base + ".csr"}.unlink();
+}
+
+CASE("The missing value is required and has to be a number") {
+    auto conf = actionConfig();
+    EXPECT_THROWS_AS(makeAction(conf), eckit::UserError);
+
+    conf.set("missing-value", "none");
+    EXPECT_THROWS_AS(makeAction(conf), eckit::UserError);
+
+    conf.set("missing-value", -999.0);
+    EXPECT(makeAction(conf));
+}
+
+CASE("Fields with missing values are rejected") {
+    auto conf = actionConfig();
+    conf.set("missing-value", -999.0);
+    auto action = makeAction(conf);
+
+    Metadata md;
+    md.set("uuidOfHGrid", std::string{"0123456789abcdef0123456789abcdef"});
+    md.set("precision", std::string{"double"});
+    md.set("bitmapPresent", true);
+    md.set("missingValue", -999.0);
+    Message field{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, std::move(md)},
+                  eckit::Buffer{SOURCE_SIZE * sizeof(double)}};
+
+    EXPECT_THROWS_AS(action->execute(std::move(field)), eckit::UserError);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
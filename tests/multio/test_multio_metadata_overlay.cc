@@ -0,0 +1,206 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/message/Message.h"
+#include "multio/message/MetadataMapping.h"
+#include "multio/message/MetadataOverlay.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Count heap allocations to check that metadata is not copied
+namespace {
+std::atomic<std::size_t> allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace multio::test {
+
+using multio::message::Message;
+using multio::message::Metadata;
+using multio::message::MetadataMapping;
+using multio::message::MetadataOverlay;
+using multio::message::MetadataValue;
+using multio::message::Peer;
+using multio::message::SharedMetadata;
+
+namespace {
+
+constexpr std::int64_t NKEYS = 100;
+
+Metadata makeMetadata() {
+    Metadata md;
+    for (std::int64_t i = 0; i < NKEYS; ++i) {
+        md.set("key" + std::to_string(i), i);
+    }
+    md.set("paramId", std::int64_t{130});
+    md.set("precision", std::string{"double"});
+    return md;
+}
+
+Message makeMessage() {
+    return Message{Message::Header{Message::Tag::Field, Peer{"test", 0}, Peer{"test", 1}, makeMetadata()}};
+}
+
+template <typename Func>
+std::size_t countAllocations(Func&& func) {
+    const std::size_t before = allocations;
+    func();
+    return allocations - before;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Look ups go through the layers") {
+    const Metadata base{{"a", 1}, {"b", 2}, {"c", 3}};
+    const Metadata layer{{"b", 20}};
+
+    MetadataOverlay md{base};
+    md.push(layer);
+    md.set("c", 300);
+    md.set("d", std::string{"new"});
+
+    EXPECT_EQUAL(md.get<std::int64_t>("a"), 1);
+    EXPECT_EQUAL(md.get<std::int64_t>("b"), 20);
+    EXPECT_EQUAL(md.get<std::int64_t>("c"), 300);
+    EXPECT_EQUAL(md.get<std::string>("d"), "new");
+    EXPECT(md.find("e") == md.end());
+    EXPECT(!md.getOpt<std::int64_t>("e"));
+    EXPECT_THROWS_AS(md.get<std::int64_t>("e"), message::MetadataMissingKeyException);
+
+    std::size_t visited = 0;
+    md.forEach([&](const auto&) { ++visited; });
+    EXPECT_EQUAL(visited, 4);
+
+    const auto flat = md.flatten();
+    EXPECT_EQUAL(flat.size(), 4);
+    EXPECT_EQUAL(flat.get<std::int64_t>("b"), 20);
+    EXPECT_EQUAL(flat.get<std::int64_t>("c"), 300);
+
+    // Layers are not modified
+    EXPECT_EQUAL(base.get<std::int64_t>("c"), 3);
+    EXPECT(base.find("d") == base.end());
+}
+
+CASE("Keys set on shared metadata do not copy it") {
+    const auto msg = makeMessage();
+
+    Message copied{msg};
+    Message overlaid{msg};
+    std::size_t copyAllocations = countAllocations([&] {
+        copied.acquire();
+        copied.modifyMetadata().set("missingValue", 9999.0);
+        copied.modifyMetadata().set("bitmapPresent", true);
+    });
+    std::size_t overlayAllocations = countAllocations([&] {
+        overlaid.acquire();
+        overlaid.modifyMetadataOverlay().set("missingValue", 9999.0);
+        overlaid.modifyMetadataOverlay().set("bitmapPresent", true);
+    });
+
+    eckit::Log::info() << "Setting 2 keys on shared metadata with " << msg.metadata().size()
+                       << " keys :: copy " << copyAllocations << " allocations, overlay " << overlayAllocations
+                       << " allocations" << std::endl;
+    EXPECT(copyAllocations > NKEYS);
+    EXPECT(overlayAllocations < 10);
+
+    // Pending keys are visible without merging, the original message is unchanged
+    EXPECT(overlaid.sharedMetadata().overlay() != nullptr);
+    EXPECT_EQUAL(overlaid.sharedMetadata().getOpt<double>("missingValue").value(), 9999.0);
+    EXPECT_EQUAL(overlaid.precision(), util::PrecisionTag::Double);
+    EXPECT(overlaid.sharedMetadata().overlay() != nullptr);
+
+    const MetadataOverlay view{overlaid.sharedMetadata()};
+    EXPECT(view.get<bool>("bitmapPresent"));
+    EXPECT_EQUAL(view.get<std::int64_t>("key42"), 42);
+    EXPECT(msg.metadata().find("missingValue") == msg.metadata().end());
+
+    // Reading does not merge, the full metadata is only available once the overlay has been merged
+    const Message reader{overlaid};
+    EXPECT_THROWS_AS(reader.metadata(), eckit::AssertionFailed);
+    EXPECT(reader.sharedMetadata().overlay() != nullptr);
+    EXPECT_EQUAL(reader.fieldId(), overlaid.fieldId());
+    EXPECT(reader.sharedMetadata().overlay() != nullptr);
+
+    overlaid.mergeMetadataOverlay();
+    EXPECT(overlaid.sharedMetadata().overlay() == nullptr);
+    EXPECT_EQUAL(overlaid.metadata().size(), msg.metadata().size() + 2);
+    EXPECT(reader.sharedMetadata().overlay() != nullptr);
+    EXPECT(msg.metadata().find("missingValue") == msg.metadata().end());
+}
+
+CASE("Metadata that is not shared is modified in place") {
+    auto msg = makeMessage();
+    msg.acquire();
+    msg.modifyMetadataOverlay().set("missingValue", 9999.0);
+    EXPECT(msg.sharedMetadata().overlay() == nullptr);
+    EXPECT_EQUAL(msg.sharedMetadata().base().get<double>("missingValue"), 9999.0);
+}
+
+CASE("Mappings applied to the overlay match mappings applied in place") {
+    MetadataMapping::DataMapping data;
+    data.emplace(MetadataValue{std::int64_t{130}}, Metadata{{"shortName", std::string{"t"}}, {"key1", 1000}});
+    const MetadataMapping mapping{"paramId", std::move(data)};
+
+    for (const bool overwrite : {true, false}) {
+        message::MetadataMappingOptions options;
+        options.overwriteExisting = overwrite;
+
+        auto expected = makeMetadata();
+        mapping.applyInplace(expected, options);
+
+        const auto msg = makeMessage();
+        Message mapped{msg};
+        mapped.acquireMetadata();
+        const auto mappingAllocations
+            = countAllocations([&] { mapping.applyInplace(mapped.header().modifySharedMetadata(), options); });
+        EXPECT(mappingAllocations < NKEYS);
+
+        mapped.mergeMetadataOverlay();
+        const auto& result = mapped.metadata();
+        EXPECT_EQUAL(result.size(), expected.size());
+        EXPECT_EQUAL(result.get<std::string>("shortName"), "t");
+        EXPECT_EQUAL(result.get<std::int64_t>("key1"), expected.get<std::int64_t>("key1"));
+        EXPECT_EQUAL(msg.metadata().get<std::int64_t>("key1"), 1);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
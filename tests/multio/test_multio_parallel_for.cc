@@ -0,0 +1,91 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/util/ParallelFor.h"
+
+namespace multio::test {
+
+using multio::util::parallelFor;
+using multio::util::ParallelForPool;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("All indices are visited once, in contiguous chunks") {
+    constexpr std::size_t size = 10007;
+    std::vector<int> visits(size, 0);
+    std::vector<std::size_t> begins(4);
+    parallelFor(4, size, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        begins[chunk] = begin;
+        for (std::size_t i = begin; i < end; ++i) {
+            ++visits[i];
+        }
+    });
+
+    EXPECT(visits == std::vector<int>(size, 1));
+    EXPECT(begins == (std::vector<std::size_t>{0, size / 4, size / 2, 3 * size / 4}));
+}
+
+CASE("Workers are reused across calls") {
+    std::atomic<std::size_t> sum{0};
+    for (int call = 0; call < 100; ++call) {
+        parallelFor(3, 300, [&](std::size_t, std::size_t begin, std::size_t end) { sum += end - begin; });
+    }
+    EXPECT_EQUAL(sum.load(), 100 * 300);
+
+    const auto workers = ParallelForPool::instance().workers();
+    EXPECT(workers >= 2);
+    for (int call = 0; call < 100; ++call) {
+        parallelFor(3, 300, [](std::size_t, std::size_t, std::size_t) {});
+    }
+    EXPECT_EQUAL(ParallelForPool::instance().workers(), workers);
+}
+
+CASE("Nested calls complete") {
+    std::atomic<std::size_t> count{0};
+    parallelFor(4, 4, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            parallelFor(4, 100, [&](std::size_t, std::size_t b, std::size_t e) { count += e - b; });
+        }
+    });
+    EXPECT_EQUAL(count.load(), 400);
+}
+
+CASE("Exceptions of any chunk are rethrown after all chunks are done") {
+    std::atomic<int> done{0};
+    EXPECT_THROWS_AS(parallelFor(4, 400,
+                                 [&](std::size_t chunk, std::size_t, std::size_t) {
+                                     ++done;
+                                     if (chunk == 2) {
+                                         throw eckit::SeriousBug("chunk failed");
+                                     }
+                                 }),
+                     eckit::SeriousBug);
+    EXPECT_EQUAL(done.load(), 4);
+
+    // The pool stays usable
+    std::atomic<std::size_t> sum{0};
+    parallelFor(4, 400, [&](std::size_t, std::size_t begin, std::size_t end) { sum += end - begin; });
+    EXPECT_EQUAL(sum.load(), 400);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
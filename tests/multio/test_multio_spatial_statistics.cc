@@ -0,0 +1,195 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "multio/action/spatial-statistics/SpatialReduction.h"
+
+namespace multio::test {
+
+using multio::action::GridWeights;
+using multio::action::spatialStatistics::Partial;
+using multio::action::spatialStatistics::reduceRows;
+using multio::action::spatialStatistics::rowBands;
+using multio::action::spatialStatistics::weightedPercentiles;
+
+namespace {
+
+constexpr float MISSING = 9999.0;
+
+// Three rows at 60N, 0 and 60S with 2, 4 and 2 points, the weights of all points sum to 1
+GridWeights testWeights() {
+    return GridWeights{"test", {60.0, 0.0, -60.0}, {0.1, 0.15, 0.1}, {0, 2, 6, 8}};
+}
+
+bool close(double a, double b) {
+    return std::abs(a - b) <= 1e-12;
+}
+
+Partial reduce(const std::vector<float>& values, const GridWeights& weights, long bands, bool haveMissing) {
+    Partial partial{static_cast<std::size_t>(bands)};
+    reduceRows(values.data(), weights, rowBands(weights, bands), 0, weights.rows(), haveMissing, MISSING, partial);
+    return partial;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Global mean, minimum and maximum are area weighted") {
+    const auto weights = testWeights();
+    const std::vector<float> values{1, 3, 2, 4, 6, 8, -1, 5};
+
+    const auto total = reduce(values, weights, 3, false);
+    // 0.1 * (1 + 3) + 0.15 * (2 + 4 + 6 + 8) + 0.1 * (-1 + 5)
+    EXPECT(close(total.sum, 3.8));
+    EXPECT(close(total.weight, 1.0));
+    EXPECT(total.min == -1.0);
+    EXPECT(total.max == 8.0);
+
+    // One band per row
+    EXPECT(rowBands(weights, 3) == (std::vector<std::size_t>{0, 1, 2}));
+    EXPECT(close(total.bandSum[0] / total.bandWeight[0], 2.0));
+    EXPECT(close(total.bandSum[1] / total.bandWeight[1], 5.0));
+    EXPECT(close(total.bandSum[2] / total.bandWeight[2], 2.0));
+}
+
+CASE("Missing values are skipped, bands without valid points stay empty") {
+    const auto weights = testWeights();
+    const std::vector<float> values{1, 3, 2, MISSING, 6, MISSING, MISSING, MISSING};
+
+    const auto total = reduce(values, weights, 3, true);
+    // 0.1 * (1 + 3) + 0.15 * (2 + 6) over 0.1 * 2 + 0.15 * 2
+    EXPECT(close(total.sum / total.weight, 3.2));
+    EXPECT(total.min == 1.0);
+    EXPECT(total.max == 6.0);
+    EXPECT(close(total.bandSum[1] / total.bandWeight[1], 4.0));
+    EXPECT(total.bandWeight[2] == 0.0);
+
+    // Without a bitmap the missing value is an ordinary value
+    EXPECT(reduce(values, weights, 3, false).max == MISSING);
+
+    // All points missing
+    const std::vector<float> allMissing(weights.size(), MISSING);
+    const auto none = reduce(allMissing, weights, 3, true);
+    EXPECT(none.weight == 0.0);
+    EXPECT(none.min > none.max);
+}
+
+CASE("Zonal bands without rows are empty") {
+    const auto weights = testWeights();
+    const std::vector<float> values{1, 3, 2, 4, 6, 8, -1, 5};
+
+    // Bands of 30 degrees: the rows are in bands 1, 3 and 5
+    EXPECT(rowBands(weights, 6) == (std::vector<std::size_t>{1, 3, 5}));
+    const auto total = reduce(values, weights, 6, false);
+    for (const std::size_t b : {0, 2, 4}) {
+        EXPECT(total.bandWeight[b] == 0.0);
+        EXPECT(total.bandSum[b] == 0.0);
+    }
+    EXPECT(close(total.bandSum[3] / total.bandWeight[3], 5.0));
+
+    // A single band is the global mean
+    EXPECT(close(reduce(values, weights, 1, false).bandSum[0], 3.8));
+}
+
+CASE("Partials of row ranges merge to the reduction of all rows") {
+    const auto weights = testWeights();
+    const std::vector<float> values{1, 3, 2, MISSING, 6, 8, MISSING, 5};
+    const auto rowBand = rowBands(weights, 3);
+
+    Partial north{3};
+    Partial south{3};
+    reduceRows(values.data(), weights, rowBand, 0, 1, true, MISSING, north);
+    reduceRows(values.data(), weights, rowBand, 1, 3, true, MISSING, south);
+    north.merge(south);
+
+    const auto total = reduce(values, weights, 3, true);
+    EXPECT(close(north.sum, total.sum));
+    EXPECT(close(north.weight, total.weight));
+    EXPECT(north.min == total.min);
+    EXPECT(north.max == total.max);
+    EXPECT(north.bandSum == total.bandSum);
+    EXPECT(north.bandWeight == total.bandWeight);
+}
+
+CASE("Percentiles are area weighted") {
+    const auto weights = testWeights();
+    const std::vector<float> values{1, 3, 2, 4, 6, 8, -1, 5};
+
+    // Sorted values with their weights: -1 (0.1), 1 (0.1), 2 (0.15), 3 (0.1), 4 (0.15), 5 (0.1), 6 (0.15), 8 (0.15)
+    const auto result = weightedPercentiles(values.data(), weights, false, MISSING, {100.0, 0.0, 50.0});
+    EXPECT(result == (std::vector<double>{8.0, -1.0, 4.0}));
+
+    // Without 2, 4 and 8: -1 (0.1), 1 (0.1), 3 (0.1), 5 (0.1), 6 (0.15)
+    const std::vector<float> withMissing{1, 3, MISSING, MISSING, 6, MISSING, -1, 5};
+    EXPECT(weightedPercentiles(withMissing.data(), weights, true, MISSING, {50.0}) == std::vector<double>{3.0});
+
+    const std::vector<float> allMissing(weights.size(), MISSING);
+    EXPECT(weightedPercentiles(allMissing.data(), weights, true, MISSING, {50.0})
+           == std::vector<double>{static_cast<double>(MISSING)});
+}
+
+CASE("Percentiles by selection match the sorted field") {
+    // Weights are multiples of 1/64, so all partial sums are exact and independent of the summation order
+    const std::size_t rows = 50;
+    std::vector<double> latitudes(rows);
+    std::vector<double> rowWeights(rows);
+    std::vector<std::size_t> rowOffsets{0};
+    for (std::size_t j = 0; j < rows; ++j) {
+        latitudes[j] = 90.0 - 180.0 * (static_cast<double>(j) + 0.5) / static_cast<double>(rows);
+        rowWeights[j] = static_cast<double>(1 + j % 7) / 64.0;
+        rowOffsets.push_back(rowOffsets.back() + 20 + (j * 13) % 40);
+    }
+    const GridWeights weights{"test", latitudes, rowWeights, rowOffsets};
+
+    // Few distinct values, so that many points are tied
+    std::vector<float> values(weights.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<float>((i * 7919) % 101) - 50.0f;
+    }
+
+    std::vector<std::pair<float, double>> sorted;
+    double total = 0.0;
+    for (std::size_t j = 0; j < weights.rows(); ++j) {
+        for (std::size_t i = weights.rowOffsets[j]; i < weights.rowOffsets[j + 1]; ++i) {
+            sorted.emplace_back(values[i], weights.rowWeights[j]);
+            total += weights.rowWeights[j];
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const std::vector<double> percentiles{0.0, 1.0, 10.0, 25.0, 33.3, 50.0, 75.0, 90.0, 99.0, 100.0};
+    const auto result = weightedPercentiles(values.data(), weights, false, MISSING, percentiles);
+    for (std::size_t k = 0; k < percentiles.size(); ++k) {
+        const double target = percentiles[k] / 100.0 * total;
+        double cumulative = 0.0;
+        std::size_t i = 0;
+        while (i + 1 < sorted.size() && cumulative + sorted[i].second < target) {
+            cumulative += sorted[i].second;
+            ++i;
+        }
+        EXPECT_EQUAL(result[k], static_cast<double>(sorted[i].first));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}
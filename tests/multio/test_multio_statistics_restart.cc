@@ -0,0 +1,180 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "multio/action/statistics/RestartRecord.h"
+#include "multio/action/statistics/StatisticsIO.h"
+
+namespace multio::test {
+
+using multio::action::IOBuffer;
+using multio::action::RestartRecord;
+using multio::action::StatisticsIO;
+using multio::action::StatisticsIOFactory;
+
+namespace {
+
+const std::string RECORD = "operation";
+
+std::shared_ptr<StatisticsIO> makeIO(const std::string& suffix) {
+    auto io = StatisticsIOFactory::instance().build("fstream_io", ".", "RestartRecordTest");
+    io->setKey("key");
+    io->setSuffix(suffix);
+    io->setCurrStep(1);
+    return io;
+}
+
+// Compressors to test: "none" and the ones eckit was built with
+std::vector<std::string> compressors() {
+    std::vector<std::string> names{"none"};
+    for (const std::string name : {"lz4", "snappy", "aec", "bzip2"}) {
+        if (multio::action::restart::isCompressorAvailable(name)) {
+            names.push_back(name);
+        }
+    }
+    return names;
+}
+
+template <typename T>
+std::vector<T> testValues(std::size_t size, double offset) {
+    std::vector<T> values(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        values[i] = static_cast<T>(offset + std::sin(0.01 * static_cast<double>(i)) * 100.0);
+    }
+    return values;
+}
+
+std::string restartFile(const std::string& suffix) {
+    return "./RestartRecordTest/key/" + suffix + "/" + RECORD + "-0000000001.fstreamIO";
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Single precision records round-trip bitwise with all compressors") {
+    for (const auto& compressor : compressors()) {
+        auto io = makeIO("float_" + compressor);
+        const auto values = testValues<float>(10000, 273.15);
+        const auto counts = testValues<float>(10000, 0.0);
+        RestartRecord<float>{RECORD, compressor}.dump(io, {&values, &counts});
+
+        std::vector<float> loadedValues(values.size());
+        std::vector<float> loadedCounts(counts.size());
+        RestartRecord<float>{RECORD, compressor}.load(io, {&loadedValues, &loadedCounts});
+        EXPECT(loadedValues == values);
+        EXPECT(loadedCounts == counts);
+
+        eckit::PathName{restartFile("float_" + compressor)}.unlink();
+    }
+}
+
+CASE("Double precision records round-trip bitwise with all compressors") {
+    for (const auto& compressor : compressors()) {
+        auto io = makeIO("double_" + compressor);
+        const auto values = testValues<double>(4097, -1.0);
+        RestartRecord<double>{RECORD, compressor}.dump(io, {&values});
+
+        std::vector<double> loaded(values.size());
+        RestartRecord<double>{RECORD, compressor}.load(io, {&loaded});
+        EXPECT(loaded == values);
+
+        eckit::PathName{restartFile("double_" + compressor)}.unlink();
+    }
+}
+
+CASE("Records written in double precision are loaded into single precision operations") {
+    const std::string compressor = compressors().back();
+    auto io = makeIO("convert");
+    const auto values = testValues<double>(1000, 10.0);
+    RestartRecord<double>{RECORD, compressor}.dump(io, {&values});
+
+    std::vector<float> loaded(values.size());
+    RestartRecord<float>{RECORD, compressor}.load(io, {&loaded});
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT(loaded[i] == static_cast<float>(values[i]));
+    }
+
+    eckit::PathName{restartFile("convert")}.unlink();
+}
+
+CASE("Legacy records written by older versions are loaded") {
+    auto io = makeIO("legacy");
+    const auto values = testValues<double>(1000, 5.0);
+    const auto counts = testValues<double>(1000, 0.0);
+    {
+        // Legacy layout: all arrays widened to double, followed by the checksum
+        IOBuffer record{io->getBuffer(2 * values.size() + 1)};
+        record.zero();
+        std::memcpy(record.data(), values.data(), values.size() * sizeof(double));
+        std::memcpy(record.data() + values.size(), counts.data(), counts.size() * sizeof(double));
+        record.computeChecksum();
+        io->write(RECORD, 2 * values.size() + 1);
+        io->flush();
+    }
+
+    std::vector<float> loadedValues(values.size());
+    std::vector<float> loadedCounts(counts.size());
+    RestartRecord<float>{RECORD, "none"}.load(io, {&loadedValues, &loadedCounts});
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT(loadedValues[i] == static_cast<float>(values[i]));
+        EXPECT(loadedCounts[i] == static_cast<float>(counts[i]));
+    }
+
+    eckit::PathName{restartFile("legacy")}.unlink();
+}
+
+CASE("Corrupted and truncated records are rejected") {
+    auto io = makeIO("corrupt");
+    const auto values = testValues<float>(1000, 1.0);
+    const RestartRecord<float> record{RECORD, "none"};
+    record.dump(io, {&values});
+    const std::string fname = restartFile("corrupt");
+
+    // Flip a byte of the payload
+    {
+        std::FILE* fp = std::fopen(fname.c_str(), "r+");
+        ASSERT(fp);
+        std::fseek(fp, 64, SEEK_SET);
+        const unsigned char byte = 0xFF;
+        std::fwrite(&byte, 1, 1, fp);
+        std::fclose(fp);
+    }
+    std::vector<float> loaded(values.size());
+    EXPECT_THROWS_AS(record.load(io, {&loaded}), eckit::SeriousBug);
+
+    // Cut the record by one word
+    eckit::PathName{fname}.unlink();
+    record.dump(io, {&values});
+    ::truncate(fname.c_str(), static_cast<off_t>(eckit::PathName{fname}.size()) - 8);
+    EXPECT_THROWS_AS(record.load(io, {&loaded}), eckit::SeriousBug);
+
+    eckit::PathName{fname}.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace multio::test
+
+int main(int argc, char** argv) {
+    return eckit::testing::run_tests(argc, argv);
+}